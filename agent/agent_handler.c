@@ -27,6 +27,19 @@
 
 #include <net-snmp/agent/bulk_to_next.h>
 
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_PTHREAD_CREATE) && !defined(WIN32)
+#include <pthread.h>
+/*
+ * agentWorkerThreads update the call statistics from other threads
+ */
+static pthread_mutex_t handler_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+#define HANDLER_STATS_LOCK()    pthread_mutex_lock(&handler_stats_lock)
+#define HANDLER_STATS_UNLOCK()  pthread_mutex_unlock(&handler_stats_lock)
+#else
+#define HANDLER_STATS_LOCK()
+#define HANDLER_STATS_UNLOCK()
+#endif
+
 netsnmp_feature_child_of(agent_handler, libnetsnmpagent);
 
 netsnmp_feature_child_of(handler_mark_requests_as_delegated, agent_handler);
@@ -566,6 +579,59 @@ netsnmp_call_handler(netsnmp_mib_handler *next_handler,
     return ret;
 }
 
+/*
+ * Accounts the time since *start to a registration.  The statistics are
+ * allocated when the registration is registered; handlers may be called
+ * from the worker threads, so they are updated under a lock.
+ */
+static void
+_handler_stats_update(netsnmp_handler_registration *reginfo,
+                      const struct timeval *start)
+{
+    netsnmp_handler_stats *stats = reginfo->stats;
+    struct timeval  now;
+    u_long          usecs, bucket;
+
+    if (stats == NULL)
+        return;
+
+    netsnmp_get_monotonic_clock(&now);
+    usecs = (now.tv_sec - start->tv_sec) * 1000000 +
+        (now.tv_usec - start->tv_usec);
+
+    for (bucket = 0; bucket < NETSNMP_HANDLER_STATS_BUCKETS - 1 &&
+         (usecs >> bucket) != 0; bucket++)
+        ;
+    HANDLER_STATS_LOCK();
+    stats->histogram[bucket]++;
+    stats->calls++;
+    if (usecs > stats->max_usecs)
+        stats->max_usecs = usecs;
+    incrByU32(&stats->usecs, usecs);
+    HANDLER_STATS_UNLOCK();
+}
+
+/** Copies the call statistics of a registration.
+ *
+ *  @param reginfo the registration
+ *  @param stats   receives the statistics; zeroed if there are none
+ *
+ *  @return 1 if the registration keeps statistics, 0 otherwise.
+ */
+int
+netsnmp_handler_stats_get(const netsnmp_handler_registration *reginfo,
+                          netsnmp_handler_stats *stats)
+{
+    if (reginfo == NULL || reginfo->stats == NULL) {
+        memset(stats, 0, sizeof(*stats));
+        return 0;
+    }
+    HANDLER_STATS_LOCK();
+    *stats = *reginfo->stats;
+    HANDLER_STATS_UNLOCK();
+    return 1;
+}
+
 /** @private
  *  Calls all the MIB Handlers in registration struct for a given mode.
  *
@@ -577,6 +643,7 @@ netsnmp_call_handlers(netsnmp_handler_registration *reginfo,
                       netsnmp_request_info *requests)
 {
     netsnmp_request_info *request;
+    struct timeval  start;
     int             status;
 
     if (reginfo == NULL || reqinfo == NULL || requests == NULL) {
@@ -628,7 +695,9 @@ netsnmp_call_handlers(netsnmp_handler_registration *reginfo,
         request->processed = 0;
     }
 
+    netsnmp_get_monotonic_clock(&start);
     status = netsnmp_call_handler(reginfo->handler, reginfo, reqinfo, requests);
+    _handler_stats_update(reginfo, &start);
 
     return status;
 }
@@ -787,6 +856,7 @@ netsnmp_handler_registration_free(netsnmp_handler_registration *reginfo)
         SNMP_FREE(reginfo->contextName);
         SNMP_FREE(reginfo->rootoid);
         reginfo->rootoid_len = 0;
+        SNMP_FREE(reginfo->stats);
         SNMP_FREE(reginfo);
     }
 }
@@ -844,6 +914,12 @@ netsnmp_handler_registration_dup(netsnmp_handler_registration *reginfo)
                reginfo->rootoid_len * sizeof(oid));
     }
 
+    if (reginfo->stats != NULL) {
+        r->stats = SNMP_MALLOC_TYPEDEF(netsnmp_handler_stats);
+        if (r->stats == NULL)
+            goto err;
+    }
+
     r->handler = netsnmp_handler_dup(reginfo->handler);
     if (r->handler == NULL)
         goto err;
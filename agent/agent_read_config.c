@@ -105,6 +105,7 @@
 #include <net-snmp/agent/agent_trap.h>
 #include "snmpd.h"
 #include <net-snmp/agent/agent_callbacks.h>
+#include <net-snmp/agent/agent_workers.h>
 #include <net-snmp/agent/table.h>
 #include <net-snmp/agent/table_iterator.h>
 #include <net-snmp/agent/table_data.h>
@@ -270,6 +271,9 @@ init_agent_read_config(const char *app)
     register_app_config_handler("agentaddress",
                                 snmpd_set_agent_address, NULL,
                                 "SNMP bind address");
+    netsnmp_ds_register_config(ASN_INTEGER, app, "agentaddressSockets",
+                               NETSNMP_DS_APPLICATION_ID,
+                               NETSNMP_DS_AGENT_UDP_SOCKETS);
 #endif /* NETSNMP_NO_LISTEN_SUPPORT */
     netsnmp_ds_register_config(ASN_BOOLEAN, app, "quit", 
 			       NETSNMP_DS_APPLICATION_ID,
@@ -297,8 +301,12 @@ init_agent_read_config(const char *app)
                                NETSNMP_DS_APPLICATION_ID,
                                NETSNMP_DS_AGENT_PDU_STATS_THRESHOLD);
 #endif /* NETSNMP_NO_PDU_STATS */
+    netsnmp_ds_register_config(ASN_INTEGER, app, "agentWorkerThreads",
+                               NETSNMP_DS_APPLICATION_ID,
+                               NETSNMP_DS_AGENT_WORKER_THREADS);
 
     netsnmp_init_handler_conf();
+    netsnmp_init_cache_conf();
 
 #include "agent_module_dot_conf.h"
 #include "mib_module_dot_conf.h"
@@ -310,6 +318,7 @@ init_agent_read_config(const char *app)
 void
 update_config(void)
 {
+    netsnmp_agent_workers_sync();
     snmp_call_callbacks(SNMP_CALLBACK_APPLICATION,
                         SNMPD_CALLBACK_PRE_UPDATE_CONFIG, NULL);
     free_config();
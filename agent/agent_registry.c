@@ -67,6 +67,7 @@
 #include <net-snmp/agent/table_iterator.h>
 #include <net-snmp/agent/agent_index.h>
 #include <net-snmp/agent/agent_registry.h>
+#include <net-snmp/agent/agent_workers.h>
 
 #ifdef USING_AGENTX_SUBAGENT_MODULE
 #include "agentx/subagent.h"
@@ -281,6 +282,259 @@ clear_lookup_cache(void) {
 /**  @} */
 /* End of Lookup cache code */
 
+/** @defgroup agent_subtree_index Subtree index, an OID trie of the registered subtrees.
+ *     Maintain a per-context index of the start OIDs of the subtrees in the
+ *     context's subtree list, so that locating the subtree responsible for
+ *     an OID costs a walk down the OID rather than a walk along the list.
+ *   @ingroup agent_registry
+ *
+ * @{
+ */
+
+/*
+ * One node per sub-identifier.  A node refers to the list element that
+ * starts at the OID spelled by the path from the root to that node, if
+ * any.  Nodes that neither refer to a subtree nor have children are
+ * pruned, so every leaf refers to a subtree.
+ */
+typedef struct subtree_index_node_s {
+    oid                          subid;
+    netsnmp_subtree             *subtree;
+    struct subtree_index_node_s **children;     /* sorted by subid */
+    size_t                       children_len;
+    size_t                       children_max;
+} subtree_index_node;
+
+/** @private
+ *  Frees an index node and everything below it.
+ */
+static void
+subtree_index_free(subtree_index_node *node)
+{
+    size_t i;
+
+    if (node == NULL)
+        return;
+    for (i = 0; i < node->children_len; i++)
+        subtree_index_free(node->children[i]);
+    free(node->children);
+    free(node);
+}
+
+/** @private
+ *  Binary search of the children of an index node.
+ *
+ *  @return position of the first child whose sub-identifier is not less
+ *          than subid.
+ */
+NETSNMP_STATIC_INLINE size_t
+subtree_index_child_pos(const subtree_index_node *node, oid subid)
+{
+    size_t lo = 0, hi = node->children_len, mid;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (node->children[mid]->subid < subid)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/** @private
+ *  Makes the index refer to subtree at the given OID.
+ *
+ *  @return SNMPERR_SUCCESS, or an error code if the index could not be
+ *          extended; the index should then be discarded.
+ */
+static int
+subtree_index_add(subtree_index_node *root, const oid *name, size_t len,
+                  netsnmp_subtree *subtree)
+{
+    subtree_index_node *node = root, *child, **children;
+    size_t i, pos, newmax;
+
+    if (len > MAX_OID_LEN)
+        return SNMPERR_GENERR;
+
+    for (i = 0; i < len; i++) {
+        pos = subtree_index_child_pos(node, name[i]);
+        if (pos < node->children_len &&
+            node->children[pos]->subid == name[i]) {
+            node = node->children[pos];
+            continue;
+        }
+        if (node->children_len == node->children_max) {
+            newmax = node->children_max ? 2 * node->children_max : 4;
+            children = (subtree_index_node **)
+                realloc(node->children, newmax * sizeof(*children));
+            if (children == NULL)
+                return SNMPERR_MALLOC;
+            node->children = children;
+            node->children_max = newmax;
+        }
+        child = SNMP_MALLOC_TYPEDEF(subtree_index_node);
+        if (child == NULL)
+            return SNMPERR_MALLOC;
+        child->subid = name[i];
+        memmove(&node->children[pos + 1], &node->children[pos],
+                (node->children_len - pos) * sizeof(*node->children));
+        node->children[pos] = child;
+        node->children_len++;
+        node = child;
+    }
+    node->subtree = subtree;
+    return SNMPERR_SUCCESS;
+}
+
+/** @private
+ *  Removes the reference to subtree at the given OID from the index and
+ *  prunes the nodes that no longer lead anywhere.  Nothing is removed if
+ *  the index refers to a different subtree at that OID.
+ */
+static void
+subtree_index_remove(subtree_index_node *root, const oid *name, size_t len,
+                     const netsnmp_subtree *subtree)
+{
+    subtree_index_node *path[MAX_OID_LEN + 1];
+    size_t              pos[MAX_OID_LEN];
+    subtree_index_node *node = root, *parent;
+    size_t              i;
+
+    if (len > MAX_OID_LEN)
+        return;
+
+    path[0] = root;
+    for (i = 0; i < len; i++) {
+        pos[i] = subtree_index_child_pos(node, name[i]);
+        if (pos[i] >= node->children_len ||
+            node->children[pos[i]]->subid != name[i])
+            return;
+        node = path[i + 1] = node->children[pos[i]];
+    }
+    if (node->subtree != subtree)
+        return;
+    node->subtree = NULL;
+
+    for (i = len; i > 0; i--) {
+        node = path[i];
+        if (node->subtree != NULL || node->children_len > 0)
+            break;
+        parent = path[i - 1];
+        parent->children_len--;
+        memmove(&parent->children[pos[i - 1]],
+                &parent->children[pos[i - 1] + 1],
+                (parent->children_len - pos[i - 1]) *
+                sizeof(*parent->children));
+        subtree_index_free(node);
+    }
+}
+
+/** @private
+ *  Looks up the subtree with the greatest start OID that precedes the
+ *  given OID.
+ *
+ *  @param inclusive If nonzero, a subtree starting exactly at name
+ *                   is accepted as well.
+ *
+ *  @return the subtree found, or NULL if all subtrees start after name.
+ */
+static netsnmp_subtree *
+subtree_index_find_prev(const subtree_index_node *root, const oid *name,
+                        size_t len, int inclusive)
+{
+    const subtree_index_node *node = root, *left;
+    netsnmp_subtree *prev = NULL;
+    size_t i, pos;
+
+    for (i = 0; i < len; i++) {
+        /*
+         * Whatever starts at this prefix, or below a smaller sibling of
+         * the next sub-identifier, precedes name.  The right-most leaf
+         * below that sibling is the greatest of those.
+         */
+        if (node->subtree)
+            prev = node->subtree;
+        pos = subtree_index_child_pos(node, name[i]);
+        if (pos > 0) {
+            for (left = node->children[pos - 1]; left->children_len > 0;
+                 left = left->children[left->children_len - 1])
+                ;
+            prev = left->subtree;
+        }
+        if (pos >= node->children_len ||
+            node->children[pos]->subid != name[i])
+            return prev;
+        node = node->children[pos];
+    }
+    if (inclusive && node->subtree)
+        prev = node->subtree;
+    return prev;
+}
+
+/** @private
+ *  Discards the index of a context.  Lookups in that context fall back
+ *  to walking the subtree list until the index is rebuilt.
+ */
+static void
+subtree_index_drop(subtree_context_cache *ptr)
+{
+    DEBUGMSGTL(("subtree", "dropping subtree index for context: \"%s\"\n",
+                ptr->context_name));
+    subtree_index_free(ptr->index);
+    ptr->index = NULL;
+}
+
+/** @private
+ *  Rebuilds the index of a context from its subtree list.
+ */
+static void
+subtree_index_rebuild(subtree_context_cache *ptr)
+{
+    netsnmp_subtree *s;
+
+    subtree_index_free(ptr->index);
+    ptr->index = SNMP_MALLOC_TYPEDEF(subtree_index_node);
+    for (s = ptr->first_subtree; s != NULL && ptr->index != NULL; s = s->next)
+        if (subtree_index_add(ptr->index, s->start_a, s->start_len, s) !=
+            SNMPERR_SUCCESS)
+            subtree_index_drop(ptr);
+}
+
+/** @private
+ *  Brings the index of a context up to date after the part of its
+ *  subtree list from start to end (inclusive) has been modified.
+ *  Only the list elements in that part are visited.
+ */
+static void
+subtree_index_update(subtree_context_cache *ptr,
+                     const oid *start, size_t start_len,
+                     const oid *end, size_t end_len)
+{
+    netsnmp_subtree *s;
+
+    if (ptr->index == NULL)
+        return;
+
+    s = subtree_index_find_prev(ptr->index, start, start_len, 0);
+    s = s ? s->next : ptr->first_subtree;
+    for (; s != NULL &&
+             snmp_oid_compare(s->start_a, s->start_len, end, end_len) <= 0;
+         s = s->next) {
+        if (snmp_oid_compare(s->start_a, s->start_len, start, start_len) < 0)
+            continue;
+        if (subtree_index_add(ptr->index, s->start_a, s->start_len, s) !=
+            SNMPERR_SUCCESS) {
+            subtree_index_drop(ptr);
+            return;
+        }
+    }
+}
+
+/**  @} */
+/* End of Subtree index code */
+
 /** @defgroup agent_context_cache Context cache, storing the OIDs under their contexts.
  *     Maintain the cache used for locating sub-trees registered under different contexts.
  *   @ingroup agent_registry
@@ -301,6 +555,31 @@ get_top_context_cache(void)
     return context_subtrees;
 }
 
+/** @private
+ *  Finds the Context Cache element of given context name.
+ *
+ *  @param context_name Text name of the context we're searching for.
+ *
+ *  @return pointer to the context cache element, or NULL if not found.
+ */
+static subtree_context_cache *
+subtree_context_find(const char *context_name)
+{
+    subtree_context_cache *ptr;
+
+    if (!context_name) {
+        context_name = "";
+    }
+
+    for (ptr = context_subtrees; ptr != NULL; ptr = ptr->next) {
+        if (ptr->context_name != NULL && 
+	    strcmp(ptr->context_name, context_name) == 0) {
+            return ptr;
+        }
+    }
+    return NULL;
+}
+
 /** Finds the first subtree registered under given context.
  *
  *  @param context_name Text name of the context we're searching for.
@@ -318,12 +597,10 @@ netsnmp_subtree_find_first(const char *context_name)
 
     DEBUGMSGTL(("subtree", "looking for subtree for context: \"%s\"\n", 
 		context_name));
-    for (ptr = context_subtrees; ptr != NULL; ptr = ptr->next) {
-        if (ptr->context_name != NULL && 
-	    strcmp(ptr->context_name, context_name) == 0) {
-            DEBUGMSGTL(("subtree", "found one for: \"%s\"\n", context_name));
-            return ptr->first_subtree;
-        }
+    ptr = subtree_context_find(context_name);
+    if (ptr != NULL) {
+        DEBUGMSGTL(("subtree", "found one for: \"%s\"\n", context_name));
+        return ptr->first_subtree;
     }
     DEBUGMSGTL(("subtree", "didn't find a subtree for context: \"%s\"\n", 
 		context_name));
@@ -357,6 +634,7 @@ add_subtree(netsnmp_subtree *new_tree, const char *context_name)
     ptr->next = context_subtrees;
     ptr->first_subtree = new_tree;
     ptr->context_name = strdup(context_name);
+    ptr->index = SNMP_MALLOC_TYPEDEF(subtree_index_node);
     context_subtrees = ptr;
 
     return ptr->first_subtree;
@@ -367,6 +645,11 @@ netsnmp_remove_subtree(netsnmp_subtree *tree)
 {
     subtree_context_cache *ptr;
 
+    ptr = subtree_context_find(tree->reginfo ? tree->reginfo->contextName
+                                             : NULL);
+    if (ptr && ptr->index)
+        subtree_index_remove(ptr->index, tree->start_a, tree->start_len, tree);
+
     if (!tree->prev) {
         for (ptr = context_subtrees; ptr; ptr = ptr->next)
             if (ptr->first_subtree == tree)
@@ -433,6 +716,7 @@ clear_context(void) {
 	    clear_subtree(t);
 	}
 
+        subtree_index_free(ptr->index);
         free(NETSNMP_REMOVE_CONST(char*, ptr->context_name));
         SNMP_FREE(ptr);
 
@@ -453,6 +737,7 @@ clear_context(void) {
  */
 
 static void register_mib_detach_node(netsnmp_subtree *s);
+int netsnmp_subtree_load(netsnmp_subtree *new_sub, const char *context_name);
 
 /** Frees single subtree item.
  *  Deallocated memory for given netsnmp_subtree item, including
@@ -466,6 +751,7 @@ void
 netsnmp_subtree_free(netsnmp_subtree *a)
 {
   if (a != NULL) {
+    netsnmp_agent_workers_sync();
     if (a->variables != NULL && netsnmp_oid_equals(a->name_a, a->namelen, 
 					     a->start_a, a->start_len) == 0) {
       SNMP_FREE(a->variables);
@@ -746,24 +1032,16 @@ netsnmp_subtree_split(netsnmp_subtree *current, oid name[], int name_len)
     return new_sub;
 }
 
-/** Loads the subtree under given context name.
- *
- *  @param new_sub The subtree to be loaded into current subtree.
- *
- *  @param context_name Text name of the context we're searching for.
- *
- *  @return gives MIB_REGISTERED_OK on success, error code otherwise.
+/** @private
+ *  Links the subtree into the subtree list of given context name,
+ *  splitting it and the existing subtrees where they overlap.
  */
-int
-netsnmp_subtree_load(netsnmp_subtree *new_sub, const char *context_name)
+static int
+subtree_load(netsnmp_subtree *new_sub, const char *context_name)
 {
     netsnmp_subtree *tree1, *tree2;
     netsnmp_subtree *prev, *next;
 
-    if (new_sub == NULL) {
-        return MIB_REGISTERED_OK;       /* Degenerate case */
-    }
-
     if (!netsnmp_subtree_find_first(context_name)) {
         static int inloop = 0;
         if (!inloop) {
@@ -951,6 +1229,50 @@ netsnmp_subtree_load(netsnmp_subtree *new_sub, const char *context_name)
     return 0;
 }
 
+/** Loads the subtree under given context name.
+ *
+ *  @param new_sub The subtree to be loaded into current subtree.
+ *
+ *  @param context_name Text name of the context we're searching for.
+ *
+ *  @return gives MIB_REGISTERED_OK on success, error code otherwise.
+ */
+int
+netsnmp_subtree_load(netsnmp_subtree *new_sub, const char *context_name)
+{
+    subtree_context_cache *ptr;
+    oid             start[MAX_OID_LEN], end[MAX_OID_LEN];
+    size_t          start_len, end_len;
+    int             res;
+
+    if (new_sub == NULL) {
+        return MIB_REGISTERED_OK;       /* Degenerate case */
+    }
+
+    /*
+     * Loading only splits and relinks subtrees between the start and the
+     * end of the new one, so that is all the index has to catch up with.
+     * Remember the bounds now: splitting new_sub moves its end.
+     */
+    start_len = new_sub->start_len;
+    end_len = new_sub->end_len;
+    if (start_len <= MAX_OID_LEN && end_len <= MAX_OID_LEN) {
+        memcpy(start, new_sub->start_a, start_len * sizeof(oid));
+        memcpy(end, new_sub->end_a, end_len * sizeof(oid));
+    }
+
+    res = subtree_load(new_sub, context_name);
+
+    if (res == MIB_REGISTERED_OK &&
+        (ptr = subtree_context_find(context_name)) != NULL) {
+        if (start_len <= MAX_OID_LEN && end_len <= MAX_OID_LEN)
+            subtree_index_update(ptr, start, start_len, end, end_len);
+        else
+            subtree_index_rebuild(ptr);
+    }
+    return res;
+}
+
 /** Free the given subtree and all its children.
  *
  *  @param sub Subtree branch to be cleared and freed.
@@ -978,10 +1300,17 @@ netsnmp_subtree_find_prev(const oid *name, size_t len, netsnmp_subtree *subtree,
 			  const char *context_name)
 {
     lookup_cache *lookup_cache = NULL;
+    subtree_context_cache *ptr;
     netsnmp_subtree *myptr = NULL, *previous = NULL;
     int cmp = 1;
     size_t ll_off = 0;
 
+    /* a search over the whole context can use its index */
+    ptr = subtree_context_find(context_name);
+    if (ptr && ptr->index && (!subtree || subtree == ptr->first_subtree)) {
+        return subtree_index_find_prev(ptr->index, name, len, 1);
+    }
+
     if (subtree) {
         myptr = subtree;
     } else {
@@ -1174,6 +1503,13 @@ netsnmp_register_mib(const char *moduleName,
         netsnmp_assert(!"register context == reginfo->contextName"); /* always false */
     }
 
+    /*
+     * allocated here rather than on the first call, which may happen on
+     * a worker thread
+     */
+    if (reginfo->stats == NULL)
+        reginfo->stats = SNMP_MALLOC_TYPEDEF(netsnmp_handler_stats);
+
     /*  Create the new subtree node being registered.  */
 
     subtree->reginfo = reginfo;
@@ -1600,7 +1936,8 @@ register_mib(const char *moduleName,
 void
 netsnmp_subtree_unload(netsnmp_subtree *sub, netsnmp_subtree *prev, const char *context)
 {
-    netsnmp_subtree *ptr;
+    subtree_context_cache *ptr;
+    netsnmp_subtree *c;
 
     DEBUGMSGTL(("register_mib", "unload("));
     if (sub != NULL) {
@@ -1627,11 +1964,11 @@ netsnmp_subtree_unload(netsnmp_subtree *sub, netsnmp_subtree *prev, const char *
      */
 
     if (sub->children == NULL) {        /* just remove this node completely */
-        for (ptr = sub->prev; ptr; ptr = ptr->children) {
-            netsnmp_subtree_change_next(ptr, sub->next);
+        for (c = sub->prev; c; c = c->children) {
+            netsnmp_subtree_change_next(c, sub->next);
         }
-        for (ptr = sub->next; ptr; ptr = ptr->children) {
-            netsnmp_subtree_change_prev(ptr, sub->prev);
+        for (c = sub->next; c; c = c->children) {
+            netsnmp_subtree_change_prev(c, sub->prev);
         }
 
 	if (sub->prev == NULL) {
@@ -1639,15 +1976,25 @@ netsnmp_subtree_unload(netsnmp_subtree *sub, netsnmp_subtree *prev, const char *
 	}
 
     } else {
-        for (ptr = sub->prev; ptr; ptr = ptr->children)
-            netsnmp_subtree_change_next(ptr, sub->children);
-        for (ptr = sub->next; ptr; ptr = ptr->children)
-            netsnmp_subtree_change_prev(ptr, sub->children);
+        for (c = sub->prev; c; c = c->children)
+            netsnmp_subtree_change_next(c, sub->children);
+        for (c = sub->next; c; c = c->children)
+            netsnmp_subtree_change_prev(c, sub->children);
 
 	if (sub->prev == NULL) {
 	    netsnmp_subtree_replace_first(sub->children, context);
 	}
     }
+
+    ptr = subtree_context_find(context);
+    if (ptr && ptr->index) {
+        if (sub->children == NULL) {
+            subtree_index_remove(ptr->index, sub->start_a, sub->start_len, sub);
+        } else if (subtree_index_add(ptr->index, sub->start_a, sub->start_len,
+                                     sub->children) != SNMPERR_SUCCESS) {
+            subtree_index_drop(ptr);
+        }
+    }
     invalidate_lookup_cache(context);
 }
 
@@ -2014,6 +2361,7 @@ unregister_mibs_by_session(netsnmp_session * ss)
             }
         }
         netsnmp_subtree_join(contextptr->first_subtree);
+        subtree_index_rebuild(contextptr);
     }
 }
 
@@ -2329,6 +2677,59 @@ dump_registry(void)
     dump_idx_registry();
 }
 
+/** Logs the call statistics of every registration that has been called,
+ *  under the debug token "stats:handler".
+ */
+void
+netsnmp_dump_handler_stats(void)
+{
+    subtree_context_cache *ptr;
+    netsnmp_subtree *myptr, *myptr2;
+    netsnmp_handler_registration *last = NULL;
+    netsnmp_handler_stats stats;
+    char            buf[32];
+    int             i;
+
+    DEBUGIF("stats:handler") {
+        for (ptr = context_subtrees; ptr; ptr = ptr->next) {
+            for (myptr = ptr->first_subtree; myptr != NULL;
+                 myptr = myptr->next) {
+                for (myptr2 = myptr; myptr2 != NULL;
+                     myptr2 = myptr2->children) {
+                    if (myptr2->reginfo == NULL || myptr2->reginfo == last ||
+                        !netsnmp_handler_stats_get(myptr2->reginfo, &stats) ||
+                        stats.calls == 0)
+                        continue;
+                    last = myptr2->reginfo;
+
+                    printU64(buf, &stats.usecs);
+                    DEBUGMSGT_NC(("stats:handler", "%s ",
+                                  last->handlerName ? last->handlerName :
+                                  "no-name"));
+                    DEBUGMSGOID(("stats:handler", last->rootoid,
+                                 last->rootoid_len));
+                    DEBUGMSG_NC(("stats:handler",
+                                 " context \"%s\": %lu calls, %s us, max %lu us\n",
+                                 ptr->context_name, stats.calls, buf,
+                                 stats.max_usecs));
+                    for (i = 0; i < NETSNMP_HANDLER_STATS_BUCKETS; i++) {
+                        if (stats.histogram[i] == 0)
+                            continue;
+                        if (i < NETSNMP_HANDLER_STATS_BUCKETS - 1)
+                            DEBUGMSGT_NC(("stats:handler",
+                                          "    < %lu us: %lu\n",
+                                          1UL << i, stats.histogram[i]));
+                        else
+                            DEBUGMSGT_NC(("stats:handler",
+                                          "    >= %lu us: %lu\n",
+                                          1UL << (i - 1), stats.histogram[i]));
+                    }
+                }
+            }
+        }
+    }
+}
+
 /**  @} */
 /* End of MIB registration code */
 
@@ -0,0 +1,610 @@
+/*
+ * agent_workers.c
+ */
+/** @defgroup agent_workers Worker threads for read requests
+ *  @ingroup agent
+ *
+ * When the agentWorkerThreads token is set, GET, GETNEXT and GETBULK
+ * requests for registrations whose whole handler chain is flagged
+ * MIB_HANDLER_THREAD_SAFE are handed to a pool of worker threads instead
+ * of being answered by the main loop.  The reqinfo such handlers see has
+ * no agent session (reqinfo->asp is NULL).
+ *
+ * A job carries private copies of the requests and of their varbinds;
+ * the original requests are marked as delegated until the main thread
+ * copies the results back, so the rest of the agent (GETNEXT walking,
+ * GETBULK repetitions, queueing of SET requests until no delegated
+ * requests are left) needs no changes.  Workers never run two jobs for
+ * the same registration at once, which keeps helpers that temporarily
+ * modify their registration (e.g. the scalar helper) safe.
+ *
+ * The table, table_container, scalar and instance helpers are thread
+ * safe, but few modules are: sysUpTime and sysORTable opt in.  A module
+ * that does must call netsnmp_agent_workers_sync() before changing the
+ * data its handler reads.
+ *
+ * @{
+ */
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-features.h>
+
+#include <sys/types.h>
+#if HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#if HAVE_STRING_H
+#include <string.h>
+#else
+#include <strings.h>
+#endif
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#if HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#include <errno.h>
+#include <signal.h>
+
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_PTHREAD_CREATE) && !defined(WIN32)
+#include <pthread.h>
+#define NETSNMP_AGENT_WORKERS 1
+#endif
+
+#include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/agent/net-snmp-agent-includes.h>
+#include <net-snmp/agent/agent_workers.h>
+
+#ifdef NETSNMP_AGENT_WORKERS
+
+#define AGENT_WORKERS_MAX 64
+
+typedef struct agent_worker_job_s {
+    struct agent_worker_job_s *next;
+    netsnmp_agent_session *asp;         /* main thread only; NULL once the
+                                         * session is gone */
+    netsnmp_handler_registration *reginfo;
+    char           *name;               /* the registration's, which may be
+                                         * gone by the time the job is
+                                         * collected */
+    netsnmp_agent_request_info reqinfo; /* private to the job */
+    int             mode;
+    netsnmp_request_info *orig;         /* the delegated requests */
+    netsnmp_request_info *requests;     /* their copies */
+    netsnmp_variable_list *vars;        /* copies of the varbinds */
+    int             nrequests;
+    int             nvars;
+    int             status;
+} agent_worker_job;
+
+/*
+ * Everything below the lock is shared with the worker threads.  The
+ * counters above it are only touched by the main thread.
+ */
+static int      workers_started;
+static int      workers_failed;
+static int      workers_outstanding;
+
+static pthread_mutex_t workers_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t workers_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t workers_idle = PTHREAD_COND_INITIALIZER;
+static pthread_t *workers;
+static agent_worker_job **workers_running;
+static int      workers_size;
+static int      workers_stop;
+static agent_worker_job *queue_head, *queue_tail;
+static agent_worker_job *done_head, *done_tail;
+static int      wake_fd[2] = { -1, -1 };
+
+/*
+ * number of varbinds a handler may use for this request: GETBULK
+ * handlers walk along the repetitions, everybody else uses one.
+ */
+static int
+_request_nvars(netsnmp_request_info *request, int mode)
+{
+    netsnmp_variable_list *var = request->requestvb;
+    int             n = 1;
+
+    if (mode == MODE_GETBULK)
+        for (; n <= request->repeat && var->next_variable; n++)
+            var = var->next_variable;
+    return n;
+}
+
+static void
+_job_free(agent_worker_job *job)
+{
+    int             i;
+
+    if (job->requests)
+        for (i = 0; i < job->nrequests; i++)
+            netsnmp_free_request_data_sets(&job->requests[i]);
+    if (job->vars)
+        for (i = 0; i < job->nvars; i++)
+            snmp_free_var_internals(&job->vars[i]);
+    netsnmp_free_agent_data_sets(&job->reqinfo);
+    free(job->name);
+    free(job->requests);
+    free(job->vars);
+    free(job);
+}
+
+/* call with workers_lock held */
+static int
+_reginfo_busy(netsnmp_handler_registration *reginfo)
+{
+    int             i;
+
+    for (i = 0; i < workers_size; i++)
+        if (workers_running[i] && workers_running[i]->reginfo == reginfo)
+            return 1;
+    return 0;
+}
+
+/* call with workers_lock held */
+static int
+_asp_busy(netsnmp_agent_session *asp)
+{
+    int             i;
+
+    for (i = 0; i < workers_size; i++)
+        if (workers_running[i] &&
+            (asp == NULL || workers_running[i]->asp == asp))
+            return 1;
+    return 0;
+}
+
+static void    *
+_worker_main(void *arg)
+{
+    int             me = (int)(intptr_t)arg;
+    agent_worker_job *job, *prev;
+    char            c = 0;
+
+    pthread_mutex_lock(&workers_lock);
+    while (!workers_stop) {
+        for (prev = NULL, job = queue_head; job; prev = job, job = job->next)
+            if (!_reginfo_busy(job->reginfo))
+                break;
+        if (job == NULL) {
+            pthread_cond_wait(&workers_work, &workers_lock);
+            continue;
+        }
+        if (prev)
+            prev->next = job->next;
+        else
+            queue_head = job->next;
+        if (queue_tail == job)
+            queue_tail = prev;
+        job->next = NULL;
+        workers_running[me] = job;
+        pthread_mutex_unlock(&workers_lock);
+
+        job->status = netsnmp_call_handlers(job->reginfo, &job->reqinfo,
+                                            job->requests);
+
+        pthread_mutex_lock(&workers_lock);
+        workers_running[me] = NULL;
+        if (done_tail)
+            done_tail->next = job;
+        else
+            done_head = job;
+        done_tail = job;
+        pthread_cond_broadcast(&workers_idle);
+        if (queue_head)
+            pthread_cond_broadcast(&workers_work);
+        /*
+         * a full pipe already has a wakeup pending
+         */
+        while (write(wake_fd[1], &c, 1) < 0 && errno == EINTR)
+            ;
+    }
+    pthread_mutex_unlock(&workers_lock);
+    return NULL;
+}
+
+/*
+ * copy the results of a finished job back into the delegated requests
+ */
+static void
+_job_finish(agent_worker_job *job)
+{
+    netsnmp_request_info *request, *copy = job->requests;
+    netsnmp_variable_list *var, *vcopy = job->vars, *cv;
+    int             j, n, error = 0;
+
+    for (request = job->orig; request; request = request->next, copy++) {
+        netsnmp_variable_list *last = request->requestvb;
+
+        n = _request_nvars(request, job->mode);
+        for (var = request->requestvb, j = 0; j < n;
+             var = var->next_variable, j++) {
+            cv = &vcopy[j];
+            snmp_set_var_objid(var, cv->name, cv->name_length);
+            snmp_set_var_typed_value(var, cv->type, cv->val.string,
+                                     cv->val_len);
+            if (copy->requestvb == cv)
+                last = var;
+        }
+        vcopy += n;
+
+        request->requestvb = last;
+        request->status = copy->status;
+        request->repeat = copy->repeat;
+        request->inclusive = copy->inclusive;
+        request->delegated = 0;
+        if (request->status != SNMP_ERR_NOERROR)
+            error = 1;
+    }
+
+    /*
+     * the handler failed without saying which request was at fault
+     */
+    if (job->status != SNMP_ERR_NOERROR && !error && job->orig)
+        job->orig->status = job->status;
+}
+
+static void
+_workers_collect(int fd, void *data)
+{
+    agent_worker_job *job, *next;
+    char            buf[64];
+
+    while (read(fd, buf, sizeof(buf)) > 0)
+        ;
+
+    pthread_mutex_lock(&workers_lock);
+    job = done_head;
+    done_head = done_tail = NULL;
+    pthread_mutex_unlock(&workers_lock);
+
+    if (job == NULL)
+        return;
+
+    for (; job; job = next) {
+        next = job->next;
+        DEBUGMSGTL(("agent_workers", "job %p for %s done, status %d\n",
+                    job, job->name, job->status));
+        if (job->asp)
+            _job_finish(job);
+        _job_free(job);
+        workers_outstanding--;
+    }
+
+    netsnmp_check_outstanding_agent_requests();
+}
+
+static int
+_workers_start(void)
+{
+    sigset_t        all, old;
+    int             n, i, rc = 0;
+
+    n = netsnmp_ds_get_int(NETSNMP_DS_APPLICATION_ID,
+                           NETSNMP_DS_AGENT_WORKER_THREADS);
+    if (n > AGENT_WORKERS_MAX) {
+        snmp_log(LOG_WARNING, "agentWorkerThreads: using %d threads\n",
+                 AGENT_WORKERS_MAX);
+        n = AGENT_WORKERS_MAX;
+    }
+
+    workers = (pthread_t *) calloc(n, sizeof(pthread_t));
+    workers_running = (agent_worker_job **) calloc(n, sizeof(agent_worker_job *));
+    if (!workers || !workers_running || pipe(wake_fd) < 0) {
+        snmp_log_perror("agentWorkerThreads");
+        goto fail;
+    }
+    fcntl(wake_fd[0], F_SETFL, fcntl(wake_fd[0], F_GETFL) | O_NONBLOCK);
+    fcntl(wake_fd[1], F_SETFL, fcntl(wake_fd[1], F_GETFL) | O_NONBLOCK);
+    workers_size = n;
+
+    /*
+     * signals are for the main thread only
+     */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    for (i = 0; i < n; i++) {
+        rc = pthread_create(&workers[i], NULL, _worker_main,
+                            (void *)(intptr_t)i);
+        if (rc != 0)
+            break;
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if (i == 0) {
+        snmp_log(LOG_ERR, "agentWorkerThreads: cannot create threads: %s\n",
+                 strerror(rc));
+        goto fail;
+    }
+    if (i < n)
+        snmp_log(LOG_WARNING,
+                 "agentWorkerThreads: only %d of %d threads started: %s\n",
+                 i, n, strerror(rc));
+    workers_started = i;
+    register_readfd(wake_fd[0], _workers_collect, NULL);
+
+    DEBUGMSGTL(("agent_workers", "started %d worker threads\n", i));
+    return 1;
+
+  fail:
+    if (wake_fd[0] >= 0) {
+        close(wake_fd[0]);
+        close(wake_fd[1]);
+        wake_fd[0] = wake_fd[1] = -1;
+    }
+    SNMP_FREE(workers);
+    SNMP_FREE(workers_running);
+    workers_size = 0;
+    workers_failed = 1;
+    return 0;
+}
+
+/**
+ * Decide whether a request for a registration should be handed to the
+ * worker threads, starting them on first use.
+ *
+ * Only read requests qualify, and only when every handler in the chain
+ * is flagged MIB_HANDLER_THREAD_SAFE.
+ *
+ * @return 1 if netsnmp_agent_workers_dispatch() should be used.
+ */
+int
+netsnmp_agent_workers_eligible(netsnmp_handler_registration *reginfo,
+                               netsnmp_agent_request_info *reqinfo)
+{
+    netsnmp_mib_handler *handler;
+
+    if (!workers_started &&
+        (workers_failed ||
+         netsnmp_ds_get_int(NETSNMP_DS_APPLICATION_ID,
+                            NETSNMP_DS_AGENT_WORKER_THREADS) <= 0))
+        return 0;
+
+    switch (reqinfo->mode) {
+    case MODE_GET:
+    case MODE_GETNEXT:
+    case MODE_GETBULK:
+        break;
+    default:
+        return 0;
+    }
+
+    if (!(reginfo->modes & HANDLER_CAN_GETANDGETNEXT) ||
+        reginfo->handler == NULL)
+        return 0;
+    for (handler = reginfo->handler; handler; handler = handler->next)
+        if (!(handler->flags & MIB_HANDLER_THREAD_SAFE))
+            return 0;
+
+    if (!workers_started && !_workers_start())
+        return 0;
+    return 1;
+}
+
+/**
+ * Queue a list of requests for the worker threads.  The requests are
+ * marked delegated and completed from the main loop once a worker has
+ * called the handlers.
+ *
+ * @return SNMP_ERR_NOERROR, or SNMP_ERR_GENERR if the job could not be
+ *         set up.
+ */
+int
+netsnmp_agent_workers_dispatch(netsnmp_handler_registration *reginfo,
+                               netsnmp_agent_request_info *reqinfo,
+                               netsnmp_request_info *requests)
+{
+    agent_worker_job *job;
+    netsnmp_request_info *request, *copy;
+    netsnmp_variable_list *var, *vcopy;
+    int             j, n;
+
+    job = SNMP_MALLOC_TYPEDEF(agent_worker_job);
+    if (job == NULL)
+        return SNMP_ERR_GENERR;
+
+    for (request = requests; request; request = request->next) {
+        job->nrequests++;
+        job->nvars += _request_nvars(request, reqinfo->mode);
+    }
+    job->requests = (netsnmp_request_info *)
+        calloc(job->nrequests, sizeof(netsnmp_request_info));
+    job->vars = (netsnmp_variable_list *)
+        calloc(job->nvars, sizeof(netsnmp_variable_list));
+    if (!job->requests || !job->vars)
+        goto fail;
+
+    job->asp = reqinfo->asp;
+    job->reginfo = reginfo;
+    job->name = strdup(reginfo->handlerName ? reginfo->handlerName : "");
+    if (job->name == NULL)
+        goto fail;
+    job->mode = reqinfo->mode;
+    job->reqinfo.mode = reqinfo->mode;
+    /*
+     * the agent session belongs to the main thread, which keeps using it
+     * (and may free it) while the job runs, so the handlers get none.
+     */
+    job->reqinfo.asp = NULL;
+    job->orig = requests;
+
+    copy = job->requests;
+    vcopy = job->vars;
+    for (request = requests; request; request = request->next, copy++) {
+        n = _request_nvars(request, reqinfo->mode);
+        for (var = request->requestvb, j = 0; j < n;
+             var = var->next_variable, j++) {
+            if (snmp_clone_var(var, &vcopy[j]))
+                goto fail;
+            vcopy[j].next_variable = (j + 1 < n) ? &vcopy[j + 1] : NULL;
+        }
+        copy->requestvb = vcopy;
+        copy->agent_req_info = &job->reqinfo;
+        copy->range_end = request->range_end;
+        copy->range_end_len = request->range_end_len;
+        copy->inclusive = request->inclusive;
+        copy->status = request->status;
+        copy->index = request->index;
+        copy->repeat = request->repeat;
+        copy->orig_repeat = request->orig_repeat;
+        copy->subtree = request->subtree;
+        copy->prev = (copy == job->requests) ? NULL : copy - 1;
+        copy->next = request->next ? copy + 1 : NULL;
+        vcopy += n;
+    }
+
+    for (request = requests; request; request = request->next)
+        request->delegated = 1;
+    workers_outstanding++;
+
+    DEBUGMSGTL(("agent_workers", "job %p for %s: %d requests\n",
+                job, reginfo->handlerName, job->nrequests));
+
+    pthread_mutex_lock(&workers_lock);
+    if (queue_tail)
+        queue_tail->next = job;
+    else
+        queue_head = job;
+    queue_tail = job;
+    pthread_cond_signal(&workers_work);
+    pthread_mutex_unlock(&workers_lock);
+
+    return SNMP_ERR_NOERROR;
+
+  fail:
+    _job_free(job);
+    return SNMP_ERR_GENERR;
+}
+
+/**
+ * Wait until the worker threads are idle.  Call this before changing
+ * anything a thread-safe handler might be looking at, such as the
+ * registry or the configuration.  Results are still delivered through
+ * the main loop.
+ */
+void
+netsnmp_agent_workers_sync(void)
+{
+    if (!workers_outstanding)
+        return;
+
+    pthread_mutex_lock(&workers_lock);
+    while (queue_head || _asp_busy(NULL))
+        pthread_cond_wait(&workers_idle, &workers_lock);
+    pthread_mutex_unlock(&workers_lock);
+}
+
+/**
+ * Drop the jobs of an agent session that is being freed.  Waits for a
+ * worker that is still running one of them, so the delegated requests
+ * the job copies its results into stay valid until it is done.
+ */
+void
+netsnmp_agent_workers_forget(netsnmp_agent_session *asp)
+{
+    agent_worker_job *job, *prev, *next;
+
+    if (!workers_outstanding || asp == NULL)
+        return;
+
+    pthread_mutex_lock(&workers_lock);
+    for (prev = NULL, job = queue_head; job; job = next) {
+        next = job->next;
+        if (job->asp != asp) {
+            prev = job;
+            continue;
+        }
+        if (prev)
+            prev->next = next;
+        else
+            queue_head = next;
+        if (queue_tail == job)
+            queue_tail = prev;
+        _job_free(job);
+        workers_outstanding--;
+    }
+    while (_asp_busy(asp))
+        pthread_cond_wait(&workers_idle, &workers_lock);
+    for (job = done_head; job; job = job->next)
+        if (job->asp == asp)
+            job->asp = NULL;
+    pthread_mutex_unlock(&workers_lock);
+}
+
+/**
+ * Stop the worker threads and drop any jobs that have not completed.
+ */
+void
+netsnmp_agent_workers_shutdown(void)
+{
+    agent_worker_job *job, *next;
+    int             i;
+
+    if (!workers_started)
+        return;
+
+    pthread_mutex_lock(&workers_lock);
+    workers_stop = 1;
+    pthread_cond_broadcast(&workers_work);
+    pthread_mutex_unlock(&workers_lock);
+    for (i = 0; i < workers_started; i++)
+        pthread_join(workers[i], NULL);
+
+    for (job = queue_head; job; job = next) {
+        next = job->next;
+        _job_free(job);
+    }
+    for (job = done_head; job; job = next) {
+        next = job->next;
+        _job_free(job);
+    }
+    queue_head = queue_tail = done_head = done_tail = NULL;
+
+    unregister_readfd(wake_fd[0]);
+    close(wake_fd[0]);
+    close(wake_fd[1]);
+    wake_fd[0] = wake_fd[1] = -1;
+    SNMP_FREE(workers);
+    SNMP_FREE(workers_running);
+    workers_size = 0;
+    workers_started = 0;
+    workers_outstanding = 0;
+    workers_stop = 0;
+    DEBUGMSGTL(("agent_workers", "worker threads stopped\n"));
+}
+
+#else                           /* !NETSNMP_AGENT_WORKERS */
+
+int
+netsnmp_agent_workers_eligible(netsnmp_handler_registration *reginfo,
+                               netsnmp_agent_request_info *reqinfo)
+{
+    return 0;
+}
+
+int
+netsnmp_agent_workers_dispatch(netsnmp_handler_registration *reginfo,
+                               netsnmp_agent_request_info *reqinfo,
+                               netsnmp_request_info *requests)
+{
+    return netsnmp_call_handlers(reginfo, reqinfo, requests);
+}
+
+void
+netsnmp_agent_workers_sync(void)
+{
+}
+
+void
+netsnmp_agent_workers_forget(netsnmp_agent_session *asp)
+{
+}
+
+void
+netsnmp_agent_workers_shutdown(void)
+{
+}
+
+#endif                          /* !NETSNMP_AGENT_WORKERS */
+/** @} */
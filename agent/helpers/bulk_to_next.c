@@ -20,6 +20,12 @@
  *  The only purpose of this handler is to convert a GETBULK request
  *  to a GETNEXT request.  It is inserted into handler chains where
  *  the handler has not set the HANDLER_CAN_GETBULK flag.
+ *
+ *  Registrations that set HANDLER_CAN_BULK_NEXT are asked for all the
+ *  repetitions of a request in a single pass: the GETNEXT is repeated
+ *  from each answer until the repetitions are used up, the answer
+ *  leaves the registration or the handler stops answering.  Others get
+ *  one GETNEXT per pass of the agent's GETBULK loop.
  *  @ingroup utilities
  *  @{
  */
@@ -35,7 +41,7 @@ netsnmp_get_bulk_to_next_handler(void)
                                netsnmp_bulk_to_next_helper);
 
     if (NULL != handler)
-        handler->flags |= MIB_HANDLER_AUTO_NEXT;
+        handler->flags |= MIB_HANDLER_AUTO_NEXT | MIB_HANDLER_THREAD_SAFE;
 
     return handler;
 }
@@ -81,6 +87,68 @@ netsnmp_bulk_to_next_fix_requests(netsnmp_request_info *requests)
 }
 
 /** @internal Implements the bulk_to_next handler */
+/*
+ * Keep calling the next handler with the requests that
+ * netsnmp_bulk_to_next_fix_requests() moved on to their next repetition,
+ * resetting them the way the agent does between passes.  Requests that
+ * are delegated or failed are left to the agent.
+ */
+static int
+_bulk_to_next_window(netsnmp_mib_handler *handler,
+                     netsnmp_handler_registration *reginfo,
+                     netsnmp_agent_request_info *reqinfo,
+                     netsnmp_request_info *requests)
+{
+    netsnmp_request_info *request, *pending, *last, *first_prev, **all;
+    int             ret = SNMP_ERR_NOERROR, count = 0, i;
+
+    for (request = requests; request; request = request->next)
+        ++count;
+    all = (netsnmp_request_info **) malloc(count * sizeof(*all));
+    if (NULL == all)
+        return ret;             /* the agent will do one pass at a time */
+    for (request = requests, i = 0; request; request = request->next)
+        all[i++] = request;
+    first_prev = requests->prev;
+
+    while (SNMP_ERR_NOERROR == ret) {
+        pending = last = NULL;
+        for (i = 0; i < count; i++) {
+            request = all[i];
+            if (request->requestvb->type != ASN_PRIV_RETRY ||
+                request->delegated || request->status != SNMP_ERR_NOERROR)
+                continue;
+            request->processed = 0;
+            if (request->parent_data)
+                netsnmp_free_request_data_sets(request);
+            request->requestvb->type = ASN_NULL;
+            request->prev = last;
+            request->next = NULL;
+            if (last)
+                last->next = request;
+            else
+                pending = request;
+            last = request;
+        }
+        if (NULL == pending)
+            break;
+
+        ret = netsnmp_call_next_handler(handler, reginfo, reqinfo, pending);
+        netsnmp_bulk_to_next_fix_requests(pending);
+    }
+
+    /*
+     * restore the request list the agent gave us
+     */
+    for (i = 0; i < count; i++) {
+        all[i]->prev = i ? all[i - 1] : first_prev;
+        all[i]->next = (i + 1 < count) ? all[i + 1] : NULL;
+    }
+    free(all);
+
+    return ret;
+}
+
 int
 netsnmp_bulk_to_next_helper(netsnmp_mib_handler *handler,
                             netsnmp_handler_registration *reginfo,
@@ -119,13 +187,17 @@ netsnmp_bulk_to_next_helper(netsnmp_mib_handler *handler,
         reqinfo->mode = MODE_GETNEXT;
         ret =
             netsnmp_call_next_handler(handler, reginfo, reqinfo, requests);
-        reqinfo->mode = MODE_GETBULK;
 
         /*
          * update the varbinds for the next request series 
          */
         netsnmp_bulk_to_next_fix_requests(requests);
 
+        if (SNMP_ERR_NOERROR == ret &&
+            (reginfo->modes & HANDLER_CAN_BULK_NEXT))
+            ret = _bulk_to_next_window(handler, reginfo, reqinfo, requests);
+        reqinfo->mode = MODE_GETBULK;
+
         /*
          * let agent handler know that we've already called next handler
          */
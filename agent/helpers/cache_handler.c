@@ -21,6 +21,19 @@
 #else
 #include <strings.h>
 #endif
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#if HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#include <errno.h>
+#include <signal.h>
+
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_PTHREAD_CREATE) && !defined(WIN32)
+#include <pthread.h>
+#define NETSNMP_CACHE_BACKGROUND 1
+#endif
 
 #include <net-snmp/net-snmp-includes.h>
 #include <net-snmp/agent/net-snmp-agent-includes.h>
@@ -36,6 +49,300 @@ static netsnmp_cache  *cache_head = NULL;
 static int             cache_outstanding_valid = 0;
 static int             _cache_load( netsnmp_cache *cache );
 
+struct netsnmp_cache_group_s {
+    char                *name;
+    netsnmp_cache       *members;       /* linked through group_next */
+    netsnmp_cache_group *next;
+};
+
+static netsnmp_cache_group *cache_groups = NULL;
+static int             cache_group_loading = 0;
+static netsnmp_agent_request_info *cache_group_reqinfo = NULL;
+
+/*
+ * The caches a cacheGroup line put into a group, with the group their
+ * module had put them in (if any), so that re-reading the configuration
+ * starts from the modules' groups again.
+ */
+typedef struct cache_group_conf_s {
+    struct cache_group_conf_s *next;
+    netsnmp_cache  *cache;
+    char           *previous;
+} cache_group_conf;
+
+static cache_group_conf *cache_group_confs = NULL;
+
+static void     _cache_loaded(netsnmp_cache *cache, u_int duration);
+static void     _cache_group_conf_forget(netsnmp_cache *cache);
+static void     _cache_release(netsnmp_cache *cache);
+
+/*
+ * Requests delegated until the snapshot being built for a cache without
+ * any data to answer from is ready
+ */
+typedef struct cache_waiter_s {
+    struct cache_waiter_s   *next;
+    netsnmp_cache           *cache;
+    netsnmp_delegated_cache *dcache;
+} cache_waiter;
+
+static cache_waiter *cache_waiters = NULL;
+static void     _cache_waiters_resume(netsnmp_cache *cache, int drop);
+
+#ifdef NETSNMP_CACHE_BACKGROUND
+/*
+ * The snapshots of caches loaded in the background are built one at a
+ * time by a loader thread, which is started when it is first needed.
+ * Finished jobs are handed back to the agent's thread through a pipe.
+ */
+typedef struct cache_job_s {
+    struct cache_job_s   *next;
+    netsnmp_cache        *cache;
+    NetsnmpCacheSnapshot *load_snapshot;
+    void                 *magic;
+    void                 *snapshot;
+    u_int                 duration;     /* in ms */
+    int                   orphaned;     /* the cache was freed meanwhile */
+} cache_job;
+
+static pthread_mutex_t cache_jobs_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cache_jobs_work = PTHREAD_COND_INITIALIZER;
+static cache_job *cache_jobs_queue = NULL;
+static cache_job *cache_jobs_running = NULL;
+static cache_job *cache_jobs_finished = NULL;
+static int      cache_loader_state = 0; /* 1 running, -1 failed to start */
+static int      cache_wake_fd[2] = { -1, -1 };
+
+static void    *
+_cache_loader_main(void *arg)
+{
+    cache_job      *job;
+    struct timeval  start, end;
+    char            c = 0;
+
+    pthread_mutex_lock(&cache_jobs_lock);
+    for (;;) {
+        while (NULL == cache_jobs_queue)
+            pthread_cond_wait(&cache_jobs_work, &cache_jobs_lock);
+        job = cache_jobs_queue;
+        cache_jobs_queue = job->next;
+        cache_jobs_running = job;
+        pthread_mutex_unlock(&cache_jobs_lock);
+
+        netsnmp_get_monotonic_clock(&start);
+        job->snapshot = job->load_snapshot(job->cache, job->magic);
+        netsnmp_get_monotonic_clock(&end);
+        NETSNMP_TIMERSUB(&end, &start, &end);
+        job->duration = end.tv_sec * 1000 + end.tv_usec / 1000;
+
+        pthread_mutex_lock(&cache_jobs_lock);
+        cache_jobs_running = NULL;
+        job->next = cache_jobs_finished;
+        cache_jobs_finished = job;
+        /*
+         * a full pipe already has a wakeup pending
+         */
+        while (write(cache_wake_fd[1], &c, 1) < 0 && errno == EINTR)
+            ;
+    }
+    return NULL;
+}
+
+/*
+ * installs the snapshot of a finished job, in the agent's thread
+ */
+static void
+_cache_job_finish(cache_job *job)
+{
+    netsnmp_cache  *cache = job->cache;
+
+    cache->loading = 0;
+    if (job->orphaned) {
+        DEBUGMSGTL(("helper:cache_handler",
+                    "background load of freed cache %p done\n", cache));
+        if (job->snapshot && job->snapshot != job->magic)
+            cache->free_snapshot(cache, job->snapshot);
+        _cache_release(cache);
+        free(job);
+        return;
+    }
+    if (NULL == job->snapshot) {
+        DEBUGMSGTL(("helper:cache_handler", "background load of %p failed\n",
+                    cache));
+    } else if (job->snapshot == job->magic) {
+        _cache_loaded(cache, job->duration);
+        DEBUGMSGTL(("helper:cache_handler",
+                    "background load of %p done in %u ms, unchanged\n",
+                    cache, job->duration));
+    } else {
+        cache->swap_snapshot(cache, cache->magic, job->snapshot);
+        cache->loads++;
+        _cache_loaded(cache, job->duration);
+        DEBUGMSGTL(("helper:cache_handler",
+                    "background load of %p done in %u ms\n",
+                    cache, job->duration));
+    }
+    _cache_waiters_resume(cache, !cache->valid);
+    free(job);
+}
+
+static void
+_cache_jobs_collect(int fd, void *data)
+{
+    cache_job      *job, *next;
+    char            buf[64];
+
+    while (read(fd, buf, sizeof(buf)) > 0)
+        ;
+
+    pthread_mutex_lock(&cache_jobs_lock);
+    job = cache_jobs_finished;
+    cache_jobs_finished = NULL;
+    pthread_mutex_unlock(&cache_jobs_lock);
+
+    for (; job; job = next) {
+        next = job->next;
+        _cache_job_finish(job);
+    }
+}
+
+/*
+ * drops the job of a cache that is being freed. A job that is queued
+ * or finished is dropped right away; the cache of a job that is being
+ * run is freed once it is finished.
+ *
+ * @retval 1 the cache is freed later, 0 it can be freed now
+ */
+static int
+_cache_job_orphan(netsnmp_cache *cache)
+{
+    cache_job      *job = NULL, **jp;
+    int             later = 0;
+
+    pthread_mutex_lock(&cache_jobs_lock);
+    for (jp = &cache_jobs_queue; *jp; jp = &(*jp)->next)
+        if ((*jp)->cache == cache)
+            break;
+    if (NULL == *jp)
+        for (jp = &cache_jobs_finished; *jp; jp = &(*jp)->next)
+            if ((*jp)->cache == cache)
+                break;
+    if (*jp) {
+        job = *jp;
+        *jp = job->next;
+    } else if (cache_jobs_running && cache_jobs_running->cache == cache) {
+        cache_jobs_running->orphaned = 1;
+        later = 1;
+    }
+    pthread_mutex_unlock(&cache_jobs_lock);
+
+    if (job) {
+        if (job->snapshot && job->snapshot != job->magic)
+            cache->free_snapshot(cache, job->snapshot);
+        free(job);
+        cache->loading = 0;
+    }
+    return later;
+}
+
+static int
+_cache_loader_start(void)
+{
+    pthread_t       thread;
+    sigset_t        all, old;
+    int             rc;
+
+    cache_loader_state = -1;
+    if (pipe(cache_wake_fd) < 0) {
+        snmp_log_perror("cache loader");
+        return 0;
+    }
+    fcntl(cache_wake_fd[0], F_SETFL, fcntl(cache_wake_fd[0], F_GETFL) | O_NONBLOCK);
+    fcntl(cache_wake_fd[1], F_SETFL, fcntl(cache_wake_fd[1], F_GETFL) | O_NONBLOCK);
+
+    /*
+     * signals are for the main thread only
+     */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    rc = pthread_create(&thread, NULL, _cache_loader_main, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (rc != 0) {
+        snmp_log(LOG_ERR, "cannot create the cache loader thread: %s\n",
+                 strerror(rc));
+        close(cache_wake_fd[0]);
+        close(cache_wake_fd[1]);
+        cache_wake_fd[0] = cache_wake_fd[1] = -1;
+        return 0;
+    }
+    pthread_detach(thread);
+    register_readfd(cache_wake_fd[0], _cache_jobs_collect, NULL);
+    cache_loader_state = 1;
+    DEBUGMSGTL(("helper:cache_handler", "started the cache loader thread\n"));
+    return 1;
+}
+
+static int
+_cache_job_start(netsnmp_cache *cache)
+{
+    cache_job      *job, **jp;
+
+    if (cache_loader_state < 0 ||
+        (0 == cache_loader_state && !_cache_loader_start()))
+        return 0;
+
+    job = SNMP_MALLOC_TYPEDEF(cache_job);
+    if (NULL == job)
+        return 0;
+    job->cache = cache;
+    job->load_snapshot = cache->load_snapshot;
+    job->magic = cache->magic;
+    cache->loading = 1;
+
+    pthread_mutex_lock(&cache_jobs_lock);
+    for (jp = &cache_jobs_queue; *jp; jp = &(*jp)->next)
+        ;
+    *jp = job;
+    pthread_cond_signal(&cache_jobs_work);
+    pthread_mutex_unlock(&cache_jobs_lock);
+
+    DEBUGMSGTL(("helper:cache_handler", "loading %p in the background\n",
+                cache));
+    return 1;
+}
+#else                           /* !NETSNMP_CACHE_BACKGROUND */
+static int
+_cache_job_start(netsnmp_cache *cache)
+{
+    return 0;
+}
+
+static int
+_cache_job_orphan(netsnmp_cache *cache)
+{
+    return 0;
+}
+#endif                          /* !NETSNMP_CACHE_BACKGROUND */
+
+/*
+ * Starts loading an expired cache in the background, unless that is
+ * under way already, provided its data may still be used. Returns 1 if
+ * the request can go on with the data it has.
+ */
+static int
+_cache_load_background(netsnmp_cache *cache)
+{
+    if (NULL == cache->load_snapshot || cache->max_stale <= 0 ||
+        !cache->valid || NULL == cache->timestampM || cache->timeout < 0)
+        return 0;
+    if (netsnmp_ready_monotonic(cache->timestampM,
+                                1000 * (cache->timeout + cache->max_stale)))
+        return 0;               /* too old, load it now */
+    if (cache->loading)
+        return 1;
+    return _cache_job_start(cache);
+}
+
 #define CACHE_RELEASE_FREQUENCY 60      /* Check for expired caches every 60s */
 
 void            release_cached_resources(unsigned int regNo,
@@ -98,6 +405,22 @@ void            release_cached_resources(unsigned int regNo,
  *  not be used if cache is not synchronized automatically as it would
  *  result in stale cache information when if polling happens too fast.
  *
+ *  Caches of related data can be put into a named group, with
+ *  netsnmp_cache_group_add() or the "cacheGroup" snmpd.conf token.
+ *  Whenever a cache of a group is loaded, the other caches of the group
+ *  that hold data and have expired, or that the current request reaches
+ *  into, are loaded with it, and a request that used one of them won't
+ *  reload any of the others. The caches of a group are thus loaded in
+ *  one go, rather than one after the other as a walk reaches them.
+ *
+ *  A cache whose module can build a new copy of its data without
+ *  touching the current one can be loaded in the background, see
+ *  netsnmp_cache_set_background(). Once such a cache has expired,
+ *  requests go on using its data while a separate thread builds the new
+ *  copy, which is swapped in by the agent's thread when it is ready.
+ *  Only when the data has been expired for more than max_stale seconds
+ *  do requests wait for it to be loaded.
+ *
  *
  *  Here are some suggestions for some common situations.
  *
@@ -261,9 +584,27 @@ netsnmp_cache_free(netsnmp_cache *cache)
     if(0 != cache->timer_id)
         netsnmp_cache_timer_stop(cache);
 
+    _cache_group_conf_forget(cache);
+    netsnmp_cache_group_remove(cache);
+    _cache_waiters_resume(cache, 1);
+
     if (cache->valid)
         _cache_free(cache);
 
+    /*
+     * a snapshot that is still being built refers to the cache
+     */
+    if (cache->loading && _cache_job_orphan(cache))
+        return SNMPERR_SUCCESS;
+
+    _cache_release(cache);
+
+    return SNMPERR_SUCCESS;
+}
+
+static void
+_cache_release(netsnmp_cache *cache)
+{
     if (cache->timestampM)
 	free(cache->timestampM);
 
@@ -271,8 +612,6 @@ netsnmp_cache_free(netsnmp_cache *cache)
         free(cache->rootoid);
 
     free(cache);
-
-    return SNMPERR_SUCCESS;
 }
 
 /** removes a cache
@@ -311,10 +650,23 @@ _timer_reload(unsigned int regNo, void *clientargs)
 {
     netsnmp_cache *cache = (netsnmp_cache *)clientargs;
 
+    /*
+     * skip this round if the cache was loaded along with another cache
+     * of its group in the meantime
+     */
+    if (cache->group && cache->valid && cache->timeout > 0 &&
+        !netsnmp_ready_monotonic(cache->timestampM, 500 * cache->timeout)) {
+        DEBUGMSGT(("cache_timer:start", "cache %p loaded with group %s\n",
+                   cache, cache->group->name));
+        return;
+    }
+
     DEBUGMSGT(("cache_timer:start", "loading cache %p\n", cache));
 
     cache->expired = 1;
 
+    if (_cache_load_background(cache))
+        return;
     _cache_load(cache);
 }
 
@@ -372,6 +724,269 @@ netsnmp_cache_timer_stop(netsnmp_cache *cache)
     cache->flags |= NETSNMP_CACHE_AUTO_RELOAD;
 }
 
+/** adds a cache to the named group, creating the group if needed.
+ *  A cache belongs to one group at most, so it leaves any group it was
+ *  in before.
+ */
+int
+netsnmp_cache_group_add(const char *name, netsnmp_cache *cache)
+{
+    netsnmp_cache_group *group;
+
+    if (NULL == name || NULL == cache)
+        return SNMPERR_GENERR;
+
+    if (cache->group && 0 == strcmp(cache->group->name, name))
+        return SNMPERR_SUCCESS;
+    netsnmp_cache_group_remove(cache);
+
+    for (group = cache_groups; group; group = group->next)
+        if (0 == strcmp(group->name, name))
+            break;
+    if (NULL == group) {
+        group = SNMP_MALLOC_TYPEDEF(netsnmp_cache_group);
+        if (NULL == group || NULL == (group->name = strdup(name))) {
+            snmp_log(LOG_ERR,"malloc error in netsnmp_cache_group_add\n");
+            free(group);
+            return SNMPERR_GENERR;
+        }
+        group->next = cache_groups;
+        cache_groups = group;
+    }
+
+    cache->group = group;
+    cache->group_next = group->members;
+    group->members = cache;
+
+    DEBUGMSGTL(("helper:cache_handler", "cache %p joins group %s: ",
+                cache, name));
+    DEBUGMSGOID(("helper:cache_handler", cache->rootoid, cache->rootoid_len));
+    DEBUGMSG(("helper:cache_handler", "\n"));
+    return SNMPERR_SUCCESS;
+}
+
+/** removes a cache from its group. The last cache to leave a group
+ *  frees it.
+ */
+void
+netsnmp_cache_group_remove(netsnmp_cache *cache)
+{
+    netsnmp_cache_group *group, **gp;
+    netsnmp_cache      **cp;
+
+    if (NULL == cache || NULL == (group = cache->group))
+        return;
+
+    for (cp = &group->members; *cp; cp = &(*cp)->group_next)
+        if (*cp == cache) {
+            *cp = cache->group_next;
+            break;
+        }
+    cache->group = NULL;
+    cache->group_next = NULL;
+
+    if (group->members)
+        return;
+    for (gp = &cache_groups; *gp; gp = &(*gp)->next)
+        if (*gp == group) {
+            *gp = group->next;
+            break;
+        }
+    free(group->name);
+    free(group);
+}
+
+/** returns the name of the group of a cache, or NULL */
+const char *
+netsnmp_cache_group_name(const netsnmp_cache *cache)
+{
+    return (cache && cache->group) ? cache->group->name : NULL;
+}
+
+/** makes a cache load in the background once it has expired.
+ *  snapshot_hook is called in a separate thread, and returns a new copy
+ *  of the data, or NULL if it failed. It must not touch anything the
+ *  agent might be using meanwhile. It may return the magic pointer it
+ *  was passed to keep the cached data as it is: the cache then counts
+ *  as freshly loaded, and neither swap_hook nor free_hook is called
+ *  with that pointer. swap_hook is called in the agent's
+ *  thread to replace the cached data with the snapshot, and frees the
+ *  old data. free_hook frees a snapshot that is not swapped in, because
+ *  the cache was freed while it was being built; it must not use the
+ *  cache's magic pointer.
+ *  Until the snapshot is swapped in, requests go on using the expired
+ *  data. Data that expired more than max_stale seconds ago is loaded in
+ *  the request instead, unless a snapshot is being built already: the
+ *  agent's thread never waits for the loader. A request that finds no
+ *  data at all is delegated until the snapshot is ready.
+ *  A max_stale of 0 (also settable through the nsCacheTable) turns
+ *  background loading off.
+ */
+void
+netsnmp_cache_set_background(netsnmp_cache *cache, int max_stale,
+                             NetsnmpCacheSnapshot *snapshot_hook,
+                             NetsnmpCacheSwap *swap_hook,
+                             NetsnmpCacheFree *free_hook)
+{
+    if (NULL == cache)
+        return;
+    if (NULL == snapshot_hook || NULL == swap_hook || NULL == free_hook) {
+        snmp_log(LOG_ERR,
+                 "bad param in netsnmp_cache_set_background\n");
+        return;
+    }
+    cache->max_stale = max_stale;
+    cache->load_snapshot = snapshot_hook;
+    cache->swap_snapshot = swap_hook;
+    cache->free_snapshot = free_hook;
+}
+
+/*
+ * looks up the cache for an OID given in a configuration line
+ */
+static netsnmp_cache *
+_cache_find_conf(const char *name)
+{
+    oid             objid[MAX_OID_LEN];
+    size_t          objid_len = MAX_OID_LEN;
+    netsnmp_cache  *cache;
+
+    if (!snmp_parse_oid(name, objid, &objid_len)) {
+        netsnmp_config_error("unknown cache OID \"%s\"", name);
+        return NULL;
+    }
+    for (cache = cache_head; cache; cache = cache->next)
+        if (0 == netsnmp_oid_equals(cache->rootoid, cache->rootoid_len,
+                                    objid, objid_len))
+            return cache;
+    netsnmp_config_error("no cache registered for \"%s\"", name);
+    return NULL;
+}
+
+/** @private
+ *  Parses the "cacheGroup NAME OID [OID...]" token line. The OIDs are
+ *  those of the caches, as listed in the nsCacheTable.
+ */
+static void
+_parse_cache_group_conf(const char *token, const char *cptr)
+{
+    char            name[64], buf[SPRINT_MAX_LEN];
+    netsnmp_cache  *cache;
+    cache_group_conf *conf;
+
+    cptr = copy_nword_const(cptr, name, sizeof(name));
+    if (!cptr) {
+        config_perror("no cache OID specified");
+        return;
+    }
+    while (cptr) {
+        cptr = copy_nword_const(cptr, buf, sizeof(buf));
+        cache = _cache_find_conf(buf);
+        if (NULL == cache)
+            continue;
+        for (conf = cache_group_confs; conf; conf = conf->next)
+            if (conf->cache == cache)
+                break;
+        if (NULL == conf) {
+            conf = SNMP_MALLOC_TYPEDEF(cache_group_conf);
+            if (NULL == conf) {
+                snmp_log(LOG_ERR,"malloc error in cacheGroup\n");
+                return;
+            }
+            conf->cache = cache;
+            if (cache->group)
+                conf->previous = strdup(cache->group->name);
+            conf->next = cache_group_confs;
+            cache_group_confs = conf;
+        }
+        netsnmp_cache_group_add(name, cache);
+    }
+}
+
+/*
+ * Puts the caches a cacheGroup line moved back into the groups of their
+ * modules, before the configuration is read again.
+ */
+static int
+_cache_group_conf_reset(int majorID, int minorID, void *serverarg,
+                        void *clientarg)
+{
+    cache_group_conf *conf;
+
+    while ((conf = cache_group_confs) != NULL) {
+        cache_group_confs = conf->next;
+        if (conf->previous)
+            netsnmp_cache_group_add(conf->previous, conf->cache);
+        else
+            netsnmp_cache_group_remove(conf->cache);
+        free(conf->previous);
+        free(conf);
+    }
+    return SNMPERR_SUCCESS;
+}
+
+/*
+ * drops the cacheGroup record of a cache that is freed
+ */
+static void
+_cache_group_conf_forget(netsnmp_cache *cache)
+{
+    cache_group_conf *conf, **cp;
+
+    for (cp = &cache_group_confs; (conf = *cp) != NULL; cp = &conf->next)
+        if (conf->cache == cache) {
+            *cp = conf->next;
+            free(conf->previous);
+            free(conf);
+            return;
+        }
+}
+
+/** @private
+ *  Parses the "cacheMaxStale OID SECONDS" token line.
+ */
+static void
+_parse_cache_max_stale_conf(const char *token, const char *cptr)
+{
+    char            buf[SPRINT_MAX_LEN];
+    netsnmp_cache  *cache;
+
+    cptr = copy_nword_const(cptr, buf, sizeof(buf));
+    if (!cptr) {
+        config_perror("no staleness limit specified");
+        return;
+    }
+    cache = _cache_find_conf(buf);
+    if (NULL == cache)
+        return;
+    if (NULL == cache->load_snapshot)
+        netsnmp_config_warn("cache \"%s\" is never loaded in the background",
+                            buf);
+    cache->max_stale = atoi(cptr);
+    if (cache->max_stale < 0) {
+        config_perror("the staleness limit must not be negative");
+        cache->max_stale = 0;
+    }
+}
+
+/** @private
+ *  Registers the cacheGroup and cacheMaxStale parser tokens.
+ *  Used in init_agent_read_config().
+ */
+void
+netsnmp_init_cache_conf(void)
+{
+    snmpd_register_const_config_handler("cacheGroup",
+                                        _parse_cache_group_conf, NULL,
+                                        "NAME OID [OID...]");
+    snmpd_register_const_config_handler("cacheMaxStale",
+                                        _parse_cache_max_stale_conf, NULL,
+                                        "OID SECONDS");
+    snmp_register_callback(SNMP_CALLBACK_LIBRARY,
+                           SNMP_CALLBACK_PRE_READ_CONFIG,
+                           _cache_group_conf_reset, NULL);
+}
+
 
 /** returns a cache handler that can be injected into a given handler chain.  
  */
@@ -573,9 +1188,14 @@ netsnmp_cache_check_and_reload(netsnmp_cache * cache)
         DEBUGMSGT(("helper:cache_handler", " no cache\n"));
         return 0;	/* ?? or -1 */
     }
-    if (!cache->valid || netsnmp_cache_check_expired(cache))
+    if (!cache->valid || netsnmp_cache_check_expired(cache)) {
+        if (_cache_load_background(cache)) {
+            DEBUGMSGT(("helper:cache_handler", " expired, loading in "
+                       "the background\n"));
+            return 0;
+        }
         return _cache_load( cache );
-    else {
+    } else {
         DEBUGMSGT(("helper:cache_handler", " cached (%d)\n",
                    cache->timeout));
         return 0;
@@ -603,6 +1223,85 @@ netsnmp_is_cache_valid(netsnmp_agent_request_info * reqinfo)
 }
 #endif /* NETSNMP_FEATURE_REMOVE_NETSNMP_IS_CACHE_VALID */
 
+/*
+ * delegates the requests to a handler until the snapshot being built
+ * for its cache is ready
+ *
+ * @retval 1 delegated, 0 the requests have to go on now
+ */
+static int
+_cache_waiter_add(netsnmp_cache *cache, netsnmp_mib_handler *handler,
+                  netsnmp_handler_registration *reginfo,
+                  netsnmp_agent_request_info *reqinfo,
+                  netsnmp_request_info *requests)
+{
+    cache_waiter   *waiter;
+    netsnmp_request_info *request;
+
+    if (NULL == reqinfo->asp)
+        return 0;
+    waiter = SNMP_MALLOC_TYPEDEF(cache_waiter);
+    if (NULL == waiter)
+        return 0;
+    waiter->dcache = netsnmp_create_delegated_cache(handler, reginfo,
+                                                    reqinfo, requests, NULL);
+    if (NULL == waiter->dcache) {
+        free(waiter);
+        return 0;
+    }
+    waiter->cache = cache;
+    waiter->next = cache_waiters;
+    cache_waiters = waiter;
+
+    for (request = requests; request; request = request->next)
+        request->delegated = 1;
+    DEBUGMSGTL(("helper:cache_handler", "delegating request until %p is "
+                "loaded\n", cache));
+    return 1;
+}
+
+/*
+ * passes the requests delegated to a cache on to the next handlers, or
+ * fails them if the cache is dropped
+ */
+static void
+_cache_waiters_resume(netsnmp_cache *cache, int drop)
+{
+    cache_waiter   *waiter, **wp;
+    netsnmp_delegated_cache *dcache;
+    netsnmp_request_info *request;
+    char            addrstr[32];
+
+    snprintf(addrstr, sizeof(addrstr), "%p", cache);
+    for (wp = &cache_waiters; (waiter = *wp) != NULL; ) {
+        if (waiter->cache != cache) {
+            wp = &waiter->next;
+            continue;
+        }
+        *wp = waiter->next;
+
+        dcache = netsnmp_handler_check_cache(waiter->dcache);
+        if (dcache) {
+            DEBUGMSGTL(("helper:cache_handler", "resuming request delegated "
+                        "to %p\n", cache));
+            for (request = dcache->requests; request;
+                 request = request->next)
+                request->delegated = 0;
+            if (drop)
+                netsnmp_request_set_error_all(dcache->requests,
+                                              SNMP_ERR_GENERR);
+            else {
+                netsnmp_cache_reqinfo_insert(cache, dcache->reqinfo,
+                                             addrstr);
+                netsnmp_call_next_handler(dcache->handler, dcache->reginfo,
+                                          dcache->reqinfo, dcache->requests);
+            }
+        }
+        netsnmp_free_delegated_cache(waiter->dcache);
+        free(waiter);
+    }
+}
+
 /** Implements the cache handler */
 int
 netsnmp_cache_helper_handler(netsnmp_mib_handler * handler,
@@ -666,12 +1365,44 @@ netsnmp_cache_helper_handler(netsnmp_mib_handler * handler,
         if (netsnmp_cache_is_valid(reqinfo, addrstr))
             break;
 
+        /*
+         * without any data to answer from, the request has to wait for
+         * the snapshot being built in the background
+         */
+        if (cache->loading && !cache->valid && MODE_IS_GET(reqinfo->mode) &&
+            _cache_waiter_add(cache, handler, reginfo, reqinfo, requests)) {
+            handler->flags |= MIB_HANDLER_AUTO_NEXT_OVERRIDE_ONCE;
+            cache->cache_hint = NULL;
+            return SNMP_ERR_NOERROR;
+        }
+
         /*
          * call the load hook, and update the cache timestamp.
          * If it's not already there, add to reqinfo
          */
+        cache_group_reqinfo = reqinfo;
         netsnmp_cache_check_and_reload(cache);
+        cache_group_reqinfo = NULL;
         netsnmp_cache_reqinfo_insert(cache, reqinfo, addrstr);
+
+        /*
+         * the other caches of the group have been loaded along with
+         * this one if they needed to, so don't reload them for this
+         * request either.
+         */
+        if (cache->group) {
+            netsnmp_cache *member;
+            char member_addr[32];
+
+            for (member = cache->group->members; member;
+                 member = member->group_next) {
+                if (member == cache || !member->valid ||
+                    netsnmp_cache_check_expired(member))
+                    continue;
+                snprintf(member_addr, sizeof(member_addr), "%p", member);
+                netsnmp_cache_reqinfo_insert(member, reqinfo, member_addr);
+            }
+        }
         /** next handler called automatically - 'AUTO_NEXT' */
         break;
 
@@ -720,10 +1451,21 @@ _cache_free( netsnmp_cache *cache )
 }
 
 static int
-_cache_load( netsnmp_cache *cache )
+_cache_load_one( netsnmp_cache *cache )
 {
+    struct timeval start, end;
     int ret = -1;
 
+    /*
+     * Rather than loading it here as well, go on with the data there is
+     * until the snapshot being built in the background is ready
+     */
+    if (cache->loading) {
+        DEBUGMSGT(("helper:cache_handler", " still loading in the "
+                   "background\n"));
+        return cache->valid ? 0 : -1;
+    }
+
     /*
      * If we've got a valid cache, then release it before reloading
      */
@@ -731,15 +1473,35 @@ _cache_load( netsnmp_cache *cache )
         (! (cache->flags & NETSNMP_CACHE_DONT_FREE_BEFORE_LOAD)))
         _cache_free(cache);
 
-    if ( cache->load_cache)
+    if ( cache->load_cache) {
+        netsnmp_get_monotonic_clock(&start);
         ret = cache->load_cache(cache, cache->magic);
+        netsnmp_get_monotonic_clock(&end);
+        cache->loads++;
+    }
     if (ret < 0) {
         DEBUGMSGT(("helper:cache_handler", " load failed (%d)\n", ret));
         cache->valid = 0;
         return ret;
     }
+    NETSNMP_TIMERSUB(&end, &start, &end);
+    _cache_loaded(cache, end.tv_sec * 1000 + end.tv_usec / 1000);
+    DEBUGMSGT(("helper:cache_handler", " loaded (%d)\n", cache->timeout));
+
+    return ret;
+}
+
+/*
+ * Marks a cache as freshly loaded, in duration ms
+ */
+static void
+_cache_loaded(netsnmp_cache *cache, u_int duration)
+{
     cache->valid = 1;
     cache->expired = 0;
+    cache->load_time = duration;
+    if (duration > cache->load_time_max)
+        cache->load_time_max = duration;
 
     /*
      * If we didn't previously have any valid caches outstanding,
@@ -752,7 +1514,69 @@ _cache_load( netsnmp_cache *cache )
         cache_outstanding_valid = 1;
     }
     netsnmp_set_monotonic_marker(&cache->timestampM);
-    DEBUGMSGT(("helper:cache_handler", " loaded (%d)\n", cache->timeout));
+}
+
+/*
+ * Tells whether a variable of the request, as far as it has got, lies
+ * within the subtree of a cache.
+ */
+static int
+_cache_request_touches(netsnmp_agent_request_info *reqinfo,
+                       netsnmp_cache *cache)
+{
+    netsnmp_variable_list *var;
+
+    if (NULL == reqinfo || NULL == reqinfo->asp ||
+        NULL == reqinfo->asp->pdu || NULL == cache->rootoid)
+        return 0;
+    for (var = reqinfo->asp->pdu->variables; var; var = var->next_variable)
+        if (0 == netsnmp_oid_is_subtree(cache->rootoid, cache->rootoid_len,
+                                        var->name, var->name_length))
+            return 1;
+    return 0;
+}
+
+/*
+ * Loads a cache and, if it belongs to a group, the other caches of the
+ * group that hold data and have expired, or that the current request
+ * reaches into. Caches that are reloaded for every request, those whose
+ * load routine relies on the handler arguments of a request and those
+ * the current request has used already are left to load themselves.
+ */
+static int
+_cache_load( netsnmp_cache *cache )
+{
+    netsnmp_cache *member;
+    char member_addr[32];
+    int ret;
+
+    ret = _cache_load_one(cache);
+    if (ret < 0 || NULL == cache->group || cache_group_loading)
+        return ret;
+
+    cache_group_loading = 1;
+    for (member = cache->group->members; member; member = member->group_next) {
+        if (member == cache || !member->enabled || !member->valid ||
+            member->loading ||
+            NULL == member->load_cache || member->timeout < 0 ||
+            (member->flags & NETSNMP_CACHE_HINT_HANDLER_ARGS))
+            continue;
+        if (cache_group_reqinfo) {
+            snprintf(member_addr, sizeof(member_addr), "%p", member);
+            if (netsnmp_cache_reqinfo_extract(cache_group_reqinfo,
+                                              member_addr))
+                continue;
+        }
+        if (!netsnmp_cache_check_expired(member) &&
+            !_cache_request_touches(cache_group_reqinfo, member))
+            continue;
+        DEBUGMSGTL(("helper:cache_handler", "loading %p with group %s\n",
+                    member, cache->group->name));
+        if (_cache_load_background(member))
+            continue;
+        _cache_load_one(member);
+    }
+    cache_group_loading = 0;
 
     return ret;
 }
@@ -776,7 +1600,7 @@ release_cached_resources(unsigned int regNo, void *clientargs)
     for (cache = cache_head; cache; cache = cache->next) {
         DEBUGMSGTL(("helper:cache_handler"," checking %p (flags 0x%x)\n",
                      cache, cache->flags));
-        if (cache->valid &&
+        if (cache->valid && !cache->loading &&
             ! (cache->flags & NETSNMP_CACHE_DONT_AUTO_RELEASE)) {
             DEBUGMSGTL(("helper:cache_handler","  releasing %p\n", cache));
             /*
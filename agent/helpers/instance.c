@@ -77,8 +77,14 @@ netsnmp_num_file_instance_deref(netsnmp_num_file_instance *nfi)
 netsnmp_mib_handler *
 netsnmp_get_instance_handler(void)
 {
-    return netsnmp_create_handler("instance",
-                                  netsnmp_instance_helper_handler);
+    netsnmp_mib_handler *handler =
+        netsnmp_create_handler("instance",
+                               netsnmp_instance_helper_handler);
+
+    if (NULL != handler)
+        handler->flags |= MIB_HANDLER_THREAD_SAFE;
+
+    return handler;
 }
 
 /**
@@ -38,7 +38,7 @@ netsnmp_get_read_only_handler(void)
     ret = netsnmp_create_handler("read_only",
                                  netsnmp_read_only_helper);
     if (ret) {
-        ret->flags |= MIB_HANDLER_AUTO_NEXT;
+        ret->flags |= MIB_HANDLER_AUTO_NEXT | MIB_HANDLER_THREAD_SAFE;
     }
     return ret;
 }
@@ -51,8 +51,14 @@
 netsnmp_mib_handler *
 netsnmp_get_scalar_handler(void)
 {
-    return netsnmp_create_handler("scalar",
-                                  netsnmp_scalar_helper_handler);
+    netsnmp_mib_handler *handler =
+        netsnmp_create_handler("scalar",
+                               netsnmp_scalar_helper_handler);
+
+    if (NULL != handler)
+        handler->flags |= MIB_HANDLER_THREAD_SAFE;
+
+    return handler;
 }
 
 /**
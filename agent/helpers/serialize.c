@@ -35,8 +35,14 @@
 netsnmp_mib_handler *
 netsnmp_get_serialize_handler(void)
 {
-    return netsnmp_create_handler("serialize",
-                                  netsnmp_serialize_helper_handler);
+    netsnmp_mib_handler *handler =
+        netsnmp_create_handler("serialize",
+                               netsnmp_serialize_helper_handler);
+
+    if (NULL != handler)
+        handler->flags |= MIB_HANDLER_THREAD_SAFE;
+
+    return handler;
 }
 
 /** functionally the same as calling netsnmp_register_handler() but also
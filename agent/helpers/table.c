@@ -116,6 +116,7 @@ netsnmp_get_table_handler(netsnmp_table_registration_info *tabreq)
 
     ret = netsnmp_create_handler(TABLE_HANDLER_NAME, table_helper_handler);
     if (ret) {
+        ret->flags |= MIB_HANDLER_THREAD_SAFE;
         ret->myvoid = (void *) tabreq;
         tabreq->number_indexes = count_varbinds(tabreq->indexes);
     }
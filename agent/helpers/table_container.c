@@ -335,7 +335,7 @@ netsnmp_container_table_handler_get(netsnmp_table_registration_info *tabreg,
     handler->myvoid = (void*)tad;
     handler->data_clone = (void *(*)(void *))netsnmp_container_table_data_clone;
     handler->data_free = (void (*)(void *))netsnmp_container_table_data_free;
-    handler->flags |= MIB_HANDLER_AUTO_NEXT;
+    handler->flags |= MIB_HANDLER_AUTO_NEXT | MIB_HANDLER_THREAD_SAFE;
     
     return handler;
 }
@@ -688,6 +688,129 @@ _data_lookup(netsnmp_handler_registration *reginfo,
     }
 }
 
+/*
+ * For registrations with HANDLER_CAN_BULK_NEXT: answer the remaining
+ * repetitions of an answered GETBULK request from the rows that follow
+ * in the container, calling the handlers below once for all of them.
+ * Stops at the end of the table, at the end of the request's range or
+ * at the first repetition the handlers do not answer; the agent (and
+ * bulk_to_next) go on from the last answer as usual.
+ */
+static void
+_bulk_window(netsnmp_mib_handler *handler,
+             netsnmp_handler_registration *reginfo,
+             netsnmp_agent_request_info *agtreq_info,
+             netsnmp_request_info *request, container_table_data *tad)
+{
+    netsnmp_table_request_info *tblreq_info, *infos = NULL;
+    netsnmp_request_info *reqs = NULL, *r;
+    netsnmp_variable_list *var;
+    netsnmp_index *row;
+    int             n, i, answered = 0, used = 0;
+
+    var = request->requestvb;
+    if (request->repeat <= 0 || NULL == var->next_variable ||
+        request->processed || request->delegated ||
+        request->status != SNMP_ERR_NOERROR ||
+        var->type == ASN_NULL || var->type == ASN_PRIV_RETRY)
+        return;
+    tblreq_info = netsnmp_extract_table_info(request);
+    row = (netsnmp_index*)netsnmp_container_table_extract_context(request);
+    if (NULL == tblreq_info || NULL == row)
+        return;
+
+    for (n = 0, var = var->next_variable; var && n < request->repeat;
+         var = var->next_variable)
+        ++n;
+    reqs = (netsnmp_request_info*)calloc(n, sizeof(*reqs));
+    infos = (netsnmp_table_request_info*)calloc(n, sizeof(*infos));
+    if (NULL == reqs || NULL == infos)
+        goto done;
+
+    for (i = 0, var = request->requestvb->next_variable; i < n;
+         i++, var = var->next_variable) {
+        netsnmp_table_request_info *info = &infos[i];
+
+        *info = i ? infos[i - 1] : *tblreq_info;
+        info->indexes = NULL;
+        /*
+         * the request may have named no index at all, the row does
+         */
+        info->number_indexes = info->reg_info->number_indexes;
+        row = (netsnmp_index*)_find_next_row(tad->table, info, row);
+        if (NULL == row)
+            break;
+        info->index_oid_len = row->len;
+        memcpy(info->index_oid, row->oids, row->len * sizeof(oid));
+        info->indexes = snmp_clone_varbind(tblreq_info->indexes);
+        if (NULL == info->indexes)
+            break;
+        netsnmp_update_variable_list_from_index(info);
+
+        r = &reqs[i];
+        r->requestvb = var;
+        r->agent_req_info = request->agent_req_info;
+        r->subtree = request->subtree;
+        r->index = request->index;
+        netsnmp_table_build_oid_from_index(reginfo, r, info);
+        used = i + 1;
+        if (request->range_end &&
+            snmp_oid_compare(var->name, var->name_length, request->range_end,
+                             request->range_end_len) >= 0)
+            break;
+
+        netsnmp_request_add_list_data(r, netsnmp_create_data_list
+                                      (TABLE_HANDLER_NAME, info, NULL));
+        netsnmp_request_add_list_data(r, netsnmp_create_data_list
+                                      (TABLE_CONTAINER_ROW, row, NULL));
+        netsnmp_request_add_list_data(r, netsnmp_create_data_list
+                                      (TABLE_CONTAINER_CONTAINER,
+                                       tad->table, NULL));
+        if (i) {
+            r->prev = &reqs[i - 1];
+            reqs[i - 1].next = r;
+        }
+    }
+    n = i;
+
+    if (n > 0)
+        netsnmp_call_next_handler(handler, reginfo, agtreq_info, reqs);
+
+    for (answered = 0; answered < n; answered++) {
+        r = &reqs[answered];
+        if (r->processed || r->delegated || r->status != SNMP_ERR_NOERROR ||
+            r->requestvb->type == ASN_NULL ||
+            r->requestvb->type == ASN_PRIV_RETRY ||
+            r->requestvb->type == SNMP_NOSUCHOBJECT ||
+            r->requestvb->type == SNMP_NOSUCHINSTANCE ||
+            r->requestvb->type == SNMP_ENDOFMIBVIEW)
+            break;
+    }
+    netsnmp_assert(answered == n || !reqs[answered].delegated);
+    if (answered > 0) {
+        request->requestvb = reqs[answered - 1].requestvb;
+        request->repeat -= answered;
+    }
+    DEBUGMSGTL(("table_container", "bulk window: %d of %d answered\n",
+                answered, n));
+
+    /*
+     * the repetitions that were not answered are left unused
+     */
+    for (i = answered; i < used; i++) {
+        snmp_set_var_typed_value(reqs[i].requestvb, ASN_NULL, NULL, 0);
+        reqs[i].requestvb->name_length = 0;
+    }
+    for (i = 0; i < n; i++)
+        netsnmp_free_request_data_sets(&reqs[i]);
+    for (i = 0; i < used; i++)
+        snmp_free_varbind(infos[i].indexes);
+
+  done:
+    free(reqs);
+    free(infos);
+}
+
 /**********************************************************************
  **********************************************************************
  *                                                                    *
@@ -782,6 +905,14 @@ _container_table_handler(netsnmp_mib_handler *handler,
             if (rc != SNMP_ERR_NOERROR) {
                 DEBUGMSGTL(("table_container",
                             "next handler returned %d\n", rc));
+            } else if ((reginfo->modes & HANDLER_CAN_BULK_NEXT) &&
+                       TABLE_CONTAINER_KEY_NETSNMP_INDEX == tad->key_type) {
+                netsnmp_request_info *curr_request;
+
+                for (curr_request = requests; curr_request;
+                     curr_request = curr_request->next)
+                    _bulk_window(handler, reginfo, agtreq_info,
+                                 curr_request, tad);
             }
 
             agtreq_info->mode = oldmode; /* restore saved mode */
@@ -39,6 +39,11 @@ extern netsnmp_cache *netsnmp_cache_get_head(void);
 
 #define  NSCACHE_TIMEOUT	2
 #define  NSCACHE_STATUS		3
+#define  NSCACHE_LOADS		4
+#define  NSCACHE_GROUP_NAME	5
+#define  NSCACHE_MAX_STALE	6
+#define  NSCACHE_LOAD_TIME	7
+#define  NSCACHE_LOAD_TIME_MAX	8
 
 #define NSCACHE_STATUS_ENABLED  1
 #define NSCACHE_STATUS_DISABLED 2
@@ -88,7 +93,7 @@ init_nsCache(void)
     }
     netsnmp_table_helper_add_indexes(table_info, ASN_PRIV_IMPLIED_OBJECT_ID, 0);
     table_info->min_column = NSCACHE_TIMEOUT;
-    table_info->max_column = NSCACHE_STATUS;
+    table_info->max_column = NSCACHE_LOAD_TIME_MAX;
 
 
     /*
@@ -273,6 +278,8 @@ handle_nsCacheTable(netsnmp_mib_handler *handler,
                 netsnmp_request_info *requests)
 {
     long status;
+    u_long loads, ms;
+    const char *group;
     netsnmp_request_info       *request     = NULL;
     netsnmp_table_request_info *table_info  = NULL;
     netsnmp_cache              *cache_entry = NULL;
@@ -316,6 +323,48 @@ handle_nsCacheTable(netsnmp_mib_handler *handler,
                                          (u_char*)&status, sizeof(status));
 	        break;
 
+            case NSCACHE_LOADS:
+                if (!cache_entry) {
+                    netsnmp_set_request_error(reqinfo, request, SNMP_NOSUCHINSTANCE);
+                    continue;
+		}
+		loads = cache_entry->loads;
+	        snmp_set_var_typed_value(request->requestvb, ASN_COUNTER,
+                                         (u_char*)&loads, sizeof(loads));
+	        break;
+
+            case NSCACHE_GROUP_NAME:
+                if (!cache_entry) {
+                    netsnmp_set_request_error(reqinfo, request, SNMP_NOSUCHINSTANCE);
+                    continue;
+		}
+		group = netsnmp_cache_group_name(cache_entry);
+	        snmp_set_var_typed_value(request->requestvb, ASN_OCTET_STR,
+                                         group, group ? strlen(group) : 0);
+	        break;
+
+            case NSCACHE_MAX_STALE:
+                if (!cache_entry) {
+                    netsnmp_set_request_error(reqinfo, request, SNMP_NOSUCHINSTANCE);
+                    continue;
+		}
+		status = cache_entry->max_stale;
+	        snmp_set_var_typed_value(request->requestvb, ASN_INTEGER,
+                                         (u_char*)&status, sizeof(status));
+	        break;
+
+            case NSCACHE_LOAD_TIME:
+            case NSCACHE_LOAD_TIME_MAX:
+                if (!cache_entry) {
+                    netsnmp_set_request_error(reqinfo, request, SNMP_NOSUCHINSTANCE);
+                    continue;
+		}
+		ms = (table_info->colnum == NSCACHE_LOAD_TIME) ?
+                    cache_entry->load_time : cache_entry->load_time_max;
+	        snmp_set_var_typed_value(request->requestvb, ASN_UNSIGNED,
+                                         (u_char*)&ms, sizeof(ms));
+	        break;
+
             default:
                 netsnmp_set_request_error(reqinfo, request, SNMP_NOSUCHOBJECT);
                 continue;
@@ -369,6 +418,28 @@ handle_nsCacheTable(netsnmp_mib_handler *handler,
                 }
 	        break;
 
+            case NSCACHE_MAX_STALE:
+                if (!cache_entry) {
+                    netsnmp_set_request_error(reqinfo, request, SNMP_ERR_NOCREATION);
+                    return SNMP_ERR_NOCREATION;
+		}
+                if ( request->requestvb->type != ASN_INTEGER ) {
+                    netsnmp_set_request_error(reqinfo, request, SNMP_ERR_WRONGTYPE);
+                    return SNMP_ERR_WRONGTYPE;
+                }
+                if (*request->requestvb->val.integer < 0 ) {
+                    netsnmp_set_request_error(reqinfo, request, SNMP_ERR_WRONGVALUE);
+                    return SNMP_ERR_WRONGVALUE;
+                }
+	        break;
+
+            case NSCACHE_LOADS:
+            case NSCACHE_GROUP_NAME:
+            case NSCACHE_LOAD_TIME:
+            case NSCACHE_LOAD_TIME_MAX:
+                netsnmp_set_request_error(reqinfo, request, SNMP_ERR_NOTWRITABLE);
+                return SNMP_ERR_NOTWRITABLE;
+
             default:
                 netsnmp_set_request_error(reqinfo, request, SNMP_ERR_NOCREATION);
                 return SNMP_ERR_NOCREATION;	/* XXX - is this right ? */
@@ -420,6 +491,10 @@ handle_nsCacheTable(netsnmp_mib_handler *handler,
                         break;
 		}
 	        break;
+
+            case NSCACHE_MAX_STALE:
+                cache_entry->max_stale = *request->requestvb->val.integer;
+	        break;
 	    }
 	}
 	break;
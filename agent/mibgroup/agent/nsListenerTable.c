@@ -0,0 +1,220 @@
+/*
+ * nsListenerTable: one row per socket the agent receives requests on,
+ * with the receive buffer size and the number of requests the kernel
+ * dropped because that buffer was full.
+ */
+
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-features.h>
+
+#if HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#if HAVE_NETINET_IN_H
+#include <netinet/in.h>
+#endif
+#if HAVE_ARPA_INET_H
+#include <arpa/inet.h>
+#endif
+
+#include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/agent/net-snmp-agent-includes.h>
+#include <net-snmp/library/snmpSocketBaseDomain.h>
+
+#include <net-snmp/agent/table.h>
+#include <net-snmp/agent/table_iterator.h>
+#include "nsListenerTable.h"
+
+/** Initializes the nsListenerTable module */
+void
+init_nsListenerTable(void)
+{
+    const oid nsListenerTable_oid[] = { 1, 3, 6, 1, 4, 1, 8072, 1, 10, 1 };
+    netsnmp_table_registration_info *table_info;
+    netsnmp_handler_registration *my_handler;
+    netsnmp_iterator_info *iinfo;
+
+    table_info = SNMP_MALLOC_TYPEDEF(netsnmp_table_registration_info);
+    iinfo = SNMP_MALLOC_TYPEDEF(netsnmp_iterator_info);
+
+    my_handler = netsnmp_create_handler_registration(
+        "nsListenerTable", nsListenerTable_handler,
+        nsListenerTable_oid, OID_LENGTH(nsListenerTable_oid),
+        HANDLER_CAN_RONLY);
+
+    if (!my_handler || !table_info || !iinfo) {
+        if (my_handler)
+            netsnmp_handler_registration_free(my_handler);
+        SNMP_FREE(table_info);
+        SNMP_FREE(iinfo);
+        return;                 /* mallocs failed */
+    }
+
+    netsnmp_table_helper_add_index(table_info, ASN_UNSIGNED);  /* nsListenerIndex */
+
+    table_info->min_column = COLUMN_NSLISTENERDOMAIN;
+    table_info->max_column = COLUMN_NSLISTENERRCVDROPS;
+    iinfo->get_first_data_point = nsListenerTable_get_first_data_point;
+    iinfo->get_next_data_point = nsListenerTable_get_next_data_point;
+    iinfo->table_reginfo = table_info;
+
+    DEBUGMSGTL(("nsListenerTable",
+                "Registering table nsListenerTable as a table iterator\n"));
+    netsnmp_register_table_iterator2(my_handler, iinfo);
+}
+
+/*
+ * The rows are the agent NSAPs, in the order of their handles.  The loop
+ * context holds the handle of the current row, the data context its
+ * transport.
+ */
+netsnmp_variable_list *
+nsListenerTable_get_first_data_point(void **my_loop_context,
+                                     void **my_data_context,
+                                     netsnmp_variable_list *put_index_data,
+                                     netsnmp_iterator_info *iinfo)
+{
+    *my_loop_context = (void *) (intptr_t) 0;
+    return nsListenerTable_get_next_data_point(my_loop_context,
+                                               my_data_context,
+                                               put_index_data, iinfo);
+}
+
+netsnmp_variable_list *
+nsListenerTable_get_next_data_point(void **my_loop_context,
+                                    void **my_data_context,
+                                    netsnmp_variable_list *put_index_data,
+                                    netsnmp_iterator_info *iinfo)
+{
+    int             handle = (int) (intptr_t) *my_loop_context;
+    netsnmp_transport *t;
+    u_long          index;
+
+    t = netsnmp_agent_nsap_next(&handle);
+    if (t == NULL)
+        return NULL;
+
+    *my_loop_context = (void *) (intptr_t) handle;
+    *my_data_context = (void *) t;
+
+    index = handle;
+    snmp_set_var_value(put_index_data, (u_char *) &index, sizeof(index));
+    return put_index_data;
+}
+
+/*
+ * Formats the local address a socket is bound to as "[address]:port".
+ */
+static size_t
+_nsListener_address(netsnmp_transport *t, char *buf, size_t buf_len)
+{
+    struct sockaddr_storage ss;
+    socklen_t       len = sizeof(ss);
+    char            addr[64];
+    const void     *in_addr;
+    u_short         port;
+
+    buf[0] = '\0';
+    if (t->sock < 0 ||
+        getsockname(t->sock, (struct sockaddr *) &ss, &len) != 0)
+        return 0;
+
+    switch (ss.ss_family) {
+    case AF_INET:
+        in_addr = &((struct sockaddr_in *) &ss)->sin_addr;
+        port = ntohs(((struct sockaddr_in *) &ss)->sin_port);
+        break;
+#ifdef NETSNMP_ENABLE_IPV6
+    case AF_INET6:
+        in_addr = &((struct sockaddr_in6 *) &ss)->sin6_addr;
+        port = ntohs(((struct sockaddr_in6 *) &ss)->sin6_port);
+        break;
+#endif
+    default:
+        return 0;
+    }
+    if (inet_ntop(ss.ss_family, in_addr, addr, sizeof(addr)) == NULL)
+        return 0;
+    snprintf(buf, buf_len, "[%s]:%hu", addr, port);
+    return strlen(buf);
+}
+
+/** handles requests for the nsListenerTable table */
+int
+nsListenerTable_handler(netsnmp_mib_handler *handler,
+                        netsnmp_handler_registration *reginfo,
+                        netsnmp_agent_request_info *reqinfo,
+                        netsnmp_request_info *requests)
+{
+    netsnmp_table_request_info *table_info;
+    netsnmp_variable_list *var;
+    netsnmp_transport *t;
+    char            buf[128];
+    size_t          len;
+    socklen_t       optlen;
+    int             rcvbuf;
+    u_long          drops;
+
+    for (; requests; requests = requests->next) {
+        var = requests->requestvb;
+        if (requests->processed != 0)
+            continue;
+
+        t = (netsnmp_transport *) netsnmp_extract_iterator_context(requests);
+        if (t == NULL) {
+            netsnmp_set_request_error(reqinfo, requests,
+                                      SNMP_NOSUCHINSTANCE);
+            continue;
+        }
+
+        table_info = netsnmp_extract_table_info(requests);
+        if (table_info == NULL)
+            continue;
+
+        switch (reqinfo->mode) {
+        case MODE_GET:
+            switch (table_info->colnum) {
+            case COLUMN_NSLISTENERDOMAIN:
+                snmp_set_var_typed_value(var, ASN_OBJECT_ID,
+                                         (const u_char *) t->domain,
+                                         t->domain_length * sizeof(oid));
+                break;
+
+            case COLUMN_NSLISTENERADDRESS:
+                len = _nsListener_address(t, buf, sizeof(buf));
+                snmp_set_var_typed_value(var, ASN_OCTET_STR,
+                                         (u_char *) buf, len);
+                break;
+
+            case COLUMN_NSLISTENERRCVBUF:
+                rcvbuf = 0;
+                optlen = sizeof(rcvbuf);
+                if (t->sock < 0 ||
+                    getsockopt(t->sock, SOL_SOCKET, SO_RCVBUF,
+                               (void *) &rcvbuf, &optlen) != 0)
+                    rcvbuf = 0;
+                snmp_set_var_typed_value(var, ASN_INTEGER,
+                                         (u_char *) &rcvbuf, sizeof(rcvbuf));
+                break;
+
+            case COLUMN_NSLISTENERRCVDROPS:
+                if (t->sock < 0 ||
+                    netsnmp_sock_get_rcv_drops(t->sock, &drops) != 0)
+                    drops = 0;
+                snmp_set_var_typed_value(var, ASN_COUNTER,
+                                         (u_char *) &drops, sizeof(drops));
+                break;
+
+            default:
+                snmp_log(LOG_ERR,
+                         "problem encountered in nsListenerTable_handler: unknown column\n");
+            }
+            break;
+
+        default:
+            snmp_log(LOG_ERR,
+                     "problem encountered in nsListenerTable_handler: unsupported mode\n");
+        }
+    }
+    return SNMP_ERR_NOERROR;
+}
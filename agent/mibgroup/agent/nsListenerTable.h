@@ -0,0 +1,23 @@
+/*
+ * nsListenerTable: the sockets the agent receives requests on
+ */
+#ifndef NSLISTENERTABLE_H
+#define NSLISTENERTABLE_H
+
+/*
+ * function declarations
+ */
+void            init_nsListenerTable(void);
+Netsnmp_Node_Handler nsListenerTable_handler;
+Netsnmp_First_Data_Point nsListenerTable_get_first_data_point;
+Netsnmp_Next_Data_Point nsListenerTable_get_next_data_point;
+
+/*
+ * column number definitions for table nsListenerTable
+ */
+#define COLUMN_NSLISTENERINDEX		1
+#define COLUMN_NSLISTENERDOMAIN		2
+#define COLUMN_NSLISTENERADDRESS	3
+#define COLUMN_NSLISTENERRCVBUF		4
+#define COLUMN_NSLISTENERRCVDROPS	5
+#endif                          /* NSLISTENERTABLE_H */
@@ -41,7 +41,8 @@ initialize_table_nsModuleTable(void)
                                                      nsModuleTable_oid,
                                                      OID_LENGTH
                                                      (nsModuleTable_oid),
-                                                     HANDLER_CAN_RWRITE);
+                                                     HANDLER_CAN_RWRITE |
+                                                     HANDLER_CAN_BULK_NEXT);
 
     if (!my_handler || !table_info || !iinfo) {
         if (my_handler)
@@ -60,7 +61,7 @@ initialize_table_nsModuleTable(void)
                                      0);
 
     table_info->min_column = 4;
-    table_info->max_column = 6;
+    table_info->max_column = 9;
 
     /*
      * iterator access routines 
@@ -87,6 +88,7 @@ init_nsModuleTable(void)
      * here we initialize all the tables we're planning on supporting 
      */
     initialize_table_nsModuleTable();
+    initialize_table_nsModuleLatencyTable();
 }
 
 /** returns the first data point within the nsModuleTable table data.
@@ -213,6 +215,8 @@ nsModuleTable_handler(netsnmp_mib_handler *handler,
     netsnmp_request_info *request;
     netsnmp_variable_list *var;
     netsnmp_subtree *tree;
+    netsnmp_handler_stats stats;
+    struct counter64 c64;
     u_long          ultmp;
     u_char          modes[1];
 
@@ -263,6 +267,7 @@ nsModuleTable_handler(netsnmp_mib_handler *handler,
         if (table_info == NULL) {
             continue;
         }
+        netsnmp_handler_stats_get(tree ? tree->reginfo : NULL, &stats);
 
         switch (reqinfo->mode) {
             /*
@@ -304,6 +309,26 @@ nsModuleTable_handler(netsnmp_mib_handler *handler,
                                          sizeof(u_long));
                 break;
 
+            case COLUMN_NSMODULECALLS:
+                ultmp = stats.calls & 0xffffffff;
+                snmp_set_var_typed_value(var, ASN_COUNTER,
+                                         (u_char *) & ultmp,
+                                         sizeof(u_long));
+                break;
+
+            case COLUMN_NSMODULECALLTIME:
+                c64 = stats.usecs;
+                snmp_set_var_typed_value(var, ASN_COUNTER64,
+                                         (u_char *) & c64, sizeof(c64));
+                break;
+
+            case COLUMN_NSMODULECALLTIMEMAX:
+                ultmp = stats.max_usecs & 0xffffffff;
+                snmp_set_var_typed_value(var, ASN_UNSIGNED,
+                                         (u_char *) & ultmp,
+                                         sizeof(u_long));
+                break;
+
             default:
                 /*
                  * We shouldn't get here 
@@ -320,3 +345,222 @@ nsModuleTable_handler(netsnmp_mib_handler *handler,
     }
     return SNMP_ERR_NOERROR;
 }
+
+/*
+ * nsModuleLatencyTable: the non-empty buckets of the latency histograms
+ * of the registrations, in the same order as nsModuleTable.  The data
+ * context of a row is the registration; its last index is the bucket.
+ */
+typedef struct latency_ptr_s {
+    netsnmp_subtree *tree;
+    subtree_context_cache *context_ptr;
+    int             bucket;
+} latency_ptr;
+
+void
+initialize_table_nsModuleLatencyTable(void)
+{
+    const oid nsModuleLatencyTable_oid[] =
+        { 1, 3, 6, 1, 4, 1, 8072, 1, 2, 2 };
+    netsnmp_table_registration_info *table_info;
+    netsnmp_handler_registration *my_handler;
+    netsnmp_iterator_info *iinfo;
+
+    table_info = SNMP_MALLOC_TYPEDEF(netsnmp_table_registration_info);
+    iinfo = SNMP_MALLOC_TYPEDEF(netsnmp_iterator_info);
+
+    my_handler =
+        netsnmp_create_handler_registration("nsModuleLatencyTable",
+                                            nsModuleLatencyTable_handler,
+                                            nsModuleLatencyTable_oid,
+                                            OID_LENGTH
+                                            (nsModuleLatencyTable_oid),
+                                            HANDLER_CAN_RONLY);
+
+    if (!my_handler || !table_info || !iinfo) {
+        if (my_handler)
+            netsnmp_handler_registration_free(my_handler);
+        SNMP_FREE(table_info);
+        SNMP_FREE(iinfo);
+        return;                 /* mallocs failed */
+    }
+
+    netsnmp_table_helper_add_indexes(table_info, ASN_OCTET_STR, /* context name */
+                                     ASN_OBJECT_ID,     /* reg point */
+                                     ASN_INTEGER,       /* priority */
+                                     ASN_UNSIGNED,      /* bucket */
+                                     0);
+
+    table_info->min_column = COLUMN_NSMODULELATENCYLIMIT;
+    table_info->max_column = COLUMN_NSMODULELATENCYCALLS;
+
+    iinfo->get_first_data_point = nsModuleLatencyTable_get_first_data_point;
+    iinfo->get_next_data_point = nsModuleLatencyTable_get_next_data_point;
+    iinfo->free_loop_context_at_end = nsModuleTable_free;
+    iinfo->table_reginfo = table_info;
+
+    DEBUGMSGTL(("initialize_table_nsModuleLatencyTable",
+                "Registering table nsModuleLatencyTable as a table iterator\n"));
+    netsnmp_register_table_iterator2(my_handler, iinfo);
+}
+
+/*
+ * Moves lptr on to the next non-empty bucket, starting with the one it
+ * points at, and sets the indexes of that row.
+ */
+static netsnmp_variable_list *
+_nsModuleLatencyTable_find(latency_ptr *lptr, void **my_data_context,
+                           netsnmp_variable_list *put_index_data)
+{
+    netsnmp_variable_list *vptr;
+    netsnmp_handler_stats stats;
+    u_long          ultmp;
+
+    while (lptr->context_ptr) {
+        for (; lptr->tree; lptr->tree = lptr->tree->next, lptr->bucket = 0) {
+            if (!netsnmp_handler_stats_get(lptr->tree->reginfo, &stats))
+                continue;
+            for (; lptr->bucket < NETSNMP_HANDLER_STATS_BUCKETS;
+                 lptr->bucket++) {
+                if (stats.histogram[lptr->bucket] != 0)
+                    break;
+            }
+            if (lptr->bucket < NETSNMP_HANDLER_STATS_BUCKETS)
+                break;
+        }
+        if (lptr->tree)
+            break;
+        lptr->context_ptr = lptr->context_ptr->next;
+        if (lptr->context_ptr)
+            lptr->tree = lptr->context_ptr->first_subtree;
+        lptr->bucket = 0;
+    }
+    if (lptr->context_ptr == NULL)
+        return NULL;
+
+    *my_data_context = lptr->tree->reginfo;
+
+    vptr = put_index_data;
+    snmp_set_var_value(vptr, lptr->context_ptr->context_name,
+                       strlen(lptr->context_ptr->context_name));
+
+    vptr = vptr->next_variable;
+    snmp_set_var_value(vptr, lptr->tree->name_a,
+                       lptr->tree->namelen * sizeof(oid));
+
+    ultmp = lptr->tree->priority;
+    vptr = vptr->next_variable;
+    snmp_set_var_value(vptr, & ultmp, sizeof(ultmp));
+
+    ultmp = lptr->bucket + 1;
+    vptr = vptr->next_variable;
+    snmp_set_var_value(vptr, & ultmp, sizeof(ultmp));
+
+    return put_index_data;
+}
+
+netsnmp_variable_list *
+nsModuleLatencyTable_get_first_data_point(void **my_loop_context,
+                                          void **my_data_context,
+                                          netsnmp_variable_list *
+                                          put_index_data,
+                                          netsnmp_iterator_info *otherstuff)
+{
+    latency_ptr    *lptr;
+
+    lptr = SNMP_MALLOC_TYPEDEF(latency_ptr);
+    if (!lptr)
+        return NULL;
+
+    lptr->context_ptr = get_top_context_cache();
+    if (lptr->context_ptr)
+        lptr->tree = lptr->context_ptr->first_subtree;
+
+    *my_loop_context = lptr;
+    return _nsModuleLatencyTable_find(lptr, my_data_context,
+                                      put_index_data);
+}
+
+netsnmp_variable_list *
+nsModuleLatencyTable_get_next_data_point(void **my_loop_context,
+                                         void **my_data_context,
+                                         netsnmp_variable_list *
+                                         put_index_data,
+                                         netsnmp_iterator_info *otherstuff)
+{
+    latency_ptr    *lptr = (latency_ptr *) * my_loop_context;
+
+    lptr->bucket++;
+    return _nsModuleLatencyTable_find(lptr, my_data_context,
+                                      put_index_data);
+}
+
+/** handles requests for the nsModuleLatencyTable table */
+int
+nsModuleLatencyTable_handler(netsnmp_mib_handler *handler,
+                             netsnmp_handler_registration *reginfo,
+                             netsnmp_agent_request_info *reqinfo,
+                             netsnmp_request_info *requests)
+{
+    netsnmp_table_request_info *table_info;
+    netsnmp_request_info *request;
+    netsnmp_variable_list *var, *idx;
+    netsnmp_handler_registration *module;
+    netsnmp_handler_stats stats;
+    u_long          ultmp, bucket;
+
+    for (request = requests; request; request = request->next) {
+        var = request->requestvb;
+        if (request->processed != 0)
+            continue;
+
+        module = (netsnmp_handler_registration *)
+            netsnmp_extract_iterator_context(request);
+        table_info = netsnmp_extract_table_info(request);
+        if (module == NULL || table_info == NULL) {
+            netsnmp_set_request_error(reqinfo, request,
+                                      SNMP_NOSUCHINSTANCE);
+            continue;
+        }
+        idx = table_info->indexes->next_variable->next_variable->next_variable;
+        bucket = *idx->val.integer - 1;
+        if (bucket >= NETSNMP_HANDLER_STATS_BUCKETS) {
+            netsnmp_set_request_error(reqinfo, request,
+                                      SNMP_NOSUCHINSTANCE);
+            continue;
+        }
+
+        switch (reqinfo->mode) {
+        case MODE_GET:
+            switch (table_info->colnum) {
+            case COLUMN_NSMODULELATENCYLIMIT:
+                if (bucket < NETSNMP_HANDLER_STATS_BUCKETS - 1)
+                    ultmp = 1UL << bucket;
+                else
+                    ultmp = 0;
+                snmp_set_var_typed_value(var, ASN_UNSIGNED,
+                                         (u_char *) & ultmp,
+                                         sizeof(u_long));
+                break;
+
+            case COLUMN_NSMODULELATENCYCALLS:
+                netsnmp_handler_stats_get(module, &stats);
+                ultmp = stats.histogram[bucket] & 0xffffffff;
+                snmp_set_var_typed_value(var, ASN_COUNTER,
+                                         (u_char *) & ultmp,
+                                         sizeof(u_long));
+                break;
+
+            default:
+                snmp_log(LOG_ERR,
+                         "problem encountered in nsModuleLatencyTable_handler: unknown column\n");
+            }
+            break;
+
+        default:
+            snmp_log(LOG_ERR,
+                     "problem encountered in nsModuleLatencyTable_handler: unsupported mode\n");
+        }
+    }
+    return SNMP_ERR_NOERROR;
+}
@@ -15,6 +15,12 @@ Netsnmp_Node_Handler nsModuleTable_handler;
 Netsnmp_First_Data_Point nsModuleTable_get_first_data_point;
 Netsnmp_Next_Data_Point nsModuleTable_get_next_data_point;
 
+void            initialize_table_nsModuleLatencyTable(void);
+Netsnmp_Node_Handler nsModuleLatencyTable_handler;
+
+Netsnmp_First_Data_Point nsModuleLatencyTable_get_first_data_point;
+Netsnmp_Next_Data_Point nsModuleLatencyTable_get_next_data_point;
+
 /*
  * column number definitions for table nsModuleTable 
  */
@@ -24,4 +30,14 @@ Netsnmp_Next_Data_Point nsModuleTable_get_next_data_point;
 #define COLUMN_NSMODULENAME		4
 #define COLUMN_NSMODULEMODES		5
 #define COLUMN_NSMODULETIMEOUT		6
+#define COLUMN_NSMODULECALLS		7
+#define COLUMN_NSMODULECALLTIME		8
+#define COLUMN_NSMODULECALLTIMEMAX	9
+
+/*
+ * column number definitions for table nsModuleLatencyTable
+ */
+#define COLUMN_NSMODULELATENCYBUCKET	1
+#define COLUMN_NSMODULELATENCYLIMIT	2
+#define COLUMN_NSMODULELATENCYCALLS	3
 #endif                          /* NSMODULETABLE_H */
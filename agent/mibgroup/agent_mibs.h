@@ -1,5 +1,6 @@
 config_require(agent/nsTransactionTable)
 config_require(agent/nsModuleTable)
+config_require(agent/nsListenerTable)
 #ifndef NETSNMP_NO_DEBUGGING
 config_require(agent/nsDebug)
 #endif
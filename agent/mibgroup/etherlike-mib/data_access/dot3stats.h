@@ -4,4 +4,5 @@
 
 #if defined(linux)
 config_require(etherlike-mib/data_access/dot3stats_linux)
+config_require(util_funcs/ethtool_stats)
 #endif
@@ -20,133 +20,6 @@
 #include "etherlike-mib/dot3StatsTable/dot3StatsTable_data_access.h"
 #include "etherlike-mib/dot3StatsTable/ioctl_imp_common.h"
 
-/*
- * @retval  0 success
- * @retval -1 getifaddrs failed 
- * @retval -2 memory allocation failed
- */
-
-struct ifname *
-dot3stats_interface_name_list_get (struct ifname *list_head, int *retval)
-{
-    struct ifaddrs *addrs = NULL, *p = NULL;
-    struct ifname *nameptr1=NULL, *nameptr2 = NULL;
-
-    DEBUGMSGTL(("access:dot3StatsTable:interface_name_list_get",
-                "called\n"));
-
-    if ((getifaddrs(&addrs)) < 0) {
-        DEBUGMSGTL(("access:dot3StatsTable:interface_name_list_get",
-                    "getifaddrs failed\n"));
-        snmp_log (LOG_ERR, "access:dot3StatsTable,interface_name_list_get, getifaddrs failed\n");
-        *retval = -1;
-        return NULL;
-    }
-
-    for (p = addrs; p; p = p->ifa_next) {
-
-        if (!list_head) {
-            list_head = malloc(sizeof(struct ifname));
-            if (!list_head) {
-                DEBUGMSGTL(("access:dot3StatsTable:interface_name_list_get",
-                            "memory allocation failed\n"));
-                snmp_log (LOG_ERR, "access:dot3StatsTable,interface_name_list_get, memory allocation failed\n");
-                freeifaddrs(addrs);
-                *retval = -2;
-                return NULL;
-            }
-            memset(list_head, 0, sizeof (struct ifname));
-            strlcpy(list_head->name, p->ifa_name, IF_NAMESIZE);
-            continue;
-        }
-
-         for (nameptr1 = list_head; nameptr1; nameptr2 = nameptr1, nameptr1 = nameptr1->ifn_next)
-            if (!strncmp(p->ifa_name, nameptr1->name, IF_NAMESIZE))
-                break;
-
-        if (nameptr1)
-            continue;
-
-        nameptr2->ifn_next = malloc(sizeof(struct ifname));
-        if (!nameptr2->ifn_next) {
-            DEBUGMSGTL(("access:dot3StatsTable:interface_name_list_get",
-                        "memory allocation failed\n"));
-            snmp_log (LOG_ERR, "access:dot3StatsTable,interface_name_list_get, memory allocation failed\n");
-            dot3stats_interface_name_list_free (list_head);
-            freeifaddrs(addrs);
-            *retval = -2;
-            return NULL;
-        }
-        nameptr2 = nameptr2->ifn_next;
-        memset(nameptr2, 0, sizeof (struct ifname));
-        strlcpy(nameptr2->name, p->ifa_name, IF_NAMESIZE);
-        continue;
-
-    }
-
-    freeifaddrs(addrs);
-    return list_head;
-}
-
-/*
- * @retval 0 success
- * @retval -1 invalid pointer
- */
-
-int
-dot3stats_interface_name_list_free (struct ifname *list_head)
-{
-    struct ifname *nameptr1 = NULL, *nameptr2 = NULL;
-
-    DEBUGMSGTL(("access:dot3StatsTable:interface_name_list_free",
-                "called\n"));
-
-    if (!list_head) {
-        snmp_log (LOG_ERR, "access:dot3StatsTable:interface_name_list_free: invalid pointer list_head");
-        DEBUGMSGTL(("access:dot3StatsTable:interface_name_list_free",
-                    "invalid pointer list_head\n"));
-        return -1;
-    }
-
-    for (nameptr1 = list_head; nameptr1; nameptr1 = nameptr2) {
-            nameptr2 = nameptr1->ifn_next;
-            free (nameptr1);
-    }
-
-    return 0;
-}
-
-/*
- * @retval  0 : not found
- * @retval !0 : ifIndex
- */
-
-int 
-dot3stats_interface_ioctl_ifindex_get (int fd, const char *name) {
-#ifndef SIOCGIFINDEX
-    return 0;
-#else
-    struct ifreq    ifrq;
-    int rc = 0;
-
-    if (!netsnmp_access_interface_include(name))
-        return 0;
-
-    DEBUGMSGTL(("access:dot3StatsTable:interface_ioctl_ifindex_get", "called\n"));
-                 
-    rc = _dot3Stats_ioctl_get(fd, SIOCGIFINDEX, &ifrq, name);
-    if (rc < 0) {
-        DEBUGMSGTL(("access:dot3StatsTable:interface_ioctl_ifindex_get",
-                    "error on interface '%s'\n", name));
-        snmp_log (LOG_ERR, "access:dot3StatsTable:interface_ioctl_ifindex_get, error on interface '%s'\n", name);
-        return 0;
-
-    }
-
-    return ifrq.ifr_ifindex;
-#endif /* SIOCGIFINDEX */
-}
-
 # if HAVE_LINUX_RTNETLINK_H /* { NETLINK */
 /*
  * The following code is based upon code I got from Stephen Hemminger
@@ -411,42 +284,74 @@ rtnl_dump_filter(struct rtnl_handle *rth,
     return rtnl_dump_filter_l(rth, a);
 }
 
-int
-_dot3Stats_netlink_get_errorcntrs(dot3StatsTable_rowreq_ctx *rowreq_ctx, const char *name)
+/*
+ * Dumps the link statistics of all interfaces into kern_db.  A dump less
+ * than NETSNMP_ETHTOOL_STATS_AGE milliseconds old, i.e. one made for an
+ * earlier interface of the same load, is used as it is.
+ *
+ * @retval 0 ok, 1 no statistics
+ */
+static int
+_dot3Stats_netlink_dump(void)
 {
+    static struct timeval dumped_at;    /* monotonic */
+    static int      dump_rc = -1;
     struct rtnl_handle rth;
     struct ifstat_ent *ke;
-    int done;
+    struct timeval  now;
+    long            age;
+
+    netsnmp_get_monotonic_clock(&now);
+    age = (now.tv_sec - dumped_at.tv_sec) * 1000 +
+          (now.tv_usec - dumped_at.tv_usec) / 1000;
+    if (dump_rc >= 0 && age >= 0 && age < NETSNMP_ETHTOOL_STATS_AGE)
+        return dump_rc;
+
+    while ((ke = kern_db) != NULL) {
+        kern_db = ke->next;
+        free(ke->name);
+        free(ke);
+    }
+    dumped_at = now;
+    dump_rc = 1;
 
     if (rtnl_open(&rth, 0) < 0)
     {
         snmp_log(LOG_ERR, "_dot3Stats_netlink_get_errorcntrs: rtnl_open() failed\n");
-        return 1;
+        return dump_rc;
     }
 
     if (rtnl_wilddump_request(&rth, AF_INET, RTM_GETLINK) < 0)
     {
         snmp_log(LOG_ERR, "_dot3Stats_netlink_get_errorcntrs: Cannot send dump request");
         rtnl_close(&rth);
-        return 1;
+        return dump_rc;
     }
 
     if (rtnl_dump_filter(&rth, get_nlmsg, NULL, NULL, NULL) < 0)
     {
         snmp_log(LOG_ERR, "_dot3Stats_netlink_get_errorcntrs: Dump terminated\n");
         rtnl_close(&rth);
-        return 1;
+        return dump_rc;
     }
 
     rtnl_close(&rth);
+    dump_rc = 0;
+    return dump_rc;
+}
+
+int
+_dot3Stats_netlink_get_errorcntrs(dot3StatsTable_rowreq_ctx *rowreq_ctx, const char *name)
+{
+    struct ifstat_ent *ke;
+
+    if (_dot3Stats_netlink_dump() != 0)
+        return 1;
 
     /*
      * Now scan kern_db for this if's data
-     * While doing so, we'll throw away the kern db.
      */
-    done = 0;
-
-    while ((ke = kern_db) != NULL)
+    for (ke = kern_db; ke; ke = ke->next)
     {
         if (strcmp(ke->name, name) == 0)
         {
@@ -472,14 +377,11 @@ _dot3Stats_netlink_get_errorcntrs(dot3StatsTable_rowreq_ctx *rowreq_ctx, const c
             data->dot3StatsInternalMacReceiveErrors = ke->stats.rx_fifo_errors;
             rowreq_ctx->column_exists_flags |= COLUMN_DOT3STATSINTERNALMACRECEIVEERRORS_FLAG;
 
-            done = 1;
+            return 0;
         }
-        kern_db = ke->next;
-        free(ke->name);
-        free(ke);
     }
 
-    return !done;
+    return 1;
 }
 # else /* }{ */
 int
@@ -642,152 +544,87 @@ interface_dot3stats_get_errorcounters (dot3StatsTable_rowreq_ctx *rowreq_ctx, co
 }
 
 /*
- * @retval  0 success
- * @retval -1 cannot get ETHTOOL_DRVINFO failed 
- * @retval -2 nstats zero - no statistcs available
- * @retval -3 memory allocation for holding the statistics failed
- * @retval -4 cannot get ETHTOOL_GSTRINGS information
- * @retval -5 cannot get ETHTOOL_GSTATS information
- * @retval -6 function not supported if HAVE_LINUX_ETHTOOL_H not defined
+ * The driver statistics that make up the columns.  A column is set to
+ * the last statistic that matches it.
  */
+static const netsnmp_ethtool_name dot3stats_names[] = {
+    { INTEL_RECEIVE_ALIGN_ERRORS,                  1,
+      COLUMN_DOT3STATSALIGNMENTERRORS_FLAG },
+    { DSA_RECEIVE_FCS_ERROR,                       1,
+      COLUMN_DOT3STATSFCSERRORS_FLAG },
+    { INTEL_TRANSMIT_MULTIPLE_COLLISIONS,          1,
+      COLUMN_DOT3STATSMULTIPLECOLLISIONFRAMES_FLAG },
+    { DSA_TRANSMIT_MULTIPLE_COLLISIONS,            0,
+      COLUMN_DOT3STATSMULTIPLECOLLISIONFRAMES_FLAG },
+    { BROADCOM_TRANSMIT_MULTIPLE_COLLISIONS_BNX2,  1,
+      COLUMN_DOT3STATSMULTIPLECOLLISIONFRAMES_FLAG },
+    { BROADCOM_TRANSMIT_MULTIPLE_COLLISIONS_TG3,   1,
+      COLUMN_DOT3STATSMULTIPLECOLLISIONFRAMES_FLAG },
+    { INTEL_TRANSMIT_LATE_COLLISIONS,              1,
+      COLUMN_DOT3STATSLATECOLLISIONS_FLAG },
+    { DSA_TRANSMIT_LATE_COLLISIONS,                0,
+      COLUMN_DOT3STATSLATECOLLISIONS_FLAG },
+    { BROADCOM_TRANSMIT_LATE_COLLISIONS,           1,
+      COLUMN_DOT3STATSLATECOLLISIONS_FLAG },
+    { INTEL_TRANSMIT_SINGLE_COLLISIONS,            1,
+      COLUMN_DOT3STATSSINGLECOLLISIONFRAMES_FLAG },
+    { DSA_TRANSMIT_SINGLE_COLLISIONS,              0,
+      COLUMN_DOT3STATSSINGLECOLLISIONFRAMES_FLAG },
+    { BROADCOM_TRANSMIT_SINGLE_COLLISIONS,         1,
+      COLUMN_DOT3STATSSINGLECOLLISIONFRAMES_FLAG },
+    { BROADCOM_TRANSMIT_EXCESS_COLLISIONS_BNX2,    1,
+      COLUMN_DOT3STATSEXCESSIVECOLLISIONS_FLAG },
+    { BROADCOM_TRANSMIT_EXCESS_COLLISIONS_TG3,     1,
+      COLUMN_DOT3STATSEXCESSIVECOLLISIONS_FLAG },
+    { DSA_TRANSMIT_EXCESS_COLLISIONS,              0,
+      COLUMN_DOT3STATSEXCESSIVECOLLISIONS_FLAG },
+    { DSA_TRANSMIT_DEFERRED,                       0,
+      COLUMN_DOT3STATSDEFERREDTRANSMISSIONS_FLAG },
+    { NULL,                                        0, 0 }
+};
 
-
-int 
-interface_ioctl_dot3stats_get (dot3StatsTable_rowreq_ctx *rowreq_ctx, int fd, const char *name) {
-
-#ifdef HAVE_LINUX_ETHTOOL_H
+/*
+ * NAME: interface_ethtool_dot3stats_get
+ * PURPOSE: To set the columns from the ethtool statistics of an interface
+ * ARGUMENTS: rowreq_ctx: where to store the value(s)
+ *      port: the interface, from netsnmp_ethtool_stats_ports()
+ * RETURNS: nothing. fields not set if data not available
+ */
+void
+interface_ethtool_dot3stats_get(dot3StatsTable_rowreq_ctx *rowreq_ctx,
+                                const netsnmp_ethtool_port *port)
+{
+    static int      consumer = -1;
     dot3StatsTable_data *data = &rowreq_ctx->data;
-    struct ethtool_drvinfo driver_info;
-    struct ethtool_gstrings *eth_strings;
-    struct ethtool_stats *eth_stats;
-    struct ifreq ifr; 
-    unsigned int nstats, size_str, i;
-    int err;
-
-    DEBUGMSGTL(("access:dot3StatsTable:interface_ioctl_dot3Stats_get",
-                "called\n"));
-
-    memset(&ifr, 0, sizeof(ifr));
-    strlcpy(ifr.ifr_name, name, sizeof(ifr.ifr_name));
-
-    memset(&driver_info, 0, sizeof (driver_info));
-    driver_info.cmd = ETHTOOL_GDRVINFO;
-    ifr.ifr_data = (char *)&driver_info;
-
-    err = _dot3Stats_ioctl_get(fd, SIOCETHTOOL, &ifr, name);
-    if (err < 0) {
-        DEBUGMSGTL(("access:dot3StatsTable:interface_ioctl_dot3Stats_get",
-                    "ETHTOOL_GETDRVINFO failed for interface |%s| \n", name));
-        return -1;
-    }
-
-    nstats = driver_info.n_stats;
-    if (nstats < 1) {
-        DEBUGMSGTL(("access:dot3StatsTable:interface_ioctl_dot3Stats_get",
-                    "no stats available for interface |%s| \n", name));
-        return -2;
+    const netsnmp_ethtool_stat *map;
+    size_t          i, len;
+    u_int           columns;
+    u_long          value;
+
+    if (consumer < 0)
+        consumer = netsnmp_ethtool_stats_consumer(dot3stats_names);
+    map = netsnmp_ethtool_stats_map(port->driver, consumer, &len);
+
+    for (i = 0; i < len; i++) {
+        columns = map[i].columns;
+        value = (u_long) port->values[map[i].index];
+        rowreq_ctx->column_exists_flags |= columns;
+
+        if (columns & COLUMN_DOT3STATSALIGNMENTERRORS_FLAG)
+            data->dot3StatsAlignmentErrors = value;
+        if (columns & COLUMN_DOT3STATSFCSERRORS_FLAG)
+            data->dot3StatsFCSErrors = value;
+        if (columns & COLUMN_DOT3STATSMULTIPLECOLLISIONFRAMES_FLAG)
+            data->dot3StatsMultipleCollisionFrames = value;
+        if (columns & COLUMN_DOT3STATSLATECOLLISIONS_FLAG)
+            data->dot3StatsLateCollisions = value;
+        if (columns & COLUMN_DOT3STATSSINGLECOLLISIONFRAMES_FLAG)
+            data->dot3StatsSingleCollisionFrames = value;
+        if (columns & COLUMN_DOT3STATSEXCESSIVECOLLISIONS_FLAG)
+            data->dot3StatsExcessiveCollisions = value;
+        if (columns & COLUMN_DOT3STATSDEFERREDTRANSMISSIONS_FLAG)
+            data->dot3StatsDeferredTransmissions = value;
     }
-
-    size_str = nstats * ETH_GSTRING_LEN;
-
-    eth_strings = malloc(size_str + sizeof (struct ethtool_gstrings));
-    if (!eth_strings) {
-        DEBUGMSGTL(("access:dot3StatsTable:interface_ioctl_dot3Stats_get",
-                    "no memory available\n"));
-        snmp_log (LOG_ERR, "access:dot3StatsTable,interface_ioctl_dot3Stats_get, no memory available\n");
-
-        return -3;
-    }
-    memset (eth_strings, 0, (size_str + sizeof (struct ethtool_gstrings)));
-
-    eth_stats = malloc (size_str + sizeof (struct ethtool_stats));
-    if (!eth_stats) {
-        free (eth_strings);
-        DEBUGMSGTL(("access:dot3StatsTable:interface_ioctl_dot3Stats_get",
-                    "no memory available\n"));
-        snmp_log (LOG_ERR, "access:dot3StatsTable,interface_ioctl_dot3Stats_get, no memory available\n");
-
-        return -3;
-    }
-     memset (eth_stats, 0, (size_str + sizeof (struct ethtool_stats)));
-
-    eth_strings->cmd = ETHTOOL_GSTRINGS;
-    eth_strings->string_set = ETH_SS_STATS;
-    eth_strings->len = nstats;
-    ifr.ifr_data = (char *) eth_strings;
-    err = _dot3Stats_ioctl_get(fd, SIOCETHTOOL, &ifr, name);
-    if (err < 0) {
-        DEBUGMSGTL(("access:dot3StatsTable:interface_ioctl_dot3Stats_get",
-                    "cannot get stats strings information for interface |%s| \n", name));
-        snmp_log (LOG_ERR, "access:dot3StatsTable,interface_ioctl_dot3Stats_get, cannot get stats strings information for interface |%s| \n", name);
-
-        free(eth_strings);
-        free(eth_stats);
-        return -4;
-    }
-
-    eth_stats->cmd = ETHTOOL_GSTATS;
-    eth_stats->n_stats = nstats;
-    ifr.ifr_data = (char *) eth_stats;
-    err = _dot3Stats_ioctl_get(fd, SIOCETHTOOL, &ifr, name);
-    if (err < 0) {
-        DEBUGMSGTL(("access:dot3StatsTable:interface_ioctl_dot3Stats_get",
-                    "cannot get stats strings information for interface |%s| \n", name));
-        snmp_log (LOG_ERR, "access:dot3StatsTable,interface_ioctl_dot3Stats_get, cannot get stats information for interface |%s| \n", name);
-
-        free(eth_strings);
-        free(eth_stats);
-        return -5;
-    }
-
-    for (i = 0; i < nstats; i++) {
-        char s[ETH_GSTRING_LEN];
-
-        strlcpy(s, (const char *) &eth_strings->data[i * ETH_GSTRING_LEN],
-                sizeof(s));
-    
-        if (DOT3STATSALIGNMENTERRORS(s)) {
-            data->dot3StatsAlignmentErrors = (u_long)eth_stats->data[i];
-            rowreq_ctx->column_exists_flags |= COLUMN_DOT3STATSALIGNMENTERRORS_FLAG;
-        }
-
-        if (DOT3STATSFCSERRORS(s)) {
-            data->dot3StatsFCSErrors = (u_long)eth_stats->data[i];
-            rowreq_ctx->column_exists_flags |= COLUMN_DOT3STATSFCSERRORS_FLAG;
-        }
-
-        if (DOT3STATSMULTIPLECOLLISIONFRAMES(s)) {
-            data->dot3StatsMultipleCollisionFrames = (u_long)eth_stats->data[i];
-            rowreq_ctx->column_exists_flags |= COLUMN_DOT3STATSMULTIPLECOLLISIONFRAMES_FLAG;
-        }
-            
-        if (DOT3STATSLATECOLLISIONS(s)) {
-            data->dot3StatsLateCollisions = (u_long)eth_stats->data[i];
-            rowreq_ctx->column_exists_flags |= COLUMN_DOT3STATSLATECOLLISIONS_FLAG;
-        }
-
-        if (DOT3STATSSINGLECOLLISIONFRAMES(s)) {
-            data->dot3StatsSingleCollisionFrames = (u_long)eth_stats->data[i];
-            rowreq_ctx->column_exists_flags |= COLUMN_DOT3STATSSINGLECOLLISIONFRAMES_FLAG;
-        }
-
-        if (DOT3STATSEXCESSIVECOLLISIONS(s)) {
-            data->dot3StatsExcessiveCollisions = (u_long)eth_stats->data[i];
-            rowreq_ctx->column_exists_flags |= COLUMN_DOT3STATSEXCESSIVECOLLISIONS_FLAG;
-        }
-        if (DOT3STATSDEFERREDTRANSMISSIONS(s)) {
-            data->dot3StatsDeferredTransmissions = (u_long)eth_stats->data[i];
-            rowreq_ctx->column_exists_flags |= COLUMN_DOT3STATSDEFERREDTRANSMISSIONS_FLAG;
-        }
-    }
-
-    free(eth_strings);
-    free(eth_stats);
-
-    return 0;
-#else
-    return -6;
-#endif
 }
 
 
@@ -864,65 +701,3 @@ interface_sysclassnet_dot3stats_get (dot3StatsTable_rowreq_ctx *rowreq_ctx, cons
 
     return;
 }
-
-
-
-/* ioctl wrapper
- *
- * @param      fd : socket fd to use w/ioctl, or -1 to open/close one
- * @param  which
- * @param ifrq
- * param ifentry : ifentry to update
- * @param name
- *
- * @retval  0 : success
- * @retval -1 : invalid parameters
- * @retval -2 : couldn't create socket
- * @retval -3 : ioctl call failed
- */
-int
-_dot3Stats_ioctl_get(int fd, int which, struct ifreq *ifrq, const char* name)
-{
-    int ourfd = -1, rc = 0;
-
-    DEBUGMSGTL(("access:dot3StatsTable:ioctl", "_dot3Stats_ioctl_get\n"));
-
-    /*
-     * sanity checks
-     */
-    if(NULL == name) {
-        DEBUGMSGTL(("access:dot3StatsTable:ioctl",
-                    "_dot3Stats_ioctl_get interface name is NULL"));
-        snmp_log (LOG_ERR, "access:dot3StatsTable:ioctl, _dot3Stats_ioctl_get interface name is NULL");
-        return -1;
-    }
-
-    /*
-     * create socket for ioctls
-     */
-    if(fd < 0) {
-        fd = ourfd = socket(AF_INET, SOCK_DGRAM, 0);
-        if(ourfd < 0) {
-            DEBUGMSGTL(("access:dot3StatsTable:ioctl",
-                        "dot3Stats_ioctl_get couldn't create a socket\n"));
-            snmp_log (LOG_ERR, "access:dot3StatsTable:ioctl, _dot3Stats_ioctl_get error on interface '%s'\n", name);
-
-            return -2;
-        }
-    }
-
-    strlcpy(ifrq->ifr_name, name, sizeof(ifrq->ifr_name));
-    rc = ioctl(fd, which, ifrq);
-    if (rc < 0) {
-        DEBUGMSGTL(("access:dot3StatsTable:ioctl",
-                    "dot3Stats_ioctl_get ioctl %d returned %d\n", which, rc));
-        rc = -3;
-    }
-
-    if(ourfd >= 0)
-        close(ourfd);
-
-    return rc;
-}
-
-
@@ -11,6 +11,7 @@
 #include <net-snmp/net-snmp-config.h>
 #include <net-snmp/net-snmp-includes.h>
 #include <net-snmp/agent/net-snmp-agent-includes.h>
+#include <net-snmp/data_access/interface.h>
 
 #if HAVE_UNISTD_H
 #include <unistd.h>
@@ -137,6 +138,8 @@ dot3StatsTable_container_init(netsnmp_container ** container_ptr_ptr,
      * cache->enabled to 0.
      */
     cache->timeout = DOT3STATSTABLE_CACHE_TIMEOUT;      /* seconds */
+
+    netsnmp_cache_group_add("interfaces", cache);
 }                               /* dot3StatsTable_container_init */
 
 /**
@@ -218,9 +221,8 @@ dot3StatsTable_container_load(netsnmp_container * container)
     size_t          count = 0;
     int             fd;
 #if defined(linux)
-    long            dot3StatsIndex;
-    int             rc = 0, retval = 0;
-    struct ifname *list_head = NULL, *p = NULL;
+    int             rc = 0;
+    netsnmp_ethtool_port *port;
 #endif
     
     DEBUGMSGTL(("verbose:dot3StatsTable:dot3StatsTable_container_load",
@@ -252,51 +254,30 @@ dot3StatsTable_container_load(netsnmp_container * container)
         return -2;
     }
 
-    /*
-     * get the interface names of the devices present in the system, in case of failure retval suggests the reson for failure
-     * and list_head contains null
-     */
-
 #if defined(linux)
-    list_head = dot3stats_interface_name_list_get (list_head, &retval);
-
-    if (!list_head) {
-        snmp_log (LOG_ERR, "access:dot3StatsTable, error getting the interface names present in the system\n");
-        DEBUGMSGTL(("access:dot3StatsTable", "error getting the interface names present in the system"));
-        close(fd);
-        return MFD_ERROR;
-    }
-    
     /*
-     * Walk over the list of interface names present in the system and retreive the statistics 
+     * Walk over the interfaces with ethtool statistics and retreive the
+     * statistics.  The collector gathers those of all interfaces in one
+     * pass, which the etherStatsTable shares when it loads along.
      */
 
-    for (p = list_head; p; p = p->ifn_next) {
+    for (port = netsnmp_ethtool_stats_ports(); port; port = port->next) {
         dot3StatsTable_rowreq_ctx *rowreq_ctx;
 
-        DEBUGMSGTL(("access:dot3StatsTable", "processing '%s'\n", p->name));
-
-        /*
-         * get index via ioctl.
-         */
+        if (!netsnmp_access_interface_include(port->name))
+            continue;
 
-        dot3StatsIndex = (long) dot3stats_interface_ioctl_ifindex_get(-1, p->name);
+        DEBUGMSGTL(("access:dot3StatsTable", "processing '%s'\n", port->name));
 
-        /* 
-         *    get the dot3stats contents populated, if the device is not an ethernet device
-         *    the operation will not be supported and an error message will be logged
-         */
-        
         rowreq_ctx = dot3StatsTable_allocate_rowreq_ctx(NULL);
         if (NULL == rowreq_ctx) {
             snmp_log(LOG_ERR, "memory allocation for dot3StatsTable failed\n");
-            dot3stats_interface_name_list_free(list_head);
             close(fd);
             return MFD_RESOURCE_UNAVAILABLE;
         }
         
         if (MFD_SUCCESS !=
-            dot3StatsTable_indexes_set(rowreq_ctx, dot3StatsIndex)) {
+            dot3StatsTable_indexes_set(rowreq_ctx, port->ifindex)) {
             snmp_log(LOG_ERR,
                      "error setting index while loading "
                      "dot3StatsTable data.\n");
@@ -314,23 +295,16 @@ dot3StatsTable_container_load(netsnmp_container * container)
 
         memset (&rowreq_ctx->data, 0, sizeof (rowreq_ctx->data));
 
-	interface_sysclassnet_dot3stats_get(rowreq_ctx, p->name);
+	interface_sysclassnet_dot3stats_get(rowreq_ctx, port->name);
 
-	interface_dot3stats_get_errorcounters(rowreq_ctx, p->name);
+	interface_dot3stats_get_errorcounters(rowreq_ctx, port->name);
 
-        rc = interface_ioctl_dot3stats_get (rowreq_ctx, fd, p->name);
+        interface_ethtool_dot3stats_get(rowreq_ctx, port);
 
-        if (rc < 0) {
-            DEBUGMSGTL(("access:dot3StatsTable", "error getting the statistics for interface |%s| "
-                        "dot3StatsTable data, operation might not be supported\n", p->name));
-            dot3StatsTable_release_rowreq_ctx(rowreq_ctx);
-            continue;
-        }
-
-        rc = interface_ioctl_dot3stats_duplex_get(rowreq_ctx, fd, p->name);
+        rc = interface_ioctl_dot3stats_duplex_get(rowreq_ctx, fd, port->name);
         if (rc < 0) {
             DEBUGMSGTL(("access:dot3StatsTable", "error getting the duplex status for |%s| "
-                        "dot3StatsTable data, operation might not be supported\n", p->name));
+                        "dot3StatsTable data, operation might not be supported\n", port->name));
             dot3StatsTable_release_rowreq_ctx(rowreq_ctx);
             continue;
         }
@@ -340,27 +314,17 @@ dot3StatsTable_container_load(netsnmp_container * container)
          */
         rc = CONTAINER_INSERT(container, rowreq_ctx);
         if (rc < 0) {
-            DEBUGMSGTL(("access:dot3StatsTable", "error inserting |%s|", p->name));
+            DEBUGMSGTL(("access:dot3StatsTable", "error inserting |%s|", port->name));
             dot3StatsTable_release_rowreq_ctx(rowreq_ctx);
             continue;
         }
 
         ++count;
     }
+#endif
 
     close(fd);
 
-    /*
-     * free the interface names list 
-     */
-
-    if ( (dot3stats_interface_name_list_free(list_head)) < 0) {
-        snmp_log(LOG_ERR, "access:dot3StatsTable, error freeing the interface name list \n");
-        DEBUGMSGTL(("access:dot3StatsTable", "error freeing the interface name list\n"));
-        return MFD_ERROR;
-    }
-#endif
-
     DEBUGMSGT(("verbose:dot3StatsTable:dot3StatsTable_container_load",
                "inserted %" NETSNMP_PRIz "d records\n", count));
 
@@ -16,18 +16,9 @@ typedef __u8 u8;
 #endif
 #include <linux/ethtool.h>
 
-/* structure for storing the interface names in the system */
+#include "util_funcs/ethtool_stats.h"
 
-struct ifname {
-    struct ifname *ifn_next;
-    char name [IF_NAMESIZE];
-};
-
-struct ifname *dot3stats_interface_name_list_get (struct ifname *, int *);
-int dot3stats_interface_name_list_free (struct ifname *list_head);
-int dot3stats_interface_ioctl_ifindex_get (int fd, const char *name);
-int _dot3Stats_ioctl_get(int fd, int which, struct ifreq *ifrq, const char* name);
-int interface_ioctl_dot3stats_get(dot3StatsTable_rowreq_ctx *rowreq_ctx, int fd, const char* name);
+void interface_ethtool_dot3stats_get(dot3StatsTable_rowreq_ctx *rowreq_ctx, const netsnmp_ethtool_port *port);
 int interface_ioctl_dot3stats_duplex_get(dot3StatsTable_rowreq_ctx *rowreq_ctx, int fd, const char* name);
 
 
@@ -56,24 +47,3 @@ int interface_ioctl_dot3stats_duplex_get(dot3StatsTable_rowreq_ctx *rowreq_ctx,
 #define DSA_RECEIVE_FCS_ERROR                           "in_fcs_error"
 
 #define DSA_TRANSMIT_DEFERRED                           "deferred"
-
-#define DOT3STATSALIGNMENTERRORS(x)            strstr(x, INTEL_RECEIVE_ALIGN_ERRORS)
-#define DOT3STATSFCSERRORS(x)                  strstr(x, DSA_RECEIVE_FCS_ERROR)
-#define DOT3STATSDEFERREDTRANSMISSIONS(x)      !strcmp(x, DSA_TRANSMIT_DEFERRED)
-
-#define DOT3STATSMULTIPLECOLLISIONFRAMES(x)    (strstr(x, INTEL_TRANSMIT_MULTIPLE_COLLISIONS)) || \
-                                               (!strcmp(x, DSA_TRANSMIT_MULTIPLE_COLLISIONS)) || \
-                                               (strstr(x, BROADCOM_TRANSMIT_MULTIPLE_COLLISIONS_BNX2)) || \
-                                               (strstr(x, BROADCOM_TRANSMIT_MULTIPLE_COLLISIONS_TG3))
-
-#define DOT3STATSLATECOLLISIONS(x)             (strstr(x, INTEL_TRANSMIT_LATE_COLLISIONS)) || \
-                                               (!strcmp(x, DSA_TRANSMIT_LATE_COLLISIONS)) || \
-                                               (strstr(x, BROADCOM_TRANSMIT_LATE_COLLISIONS))
-
-#define DOT3STATSSINGLECOLLISIONFRAMES(x)      (strstr(x, INTEL_TRANSMIT_SINGLE_COLLISIONS)) || \
-                                               (!strcmp(x, DSA_TRANSMIT_SINGLE_COLLISIONS)) || \
-                                               (strstr(x, BROADCOM_TRANSMIT_SINGLE_COLLISIONS))
-
-#define DOT3STATSEXCESSIVECOLLISIONS(x)        (strstr(x, BROADCOM_TRANSMIT_EXCESS_COLLISIONS_BNX2)) || \
-                                               (strstr(x, BROADCOM_TRANSMIT_EXCESS_COLLISIONS_TG3)) || \
-                                               (!strcmp(x, DSA_TRANSMIT_EXCESS_COLLISIONS))
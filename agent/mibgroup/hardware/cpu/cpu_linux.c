@@ -3,6 +3,7 @@
 #include <net-snmp/agent/net-snmp-agent-includes.h>
 #include <net-snmp/agent/hardware/cpu.h>
 #include "cpu_linux.h"
+#include "util_funcs/procfs_snapshot.h"
 
 #include <unistd.h>
 #include <fcntl.h>
@@ -97,53 +98,27 @@ void init_cpu_linux( void ) {
     cpu_num = n;
 }
 
-void _cpu_load_swap_etc( char *buff, netsnmp_cpu_info *cpu );
+void _cpu_load_swap_etc( const char *buff, netsnmp_cpu_info *cpu );
 
     /*
      * Load the latest CPU usage statistics
      */
 int netsnmp_cpu_arch_load( netsnmp_cache *cache, void *magic ) {
-    static char *buff  = NULL;
-    static int   bsize = 0;
     static int   first = 1;
     static int   num_cpuline_elem = 0;
-    int          bytes_read, statfd, i;
-    char        *b1, *b2;
+    int          i;
+    netsnmp_procfs_view view;
+    const char  *buff, *b1, *b2;
     unsigned long long cusell = 0, cicell = 0, csysll = 0, cidell = 0,
                        ciowll = 0, cirqll = 0, csoftll = 0, cstealll = 0,
                        cguestll = 0, cguest_nicell = 0;
     netsnmp_cpu_info* cpu;
 
-    if ((statfd = open(STAT_FILE, O_RDONLY, 0)) == -1) {
+    if (netsnmp_procfs_snapshot(STAT_FILE, &view) < 0) {
         snmp_log_perror(STAT_FILE);
         return -1;
     }
-    if (bsize == 0) {
-        bsize = getpagesize()-1;
-        buff = (char*)malloc(bsize+1);
-        if (buff == NULL) {
-            close(statfd);
-            return -1;
-        }
-    }
-    while ((bytes_read = read(statfd, buff, bsize)) == bsize) {
-        bsize += BUFSIZ;
-        buff = (char*)realloc(buff, bsize+1);
-        DEBUGMSGTL(("cpu", "/proc/stat buffer increased to %d\n", bsize));
-        close(statfd);
-        statfd = open(STAT_FILE, O_RDONLY, 0);
-        if (statfd == -1) {
-            snmp_log_perror(STAT_FILE);
-            return -1;
-	}
-    }
-    close(statfd);
-
-    if ( bytes_read < 0 ) {
-        snmp_log_perror(STAT_FILE "read error");
-        return -1;
-    }
-    buff[bytes_read] = '\0';
+    buff = view.data;
 
         /*
          * CPU statistics (overall and per-CPU)
@@ -224,43 +199,21 @@ int netsnmp_cpu_arch_load( netsnmp_cache *cache, void *magic ) {
          * Interrupt/Context Switch statistics
          *   XXX - Do these really belong here ?
          */
-void _cpu_load_swap_etc( char *buff, netsnmp_cpu_info *cpu ) {
+void _cpu_load_swap_etc( const char *buff, netsnmp_cpu_info *cpu ) {
     static int   has_vmstat = 1;
-    static char *vmbuff  = NULL;
-    static int   vmbsize = 0;
     static int   first   = 1;
-    int          bytes_read, vmstatfd;
-    char        *b;
+    netsnmp_procfs_view view;
+    const char  *vmbuff = NULL;
+    const char  *b;
     unsigned long long pin, pout, swpin, swpout;
     unsigned long long itot, iticks, ctx;
 
     if (has_vmstat) {
-      vmstatfd = open(VMSTAT_FILE, O_RDONLY, 0);
-      if (vmstatfd == -1 ) {
+      if (netsnmp_procfs_snapshot(VMSTAT_FILE, &view) < 0) {
             snmp_log(LOG_ERR, "cannot open %s\n", VMSTAT_FILE);
             has_vmstat = 0;
-      } else {
-        if (vmbsize == 0) {
-	    vmbsize = getpagesize()-1;
-	    vmbuff = (char*)malloc(vmbsize+1);
-        }
-        while ((bytes_read = read(vmstatfd, vmbuff, vmbsize)) == vmbsize) {
-	    vmbsize += BUFSIZ;
-	    vmbuff = (char*)realloc(vmbuff, vmbsize+1);
-	    close(vmstatfd);
-	    vmstatfd = open(VMSTAT_FILE, O_RDONLY, 0);
-	    if (vmstatfd == -1) {
-                snmp_log_perror("cannot open " VMSTAT_FILE);
-                return;
-	    }
-        }
-        close(vmstatfd);
-        if ( bytes_read < 0 ) {
-            snmp_log_perror(VMSTAT_FILE "read error");
-            return;
-        }
-        vmbuff[bytes_read] = '\0';
-      }
+      } else
+            vmbuff = view.data;
     }
 
     if (has_vmstat) {
@@ -1,2 +1,3 @@
 config_require(hardware/cpu/cpu)
+config_require(util_funcs/procfs_snapshot)
 void init_cpu_linux(void);
@@ -2,28 +2,20 @@
 #include <net-snmp/net-snmp-includes.h>
 #include <net-snmp/agent/net-snmp-agent-includes.h>
 #include <net-snmp/agent/hardware/memory.h>
+#include "util_funcs/procfs_snapshot.h"
 
 #include <unistd.h>
 #include <fcntl.h>
 
-/*
- * Try to use an initial size that will cover default cases. We aren't talking
- * about huge files, so why fiddle about with reallocs?
- */
-#define MEMINFO_INIT_SIZE   4096
-#define MEMINFO_STEP_SIZE   4096
 #define MEMINFO_FILE   "/proc/meminfo"
 
     /*
      * Load the latest memory usage statistics
      */
 int netsnmp_mem_arch_load( netsnmp_cache *cache, void *magic ) {
-    int          statfd;
-    static char *buff  = NULL;
-    static int   bsize = 0;
     static int   first = 1;
-    ssize_t      bytes_read;
-    char        *b;
+    netsnmp_procfs_view view;
+    const char  *b;
     int          have_memavail = 0;
     unsigned long memtotal = 0,  memavail = 0, memfree = 0, memshared = 0,
                   buffers = 0,   cached = 0, sreclaimable = 0,
@@ -34,60 +26,27 @@ int netsnmp_mem_arch_load( netsnmp_cache *cache, void *magic ) {
     /*
      * Retrieve the memory information from the underlying O/S...
      */
-    if ((statfd = open(MEMINFO_FILE, O_RDONLY, 0)) == -1) {
+    if (netsnmp_procfs_snapshot(MEMINFO_FILE, &view) < 0) {
         snmp_log_perror(MEMINFO_FILE);
-        return -1;
-    }
-    if (bsize == 0) {
-        bsize = MEMINFO_INIT_SIZE;
-        buff = (char*)malloc(bsize+1);
-        if (NULL == buff) {
-            snmp_log(LOG_ERR, "malloc failed\n");
-            close(statfd);
-            return -1;
-        }
-    }
-    while ((bytes_read = read(statfd, buff, bsize)) == bsize) {
-        b = (char*)realloc(buff, bsize + MEMINFO_STEP_SIZE + 1);
-        if (NULL == b) {
-            snmp_log(LOG_ERR, "malloc failed\n");
-            close(statfd);
-            return -1;
-        }
-        buff = b;
-        bsize += MEMINFO_STEP_SIZE;
-        DEBUGMSGTL(("mem", "/proc/meminfo buffer increased to %d\n", bsize));
-        close(statfd);
-        statfd = open(MEMINFO_FILE, O_RDONLY, 0);
-        if (statfd == -1) {
-            snmp_log_perror(MEMINFO_FILE);
-            return -1;
-        }
-    }
-    close(statfd);
-    if (bytes_read <= 0) {
-        snmp_log_perror(MEMINFO_FILE);
-        buff[0] = '\0';
-    } else {
-        buff[bytes_read] = '\0';
+        view.data = "";
     }
 
     /*
      * ... parse this into a more useable form...
      */
-    b = strstr(buff, "MemTotal: ");
+    b = netsnmp_procfs_find_line(&view, "MemTotal: ");
     if (b) 
         sscanf(b, "MemTotal: %lu", &memtotal);
     else {
         if (first)
             snmp_log(LOG_ERR, "No MemTotal line in /proc/meminfo\n");
     }
-    b = strstr(buff, "MemAvailable: ");
+    b = netsnmp_procfs_find_line(&view, "MemAvailable: ");
     if (b) {
         have_memavail = 1;
         sscanf(b, "MemAvailable: %lu", &memavail);
     }
-    b = strstr(buff, "MemFree: ");
+    b = netsnmp_procfs_find_line(&view, "MemFree: ");
     if (b) 
         sscanf(b, "MemFree: %lu", &memfree);
     else {
@@ -95,48 +54,48 @@ int netsnmp_mem_arch_load( netsnmp_cache *cache, void *magic ) {
             snmp_log(LOG_ERR, "No MemFree line in /proc/meminfo\n");
     }
     if (0 == netsnmp_os_prematch("Linux","2.4")) {
-        b = strstr(buff, "MemShared: ");
+        b = netsnmp_procfs_find_line(&view, "MemShared: ");
         if (b)
             sscanf(b, "MemShared: %lu", &memshared);
         else if (first)
             snmp_log(LOG_ERR, "No MemShared line in /proc/meminfo\n");
     }
     else {
-        b = strstr(buff, "Shmem: ");
+        b = netsnmp_procfs_find_line(&view, "Shmem: ");
         if (b)
             sscanf(b, "Shmem: %lu", &memshared);
         else if (first)
             snmp_log(LOG_ERR, "No Shmem line in /proc/meminfo\n");
     }
-    b = strstr(buff, "Buffers: ");
+    b = netsnmp_procfs_find_line(&view, "Buffers: ");
     if (b)
         sscanf(b, "Buffers: %lu", &buffers);
     else {
         if (first)
             snmp_log(LOG_ERR, "No Buffers line in /proc/meminfo\n");
     }
-    b = strstr(buff, "Cached: ");
+    b = netsnmp_procfs_find_line(&view, "Cached: ");
     if (b)
         sscanf(b, "Cached: %lu", &cached);
     else {
         if (first)
             snmp_log(LOG_ERR, "No Cached line in /proc/meminfo\n");
     }
-    b = strstr(buff, "SwapTotal: ");
+    b = netsnmp_procfs_find_line(&view, "SwapTotal: ");
     if (b)
         sscanf(b, "SwapTotal: %lu", &swaptotal);
     else {
         if (first)
             snmp_log(LOG_ERR, "No SwapTotal line in /proc/meminfo\n");
     }
-    b = strstr(buff, "SwapFree: ");
+    b = netsnmp_procfs_find_line(&view, "SwapFree: ");
     if (b)
         sscanf(b, "SwapFree: %lu", &swapfree);
     else {
         if (first)
             snmp_log(LOG_ERR, "No SwapFree line in /proc/meminfo\n");
     }
-    b = strstr(buff, "SReclaimable: ");
+    b = netsnmp_procfs_find_line(&view, "SReclaimable: ");
     if (b)
         sscanf(b, "SReclaimable: %lu", &sreclaimable);
     first = 0;
@@ -1 +1,2 @@
 config_require(hardware/memory/hw_mem)
+config_require(util_funcs/procfs_snapshot)
@@ -13,6 +13,15 @@
 #include <net-snmp/data_access/swinst.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef linux
+#include <sys/inotify.h>
+#endif
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_PTHREAD_CREATE)
+#include <pthread.h>
+#endif
 #include "swinst.h"
 #include "swinst_private.h"
 
@@ -25,6 +34,62 @@ netsnmp_feature_child_of(swinst_entry_remove, netsnmp_unused);
 
 static void netsnmp_swinst_entry_free_cb(netsnmp_swinst_entry *, void *);
 
+/*
+ * Back ends with a package database name it with netsnmp_swinst_watch().
+ * Changes to that file bump the generation, and each enumeration of the
+ * database is saved to an index file in the persistent directory, which
+ * loads replace the enumeration with for as long as the database stays
+ * the same, e.g. when the agent restarts.
+ */
+static char    *swinst_db = NULL;
+static u_int    swinst_generation = 0;
+static u_int    swinst_index_generation = 0;    /* of the index file */
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_PTHREAD_CREATE)
+/*
+ * loads may run in the cache loader thread, while the generation is
+ * bumped in the agent's thread
+ */
+static pthread_mutex_t swinst_lock = PTHREAD_MUTEX_INITIALIZER;
+#define SWINST_LOCK()   pthread_mutex_lock(&swinst_lock)
+#define SWINST_UNLOCK() pthread_mutex_unlock(&swinst_lock)
+#else
+#define SWINST_LOCK()
+#define SWINST_UNLOCK()
+#endif
+#ifdef linux
+static int      swinst_events_fd = -1;
+#endif
+
+#define SWINST_INDEX_FILE       "swinst.index"
+#define SWINST_INDEX_MAGIC      0x4e535749      /* "NSWI" */
+#define SWINST_INDEX_VERSION    2
+
+/*
+ * The index file is this header, the path of the database and one
+ * record per entry: the index as a uint32_t, the type, name and date
+ * lengths as one byte each, then the name and the date.  It is only
+ * read on the host that wrote it, so it is in host byte order.
+ */
+typedef struct swinst_index_header_s {
+    uint32_t        magic;
+    uint32_t        version;
+    uint32_t        count;
+    uint32_t        path_len;
+    /* the database when it was enumerated */
+    uint64_t        db_dev;
+    uint64_t        db_ino;
+    uint64_t        db_size;
+    int64_t         db_mtime;
+    int64_t         db_ctime;
+    uint32_t        db_mtime_nsec;
+    uint32_t        db_ctime_nsec;
+} swinst_index_header;
+
+static int  _swinst_index_read(netsnmp_container *container);
+static void _swinst_index_write(netsnmp_container *container,
+                                swinst_index_header *header);
+static int  _swinst_db_stat(swinst_index_header *header);
+
 void init_swinst( void )
 {
     static int initialized = 0;
@@ -46,6 +111,136 @@ void shutdown_swinst( void )
     DEBUGMSGTL(("swinst", "shutdown called\n"));
 
     netsnmp_swinst_arch_shutdown();
+
+#ifdef linux
+    if (swinst_events_fd >= 0) {
+        unregister_readfd(swinst_events_fd);
+        close(swinst_events_fd);
+        swinst_events_fd = -1;
+    }
+#endif
+    SNMP_FREE(swinst_db);
+}
+
+/* ---------------------------------------------------------------------
+ */
+
+/**
+ * @retval 0  changes to the installed software are not tracked
+ * @retval >0 changes whenever software is installed or removed
+ */
+u_int
+netsnmp_swinst_generation(void)
+{
+    u_int           generation;
+
+    SWINST_LOCK();
+    generation = swinst_generation;
+    SWINST_UNLOCK();
+    return generation;
+}
+
+static void
+_swinst_changed(void)
+{
+    SWINST_LOCK();
+    if (0 == ++swinst_generation)
+        swinst_generation = 1;
+    SWINST_UNLOCK();
+}
+
+#ifdef linux
+static void
+_swinst_events_process(int fd, void *data)
+{
+    char            buf[4096]
+        __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *ev;
+    const char     *name = strrchr(swinst_db, '/') + 1;
+    ssize_t         len;
+    char           *cp;
+    int             changed = 0;
+
+    for (;;) {
+        len = read(fd, buf, sizeof(buf));
+        if (len < 0 && errno == EINTR)
+            continue;
+        if (len <= 0)
+            break;
+        for (cp = buf; cp < buf + len; cp += sizeof(*ev) + ev->len) {
+            ev = (const struct inotify_event *) cp;
+            if ((ev->mask & IN_Q_OVERFLOW) ||
+                (ev->len && strcmp(ev->name, name) == 0))
+                changed = 1;
+        }
+    }
+
+    if (changed) {
+        DEBUGMSGTL(("swinst:events", "%s changed\n", swinst_db));
+        _swinst_changed();
+    }
+}
+
+/*
+ * Watches the directory of the database rather than the file, as the
+ * file may be replaced by renaming a new copy over it.
+ */
+static void
+_swinst_events_listen(void)
+{
+    char           *dir;
+
+    swinst_events_fd = inotify_init();
+    if (swinst_events_fd < 0) {
+        snmp_log_perror("swinst: inotify_init");
+        return;
+    }
+    fcntl(swinst_events_fd, F_SETFL,
+          fcntl(swinst_events_fd, F_GETFL) | O_NONBLOCK);
+
+    dir = strdup(swinst_db);
+    if (NULL != dir)
+        *strrchr(dir, '/') = '\0';
+    if (NULL == dir ||
+        inotify_add_watch(swinst_events_fd, *dir ? dir : "/",
+                          IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE |
+                          IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO) < 0 ||
+        register_readfd(swinst_events_fd, _swinst_events_process,
+                        NULL) != 0) {
+        snmp_log(LOG_ERR, "swinst: cannot watch %s for changes\n",
+                 swinst_db);
+        close(swinst_events_fd);
+        swinst_events_fd = -1;
+    } else {
+        DEBUGMSGTL(("swinst:events", "watching %s\n", swinst_db));
+        _swinst_changed();
+    }
+    free(dir);
+}
+#endif                          /* linux */
+
+/*
+ * Called by the arch init code with the absolute path of the file that
+ * holds the package database.
+ */
+void
+netsnmp_swinst_watch(const char *path)
+{
+    if (NULL == path || '/' != *path || NULL != swinst_db)
+        return;
+    swinst_db = strdup(path);
+    if (NULL == swinst_db)
+        return;
+#ifdef linux
+    _swinst_events_listen();
+#endif
+    /*
+     * an index file from before the agent started is still good if the
+     * database looks the same as when it was written
+     */
+    SWINST_LOCK();
+    swinst_index_generation = swinst_generation;
+    SWINST_UNLOCK();
 }
 
 /* ---------------------------------------------------------------------
@@ -63,7 +258,9 @@ netsnmp_container *
 netsnmp_swinst_container_load( netsnmp_container *user_container, int flags )
 {
     netsnmp_container *container = user_container;
-    int arch_rc;
+    swinst_index_header header;
+    u_int generation;
+    int arch_rc, indexed;
 
     DEBUGMSGTL(("swinst:container", "load\n"));
 
@@ -78,10 +275,32 @@ netsnmp_swinst_container_load( netsnmp_container *user_container, int flags )
     if (NULL == container->container_name)
         container->container_name = strdup("swinst container");
 
+    /*
+     * if the database is unchanged, load the last enumeration of it
+     */
+    SWINST_LOCK();
+    generation = swinst_generation;
+    indexed = (generation == swinst_index_generation);
+    SWINST_UNLOCK();
+    if (swinst_db && indexed) {
+        if (0 == _swinst_index_read(container))
+            return container;
+        netsnmp_swinst_container_free_items(container);
+    }
+    memset(&header, 0, sizeof(header));
+    if (swinst_db && _swinst_db_stat(&header) < 0)
+        DEBUGMSGTL(("swinst:index", "cannot stat %s\n", swinst_db));
+
     /*
      * call the arch specific code to load the container
      */
     arch_rc = netsnmp_swinst_arch_load( container, flags );
+    if (swinst_db && 0 == arch_rc && 0 != header.magic) {
+        _swinst_index_write(container, &header);
+        SWINST_LOCK();
+        swinst_index_generation = generation;
+        SWINST_UNLOCK();
+    }
     if (arch_rc && (flags & NETSNMP_SWINST_ALL_OR_NONE)) {
         /*
          * caller does not want a partial load, so empty the container.
@@ -195,6 +414,163 @@ netsnmp_swinst_entry_remove(netsnmp_container * container,
 }
 #endif /* NETSNMP_FEATURE_REMOVE_SWINST_ENTRY_REMOVE */
 
+/* ---------------------------------------------------------------------
+ */
+
+/*
+ * fills in the header of an index file for the database as it is now
+ */
+static int
+_swinst_db_stat(swinst_index_header *header)
+{
+    struct stat     st;
+
+    memset(header, 0, sizeof(*header));
+    if (stat(swinst_db, &st) < 0)
+        return -1;
+    header->magic = SWINST_INDEX_MAGIC;
+    header->version = SWINST_INDEX_VERSION;
+    header->path_len = strlen(swinst_db);
+    header->db_dev = st.st_dev;
+    header->db_ino = st.st_ino;
+    header->db_size = st.st_size;
+    header->db_mtime = st.st_mtime;
+    header->db_ctime = st.st_ctime;
+#ifdef linux
+    /*
+     * a package manager may rewrite the database several times within
+     * a second
+     */
+    header->db_mtime_nsec = st.st_mtim.tv_nsec;
+    header->db_ctime_nsec = st.st_ctim.tv_nsec;
+#endif
+    return 0;
+}
+
+static void
+_swinst_index_file(char *file, size_t len)
+{
+    snprintf(file, len, "%s/%s", get_persistent_directory(),
+             SWINST_INDEX_FILE);
+}
+
+/*
+ * loads the container from the index file, if that was written for the
+ * database as it is now
+ */
+static int
+_swinst_index_read(netsnmp_container *container)
+{
+    swinst_index_header header, db;
+    netsnmp_swinst_entry *entry;
+    char            file[SNMP_MAXPATH], path[SNMP_MAXPATH];
+    u_char          rec[3];
+    uint32_t        i, swIndex;
+    FILE           *fp;
+    int             rc = -1;
+
+    if (_swinst_db_stat(&db) < 0)
+        return -1;
+    _swinst_index_file(file, sizeof(file));
+    fp = fopen(file, "r");
+    if (NULL == fp)
+        return -1;
+
+    if (fread(&header, sizeof(header), 1, fp) != 1)
+        goto out;
+    db.count = header.count;
+    if (memcmp(&header, &db, sizeof(header)) != 0 ||
+        header.path_len >= sizeof(path) ||
+        fread(path, header.path_len, 1, fp) != 1 ||
+        memcmp(path, swinst_db, header.path_len) != 0) {
+        DEBUGMSGTL(("swinst:index", "%s is out of date\n", file));
+        goto out;
+    }
+
+    for (i = 0; i < header.count; i++) {
+        if (fread(&swIndex, sizeof(swIndex), 1, fp) != 1 ||
+            fread(rec, sizeof(rec), 1, fp) != 1 ||
+            rec[1] > sizeof(entry->swName) || rec[2] > sizeof(entry->swDate))
+            goto out;
+        entry = netsnmp_swinst_entry_create(swIndex);
+        if (NULL == entry)
+            goto out;
+        entry->swType = rec[0];
+        entry->swName_len = rec[1];
+        entry->swDate_len = rec[2];
+        if ((rec[1] && fread(entry->swName, rec[1], 1, fp) != 1) ||
+            (rec[2] && fread(entry->swDate, rec[2], 1, fp) != 1)) {
+            netsnmp_swinst_entry_free(entry);
+            goto out;
+        }
+        if (CONTAINER_INSERT(container, entry) != 0) {
+            netsnmp_swinst_entry_free(entry);
+            goto out;
+        }
+    }
+    rc = 0;
+    DEBUGMSGTL(("swinst:index", "loaded %u entries from %s\n",
+                header.count, file));
+
+  out:
+    fclose(fp);
+    return rc;
+}
+
+static void
+_swinst_index_write_entry(void *data, void *context)
+{
+    netsnmp_swinst_entry *entry = (netsnmp_swinst_entry *) data;
+    FILE           *fp = (FILE *) context;
+    uint32_t        swIndex = entry->swIndex;
+    u_char          rec[3];
+
+    rec[0] = entry->swType;
+    rec[1] = entry->swName_len;
+    rec[2] = entry->swDate_len;
+    fwrite(&swIndex, sizeof(swIndex), 1, fp);
+    fwrite(rec, sizeof(rec), 1, fp);
+    fwrite(entry->swName, 1, entry->swName_len, fp);
+    fwrite(entry->swDate, 1, entry->swDate_len, fp);
+}
+
+/*
+ * saves an enumeration of the database, replacing the index file
+ */
+static void
+_swinst_index_write(netsnmp_container *container,
+                    swinst_index_header *header)
+{
+    char            file[SNMP_MAXPATH], tmp[SNMP_MAXPATH + 4];
+    FILE           *fp;
+    int             err;
+
+    if (netsnmp_ds_get_boolean(NETSNMP_DS_LIBRARY_ID,
+                               NETSNMP_DS_LIB_DONT_PERSIST_STATE))
+        return;
+
+    _swinst_index_file(file, sizeof(file));
+    snprintf(tmp, sizeof(tmp), "%s.tmp", file);
+    if (mkdirhier(file, NETSNMP_AGENT_DIRECTORY_MODE, 1) ||
+        NULL == (fp = fopen(tmp, "w"))) {
+        DEBUGMSGTL(("swinst:index", "cannot create %s\n", tmp));
+        return;
+    }
+
+    header->count = CONTAINER_SIZE(container);
+    fwrite(header, sizeof(*header), 1, fp);
+    fwrite(swinst_db, 1, header->path_len, fp);
+    CONTAINER_FOR_EACH(container, _swinst_index_write_entry, fp);
+    err = ferror(fp);
+    if (fclose(fp) != 0 || err || rename(tmp, file) != 0) {
+        snmp_log(LOG_WARNING, "swinst: cannot write %s\n", file);
+        unlink(tmp);
+        return;
+    }
+    DEBUGMSGTL(("swinst:index", "saved %u entries to %s\n",
+                header->count, file));
+}
+
 /* ---------------------------------------------------------------------
  */
 
@@ -23,8 +23,10 @@ config_exclude(host/hr_swinst)
     config_require(host/data_access/swinst_darwin)
 #elif defined( HAVE_DPKG_QUERY )
     config_require(host/data_access/swinst_apt)
+#   define NETSNMP_SWINST_ARCH_THREAD_SAFE 1 /* loads can run in a thread */
 #elif defined( HAVE_LIBRPM ) && defined( linux )
     config_require(host/data_access/swinst_rpm)
+#   define NETSNMP_SWINST_ARCH_THREAD_SAFE 1 /* loads can run in a thread */
 #elif defined( HAVE_PKGLOCS_H ) || defined( hpux9 ) || defined( hpux10 ) || defined( hpux11 ) || defined( freebsd2 ) || defined( linux ) || defined( openbsd )
     config_require(host/data_access/swinst_pkginfo)
 #else
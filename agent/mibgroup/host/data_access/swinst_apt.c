@@ -35,14 +35,23 @@ config_require(date_n_time)
 
 char pkg_directory[SNMP_MAXBUF];
 static char apt_fmt[SNMP_MAXBUF];
-static char file[SNMP_MAXBUF];
 
 /* ---------------------------------------------------------------------
  */
 void
 netsnmp_swinst_arch_init(void)
 {
-    strlcpy(pkg_directory, "/var/lib/dpkg/info", sizeof(pkg_directory));
+    const char *admindir = getenv("DPKG_ADMINDIR");
+    char status[SNMP_MAXBUF];
+
+    /*
+     * dpkg-query reads the database of DPKG_ADMINDIR as well
+     */
+    if (NULL == admindir || '\0' == *admindir)
+        admindir = "/var/lib/dpkg";
+    snprintf(pkg_directory, sizeof(pkg_directory), "%s/info", admindir);
+    snprintf(status, sizeof(status), "%s/status", admindir);
+    netsnmp_swinst_watch(status);
     snprintf(apt_fmt, SNMP_MAXBUF, "%%%d[^#]#%%%d[^#]#%%%d[^#]#%%%d[^#]#%%%d[^#]#%%%d[^#]#%%%ds",
 	SNMP_MAXBUF-1, SNMP_MAXBUF-1, SNMP_MAXBUF-1, SNMP_MAXBUF-1,
 	SNMP_MAXBUF-1, SNMP_MAXBUF-1, SNMP_MAXBUF-1);
@@ -69,9 +78,9 @@ netsnmp_swinst_arch_load( netsnmp_container *container, u_int flags)
     char arch[SNMP_MAXBUF];
     char status[SNMP_MAXBUF];
     char buf[BUFSIZ];
+    char file[SNMP_MAXBUF];
     struct stat stat_buf;
     netsnmp_swinst_entry *entry;
-    u_char *date_buf;
     size_t date_len;
     int i = 1;
 
@@ -102,16 +111,16 @@ netsnmp_swinst_arch_load( netsnmp_container *container, u_int flags)
         /* get the last mod date */
         snprintf(file, sizeof(file), "%s/%s.list", pkg_directory, package);
         if(stat(file, &stat_buf) != -1) {
-            date_buf = date_n_time(&stat_buf.st_mtime, &date_len);
+            date_n_time_r(&stat_buf.st_mtime, (u_char *) entry->swDate,
+                          &date_len);
             entry->swDate_len = date_len;
-            memcpy(entry->swDate, date_buf, entry->swDate_len);
         } else {
             /* somewhy some files include :arch in .list name */
             snprintf(file, sizeof(file), "%s/%s:%s.list", pkg_directory, package, arch);
             if(stat(file, &stat_buf) != -1) {
-                date_buf = date_n_time(&stat_buf.st_mtime, &date_len);
+                date_n_time_r(&stat_buf.st_mtime, (u_char *) entry->swDate,
+                              &date_len);
                 entry->swDate_len = date_len;
-                memcpy(entry->swDate, date_buf, entry->swDate_len);
             }
         }
         /* FIXME, or fallback to whatever nonsesnse was here before, or leave it uninitialied?
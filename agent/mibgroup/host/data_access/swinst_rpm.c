@@ -73,6 +73,9 @@ netsnmp_swinst_arch_init(void)
 #endif
 
     snprintf( pkg_directory, SNMP_MAXPATH, "%s/Packages", dbpath );
+    if (-1 == stat( pkg_directory, &stat_buf ))
+        /* the sqlite backend of rpm 4.16 and later */
+        snprintf( pkg_directory, SNMP_MAXPATH, "%s/rpmdb.sqlite", dbpath );
     SNMP_FREE(rpmdbpath);
     dbpath = NULL;
 #ifdef HAVE_RPMGETPATH
@@ -81,7 +84,8 @@ netsnmp_swinst_arch_init(void)
     if (-1 == stat( pkg_directory, &stat_buf )) {
         snmp_log(LOG_ERR, "Can't find directory of RPM packages\n");
         pkg_directory[0] = '\0';
-    }
+    } else
+        netsnmp_swinst_watch( pkg_directory );
 }
 
 void
@@ -128,8 +132,6 @@ netsnmp_swinst_arch_load( netsnmp_container *container, u_int flags)
 
     while (NULL != (h = rpmdbNextIterator( mi )))
     {
-        const u_char *dt;
-
         entry = netsnmp_swinst_entry_create( i++ );
         if (NULL == entry)
             continue;   /* error already logged by function */
@@ -164,15 +166,13 @@ netsnmp_swinst_arch_load( netsnmp_container *container, u_int flags)
         if (entry->swName_len > sizeof(entry->swName))
             entry->swName_len = sizeof(entry->swName);
 
-        dt = date_n_time( &install_time, &date_len );
+        date_n_time_r( &install_time, (u_char *) entry->swDate, &date_len );
         if (date_len != 8 && date_len != 11) {
             snmp_log(LOG_ERR, "Bogus length from date_n_time for %s", entry->swName);
             entry->swDate_len = 0;
         }
-        else {
+        else
             entry->swDate_len = date_len;
-            memcpy(entry->swDate, dt, entry->swDate_len);
-        }
 
 #if HAVE_HEADERGET
         rpmtdFreeData(td_name);
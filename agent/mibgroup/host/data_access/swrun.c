@@ -36,6 +36,20 @@ static int _swrun_init = 0;
 static netsnmp_cache     *swrun_cache     = NULL;
 static netsnmp_container *swrun_container = NULL;
 
+/*
+ * process counts by name, sorted by name.  Rebuilt on first use after
+ * each load, so that proc checks don't each walk the whole container.
+ */
+typedef struct swrun_name_count_s {
+    const char     *name;    /* hrSWRunName of one of the entries */
+    int             count;
+} swrun_name_count;
+
+static swrun_name_count *swrun_names       = NULL;
+static int               swrun_names_count = 0;
+static int               swrun_names_max   = 0;
+static int               swrun_names_valid = 0;
+
 /*
  * local static prototypes
  */
@@ -65,6 +79,11 @@ shutdown_swrun(void)
 {
     DEBUGMSGTL(("swrun:access", "shutdown\n"));
 
+    SNMP_FREE(swrun_names);
+    swrun_names_count = swrun_names_max = swrun_names_valid = 0;
+#ifdef NETSNMP_SWRUN_ARCH_UPDATE
+    netsnmp_arch_swrun_shutdown();
+#endif
 }
 
 int
@@ -132,9 +151,59 @@ swrun_count_processes_by_regex( char *name, netsnmp_regex_ptr regexp )
 #endif /* NETSNMP_FEATURE_REMOVE_SWRUN_COUNT_PROCESSES_BY_REGEX */
 
 #ifndef NETSNMP_FEATURE_REMOVE_SWRUN_COUNT_PROCESSES_BY_NAME
+static int
+_swrun_name_compare(const void *lhs, const void *rhs)
+{
+    return strcmp(((const swrun_name_count *)lhs)->name,
+                  ((const swrun_name_count *)rhs)->name);
+}
+
+static void
+_swrun_names_add(netsnmp_swrun_entry *entry, int *i)
+{
+    if (*i < swrun_names_max) {
+        swrun_names[*i].name = entry->hrSWRunName;
+        swrun_names[*i].count = 1;
+        (*i)++;
+    }
+}
+
+static void
+_swrun_names_build(void)
+{
+    int i, j, n;
+
+    n = CONTAINER_SIZE( swrun_container );
+    if (n > swrun_names_max) {
+        swrun_name_count *names = (swrun_name_count *)
+            realloc(swrun_names, n * sizeof(*swrun_names));
+        if (NULL == names)
+            return;
+        swrun_names = names;
+        swrun_names_max = n;
+    }
+
+    i = 0;
+    CONTAINER_FOR_EACH(swrun_container,
+                       (netsnmp_container_obj_func *)_swrun_names_add, &i);
+
+    qsort(swrun_names, i, sizeof(*swrun_names), _swrun_name_compare);
+    for (n = i, i = 0, j = 1; j < n; j++) {
+        if (0 == strcmp(swrun_names[i].name, swrun_names[j].name))
+            swrun_names[i].count++;
+        else
+            swrun_names[++i] = swrun_names[j];
+    }
+    swrun_names_count = n ? i + 1 : 0;
+    swrun_names_valid = 1;
+    DEBUGMSGTL(("swrun:names", "%d names for %d processes\n",
+                swrun_names_count, n));
+}
+
 int
 swrun_count_processes_by_name( char *name )
 {
+    swrun_name_count key, *found;
     netsnmp_swrun_entry *entry;
     netsnmp_iterator  *it;
     int i = 0;
@@ -143,14 +212,26 @@ swrun_count_processes_by_name( char *name )
     if ( !swrun_container || !name )
         return 0;    /* or -1 */
 
-    it = CONTAINER_ITERATOR( swrun_container );
-    while ((entry = (netsnmp_swrun_entry*)ITERATOR_NEXT( it )) != NULL) {
-        if (0 == strcmp( entry->hrSWRunName, name ))
-            i++;
+    if (!swrun_names_valid)
+        _swrun_names_build();
+    if (!swrun_names_valid) {
+        /* out of memory for the index: count the slow way */
+        it = CONTAINER_ITERATOR( swrun_container );
+        while ((entry = (netsnmp_swrun_entry*)ITERATOR_NEXT( it )) != NULL) {
+            if (0 == strcmp( entry->hrSWRunName, name ))
+                i++;
+        }
+        ITERATOR_RELEASE( it );
+        return i;
     }
-    ITERATOR_RELEASE( it );
-
-    return i;
+    if (!swrun_names_count)
+        return 0;
+
+    key.name = name;
+    found = (swrun_name_count *) bsearch(&key, swrun_names, swrun_names_count,
+                                         sizeof(*swrun_names),
+                                         _swrun_name_compare);
+    return found ? found->count : 0;
 }
 #endif /* NETSNMP_FEATURE_REMOVE_SWRUN_COUNT_PROCESSES_BY_NAME */
 
@@ -162,7 +243,7 @@ swrun_count_processes_by_name( char *name )
 static int
 _cache_load( netsnmp_cache *cache,  void *magic )
 {
-    netsnmp_swrun_container_load( swrun_container, 0 );
+    netsnmp_swrun_container_load( swrun_container, NETSNMP_SWRUN_UPDATE );
     return 0;
 }
 
@@ -187,7 +268,13 @@ netsnmp_swrun_cache(void)
                            _cache_load,  _cache_free,
                            hrSWRunTable_oid, hrSWRunTable_oid_len);
         if (swrun_cache)
-            swrun_cache->flags = NETSNMP_CACHE_DONT_INVALIDATE_ON_SET;
+            swrun_cache->flags = NETSNMP_CACHE_DONT_INVALIDATE_ON_SET
+#ifdef NETSNMP_SWRUN_ARCH_UPDATE
+                /* keep the entries, for the next load to update */
+                | NETSNMP_CACHE_DONT_FREE_BEFORE_LOAD
+                | NETSNMP_CACHE_DONT_FREE_EXPIRED
+#endif
+                ;
     }
     return swrun_cache;
 }
@@ -226,6 +313,8 @@ netsnmp_swrun_container(void)
  *                  pass NULL to have the function create one.
  * @param load_flags flags to modify behaviour. Examples:
  *                   NETSNMP_SWRUN_ALL_OR_NONE
+ *                   NETSNMP_SWRUN_UPDATE: the container may hold the
+ *                   entries of an earlier load, to be updated
  *
  * @retval NULL  error
  * @retval !NULL pointer to container
@@ -246,6 +335,13 @@ netsnmp_swrun_container_load(netsnmp_container* user_container, u_int load_flags
         return NULL;
     }
 
+#ifndef NETSNMP_SWRUN_ARCH_UPDATE
+    if (load_flags & NETSNMP_SWRUN_UPDATE)
+        netsnmp_swrun_container_free_items(container);
+#endif
+    if (container == swrun_container)
+        swrun_names_valid = 0;
+
     rc =  netsnmp_arch_swrun_container_load(container, load_flags);
     if (0 != rc) {
         if (NULL == user_container) {
@@ -288,6 +384,9 @@ netsnmp_swrun_container_free_items(netsnmp_container *container)
         return;
     }
 
+    if (container == swrun_container)
+        swrun_names_valid = 0;
+
     /*
      * free all items.
      */
@@ -38,6 +38,7 @@ config_exclude(host/hr_swrun)
     config_require(host/data_access/swrun_kinfo)
 #elif defined( linux )
     config_require(host/data_access/swrun_procfs_status)
+#   define NETSNMP_SWRUN_ARCH_UPDATE 1  /* handles NETSNMP_SWRUN_UPDATE */
 #elif defined( cygwin )
     config_require(host/data_access/swrun_cygwin)
 #else
@@ -1,3 +1,6 @@
 extern void netsnmp_arch_swrun_init(void);
+#ifdef NETSNMP_SWRUN_ARCH_UPDATE
+extern void netsnmp_arch_swrun_shutdown(void);
+#endif
 extern int netsnmp_arch_swrun_container_load(netsnmp_container* container,
                                              u_int load_flags);
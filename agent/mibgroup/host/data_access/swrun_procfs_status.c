@@ -1,7 +1,7 @@
 /*
  * swrun_procfs_linux.c:
  *     hrSWRunTable data access:
- *     /proc/{pid}/status interface - Linux
+ *     /proc/{pid}/stat and cmdline interface - Linux
  */
 #include <net-snmp/net-snmp-config.h>
 
@@ -17,6 +17,10 @@
 #include <sys/types.h>
 #endif
 
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+
 #ifdef HAVE_DIRENT_H
 #include <dirent.h>
 #endif
@@ -29,10 +33,25 @@
 #include <net-snmp/library/container.h>
 #include <net-snmp/library/snmp_debug.h>
 #include <net-snmp/data_access/swrun.h>
+#include "swrun.h"
 #include "swrun_private.h"
 
 static long pagesize;
 static long sc_clk_tck;
+static DIR *procdir = NULL;   /* kept open between loads */
+
+static void
+_move_entry(netsnmp_swrun_entry *entry, netsnmp_container *to)
+{
+    CONTAINER_INSERT(to, entry);
+}
+
+static void
+_free_unless_kept(netsnmp_swrun_entry *entry, netsnmp_container *container)
+{
+    if (CONTAINER_FIND(container, entry) != entry)
+        netsnmp_swrun_entry_free(entry);
+}
 
 /* ---------------------------------------------------------------------
  */
@@ -48,23 +67,190 @@ netsnmp_arch_swrun_init(void)
     return;
 }
 
+void
+netsnmp_arch_swrun_shutdown(void)
+{
+    if (procdir) {
+        closedir(procdir);
+        procdir = NULL;
+    }
+}
+
+/*
+ * Reads a file below /proc/<pid>/ into buf and NUL terminates it.
+ *
+ * @retval length read, or -1 if the file (process) went away
+ */
+static int
+_read_pid_file(int procfd, int pid, const char *file, char *buf, size_t len)
+{
+    char    path[32];
+    ssize_t n;
+    int     fd;
+
+    snprintf(path, sizeof(path), "%d/%s", pid, file);
+    fd = openat(procfd, path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    n = pread(fd, buf, len - 1, 0);
+    close(fd);
+    if (n < 0)
+        return -1;
+    buf[n] = '\0';
+    return n;
+}
+
+/*
+ * Fills in the name, status, CPU, memory and start time of an entry
+ * from the contents of /proc/<pid>/stat:
+ *   PID (COMM) STATUS {xxx}*10 UTIME STIME {xxx}*6 STARTTIME {xxx} RSS
+ *
+ * @retval 0 ok, -1 malformed
+ */
+static int
+_parse_stat(netsnmp_swrun_entry *entry, char *buf)
+{
+    unsigned long long cpu = 0, value;
+    char   *name, *cp, *end;
+    int     field;
+
+    name = strchr(buf, '(');
+    cp = strrchr(buf, ')');
+    if (!name || !cp || cp < name || cp[1] != ' ')
+        return -1;
+    name++;
+    entry->hrSWRunName_len = snprintf(entry->hrSWRunName,
+                                      sizeof(entry->hrSWRunName), "%.*s",
+                                      (int)(cp - name), name);
+    cp += 2;
+
+    switch (*cp) {
+    case 'R':  entry->hrSWRunStatus = HRSWRUNSTATUS_RUNNING;
+               break;
+    case 'S':  entry->hrSWRunStatus = HRSWRUNSTATUS_RUNNABLE;
+               break;
+    case 'D':
+    case 'T':  entry->hrSWRunStatus = HRSWRUNSTATUS_NOTRUNNABLE;
+               break;
+    case 'Z':
+    default:   entry->hrSWRunStatus = HRSWRUNSTATUS_INVALID;
+               break;
+    }
+    cp++;
+
+    for (field = 4; field <= 24; field++) {
+        value = strtoull(cp, &end, 10);
+        if (end == cp)
+            return -1;
+        cp = end;
+        switch (field) {
+        case 14:                               /*  utime */
+        case 15:                               /* +stime */
+            cpu += value;
+            break;
+        case 22:
+            entry->start_time = value;
+            break;
+        case 24:
+            entry->hrSWRunPerfMem = value * (pagesize / 1024);   /* in kB */
+            break;
+        }
+    }
+    entry->hrSWRunPerfCPU = cpu * 100 / sc_clk_tck;
+    return 0;
+}
+
+/*
+ * Fills in the path, parameters and type of an entry from
+ * /proc/<pid>/cmdline:  argv[0] '\0' argv[1] '\0' ....
+ *
+ * @retval 0 ok, -1 if the process went away
+ */
+static int
+_parse_cmdline(netsnmp_swrun_entry *entry, int procfd, char *buf, size_t len)
+{
+    int     n, ret;
+    char   *cp;
+
+    n = _read_pid_file(procfd, entry->hrSWRunIndex, "cmdline", buf, len);
+    if (n < 0)
+        return -1;
+    while (n > 0 && buf[n - 1] == '\0')
+        n--;
+
+    if (n == 0) {
+        /* empty /proc/PID/cmdline, it's probably a kernel thread */
+        entry->hrSWRunPath_len = 0;
+        entry->hrSWRunParameters_len = 0;
+        entry->hrSWRunPath[0] = '\0';
+        entry->hrSWRunParameters[0] = '\0';
+        entry->hrSWRunType = HRSWRUNTYPE_OPERATINGSYSTEM;
+        return 0;
+    }
+    entry->hrSWRunType = HRSWRUNTYPE_APPLICATION;
+
+    /*
+     *     argv[0]   is hrSWRunPath
+     */
+    ret = snprintf(entry->hrSWRunPath, sizeof(entry->hrSWRunPath), "%s", buf);
+    if (ret < sizeof(entry->hrSWRunPath))
+        entry->hrSWRunPath_len = ret;
+    else
+        entry->hrSWRunPath_len = sizeof(entry->hrSWRunPath) - 1;
+
+    /*
+     * Stitch together argv[1..] to construct hrSWRunParameters
+     */
+    ret = strlen(buf);
+    for (cp = buf + ret + 1; cp < buf + n; cp++)
+        if (*cp == '\0')
+            *cp = ' ';
+    entry->hrSWRunParameters_len
+        = snprintf(entry->hrSWRunParameters, sizeof(entry->hrSWRunParameters),
+                   "%.*s", ret < n ? n - ret - 1 : 0, buf + ret + 1);
+    if (entry->hrSWRunParameters_len >= sizeof(entry->hrSWRunParameters))
+        entry->hrSWRunParameters_len = sizeof(entry->hrSWRunParameters) - 1;
+    return 0;
+}
+
 /* ---------------------------------------------------------------------
+ *
+ * With NETSNMP_SWRUN_UPDATE the container may still hold the entries of
+ * the previous load.  The stat file of each process is parsed on the
+ * stack first, and a process whose start time and name are unchanged
+ * keeps its entry with the new stat values; only new processes get an
+ * entry allocated and their cmdline read.  The /proc directory stays
+ * open between loads.
  */
 int
 netsnmp_arch_swrun_container_load( netsnmp_container *container, u_int flags)
 {
-    DIR                 *procdir = NULL;
+    netsnmp_container   *previous = NULL;
     struct dirent       *procentry_p;
-    FILE                *fp;
-    int                  pid, i, ret;
-    unsigned long long   cpu;
-    char                 buf[BUFSIZ], buf2[BUFSIZ], *cp, *cp1;
-    netsnmp_swrun_entry *entry;
+    int                  pid, procfd, kept = 0;
+    char                 buf[BUFSIZ];
+    netsnmp_swrun_entry  current, *entry, *old;
     
-    procdir = opendir("/proc");
     if ( NULL == procdir ) {
-        snmp_log( LOG_ERR, "Failed to open /proc" );
-        return -1;
+        procdir = opendir("/proc");
+        if ( NULL == procdir ) {
+            snmp_log( LOG_ERR, "Failed to open /proc" );
+            return -1;
+        }
+    } else
+        rewinddir( procdir );
+    procfd = dirfd( procdir );
+
+    if ((flags & NETSNMP_SWRUN_UPDATE) && CONTAINER_SIZE(container)) {
+        previous = netsnmp_container_find("swrun_previous:table_container");
+        if (NULL == previous)
+            netsnmp_swrun_container_free_items(container);
+        else {
+            CONTAINER_FOR_EACH(container,
+                               (netsnmp_container_obj_func *)_move_entry,
+                               previous);
+            CONTAINER_CLEAR(container, NULL, NULL);
+        }
     }
 
     /*
@@ -75,149 +261,59 @@ netsnmp_arch_swrun_container_load( netsnmp_container *container, u_int flags)
         if ( 0 == pid )
             continue;   /* Presumably '.' or '..' */
 
-        entry = netsnmp_swrun_entry_create(pid);
-        if (NULL == entry)
-            continue;   /* error already logged by function */
-
-        /*
-         * Now extract the interesting information
-         *   from the various /proc{PID}/ interface files
-         */
-
-        /*
-         *   Name:  process name
-         */
-        snprintf( buf2, BUFSIZ, "/proc/%d/status", pid );
-        fp = fopen( buf2, "r" );
-        if (!fp) {
-            netsnmp_swrun_entry_free(entry);
+        if (_read_pid_file(procfd, pid, "stat", buf, sizeof(buf)) < 0)
             continue; /* file (process) probably went away */
-	}
-        memset(buf, 0, sizeof(buf));
-        if (fgets( buf, BUFSIZ-1, fp ) == NULL) {
-            fclose(fp);
-            netsnmp_swrun_entry_free(entry);
+        memset(&current, 0, sizeof(current));
+        current.hrSWRunIndex = pid;
+        current.oid_index.len = 1;
+        current.oid_index.oids = &current.hrSWRunIndex;
+        if (_parse_stat(&current, buf) < 0)
             continue;
-        }
-        fclose(fp);
-
-        for ( cp = buf; *cp != ':'; cp++ )
-            ;
-        while (isspace(*(++cp)))	/* Skip ':' and following spaces */
-            ;
-        entry->hrSWRunName_len = snprintf(entry->hrSWRunName,
-                                   sizeof(entry->hrSWRunName)-1, "%s", cp);
-        if ( '\n' == entry->hrSWRunName[ entry->hrSWRunName_len-1 ]) {
-            entry->hrSWRunName[ entry->hrSWRunName_len-1 ] = '\0';
-            entry->hrSWRunName_len--;           /* Stamp on trailing newline */
-        }
-
-        /*
-         *  Command Line:
-         *     argv[0] '\0' argv[1] '\0' ....
-         */
-        snprintf( buf2, BUFSIZ, "/proc/%d/cmdline", pid );
-        fp = fopen( buf2, "r" );
-        if (!fp) {
-            netsnmp_swrun_entry_free(entry);
-            continue; /* file (process) probably went away */
-        }
-        entry->hrSWRunType = HRSWRUNTYPE_APPLICATION;
-        memset(buf, 0, sizeof(buf));
-        cp = fgets( buf, BUFSIZ-1, fp );
-        fclose(fp);
-        if (cp != NULL) {
-            /*
-             *     argv[0]   is hrSWRunPath
-             */
-            ret = snprintf(entry->hrSWRunPath, sizeof(entry->hrSWRunPath),
-                           "%s", buf);
-
-            if (ret < sizeof(entry->hrSWRunPath))
-                entry->hrSWRunPath_len = ret;
-            else
-                entry->hrSWRunPath_len = sizeof(entry->hrSWRunPath) - 1;
 
+        old = previous ? CONTAINER_FIND(previous, &current) : NULL;
+        if (old && old->start_time == current.start_time &&
+            old->hrSWRunName_len == current.hrSWRunName_len &&
+            0 == memcmp(old->hrSWRunName, current.hrSWRunName,
+                        current.hrSWRunName_len)) {
             /*
-             * Stitch together argv[1..] to construct hrSWRunParameters
+             * same process as last time: update it in place
              */
-            for (cp = buf + ret; ! (*cp == '\0' && *(cp + 1) == '\0'); cp++)
-                    if (*cp == '\0')
-                            *cp = ' ';
-
-            entry->hrSWRunParameters_len
-                = sprintf(entry->hrSWRunParameters, "%.*s",
-                          (int)sizeof(entry->hrSWRunParameters) - 1,
-                          buf + ret + 1);
-        } else {
-            /* empty /proc/PID/cmdline, it's probably a kernel thread */
-            entry->hrSWRunPath_len = 0;
-            entry->hrSWRunParameters_len = 0;
-            entry->hrSWRunType = HRSWRUNTYPE_OPERATINGSYSTEM;
+            old->hrSWRunStatus  = current.hrSWRunStatus;
+            old->hrSWRunPerfCPU = current.hrSWRunPerfCPU;
+            old->hrSWRunPerfMem = current.hrSWRunPerfMem;
+            CONTAINER_INSERT(container, old);
+            kept++;
+            continue;
         }
 
-        /*
-         *   {xxx} {xxx} STATUS  {xxx}*10  UTIME STIME  {xxx}*8 RSS
-         */
-        snprintf( buf, BUFSIZ, "/proc/%d/stat", pid );
-        fp = fopen( buf, "r" );
-        if (!fp) {
+        entry = netsnmp_swrun_entry_create(pid);
+        if (NULL == entry)
+            continue;   /* error already logged by function */
+        entry->hrSWRunStatus  = current.hrSWRunStatus;
+        entry->hrSWRunPerfCPU = current.hrSWRunPerfCPU;
+        entry->hrSWRunPerfMem = current.hrSWRunPerfMem;
+        entry->start_time     = current.start_time;
+        entry->hrSWRunName_len = current.hrSWRunName_len;
+        memcpy(entry->hrSWRunName, current.hrSWRunName,
+               sizeof(entry->hrSWRunName));
+
+        if (_parse_cmdline(entry, procfd, buf, sizeof(buf)) < 0) {
             netsnmp_swrun_entry_free(entry);
             continue; /* file (process) probably went away */
-	}
-        if (fgets( buf, BUFSIZ-1, fp ) == NULL) {
-            fclose(fp);
-            netsnmp_swrun_entry_free(entry);
-            continue;
-        }
-        fclose(fp);
-
-        cp = buf;
-        while ( ' ' != *(cp++))    /* Skip first field */
-            ;
-        cp1 = cp;                  /* Skip second field */
-        while (*cp1) {
-            if (*cp1 == ')') cp = cp1;
-            cp1++;
         }
-        cp += 2;
-        
-        switch (*cp) {
-        case 'R':  entry->hrSWRunStatus = HRSWRUNSTATUS_RUNNING;
-                   break;
-        case 'S':  entry->hrSWRunStatus = HRSWRUNSTATUS_RUNNABLE;
-                   break;
-        case 'D':
-        case 'T':  entry->hrSWRunStatus = HRSWRUNSTATUS_NOTRUNNABLE;
-                   break;
-        case 'Z':
-        default:   entry->hrSWRunStatus = HRSWRUNSTATUS_INVALID;
-                   break;
-        }
-        for (i=11; i; i--) {   /* Skip STATUS + 10 fields */
-            while (' ' != *(++cp))
-                ;
-            cp++;
-        }
-        cpu  = atol( cp );                     /*  utime */
-        while ( ' ' != *(++cp))
-            ;
-        cpu += atol( cp );                     /* +stime */
-        entry->hrSWRunPerfCPU  = cpu * 100 / sc_clk_tck;
-
-        for (i=9; i; i--) {   /* Skip stime + 8 fields */
-            while (' ' != *(++cp))
-                ;
-            cp++;
-        }
-        entry->hrSWRunPerfMem  = atol( cp );       /* rss   */
-        entry->hrSWRunPerfMem *= (pagesize/1024);  /* in kB */
         CONTAINER_INSERT(container, entry);
     }
-    closedir( procdir );
 
-    DEBUGMSGTL(("swrun:load:arch"," loaded %" NETSNMP_PRIz "d entries\n",
-                CONTAINER_SIZE(container)));
+    if (previous) {
+        /* free the entries which were not carried over */
+        CONTAINER_FOR_EACH(previous,
+                           (netsnmp_container_obj_func *)_free_unless_kept,
+                           container);
+        netsnmp_swrun_container_free(previous, NETSNMP_SWRUN_DONT_FREE_ITEMS);
+    }
+
+    DEBUGMSGTL(("swrun:load:arch"," loaded %" NETSNMP_PRIz "d entries,"
+                " %d unchanged\n", CONTAINER_SIZE(container), kept));
 
     return 0;
 }
@@ -19,14 +19,35 @@
 #include <net-snmp/agent/table_container.h>
 #include <net-snmp/data_access/swinst.h>
 #include <net-snmp/agent/cache_handler.h>
+#include "host/data_access/swinst.h"
 #include "hrSWInstalledTable.h"
 
 #define MYTABLE "hrSWInstalledTable"
 
+/*
+ * querying the package database can take seconds, so where that can be
+ * done in a thread, requests use the old list for up to this long
+ * after it expired while a new one is loaded.
+ */
+#define HRSWINSTALLED_MAX_STALE 300     /* seconds */
+
 static netsnmp_table_registration_info *table_info;
 
+/*
+ * software generation the rows in the container were loaded at
+ */
+static u_int    _loaded_generation = 0;
+#ifdef NETSNMP_SWINST_ARCH_THREAD_SAFE
+static u_int    _snapshot_generation = 0;
+#endif
+
 static void _cache_free(netsnmp_cache * cache, void *magic);
 static int _cache_load(netsnmp_cache * cache, void *magic);
+#ifdef NETSNMP_SWINST_ARCH_THREAD_SAFE
+static void *_cache_snapshot(netsnmp_cache * cache, void *magic);
+static void _cache_swap(netsnmp_cache * cache, void *magic, void *snapshot);
+static void _cache_snapshot_free(netsnmp_cache * cache, void *snapshot);
+#endif
 
 /** Initializes the hrSWInstalledTable module */
 void
@@ -126,6 +147,17 @@ initialize_table_hrSWInstalledTable(void)
         goto bail;
     }
     cache->magic = container;
+    /*
+     * keep the rows when the cache expires; _cache_load only reloads
+     * them if the installed software changed since the last load.
+     */
+    cache->flags |= NETSNMP_CACHE_DONT_FREE_BEFORE_LOAD |
+        NETSNMP_CACHE_DONT_FREE_EXPIRED;
+#ifdef NETSNMP_SWINST_ARCH_THREAD_SAFE
+    netsnmp_cache_set_background(cache, HRSWINSTALLED_MAX_STALE,
+                                 _cache_snapshot, _cache_swap,
+                                 _cache_snapshot_free);
+#endif
 
     handler = netsnmp_cache_handler_get(cache);
     if (NULL == handler) {
@@ -251,6 +283,8 @@ hrSWInstalledTable_handler(netsnmp_mib_handler *handler,
 static int
 _cache_load(netsnmp_cache * cache, void *vmagic)
 {
+    u_int           generation = netsnmp_swinst_generation();
+
     DEBUGMSGTL(("hrSWInstalledTable:cache", "load\n"));
 
     if ((NULL == cache) || (NULL == cache->magic)) {
@@ -261,8 +295,25 @@ _cache_load(netsnmp_cache * cache, void *vmagic)
     /** should only be called for an invalid or expired cache */
     netsnmp_assert((0 == cache->valid) || (1 == cache->expired));
 
+    /*
+     * the cache doesn't free the rows before calling us. Keep them if
+     * the software is known not to have changed, else start over.
+     */
+    if (CONTAINER_SIZE((netsnmp_container *) cache->magic) > 0) {
+        if (0 != generation && generation == _loaded_generation) {
+            DEBUGMSGTL(("hrSWInstalledTable:cache",
+                        "software unchanged, keeping %d entries\n",
+                        (int) CONTAINER_SIZE((netsnmp_container *)
+                                             cache->magic)));
+            return 0;
+        }
+        netsnmp_swinst_container_free_items((netsnmp_container *)
+                                            cache->magic);
+    }
+
     cache->magic =
         netsnmp_swinst_container_load((netsnmp_container *) cache->magic, 0);
+    _loaded_generation = generation;
 
     return 0;
 }                               /* _cache_load */
@@ -281,3 +332,59 @@ _cache_free(netsnmp_cache * cache, void *magic)
 
     netsnmp_swinst_container_free_items((netsnmp_container *) cache->magic);
 }                               /* _cache_free */
+
+#ifdef NETSNMP_SWINST_ARCH_THREAD_SAFE
+/**
+ * @internal
+ * loads the installed software into a new container. This is called
+ * in the cache loader thread. If the software is known not to have
+ * changed, the table container itself is returned to keep its rows.
+ * _loaded_generation and _snapshot_generation are not touched by the
+ * agent's thread while a load runs.
+ */
+static void *
+_cache_snapshot(netsnmp_cache * cache, void *magic)
+{
+    u_int           generation = netsnmp_swinst_generation();
+
+    if (0 != generation && generation == _loaded_generation)
+        return magic;
+    _snapshot_generation = generation;
+    return netsnmp_swinst_container_load(NULL, 0);
+}                               /* _cache_snapshot */
+
+static void
+_cache_swap_entry(void *entry, void *container)
+{
+    CONTAINER_INSERT((netsnmp_container *) container, entry);
+}
+
+/**
+ * @internal
+ * moves the entries of a snapshot into the table container
+ */
+static void
+_cache_swap(netsnmp_cache * cache, void *magic, void *snapshot)
+{
+    netsnmp_container *container = (netsnmp_container *) magic;
+    netsnmp_container *loaded = (netsnmp_container *) snapshot;
+
+    DEBUGMSGTL(("hrSWInstalledTable:cache", "swap\n"));
+
+    _loaded_generation = _snapshot_generation;
+    netsnmp_swinst_container_free_items(container);
+    CONTAINER_FOR_EACH(loaded, _cache_swap_entry, container);
+    netsnmp_swinst_container_free(loaded, NETSNMP_SWINST_DONT_FREE_ITEMS);
+}                               /* _cache_swap */
+
+/**
+ * @internal
+ * frees a snapshot that was not swapped in
+ */
+static void
+_cache_snapshot_free(netsnmp_cache * cache, void *snapshot)
+{
+    netsnmp_swinst_container_free((netsnmp_container *) snapshot,
+                                  NETSNMP_SWINST_NOFLAGS);
+}                               /* _cache_snapshot_free */
+#endif                          /* NETSNMP_SWINST_ARCH_THREAD_SAFE */
@@ -87,6 +87,15 @@ init_interface(void)
                                   _free_include_if_config,
                                   "IF-MIB iface names included");
 
+#if defined(linux)
+    netsnmp_ds_register_config(ASN_BOOLEAN,
+                               netsnmp_ds_get_string(NETSNMP_DS_LIBRARY_ID,
+                                                     NETSNMP_DS_LIB_APPTYPE),
+                               "interface_link_events",
+                               NETSNMP_DS_APPLICATION_ID,
+                               NETSNMP_DS_AGENT_IF_LINK_EVENTS);
+#endif
+
     snmp_register_callback(SNMP_CALLBACK_LIBRARY,
                            SNMP_CALLBACK_POST_READ_CONFIG,
                            _load_if_list, NULL);
@@ -156,7 +165,11 @@ netsnmp_access_interface_container_init(u_int flags)
 /**
  * load interface information in specified container
  *
- * @param container empty container, or NULL to have one created for you
+ * @param container empty container, or NULL to have one created for you.
+ *                  With NETSNMP_ACCESS_INTERFACE_LOAD_REUSE it may hold
+ *                  the entries of an earlier load, which are updated and
+ *                  dropped if their interface is gone.  On error the
+ *                  container is freed.
  * @param load_flags flags to modify behaviour. Examples:
  *                   NETSNMP_ACCESS_INTERFACE_INIT_ADDL_IDX_BY_NAME
  *
@@ -178,6 +191,16 @@ netsnmp_access_interface_container_load(netsnmp_container* container, u_int load
         return NULL;
     }
 
+#if !defined(linux)
+    /*
+     * only the Linux loader updates the entries of an earlier load
+     */
+    if (load_flags & NETSNMP_ACCESS_INTERFACE_LOAD_REUSE)
+        CONTAINER_CLEAR(container,
+                        (netsnmp_container_obj_func*)_access_interface_entry_release,
+                        NULL);
+#endif
+
     rc =  netsnmp_arch_interface_container_load(container, load_flags);
     if (0 != rc) {
         netsnmp_access_interface_container_free(container,
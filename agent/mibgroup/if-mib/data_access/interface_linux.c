@@ -116,6 +116,10 @@ typedef __u8 u8;           /* ditto */
 #endif  /* RTMGRP_IPV6_PREFIX */
 #endif  /* HAVE_LINUX_RTNETLINK_H */
 #endif  /* NETSNMP_ENABLE_IPV6 */
+#if defined(HAVE_LINUX_RTNETLINK_H)
+#include <linux/rtnetlink.h>
+#define SUPPORT_LINK_EVENTS 1
+#endif  /* HAVE_LINUX_RTNETLINK_H */
 unsigned long long
 netsnmp_linux_interface_get_if_speed(int fd, const char *name,
         unsigned long long defaultspeed);
@@ -138,6 +142,40 @@ netsnmp_prefix_listen_info list_info;
 int netsnmp_prefix_listen(void);
 #endif
 
+/*
+ * With "interface_link_events yes", the link attributes that cost an
+ * ioctl or a file read per interface (speed, PCI description, neighbour
+ * timers, IPv6 forwarding) are kept between loads, and only looked up
+ * again for links the kernel reports with RTM_NEWLINK or RTM_DELLINK.
+ * The kernel doesn't announce changes of the neighbour timers, so every
+ * record is also refreshed after LINK_ATTRS_MAX_AGE seconds.
+ */
+#define LINK_ATTRS_MAX_AGE      300
+#define LINK_ATTRS_NS_FLAGS     (NETSNMP_INTERFACE_FLAGS_HAS_V4_RETRANSMIT | \
+                                 NETSNMP_INTERFACE_FLAGS_HAS_V6_RETRANSMIT | \
+                                 NETSNMP_INTERFACE_FLAGS_HAS_V6_REACHABLE | \
+                                 NETSNMP_INTERFACE_FLAGS_HAS_V6_FORWARDING)
+
+typedef struct netsnmp_link_attrs_s {
+    netsnmp_index   oid_index;
+    oid             index;
+    long            loaded;     /* monotonic seconds, 0 = not loaded */
+    char           *descr;      /* NULL = interface name */
+    u_int           speed;
+    u_int           speed_high;
+    u_int           ns_flags;   /* LINK_ATTRS_NS_FLAGS only */
+    u_int           retransmit_v4;
+    u_int           retransmit_v6;
+    u_int           reachable_time;
+    char            forwarding_v6;
+} netsnmp_link_attrs;
+
+#ifdef SUPPORT_LINK_EVENTS
+static netsnmp_container *link_attrs_container = NULL;
+
+static int netsnmp_link_events_listen(void);
+#endif
+
 #ifdef HAVE_PCI_LOOKUP_NAME
 static void init_libpci(void)
 {
@@ -181,6 +219,11 @@ netsnmp_arch_interface_init(void)
     list_info.list_head = &prefix_head_list;
     netsnmp_prefix_listen();
 #endif
+#ifdef SUPPORT_LINK_EVENTS
+    if (netsnmp_ds_get_boolean(NETSNMP_DS_APPLICATION_ID,
+                               NETSNMP_DS_AGENT_IF_LINK_EVENTS))
+        netsnmp_link_events_listen();
+#endif
 
     init_libpci();
 }
@@ -652,18 +695,118 @@ _retrieve_stats(netsnmp_interface_entry *entry, struct rtnl_link *rtnl_link)
         entry->stats.obcast.low;
 }
 
+#ifdef SUPPORT_LINK_EVENTS
+static long
+_link_attrs_now(void)
+{
+    struct timeval  now;
+
+    netsnmp_get_monotonic_clock(&now);
+    return now.tv_sec + 1;      /* never 0 */
+}
+
+/*
+ * Returns the saved attributes of link @if_index, creating an empty record
+ * for it if there is none, or NULL if link events are not in use.
+ */
+static netsnmp_link_attrs *
+_link_attrs_get(oid if_index)
+{
+    netsnmp_link_attrs *attrs;
+    netsnmp_index   oid_index = { 1, &if_index };
+
+    if (NULL == link_attrs_container)
+        return NULL;
+
+    attrs = CONTAINER_FIND(link_attrs_container, &oid_index);
+    if (attrs) {
+        if (attrs->loaded &&
+            _link_attrs_now() - attrs->loaded >= LINK_ATTRS_MAX_AGE)
+            attrs->loaded = 0;
+        return attrs;
+    }
+
+    attrs = SNMP_MALLOC_TYPEDEF(netsnmp_link_attrs);
+    if (NULL == attrs)
+        return NULL;
+    attrs->index = if_index;
+    attrs->oid_index.len = 1;
+    attrs->oid_index.oids = &attrs->index;
+    if (CONTAINER_INSERT(link_attrs_container, attrs) != 0) {
+        free(attrs);
+        return NULL;
+    }
+    return attrs;
+}
+
+static void
+_link_attrs_free(netsnmp_link_attrs *attrs, void *context)
+{
+    free(attrs->descr);
+    free(attrs);
+}
+#endif /* SUPPORT_LINK_EVENTS */
+
+/*
+ * Save the attributes of @entry that were looked up the slow way, so that
+ * the next load can reuse them.
+ */
+static void
+_link_attrs_save(netsnmp_link_attrs *attrs,
+                 const netsnmp_interface_entry *entry)
+{
+    free(attrs->descr);
+    attrs->descr = NULL;
+    if (entry->descr && strcmp(entry->descr, entry->name) != 0)
+        attrs->descr = strdup(entry->descr);
+    attrs->ns_flags = entry->ns_flags & LINK_ATTRS_NS_FLAGS;
+    attrs->retransmit_v4 = entry->retransmit_v4;
+    attrs->retransmit_v6 = entry->retransmit_v6;
+    attrs->reachable_time = entry->reachable_time;
+    attrs->forwarding_v6 = entry->forwarding_v6;
+#ifdef SUPPORT_LINK_EVENTS
+    attrs->loaded = _link_attrs_now();
+#endif
+}
+
+static void
+_link_attrs_apply(const netsnmp_link_attrs *attrs,
+                  netsnmp_interface_entry *entry)
+{
+    if (attrs->descr &&
+        (!entry->descr || strcmp(entry->descr, attrs->descr) != 0)) {
+        free(entry->descr);
+        entry->descr = strdup(attrs->descr);
+    }
+    entry->ns_flags |= attrs->ns_flags;
+    entry->retransmit_v4 = attrs->retransmit_v4;
+    entry->retransmit_v6 = attrs->retransmit_v6;
+    entry->reachable_time = attrs->reachable_time;
+    entry->forwarding_v6 = attrs->forwarding_v6;
+}
+
+/*
+ * @attrs: saved attributes of this link, or NULL.  If they are loaded they
+ *         are used instead of looking the values up again, otherwise they
+ *         are filled in.
+ */
 static void netsnmp_retrieve_one_link_info(struct rtnl_link *rtnl_link, int fd,
                                            netsnmp_interface_entry *entry,
-                                           int load_stats)
+                                           int load_stats,
+                                           netsnmp_link_attrs *attrs)
 {
     struct nl_addr *nl_addr = rtnl_link_get_addr(rtnl_link);
     void *paddr = nl_addr_get_binary_addr(nl_addr);
     int paddr_len = nl_addr_get_len(nl_addr);
     unsigned int link_flags;
+    int cached = attrs && attrs->loaded;
 
-    free(entry->paddr);
-    entry->paddr = netsnmp_memdup(paddr, paddr_len);
-    entry->paddr_len = paddr_len;
+    if (!entry->paddr || entry->paddr_len != paddr_len ||
+        memcmp(entry->paddr, paddr, paddr_len) != 0) {
+        free(entry->paddr);
+        entry->paddr = netsnmp_memdup(paddr, paddr_len);
+        entry->paddr_len = paddr_len;
+    }
     entry->type = netsnmp_convert_arphrd_type(
                               rtnl_link_get_arptype(rtnl_link));
     if (entry->type == 0)
@@ -675,7 +818,16 @@ static void netsnmp_retrieve_one_link_info(struct rtnl_link *rtnl_link, int fd,
     /* MTU */
     entry->mtu = rtnl_link_get_mtu(rtnl_link);
     /* link speed */
-    netsnmp_retrieve_link_speed(fd, entry);
+    if (cached) {
+        entry->speed = attrs->speed;
+        entry->speed_high = attrs->speed_high;
+    } else {
+        netsnmp_retrieve_link_speed(fd, entry);
+        if (attrs) {
+            attrs->speed = entry->speed;
+            attrs->speed_high = entry->speed_high;
+        }
+    }
 
     /*
      * Zero speed means link problem - I'm not sure this is always true.
@@ -708,27 +860,125 @@ static void netsnmp_retrieve_one_link_info(struct rtnl_link *rtnl_link, int fd,
     if (load_stats)
         _retrieve_stats(entry, rtnl_link);
 
+    if (cached) {
+        _link_attrs_apply(attrs, entry);
+        return;
+    }
+
     _arch_interface_flags_v4_get(entry);
 
 #ifdef NETSNMP_ENABLE_IPV6
     _arch_interface_flags_v6_get(entry);
 #endif /* NETSNMP_ENABLE_IPV6 */
+
+    if (attrs)
+        _link_attrs_save(attrs, entry);
+}
+
+/*
+ * Entries of an earlier load, sorted by ifIndex, that are handed out
+ * again for the same interfaces instead of allocating new ones.
+ */
+struct old_entry {
+    oid             index;
+    netsnmp_interface_entry *entry;     /* NULL once handed out */
+};
+
+struct old_entries {
+    struct old_entry *old;
+    size_t          count;
+    size_t          used;
+};
+
+static void
+_old_entries_add(void *entry, void *context)
+{
+    struct old_entries *o = (struct old_entries *) context;
+    netsnmp_interface_entry *e = (netsnmp_interface_entry *) entry;
+
+    if (o->used < o->count) {
+        o->old[o->used].index = e->index;
+        o->old[o->used++].entry = e;
+    }
+}
+
+static void
+_old_entries_free(void *entry, void *context)
+{
+    netsnmp_access_interface_entry_free((netsnmp_interface_entry *) entry);
+}
+
+static int
+_old_entry_compare(const void *lhs, const void *rhs)
+{
+    const struct old_entry *l = lhs, *r = rhs;
+
+    return l->index < r->index ? -1 : l->index > r->index;
+}
+
+/*
+ * Takes the entry of interface @if_index out of @o and makes it look
+ * freshly created again, keeping the strings it owns.  Returns NULL if
+ * there is none, or if the interface has been renamed.
+ */
+static netsnmp_interface_entry *
+_old_entries_take(struct old_entries *o, oid if_index, const char *ifname)
+{
+    struct old_entry key, *found;
+    netsnmp_interface_entry *entry, keep;
+
+    key.index = if_index;
+    found = o->used ? bsearch(&key, o->old, o->used, sizeof(*o->old),
+                              _old_entry_compare) : NULL;
+    if (!found || !found->entry || !found->entry->name ||
+        strcmp(found->entry->name, ifname) != 0)
+        return NULL;
+    entry = found->entry;
+    found->entry = NULL;
+
+    keep = *entry;
+    memset(entry, 0, sizeof(*entry));
+    entry->index = keep.index;
+    entry->oid_index.len = 1;
+    entry->oid_index.oids = &entry->index;
+    entry->name = keep.name;
+    entry->descr = keep.descr;
+    entry->paddr = keep.paddr;
+    entry->paddr_len = keep.paddr_len;
+    entry->old_stats = keep.old_stats;
+    entry->connector_present = 1;
+    return entry;
 }
 
 /*
  * Iterate over all network interfaces (links) and store information about
- * the network interfaces in @container.
+ * the network interfaces in @container.  With @reuse, the entries already
+ * in @container are updated instead of being replaced.
  */
 static void netsnmp_retrieve_link_info(struct nl_sock *nl_sock, int fd,
-                                       netsnmp_container *container)
+                                       netsnmp_container *container,
+                                       int reuse)
 {
     struct nl_cache *link_cache;
     struct nl_object *nl_object;
+    struct old_entries old = { NULL, 0, 0 };
+    size_t i;
     int ret;
 
     ret = rtnl_link_alloc_cache(nl_sock, AF_UNSPEC, &link_cache);
     if (ret)
         return;
+
+    if (reuse && CONTAINER_SIZE(container) > 0) {
+        old.count = CONTAINER_SIZE(container);
+        old.old = (struct old_entry *) malloc(old.count * sizeof(*old.old));
+        if (old.old) {
+            CONTAINER_FOR_EACH(container, _old_entries_add, &old);
+            qsort(old.old, old.used, sizeof(*old.old), _old_entry_compare);
+            CONTAINER_CLEAR(container, NULL, NULL);
+        } else
+            CONTAINER_CLEAR(container, _old_entries_free, NULL);
+    }
 #if 0
     {
         // Debugging code: dump the statistics in ASCII format.
@@ -748,23 +998,38 @@ static void netsnmp_retrieve_link_info(struct nl_sock *nl_sock, int fd,
         int if_index = rtnl_link_get_ifindex(rtnl_link);
         const char *ifname = rtnl_link_get_name(rtnl_link);
         netsnmp_interface_entry *entry;
+        netsnmp_link_attrs *attrs = NULL;
 
         netsnmp_assert(if_index > 0);
         if (if_index <= 0)
             continue;
 	if (!netsnmp_access_interface_include(ifname))
             continue;
-        entry = netsnmp_access_interface_entry_create(ifname, if_index);
+        entry = _old_entries_take(&old, if_index, ifname);
+        if (!entry)
+            entry = netsnmp_access_interface_entry_create(ifname, if_index);
         if (!entry)
             continue;
+#ifdef SUPPORT_LINK_EVENTS
+        attrs = _link_attrs_get(if_index);
+#endif
 #ifdef HAVE_PCI_LOOKUP_NAME
-	_arch_interface_description_get(entry);
+        if (!attrs || !attrs->loaded)
+            _arch_interface_description_get(entry);
 #endif
-        netsnmp_retrieve_one_link_info(rtnl_link, fd, entry, TRUE);
+        netsnmp_retrieve_one_link_info(rtnl_link, fd, entry, TRUE, attrs);
         ret = CONTAINER_INSERT(container, entry);
         netsnmp_assert(ret == 0);
     }
     nl_cache_put(link_cache);
+
+    /*
+     * interfaces that are gone or have been renamed
+     */
+    for (i = 0; i < old.used; i++)
+        if (old.old[i].entry)
+            netsnmp_access_interface_entry_free(old.old[i].entry);
+    free(old.old);
 }
 
 /* Iterate over all network addresses and set ns_flags in @container. */
@@ -851,7 +1116,8 @@ netsnmp_arch_interface_container_load(netsnmp_container* container,
         goto free_nl_sock;
     }
 
-    netsnmp_retrieve_link_info(nl_sock, fd, container);
+    netsnmp_retrieve_link_info(nl_sock, fd, container,
+                               load_flags & NETSNMP_ACCESS_INTERFACE_LOAD_REUSE);
     netsnmp_retrieve_addr_info(nl_sock, container);
 
     ret = 0;
@@ -1195,3 +1461,114 @@ void netsnmp_prefix_process(int fd, void *data)
 }
 #endif
 
+
+#ifdef SUPPORT_LINK_EVENTS
+static void netsnmp_link_events_process(int fd, void *data);
+
+/*
+ * Open netlink socket to watch link changes, and start saving link
+ * attributes between loads.
+ */
+static int netsnmp_link_events_listen(void)
+{
+    struct sockaddr_nl localaddrinfo;
+    int fd;
+
+    fd = socket(PF_NETLINK, SOCK_DGRAM, NETLINK_ROUTE);
+    if (fd < 0) {
+        snmp_log(LOG_ERR, "netsnmp_link_events_listen: Cannot create socket.\n");
+        return -1;
+    }
+
+    memset(&localaddrinfo, 0, sizeof(struct sockaddr_nl));
+    localaddrinfo.nl_family = AF_NETLINK;
+    localaddrinfo.nl_groups = RTMGRP_LINK;
+
+    if (bind(fd, (struct sockaddr*)&localaddrinfo, sizeof(localaddrinfo)) < 0) {
+        snmp_log(LOG_ERR,"netsnmp_link_events_listen: Bind failed.\n");
+        close(fd);
+        return -1;
+    }
+
+    link_attrs_container = netsnmp_container_find("link_attrs:table_container");
+    if (NULL == link_attrs_container) {
+        close(fd);
+        return -1;
+    }
+    link_attrs_container->container_name = strdup("link attributes");
+
+    if (register_readfd(fd, netsnmp_link_events_process, NULL) != 0) {
+        snmp_log(LOG_ERR,"netsnmp_link_events_listen: error registering netlink socket\n");
+        CONTAINER_FREE(link_attrs_container);
+        link_attrs_container = NULL;
+        close(fd);
+        return -1;
+    }
+
+    DEBUGMSGTL(("access:interface:events", "listening for link changes\n"));
+    return 0;
+}
+
+/*
+ * Process the pending link notifications: a changed link is looked up
+ * again at the next load, a deleted one is forgotten.
+ */
+static void netsnmp_link_events_process(int fd, void *data)
+{
+    char               buf[16384];
+    struct nlmsghdr    *nlmp;
+    int                len;
+
+    for (;;) {
+        len = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (len < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == ENOBUFS) {
+                /*
+                 * the socket overran and notifications were lost, so
+                 * nothing that was saved can be trusted any more
+                 */
+                DEBUGMSGTL(("access:interface:events", "overrun\n"));
+                CONTAINER_CLEAR(link_attrs_container,
+                                (netsnmp_container_obj_func *) _link_attrs_free,
+                                NULL);
+                continue;
+            }
+            if (errno != EAGAIN)
+                snmp_log(LOG_ERR,"netsnmp_link_events_process: Receive failed.\n");
+            return;
+        }
+        if (len == 0)
+            return;
+
+        for (nlmp = (struct nlmsghdr *)buf; NLMSG_OK(nlmp, len);
+             nlmp = NLMSG_NEXT(nlmp, len)) {
+            struct ifinfomsg   *ifi;
+            netsnmp_link_attrs *attrs;
+            oid                 if_index;
+            netsnmp_index       oid_index = { 1, &if_index };
+
+            if ((nlmp->nlmsg_type != RTM_NEWLINK &&
+                 nlmp->nlmsg_type != RTM_DELLINK) ||
+                nlmp->nlmsg_len < NLMSG_LENGTH(sizeof(*ifi)))
+                continue;
+
+            ifi = NLMSG_DATA(nlmp);
+            if_index = ifi->ifi_index;
+            attrs = CONTAINER_FIND(link_attrs_container, &oid_index);
+            if (NULL == attrs)
+                continue;
+
+            DEBUGMSGTL(("access:interface:events", "%s link %d\n",
+                        nlmp->nlmsg_type == RTM_NEWLINK ? "changed" : "deleted",
+                        ifi->ifi_index));
+            if (nlmp->nlmsg_type == RTM_DELLINK) {
+                CONTAINER_REMOVE(link_attrs_container, attrs);
+                _link_attrs_free(attrs, NULL);
+            } else
+                attrs->loaded = 0;
+        }
+    }
+}
+#endif /* SUPPORT_LINK_EVENTS */
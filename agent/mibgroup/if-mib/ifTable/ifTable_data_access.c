@@ -50,6 +50,12 @@ static int fadeout = IFTABLE_REMOVE_MISSING_AFTER;
  */
 static int replace_old = 0;
 
+/*
+ * the interface entries of the last load, which the next load updates
+ * in place; rows of the ifTable have their own copies
+ */
+static netsnmp_container *ifentries = NULL;
+
 static void __delete_missing_interface(void *rowreq_ctx, void *container);
 
 /** @ingroup interface 
@@ -204,6 +210,12 @@ ifTable_container_init(netsnmp_container **container_ptr_ptr,
         (NETSNMP_CACHE_DONT_AUTO_RELEASE | NETSNMP_CACHE_DONT_FREE_EXPIRED
          | NETSNMP_CACHE_DONT_FREE_BEFORE_LOAD | NETSNMP_CACHE_PRELOAD |
          NETSNMP_CACHE_AUTO_RELOAD | NETSNMP_CACHE_DONT_INVALIDATE_ON_SET);
+
+    /*
+     * the per-interface statistics tables are loaded along with
+     * this one (ifXTable shares this cache)
+     */
+    netsnmp_cache_group_add("interfaces", cache);
 }                               /* ifTable_container_init */
 
 void
@@ -409,12 +421,6 @@ _check_interface_entry_for_updates(ifTable_rowreq_ctx *rowreq_ctx,
             oper_changed = 1;
         netsnmp_access_interface_entry_copy(rowreq_ctx->data.ifentry,
                                             ifentry);
-
-        /*
-         * remove entry from temporary ifcontainer
-         */
-        CONTAINER_REMOVE(ifcontainer, ifentry);
-        netsnmp_access_interface_entry_free(ifentry);
     }
 
     /*
@@ -533,11 +539,6 @@ _add_new_interface(netsnmp_interface_entry *ifentry,
 #endif
 }
 
-static void __add_new_interface(void *ifentry, void *container)
-{
-    _add_new_interface(ifentry, container);
-}
-
 /**
  * add new entry
  */
@@ -584,6 +585,11 @@ ifTable_container_shutdown(netsnmp_container *container_ptr)
         return;
     }
 
+    if (ifentries) {
+        netsnmp_access_interface_container_free(ifentries,
+                                                NETSNMP_ACCESS_INTERFACE_FREE_NOFLAGS);
+        ifentries = NULL;
+    }
 }                               /* ifTable_container_shutdown */
 
 /**
@@ -618,6 +624,9 @@ int
 ifTable_container_load(netsnmp_container *container)
 {
     struct cd_container cdc;
+    netsnmp_container *added = NULL;
+    netsnmp_interface_entry *ifentry;
+    netsnmp_iterator *it;
 
     DEBUGMSGTL(("verbose:ifTable:ifTable_container_load", "called\n"));
 
@@ -631,8 +640,9 @@ ifTable_container_load(netsnmp_container *container)
      * ifTable gets its data from the netsnmp_interface API.
      */
     cdc.current =
-        netsnmp_access_interface_container_load(NULL,
-                                                NETSNMP_ACCESS_INTERFACE_INIT_NOFLAGS);
+        netsnmp_access_interface_container_load(ifentries,
+                                                NETSNMP_ACCESS_INTERFACE_LOAD_REUSE);
+    ifentries = cdc.current;
     if (NULL == cdc.current)
         return MFD_RESOURCE_UNAVAILABLE;        /* msg already logged */
 
@@ -653,16 +663,31 @@ ifTable_container_load(netsnmp_container *container)
     }
 
     /*
-     * now add any new interfaces
-     */
-    CONTAINER_FOR_EACH(cdc.current, __add_new_interface, container);
-
-    /*
-     * free the container. we've either claimed each ifentry, or released it,
-     * so the dal function doesn't need to clear the container.
+     * now add any new interfaces.  Their entries move over to the new
+     * rows; the others stay in ifentries for the next load.
      */
-    netsnmp_access_interface_container_free(cdc.current,
-                                            NETSNMP_ACCESS_INTERFACE_FREE_DONT_CLEAR);
+    it = CONTAINER_ITERATOR(cdc.current);
+    for (ifentry = ITERATOR_FIRST(it); ifentry; ifentry = ITERATOR_NEXT(it)) {
+        if (CONTAINER_FIND(container, ifentry))
+            continue;
+        if (NULL == added)
+            added = netsnmp_container_find("ifTable_added:linked_list");
+        if (NULL == added) {
+            snmp_log(LOG_ERR, "couldn't create container for new interface\n");
+            break;
+        }
+        CONTAINER_INSERT(added, ifentry);
+    }
+    ITERATOR_RELEASE(it);
+    if (NULL != added) {
+        for (ifentry = CONTAINER_FIRST(added); ifentry;
+             ifentry = CONTAINER_FIRST(added)) {
+            CONTAINER_REMOVE(added, ifentry);
+            CONTAINER_REMOVE(cdc.current, ifentry);
+            _add_new_interface(ifentry, container);
+        }
+        CONTAINER_FREE(added);
+    }
 
     DEBUGMSGT(("verbose:ifTable:ifTable_cache_load",
                "%lu records\n", (unsigned long)CONTAINER_SIZE(container)));
@@ -18,6 +18,13 @@
  */
 static void _access_route_entry_release(netsnmp_route_entry * entry, void *unused);
 
+/*
+ * 0 until the arch code first reports a change
+ */
+static u_int _route_generation = 0;
+
+static NetsnmpAccessRouteUpdate *_route_update_hook = NULL;
+
 /**---------------------------------------------------------------------*/
 /*
  * container functions
@@ -82,6 +89,46 @@ netsnmp_access_route_container_free(netsnmp_container *container, u_int free_fla
         CONTAINER_FREE(container);
 }
 
+/**
+ * @retval 0  route changes are not tracked
+ * @retval >0 changes whenever the routes change
+ */
+u_int
+netsnmp_access_route_generation(void)
+{
+    return _route_generation;
+}
+
+void
+netsnmp_access_route_changed(void)
+{
+    if (0 == ++_route_generation)
+        _route_generation = 1;
+}
+
+void
+netsnmp_access_route_set_update_hook(NetsnmpAccessRouteUpdate *hook)
+{
+    _route_update_hook = hook;
+}
+
+/**
+ * hand a route the arch code saw added or removed to the update hook
+ *
+ * @retval  0 the hook took the entry
+ * @retval -1 there is no hook, the entry was freed
+ */
+int
+netsnmp_access_route_update(netsnmp_route_entry *entry, int removed)
+{
+    if (NULL == _route_update_hook) {
+        netsnmp_access_route_entry_free(entry);
+        return -1;
+    }
+    (*_route_update_hook)(entry, removed);
+    return 0;
+}
+
 /**---------------------------------------------------------------------*/
 /*
  * ifentry functions
@@ -18,6 +18,17 @@
 #include "route.h"
 #include "route_private.h"
 
+#ifdef HAVE_LINUX_RTNETLINK_H
+#include <errno.h>
+#include <net/if.h>
+#include <linux/rtnetlink.h>
+#define SUPPORT_ROUTE_NETLINK 1
+
+netsnmp_feature_require(container_lifo);
+
+static int _route_events_listen(void);
+#endif
+
 static int
 _type_from_flags(unsigned int flags)
 {
@@ -339,6 +350,269 @@ _load_ipv6(netsnmp_container* container, u_long *index )
 }
 #endif
 
+#ifdef SUPPORT_ROUTE_NETLINK
+/*
+ * IANAipRouteProtocol of a route, from the rtm_protocol set by whoever
+ * installed it. Routes added by hand, by the kernel or at boot are local.
+ */
+static int
+_proto_from_rtprot(int protocol)
+{
+    switch (protocol) {
+    case RTPROT_REDIRECT:
+        return IANAIPROUTEPROTOCOL_ICMP;
+#ifdef RTPROT_BGP
+    case RTPROT_BGP:
+        return IANAIPROUTEPROTOCOL_BGP;
+    case RTPROT_ISIS:
+        return IANAIPROUTEPROTOCOL_ISIS;
+    case RTPROT_OSPF:
+        return IANAIPROUTEPROTOCOL_OSPF;
+    case RTPROT_RIP:
+        return IANAIPROUTEPROTOCOL_RIP;
+    case RTPROT_EIGRP:
+        return IANAIPROUTEPROTOCOL_CISCOEIGRP;
+#endif
+    default:
+        return IANAIPROUTEPROTOCOL_LOCAL;
+    }
+}
+
+static int
+_type_from_rtm_type(int type, int gateway)
+{
+    switch (type) {
+    case RTN_UNICAST:
+        return gateway ? INETCIDRROUTETYPE_REMOTE : INETCIDRROUTETYPE_LOCAL;
+    case RTN_UNREACHABLE:
+    case RTN_PROHIBIT:
+        return INETCIDRROUTETYPE_REJECT;
+    case RTN_BLACKHOLE:
+        return INETCIDRROUTETYPE_BLACKHOLE;
+    default:
+        return INETCIDRROUTETYPE_LOCAL;
+    }
+}
+
+/*
+ * add one next hop of a route to the container
+ */
+static void
+_add_netlink_entry(netsnmp_container *container, u_long *index,
+                   const struct rtmsg *r, struct rtattr **tb, uint32_t table,
+                   int if_index, struct rtattr *gateway, int nh_flags)
+{
+    netsnmp_route_entry *entry;
+    u_char          addr_len = (AF_INET == r->rtm_family) ? 4 : 16;
+
+    entry = netsnmp_access_route_entry_create();
+    if (NULL == entry)
+        return;
+
+    entry->if_index = if_index;
+
+    /*
+     * arbitrary index
+     */
+    entry->ns_rt_index = ++(*index);
+
+    /*
+     * copy dest & next hop, which are in network order already
+     */
+    entry->rt_dest_type = (AF_INET == r->rtm_family) ?
+        INETADDRESSTYPE_IPV4 : INETADDRESSTYPE_IPV6;
+    entry->rt_dest_len = addr_len;
+    if (tb[RTA_DST] && RTA_PAYLOAD(tb[RTA_DST]) >= addr_len)
+        memcpy(entry->rt_dest, RTA_DATA(tb[RTA_DST]), addr_len);
+
+    entry->rt_nexthop_type = entry->rt_dest_type;
+    entry->rt_nexthop_len = addr_len;
+    if (gateway && RTA_PAYLOAD(gateway) >= addr_len)
+        memcpy(entry->rt_nexthop, RTA_DATA(gateway), addr_len);
+    else
+        gateway = NULL;
+
+    entry->rt_pfx_len = r->rtm_dst_len;
+
+#ifdef USING_IP_FORWARD_MIB_IPCIDRROUTETABLE_IPCIDRROUTETABLE_MODULE
+    if (AF_INET == r->rtm_family) {
+        uint32_t mask = r->rtm_dst_len ?
+            htonl(0xffffffffU << (32 - r->rtm_dst_len)) : 0;
+        memcpy(&entry->rt_mask, &mask, 4);
+    }
+#endif
+
+    if (tb[RTA_PRIORITY])
+        entry->rt_metric1 = *(uint32_t *) RTA_DATA(tb[RTA_PRIORITY]);
+    else
+        entry->rt_metric1 = 0;
+
+#ifdef USING_IP_FORWARD_MIB_INETCIDRROUTETABLE_INETCIDRROUTETABLE_MODULE
+    /*
+     * as the /proc loaders below, the if index for ipv4 routes without a
+     * next hop. ipv6 routes come from all tables, so theirs is the table
+     * and the if index, which a route event gives as well (unlike the
+     * arbitrary index the /proc loader uses).
+     */
+    if (AF_INET6 == r->rtm_family || NULL == gateway) {
+        entry->rt_policy = calloc(3, sizeof(oid));
+        if (entry->rt_policy) {
+            if (AF_INET6 == r->rtm_family)
+                entry->rt_policy[1] = table;
+            entry->rt_policy[2] = entry->if_index;
+            entry->rt_policy_len = sizeof(oid)*3;
+        }
+    }
+#endif
+
+    /*
+     * a dead next hop doesn't forward traffic (type 0 = not up)
+     */
+    entry->rt_type = (nh_flags & RTNH_F_DEAD) ? 0 :
+        _type_from_rtm_type(r->rtm_type, NULL != gateway);
+    entry->rt_proto = _proto_from_rtprot(r->rtm_protocol);
+
+    if (CONTAINER_INSERT(container, entry) < 0) {
+        DEBUGMSGTL(("access:route:container", "error with route_entry: insert into container failed.\n"));
+        netsnmp_access_route_entry_free(entry);
+    }
+}
+
+/*
+ * add all next hops of a RTM_NEWROUTE message to the container
+ */
+static void
+_add_netlink_route(netsnmp_container *container, u_long *index,
+                   struct nlmsghdr *nlmp, int family)
+{
+    struct rtmsg   *r = NLMSG_DATA(nlmp);
+    struct rtattr  *tb[RTA_MAX + 1], *rta;
+    int             len;
+    uint32_t        table;
+
+    len = nlmp->nlmsg_len - NLMSG_LENGTH(sizeof(*r));
+    if (len < 0 || r->rtm_family != family || (r->rtm_flags & RTM_F_CLONED))
+        return;
+
+    memset(tb, 0, sizeof(tb));
+    for (rta = RTM_RTA(r); RTA_OK(rta, len); rta = RTA_NEXT(rta, len))
+        if (rta->rta_type <= RTA_MAX)
+            tb[rta->rta_type] = rta;
+
+    /*
+     * /proc/net/route only lists the main table, /proc/net/ipv6_route
+     * lists all of them.
+     */
+    table = r->rtm_table;
+    if (tb[RTA_TABLE])
+        table = *(uint32_t *) RTA_DATA(tb[RTA_TABLE]);
+    if (AF_INET == family && RT_TABLE_MAIN != table)
+        return;
+
+    if (tb[RTA_MULTIPATH]) {
+        struct rtnexthop *nh = RTA_DATA(tb[RTA_MULTIPATH]);
+        int             nh_len = RTA_PAYLOAD(tb[RTA_MULTIPATH]);
+
+        while (nh_len >= (int) sizeof(*nh) && nh->rtnh_len >= sizeof(*nh) &&
+               nh->rtnh_len <= nh_len) {
+            struct rtattr *gateway = NULL;
+
+            len = nh->rtnh_len - sizeof(*nh);
+            for (rta = RTNH_DATA(nh); RTA_OK(rta, len); rta = RTA_NEXT(rta, len))
+                if (RTA_GATEWAY == rta->rta_type)
+                    gateway = rta;
+            _add_netlink_entry(container, index, r, tb, table,
+                               nh->rtnh_ifindex, gateway, nh->rtnh_flags);
+
+            nh_len -= RTNH_ALIGN(nh->rtnh_len);
+            nh = RTNH_NEXT(nh);
+        }
+    } else
+        _add_netlink_entry(container, index, r, tb, table,
+                           tb[RTA_OIF] ? *(int *) RTA_DATA(tb[RTA_OIF]) : 0,
+                           tb[RTA_GATEWAY], r->rtm_flags);
+}
+
+/*
+ * load the routes of one address family with a RTM_GETROUTE dump, which
+ * gives us binary addresses and interface indexes directly.
+ *
+ * @retval  0 success
+ * @retval -2 netlink not available, nothing loaded
+ * @retval -3 error while receiving the dump
+ */
+static int
+_load_netlink(netsnmp_container* container, u_long *index, int family)
+{
+    struct {
+        struct nlmsghdr n;
+        struct rtmsg    r;
+    } req;
+    enum            { bufsize = 32768 };
+    char           *buf;
+    int             fd, len, done = 0, rc = 0;
+    u_long          first = *index;
+
+    DEBUGMSGTL(("access:route:container",
+                "route_container_arch_load netlink (family %d)\n", family));
+
+    netsnmp_assert(NULL != container);
+
+    fd = socket(PF_NETLINK, SOCK_DGRAM, NETLINK_ROUTE);
+    if (fd < 0)
+        return -2;
+
+    memset(&req, 0, sizeof(req));
+    req.n.nlmsg_len = sizeof(req);
+    req.n.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.n.nlmsg_type = RTM_GETROUTE;
+    req.r.rtm_family = family;
+
+    buf = malloc(bufsize);
+    if (NULL == buf || send(fd, &req, req.n.nlmsg_len, 0) < 0) {
+        free(buf);
+        close(fd);
+        return -2;
+    }
+
+    while (!done) {
+        struct nlmsghdr *nlmp;
+
+        len = recv(fd, buf, bufsize, 0);
+        if (len < 0) {
+            if (errno == EINTR)
+                continue;
+            snmp_log_perror("route netlink: recv failed");
+            rc = -3;
+            break;
+        }
+        if (len == 0)
+            break;
+
+        for (nlmp = (struct nlmsghdr *)buf; NLMSG_OK(nlmp, len);
+             nlmp = NLMSG_NEXT(nlmp, len)) {
+            if (NLMSG_DONE == nlmp->nlmsg_type) {
+                done = 1;
+                break;
+            }
+            if (NLMSG_ERROR == nlmp->nlmsg_type) {
+                DEBUGMSGTL(("access:route:container",
+                            "netlink dump error (family %d)\n", family));
+                rc = (*index == first) ? -2 : -3;
+                done = 1;
+                break;
+            }
+            if (RTM_NEWROUTE == nlmp->nlmsg_type)
+                _add_netlink_route(container, index, nlmp, family);
+        }
+    }
+
+    free(buf);
+    close(fd);
+    return rc;
+}
+#endif /* SUPPORT_ROUTE_NETLINK */
+
 /** arch specific load
  * @internal
  *
@@ -361,7 +635,17 @@ netsnmp_access_route_container_arch_load(netsnmp_container* container,
         return -1;
     }
 
-    rc = _load_ipv4(container, &count);
+    /*
+     * prefer netlink, and fall back to /proc if it isn't available.
+     * Listen for changes before the dump, so that none made while it
+     * runs are missed.
+     */
+#ifdef SUPPORT_ROUTE_NETLINK
+    _route_events_listen();
+    rc = _load_netlink(container, &count, AF_INET);
+    if (-2 == rc)
+#endif
+        rc = _load_ipv4(container, &count);
     
 #ifdef NETSNMP_ENABLE_IPV6
     if((0 != rc) || (load_flags & NETSNMP_ACCESS_ROUTE_LOAD_IPV4_ONLY))
@@ -371,7 +655,11 @@ netsnmp_access_route_container_arch_load(netsnmp_container* container,
      * load ipv6. ipv6 module might not be loaded,
      * so ignore -2 err (file not found)
      */
-    rc = _load_ipv6(container, &count);
+#ifdef SUPPORT_ROUTE_NETLINK
+    rc = _load_netlink(container, &count, AF_INET6);
+    if (-2 == rc)
+#endif
+        rc = _load_ipv6(container, &count);
     if (-2 == rc)
         rc = 0;
 #endif
@@ -414,3 +702,151 @@ netsnmp_arch_route_delete(netsnmp_route_entry *entry)
 }
 
 
+
+#ifdef SUPPORT_ROUTE_NETLINK
+static void _route_events_process(int fd, void *data);
+
+/*
+ * Open netlink socket to watch route changes, which are passed on to
+ * the update hook, or tell users of the route container that it needs
+ * to be loaded again.
+ */
+static int
+_route_events_listen(void)
+{
+    static int      fd = -1;
+    struct sockaddr_nl localaddrinfo;
+
+    if (fd >= 0)
+        return 0;
+
+    fd = socket(PF_NETLINK, SOCK_DGRAM, NETLINK_ROUTE);
+    if (fd < 0) {
+        snmp_log(LOG_ERR, "_route_events_listen: Cannot create socket.\n");
+        return -1;
+    }
+
+    memset(&localaddrinfo, 0, sizeof(struct sockaddr_nl));
+    localaddrinfo.nl_family = AF_NETLINK;
+    localaddrinfo.nl_groups = RTMGRP_IPV4_ROUTE | RTMGRP_IPV4_IFADDR |
+        RTMGRP_LINK;
+#ifdef NETSNMP_ENABLE_IPV6
+    localaddrinfo.nl_groups |= RTMGRP_IPV6_ROUTE | RTMGRP_IPV6_IFADDR;
+#endif
+
+    if (bind(fd, (struct sockaddr*)&localaddrinfo, sizeof(localaddrinfo)) < 0 ||
+        register_readfd(fd, _route_events_process, NULL) != 0) {
+        snmp_log(LOG_ERR,"_route_events_listen: error setting up netlink socket\n");
+        close(fd);
+        fd = -1;
+        return -1;
+    }
+
+    DEBUGMSGTL(("access:route:events", "listening for route changes\n"));
+    netsnmp_access_route_changed();
+    return 0;
+}
+
+/*
+ * pass the next hops of a RTM_NEWROUTE/RTM_DELROUTE message to the
+ * update hook
+ *
+ * @retval  0 done, or not a route we list
+ * @retval -1 the change can't be applied this way
+ */
+static int
+_route_event_apply(struct nlmsghdr *nlmp)
+{
+    static u_long   index = 0;
+    struct rtmsg   *r = NLMSG_DATA(nlmp);
+    netsnmp_container *entries;
+    netsnmp_route_entry *entry;
+    int             rc = 0;
+
+    if (nlmp->nlmsg_len < NLMSG_LENGTH(sizeof(*r)))
+        return 0;
+    if (AF_INET != r->rtm_family
+#ifdef NETSNMP_ENABLE_IPV6
+        && AF_INET6 != r->rtm_family
+#endif
+        )
+        return 0;
+
+    /*
+     * a replaced route may have had other next hops, which aren't listed
+     */
+    if (nlmp->nlmsg_flags & NLM_F_REPLACE)
+        return -1;
+
+    entries = netsnmp_container_find("route_event:lifo");
+    if (NULL == entries)
+        return -1;
+    _add_netlink_route(entries, &index, nlmp, r->rtm_family);
+
+    while (CONTAINER_SIZE(entries)) {
+        entry = (netsnmp_route_entry *) CONTAINER_FIRST(entries);
+        CONTAINER_REMOVE(entries, NULL);
+        if (netsnmp_access_route_update(entry,
+                                        RTM_DELROUTE == nlmp->nlmsg_type) < 0)
+            rc = -1;
+    }
+    CONTAINER_FREE(entries);
+
+    return rc;
+}
+
+static void
+_route_events_process(int fd, void *data)
+{
+    char               buf[16384];
+    struct nlmsghdr    *nlmp;
+    struct ifinfomsg   *ifi;
+    int                len, changed = 0;
+
+    for (;;) {
+        len = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (len < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == ENOBUFS) {
+                /* notifications were lost */
+                changed = 1;
+                continue;
+            }
+            break;
+        }
+        if (len == 0)
+            break;
+
+        for (nlmp = (struct nlmsghdr *)buf; NLMSG_OK(nlmp, len);
+             nlmp = NLMSG_NEXT(nlmp, len)) {
+            switch (nlmp->nlmsg_type) {
+            case RTM_NEWROUTE:
+            case RTM_DELROUTE:
+                if (_route_event_apply(nlmp) < 0)
+                    changed = 1;
+                break;
+            case RTM_NEWLINK:
+                ifi = NLMSG_DATA(nlmp);
+                if (nlmp->nlmsg_len < NLMSG_LENGTH(sizeof(*ifi)) ||
+                    (ifi->ifi_flags & IFF_UP))
+                    break;
+                /* FALLTHROUGH */
+            case RTM_DELLINK:
+            case RTM_DELADDR:
+                /*
+                 * the kernel drops the routes over a link that goes down
+                 * or loses its address without a RTM_DELROUTE for them
+                 */
+                changed = 1;
+                break;
+            }
+        }
+    }
+
+    if (changed) {
+        DEBUGMSGTL(("access:route:events", "routes changed\n"));
+        netsnmp_access_route_changed();
+    }
+}
+#endif /* SUPPORT_ROUTE_NETLINK */
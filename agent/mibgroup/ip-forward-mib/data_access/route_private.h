@@ -5,3 +5,8 @@ int netsnmp_access_route_container_arch_load(struct netsnmp_container_s* contain
                                              u_int load_flags);
 int netsnmp_arch_route_create(struct netsnmp_route_s *entry);
 int netsnmp_arch_route_delete(struct netsnmp_route_s *entry);
+
+/** called by the arch code when it learns that routes changed */
+void netsnmp_access_route_changed(void);
+/** called by the arch code for each route it saw added or removed */
+int netsnmp_access_route_update(struct netsnmp_route_s *entry, int removed);
@@ -19,6 +19,8 @@
 
 #include "inetCidrRouteTable_data_access.h"
 
+static void _route_update(netsnmp_route_entry *route_entry, int removed);
+
 /** @ingroup interface 
  * @addtogroup data_access data_access: Routines to access data
  *
@@ -130,8 +132,62 @@ inetCidrRouteTable_container_init(netsnmp_container **container_ptr_ptr,
      * cache->enabled to 0.
      */
     cache->timeout = INETCIDRROUTETABLE_CACHE_TIMEOUT;  /* seconds */
+
+    /*
+     * keep the rows when the cache expires; inetCidrRouteTable_container_load
+     * only reloads them if the routes changed since the last load.
+     */
+    cache->flags |= NETSNMP_CACHE_DONT_FREE_BEFORE_LOAD |
+        NETSNMP_CACHE_DONT_FREE_EXPIRED;
+
+    /*
+     * routes added or removed after the load are applied to the rows
+     */
+    netsnmp_access_route_set_update_hook(_route_update);
 }                               /* inetCidrRouteTable_container_init */
 
+/*
+ * route generation the rows in the container were loaded at, and the
+ * container while its rows are loaded
+ */
+static u_int    _loaded_generation = 0;
+static netsnmp_container *_route_rows = NULL;
+
+static void
+_release_rowreq_ctx(inetCidrRouteTable_rowreq_ctx *rowreq_ctx, void *context)
+{
+    inetCidrRouteTable_release_rowreq_ctx(rowreq_ctx);
+}
+
+/*
+ * allocate a row context for a route entry and set its index(es).
+ * The entry is released on failure.
+ */
+static inetCidrRouteTable_rowreq_ctx *
+_route_rowreq_ctx(netsnmp_route_entry *route_entry)
+{
+    inetCidrRouteTable_rowreq_ctx *rowreq_ctx;
+
+    rowreq_ctx = inetCidrRouteTable_allocate_rowreq_ctx(route_entry, NULL);
+    if ((NULL != rowreq_ctx) &&
+        (MFD_SUCCESS == inetCidrRouteTable_indexes_set
+         (rowreq_ctx, route_entry->rt_dest_type,
+          (char *) route_entry->rt_dest, route_entry->rt_dest_len,
+          route_entry->rt_pfx_len,
+          route_entry->rt_policy, route_entry->rt_policy_len,
+          route_entry->rt_nexthop_type,
+          (char *) route_entry->rt_nexthop, route_entry->rt_nexthop_len)))
+        return rowreq_ctx;
+
+    if (rowreq_ctx) {
+        snmp_log(LOG_ERR, "error setting index while loading "
+                 "inetCidrRoute cache.\n");
+        inetCidrRouteTable_release_rowreq_ctx(rowreq_ctx);
+    } else
+        netsnmp_access_route_entry_free(route_entry);
+    return NULL;
+}
+
 /**
  * check entry for update
  */
@@ -161,25 +217,56 @@ _snarf_route_entry(netsnmp_route_entry *route_entry,
      * allocate an row context and set the index(es), then add it to
      * the container
      */
-    rowreq_ctx = inetCidrRouteTable_allocate_rowreq_ctx(route_entry, NULL);
-    if ((NULL != rowreq_ctx) &&
-        (MFD_SUCCESS == inetCidrRouteTable_indexes_set
-         (rowreq_ctx, route_entry->rt_dest_type,
-          (char *) route_entry->rt_dest, route_entry->rt_dest_len,
-          route_entry->rt_pfx_len,
-          route_entry->rt_policy, route_entry->rt_policy_len,
-          route_entry->rt_nexthop_type,
-          (char *) route_entry->rt_nexthop, route_entry->rt_nexthop_len))) {
+    rowreq_ctx = _route_rowreq_ctx(route_entry);
+    if (NULL != rowreq_ctx) {
         CONTAINER_INSERT(container, rowreq_ctx);
         rowreq_ctx->row_status = ROWSTATUS_ACTIVE;
+    }
+}
+
+/*
+ * apply a route the route access code saw added, changed or removed
+ * to the rows
+ */
+static void
+_route_update(netsnmp_route_entry *route_entry, int removed)
+{
+    inetCidrRouteTable_rowreq_ctx *rowreq_ctx, *old;
+    inetCidrRouteTable_data *data;
+
+    /*
+     * rows that aren't current are loaded again on the next request
+     */
+    if (NULL == _route_rows ||
+        _loaded_generation != netsnmp_access_route_generation()) {
+        netsnmp_access_route_entry_free(route_entry);
+        return;
+    }
+
+    rowreq_ctx = _route_rowreq_ctx(route_entry);
+    if (NULL == rowreq_ctx)
+        return;
+
+    old = (inetCidrRouteTable_rowreq_ctx *)
+        CONTAINER_FIND(_route_rows, rowreq_ctx);
+    if (removed || 0 == route_entry->rt_type) {
+        DEBUGMSGTL(("inetCidrRouteTable:access", "route removed\n"));
+        if (NULL != old) {
+            CONTAINER_REMOVE(_route_rows, old);
+            inetCidrRouteTable_release_rowreq_ctx(old);
+        }
+    } else if (NULL != old) {
+        DEBUGMSGTL(("inetCidrRouteTable:access", "route changed\n"));
+        data = old->data;
+        old->data = rowreq_ctx->data;
+        rowreq_ctx->data = data;
     } else {
-        if (rowreq_ctx) {
-            snmp_log(LOG_ERR, "error setting index while loading "
-                     "inetCidrRoute cache.\n");
-            inetCidrRouteTable_release_rowreq_ctx(rowreq_ctx);
-        } else
-            netsnmp_access_route_entry_free(route_entry);
+        DEBUGMSGTL(("inetCidrRouteTable:access", "route added\n"));
+        rowreq_ctx->row_status = ROWSTATUS_ACTIVE;
+        CONTAINER_INSERT(_route_rows, rowreq_ctx);
+        return;
     }
+    inetCidrRouteTable_release_rowreq_ctx(rowreq_ctx);
 }
 
 /**
@@ -209,6 +296,8 @@ inetCidrRouteTable_container_shutdown(netsnmp_container *container_ptr)
         return;
     }
 
+    netsnmp_access_route_set_update_hook(NULL);
+    _route_rows = NULL;
 }                               /* inetCidrRouteTable_container_shutdown */
 
 /**
@@ -248,9 +337,27 @@ int
 inetCidrRouteTable_container_load(netsnmp_container *container)
 {
     netsnmp_container *route_container;
+    u_int           generation = netsnmp_access_route_generation();
 
     DEBUGMSGTL(("verbose:inetCidrRouteTable:inetCidrRouteTable_container_load", "called\n"));
 
+    /*
+     * the cache doesn't free the rows before calling us. Keep them if
+     * the routes are known not to have changed, else start over.
+     */
+    if (CONTAINER_SIZE(container) > 0) {
+        if (0 != generation && generation == _loaded_generation) {
+            DEBUGMSGT(("verbose:inetCidrRouteTable:inetCidrRouteTable_cache_load",
+                       "routes unchanged, keeping %d records\n",
+                       (int)CONTAINER_SIZE(container)));
+            return MFD_SUCCESS;
+        }
+        inetCidrRouteTable_container_free(container);
+        CONTAINER_CLEAR(container,
+                        (netsnmp_container_obj_func *) _release_rowreq_ctx,
+                        NULL);
+    }
+
     /*
      * TODO:351:M: |-> Load/update data in the inetCidrRouteTable container.
      * loop over your inetCidrRouteTable data, allocate a rowreq context,
@@ -286,6 +393,12 @@ inetCidrRouteTable_container_load(netsnmp_container *container)
     DEBUGMSGT(("verbose:inetCidrRouteTable:inetCidrRouteTable_cache_load",
                "%d records\n", (int)CONTAINER_SIZE(container)));
 
+    /*
+     * the route loader may only have started tracking changes now
+     */
+    _loaded_generation = netsnmp_access_route_generation();
+    _route_rows = container;
+
     return MFD_SUCCESS;
 }                               /* inetCidrRouteTable_container_load */
 
@@ -310,6 +423,7 @@ inetCidrRouteTable_container_free(netsnmp_container *container)
     /*
      * TODO:380:M: Free inetCidrRouteTable container data.
      */
+    _route_rows = NULL;
 }                               /* inetCidrRouteTable_container_free */
 
 /**
@@ -13,6 +13,7 @@
 #include "../ipSystemStatsTable/ipSystemStatsTable.h"
 #include "systemstats.h"
 #include "systemstats_private.h"
+#include "util_funcs/procfs_snapshot.h"
 
 #include <stdint.h>
 #include <sys/types.h>
@@ -92,18 +93,38 @@ netsnmp_access_systemstats_container_arch_load(netsnmp_container* container,
 #endif
 }
 
+/*
+ * Parses up to max space separated numbers from the line [cp, end).
+ *
+ * @retval the number of values parsed
+ */
+static int
+_scan_values(const char *cp, const char *end, unsigned long long *vals,
+             int max)
+{
+    char           *endp;
+    int             n;
+
+    for (n = 0; n < max; n++) {
+        vals[n] = strtoull(cp, &endp, 10);
+        if (endp == cp || endp > end)
+            break;
+        cp = endp;
+    }
+    return n;
+}
+
 /*
  * Based on load_flags, load ipSystemStatsTable or ipIfStatsTable for ipv4 entries. 
  */
 static int
 _systemstats_v4(netsnmp_container* container, u_int load_flags)
 {
-    FILE           *devin;
-    char            line[1024];
+    netsnmp_procfs_view devin;
     netsnmp_systemstats_entry *entry = NULL;
     int             scan_count;
-    char           *stats, *start = line;
-    int             len;
+    const char     *stats, *start, *end;
+    size_t          len;
     unsigned long long scan_vals[19];
 
     DEBUGMSGTL(("access:systemstats:container:arch", "load v4 (flags %x)\n",
@@ -116,20 +137,20 @@ _systemstats_v4(netsnmp_container* container, u_int load_flags)
         return 0;
     }
 
-    if (!(devin = fopen("/proc/net/snmp", "r"))) {
+    if (netsnmp_procfs_snapshot("/proc/net/snmp", &devin) < 0) {
         snmp_log_perror("systemstats_linux: cannot open /proc/net/snmp");
         return -2;
     }
 
     /*
-     * skip header, but make sure it's the length we expect...
+     * skip header, but make sure it's the length we expect (without the
+     * newline)...
      */
-    NETSNMP_IGNORE_RESULT(fgets(line, sizeof(line), devin));
-    len = strlen(line);
-    if (224 != len) {
-        fclose(devin);
+    if (!netsnmp_procfs_getline(&devin, &len))
+        len = 0;
+    if (223 != len) {
         snmp_log(LOG_ERR, "systemstats_linux: unexpected header length in /proc/net/snmp."
-                 " %d != 224\n", len);
+                 " %d != 223\n", (int)len);
         return -4;
     }
 
@@ -138,28 +159,25 @@ _systemstats_v4(netsnmp_container* container, u_int load_flags)
      * Read in each line in turn, isolate the systemstats name
      *   and retrieve (or create) the corresponding data structure.
      */
-    start = fgets(line, sizeof(line), devin);
-    fclose(devin);
+    start = netsnmp_procfs_getline(&devin, &len);
     if (start) {
+        end = start + len;
 
-        len = strlen(line);
-        if (line[len - 1] == '\n')
-            line[len - 1] = '\0';
-
-        while (*start && *start == ' ')
+        while (start < end && *start == ' ')
             start++;
 
-        if ((!*start) || ((stats = strrchr(start, ':')) == NULL)) {
+        /* the name ends at the last ':' */
+        for (stats = end; stats > start && stats[-1] != ':'; stats--)
+            ;
+        if (stats == start) {
             snmp_log(LOG_ERR,
-                     "systemstats data format error 1, line ==|%s|\n", line);
+                     "systemstats data format error 1, line ==|%.*s|\n",
+                     (int)(end - start), start);
             return -4;
         }
 
-        DEBUGMSGTL(("access:systemstats", "processing '%s'\n", start));
-
-        *stats++ = 0; /* null terminate name */
-        while (*stats == ' ') /* skip spaces before stats */
-            stats++;
+        DEBUGMSGTL(("access:systemstats", "processing '%.*s'\n",
+                    (int)(stats - 1 - start), start));
 
         entry = netsnmp_access_systemstats_entry_create(1, 0,
                     "ipSystemStatsTable.ipv4");
@@ -176,16 +194,7 @@ _systemstats_v4(netsnmp_container* container, u_int load_flags)
          */
 
         memset(scan_vals, 0x0, sizeof(scan_vals));
-        scan_count = sscanf(stats,
-                            "%llu %llu %llu %llu %llu %llu %llu %llu %llu %llu"
-                            "%llu %llu %llu %llu %llu %llu %llu %llu %llu",
-                            &scan_vals[0],&scan_vals[1],&scan_vals[2],
-                            &scan_vals[3],&scan_vals[4],&scan_vals[5],
-                            &scan_vals[6],&scan_vals[7],&scan_vals[8],
-                            &scan_vals[9],&scan_vals[10],&scan_vals[11],
-                            &scan_vals[12],&scan_vals[13],&scan_vals[14],
-                            &scan_vals[15],&scan_vals[16],&scan_vals[17],
-                            &scan_vals[18]);
+        scan_count = _scan_values(stats, end, scan_vals, 19);
         DEBUGMSGTL(("access:systemstats", "  read %d values\n", scan_count));
 
         if(scan_count != 19) {
@@ -268,8 +277,9 @@ static int
 _additional_systemstats_v4(netsnmp_systemstats_entry* entry,
                            u_int load_flags)
 {
-    FILE           *devin;
-    char            line[1024];
+    netsnmp_procfs_view devin;
+    const char     *line;
+    size_t          len;
     int             scan_count;
     unsigned long long scan_vals[12];
     int             retval = 0;
@@ -277,7 +287,7 @@ _additional_systemstats_v4(netsnmp_systemstats_entry* entry,
     DEBUGMSGTL(("access:systemstats:container:arch",
                 "load addtional v4 (flags %u)\n", load_flags));
 
-    if (!(devin = fopen("/proc/net/netstat", "r"))) {
+    if (netsnmp_procfs_snapshot("/proc/net/netstat", &devin) < 0) {
         snmp_log_perror("systemstats_linux: cannot open /proc/net/netstat");
         return -2;
     }
@@ -285,26 +295,23 @@ _additional_systemstats_v4(netsnmp_systemstats_entry* entry,
     /*
      * Get header and stat lines
      */
-    while (fgets(line, sizeof(line), devin)) {
-        if (strncmp(IP_EXT_HEAD, line, sizeof(IP_EXT_HEAD) - 1) == 0) {
+    while ((line = netsnmp_procfs_getline(&devin, &len))) {
+        if (len >= sizeof(IP_EXT_HEAD) - 1 &&
+            strncmp(IP_EXT_HEAD, line, sizeof(IP_EXT_HEAD) - 1) == 0) {
             /* next line should includes IPv4 addtional statistics */
-            if ((fgets(line, sizeof(line), devin)) == NULL) {
+            if ((line = netsnmp_procfs_getline(&devin, &len)) == NULL) {
                 retval = -4;
                 break;
             }
-            if (strncmp(IP_EXT_HEAD, line, sizeof(IP_EXT_HEAD) - 1) != 0) {
+            if (len < sizeof(IP_EXT_HEAD) - 1 ||
+                strncmp(IP_EXT_HEAD, line, sizeof(IP_EXT_HEAD) - 1) != 0) {
                 retval = -4;
                 break;
             }
 
             memset(scan_vals, 0x0, sizeof(scan_vals));
-            scan_count = sscanf(line,
-                                "%*s"   /* ignore `IpExt:' */
-                                "%llu %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
-                                &scan_vals[0], &scan_vals[1], &scan_vals[2],
-                                &scan_vals[3], &scan_vals[4], &scan_vals[5],
-                                &scan_vals[6], &scan_vals[7], &scan_vals[8],
-                                &scan_vals[9], &scan_vals[10], &scan_vals[11]);
+            scan_count = _scan_values(line + sizeof(IP_EXT_HEAD) - 1,
+                                      line + len, scan_vals, 12);
             if (scan_count < 6) {
                 snmp_log(LOG_ERR,
                         "error scanning addtional systemstats data"
@@ -350,8 +357,6 @@ _additional_systemstats_v4(netsnmp_systemstats_entry* entry,
         }
     }
 
-    fclose(devin);
-
     if (retval < 0)
         DEBUGMSGTL(("access:systemstats",
                     "/proc/net/netstat does not include addtional stats\n"));
@@ -365,11 +370,12 @@ _additional_systemstats_v4(netsnmp_systemstats_entry* entry,
  * Load one /proc/net/snmp6 - like file (e.g. /proc/net/dev_snmp6)
  */ 
 static int 
-_systemstats_v6_load_file(netsnmp_systemstats_entry *entry, FILE *devin)
+_systemstats_v6_load_file(netsnmp_systemstats_entry *entry,
+                          netsnmp_procfs_view *devin)
 {
-    char            line[1024];
-    char           *stats, *start = line;
-    int             len, rc;
+    const char     *line, *stats;
+    size_t          len;
+    int             rc;
     uintmax_t       scan_val;
 
     /*
@@ -378,25 +384,27 @@ _systemstats_v6_load_file(netsnmp_systemstats_entry *entry, FILE *devin)
      */
     rc = 0;
     while (1) {
-        start = fgets(line, sizeof(line), devin);
-        if (NULL == start)
+        line = netsnmp_procfs_getline(devin, &len);
+        if (NULL == line)
             break;
 
-        len = strlen(line);
-        if (line[len - 1] == '\n')
-            line[len - 1] = '\0';
-
-        if (('I' != line[0]) || ('6' != line[2]))
+        /* "Ip6" and at least the characters looked at below */
+        if (len < 12 || ('I' != line[0]) || ('6' != line[2]))
             continue;
 
-        stats = strrchr(line, ' ');
-        if (NULL == stats) {
+        /* the value follows the last blank */
+        for (stats = line + len; stats > line && stats[-1] != ' ' &&
+                 stats[-1] != '\t'; stats--)
+            ;
+        if (stats == line) {
             snmp_log(LOG_ERR,
-                     "systemstats data format error 1, line ==|%s|\n", line);
+                     "systemstats data format error 1, line ==|%.*s|\n",
+                     (int)len, line);
             continue;
         }
 
-        DEBUGMSGTL(("access:systemstats", "processing '%s'\n", line));
+        DEBUGMSGTL(("access:systemstats", "processing '%.*s'\n",
+                    (int)len, line));
 
         /*
          * OK - we've now got (or created) the data structure for
@@ -528,7 +536,8 @@ _systemstats_v6_load_file(netsnmp_systemstats_entry *entry, FILE *devin)
             rc = 1;
         
         if (rc)
-            DEBUGMSGTL(("access:systemstats", "unknown stat %s\n", line));
+            DEBUGMSGTL(("access:systemstats", "unknown stat %.*s\n",
+                        (int)len, line));
     }
     /*
      * Let DiscontinuityTime and RefreshRate active
@@ -545,7 +554,7 @@ _systemstats_v6_load_file(netsnmp_systemstats_entry *entry, FILE *devin)
 static int 
 _systemstats_v6_load_systemstats(netsnmp_container* container, u_int load_flags)
 {
-    FILE *devin;
+    netsnmp_procfs_view devin;
     netsnmp_systemstats_entry *entry = NULL;
     const char     *filename = "/proc/net/snmp6";
     int rc = 0;
@@ -559,8 +568,7 @@ _systemstats_v6_load_systemstats(netsnmp_container* container, u_int load_flags)
      * try to open file. If we can't, that's ok - maybe the module hasn't
      * been loaded yet.
      */
-    devin = fopen(filename, "r");
-    if (!devin) {
+    if (netsnmp_procfs_snapshot(filename, &devin) < 0) {
         DEBUGMSGTL(("access:systemstats",
                 "Failed to load Systemstats Table (linux1), cannot open %s\n",
                 filename));
@@ -568,9 +576,7 @@ _systemstats_v6_load_systemstats(netsnmp_container* container, u_int load_flags)
         return 0;
     }
     
-    rc = _systemstats_v6_load_file(entry, devin);
-
-    fclose(devin);
+    rc = _systemstats_v6_load_file(entry, &devin);
 
     /*
      * add to container
@@ -598,10 +604,9 @@ _systemstats_v6_load_ifstats(netsnmp_container* container, u_int load_flags)
     DIR            *dev_snmp6_dir;
     struct dirent  *dev_snmp6_entry;
     char           dev_filename[DEV_FILENAME_LEN];
-    FILE           *devin;
-    char           line[1024];
-    char           *start = line;
-    char           *scan_str;
+    netsnmp_procfs_view devin;
+    const char     *start, *scan_str;
+    size_t          len;
     uintmax_t       scan_val;
     netsnmp_systemstats_entry *entry = NULL;
             
@@ -628,7 +633,7 @@ _systemstats_v6_load_ifstats(netsnmp_container* container, u_int load_flags)
                     dev_snmp6_entry->d_name);
             continue;
         }
-        if (NULL == (devin = fopen(dev_filename, "r"))) {
+        if (netsnmp_procfs_snapshot(dev_filename, &devin) < 0) {
             char msg[128];
             snprintf(msg, sizeof(msg), "systemstats_linux: %s", dev_filename);
             snmp_log_perror(dev_filename);
@@ -642,24 +647,26 @@ _systemstats_v6_load_ifstats(netsnmp_container* container, u_int load_flags)
         if (isdigit(dev_snmp6_entry->d_name[0])) {
             scan_val = strtoull(dev_snmp6_entry->d_name, NULL, 0);
         } else {
-            if (NULL == (start = fgets(line, sizeof(line), devin))) {
+            if (NULL == (start = netsnmp_procfs_getline(&devin, &len))) {
                 snmp_log(LOG_ERR, "%s doesn't include any lines\n",
                         dev_filename);
-                fclose(devin);
+                netsnmp_procfs_forget(dev_filename);
                 continue;
             }
     
-            if (0 != strncmp(start, IFINDEX_LINE, 7)) {
+            if (len < 7 || 0 != strncmp(start, IFINDEX_LINE, 7)) {
                 snmp_log(LOG_ERR, "%s doesn't include ifIndex line",
                         dev_filename);
-                fclose(devin);
+                netsnmp_procfs_forget(dev_filename);
                 continue;
             }
 
-            scan_str = strrchr(line, ' ');
-            if (NULL == scan_str) {
+            for (scan_str = start + len; scan_str > start &&
+                     scan_str[-1] != ' ' && scan_str[-1] != '\t'; scan_str--)
+                ;
+            if (scan_str == start) {
                 snmp_log(LOG_ERR, "%s is wrong format", dev_filename);
-                fclose(devin);
+                netsnmp_procfs_forget(dev_filename);
                 continue;
             }
             scan_val = strtoull(scan_str, NULL, 0);
@@ -668,14 +675,14 @@ _systemstats_v6_load_ifstats(netsnmp_container* container, u_int load_flags)
         entry = netsnmp_access_systemstats_entry_create(2, scan_val,
                 "ipIfStatsTable.ipv6");
         if(NULL == entry) {
-            fclose(devin);
+            netsnmp_procfs_forget(dev_filename);
             closedir(dev_snmp6_dir);
             return -3;
         }
         
-        _systemstats_v6_load_file(entry, devin);
+        _systemstats_v6_load_file(entry, &devin);
         CONTAINER_INSERT(container, entry);
-        fclose(devin);
+        netsnmp_procfs_forget(dev_filename);
     }
     closedir(dev_snmp6_dir);
     return 0;
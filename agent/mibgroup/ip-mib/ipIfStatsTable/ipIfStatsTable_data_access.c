@@ -148,6 +148,8 @@ ipIfStatsTable_container_init(netsnmp_container ** container_ptr_ptr,
         (NETSNMP_CACHE_DONT_AUTO_RELEASE | NETSNMP_CACHE_DONT_FREE_EXPIRED
          | NETSNMP_CACHE_DONT_FREE_BEFORE_LOAD |
          NETSNMP_CACHE_AUTO_RELOAD);
+
+    netsnmp_cache_group_add("interfaces", cache);
 }                               /* ipIfStatsTable_container_init */
 
 /**
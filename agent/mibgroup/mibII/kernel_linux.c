@@ -19,6 +19,7 @@
 #include <stddef.h>
 
 #include "kernel_linux.h"
+#include "util_funcs/procfs_snapshot.h"
 
 struct ip_mib   cached_ip_mib;
 struct ip6_mib   cached_ip6_mib;
@@ -184,7 +185,8 @@ netsnmp_feature_child_of(linux_ip6_stat_all, libnetsnmpmibs);
 netsnmp_feature_child_of(linux_read_ip6_stat, linux_ip6_stat_all);
 
 static int
-decode_icmp_msg(char *line, char *data, struct icmp4_msg_mib *msg)
+decode_icmp_msg(const char *line, size_t line_len, const char *data,
+                size_t data_len, struct icmp4_msg_mib *msg)
 {
     char *token, *saveptr, *lineptr, *saveptr1, *dataptr, *delim = NULL;
     char line_cpy[1024];
@@ -195,12 +197,11 @@ decode_icmp_msg(char *line, char *data, struct icmp4_msg_mib *msg)
         return -1;
 
     /*
-     * Since we are using strtok, there is a possiblity of the orginal data
-     * getting modified. So we take a local copy for this purpose even though
-     * its expensive.
+     * The lines are in the /proc snapshot, which we must not modify, and
+     * strtok wants them NUL terminated. So we take a local copy.
      */
-    strlcpy(line_cpy, line, sizeof(line_cpy));
-    strlcpy(data_cpy, data, sizeof(data_cpy));
+    snprintf(line_cpy, sizeof(line_cpy), "%.*s", (int)line_len, line);
+    snprintf(data_cpy, sizeof(data_cpy), "%.*s", (int)data_len, data);
 
     lineptr = line_cpy;
     dataptr = data_cpy;
@@ -241,35 +242,96 @@ decode_icmp_msg(char *line, char *data, struct icmp4_msg_mib *msg)
     return 0;
 }
 
+/*
+ * Returns the next space separated token in [*cp, end) and its length,
+ * and moves *cp past it.
+ */
+static const char *
+_next_token(const char **cp, const char *end, size_t *len)
+{
+    const char     *token;
+
+    while (*cp < end && **cp == ' ')
+        (*cp)++;
+    if (*cp == end)
+        return NULL;
+    token = *cp;
+    while (*cp < end && **cp != ' ')
+        (*cp)++;
+    *len = *cp - token;
+    return token;
+}
+
+static int
+_token_is(const char *token, size_t len, const char *s)
+{
+    return strlen(s) == len && memcmp(token, s, len) == 0;
+}
+
+#ifdef NETSNMP_ENABLE_IPV6
+/*
+ * Splits a "Name   value" line of /proc/net/snmp6 into a NUL terminated
+ * copy of the name and the value.
+ *
+ * @retval 0 ok, -1 not such a line
+ */
+static int
+_snmp6_line(const char *line, size_t len, char *name, size_t name_size,
+            unsigned long *value)
+{
+    const char     *cp = line, *end = line + len;
+    char           *endp;
+
+    while (cp < end && *cp != ' ' && *cp != '\t')
+        cp++;
+    if (cp == line || cp == end || (size_t)(cp - line) >= name_size)
+        return -1;
+    memcpy(name, line, cp - line);
+    name[cp - line] = '\0';
+
+    *value = strtoul(cp, &endp, 10);
+    if (endp == cp || endp > end)
+        return -1;
+    return 0;
+}
+#endif
+
 static int
 linux_read_mibII_stats(void)
 {
-    FILE           *in;
-    char            line[1024], data[1024], *linepos, *datapos, *pfx, *hdr, *v;
+    netsnmp_procfs_view in;
+    const char     *line, *data, *line_end, *data_end, *pfx, *hdr, *v;
+    size_t          line_len, data_len, pfx_len, hdr_len, v_len;
     const struct stats_descr *d;
     const struct stats_descr *const end = ipv4_snmp_stats +
                           sizeof(ipv4_snmp_stats) / sizeof(ipv4_snmp_stats[0]);
     int             ret = 0;
 
-    in = fopen("/proc/net/snmp", "r");
-    if (!in) {
+    if (netsnmp_procfs_snapshot("/proc/net/snmp", &in) < 0) {
         DEBUGMSGTL(("mibII/kernel_linux","Unable to open /proc/net/snmp"));
         return -1;
     }
 
-    while (fgets(line, sizeof(line), in) && fgets(data, sizeof(data), in)) {
-        if (!(pfx = strtok_r(line, " ", &linepos)))
+    /*
+     * pairs of lines: "Prefix: Name1 Name2 ..." and "Prefix: 1 2 ..."
+     */
+    while ((line = netsnmp_procfs_getline(&in, &line_len)) &&
+           (data = netsnmp_procfs_getline(&in, &data_len))) {
+        line_end = line + line_len;
+        data_end = data + data_len;
+        if (!(pfx = _next_token(&line, line_end, &pfx_len)))
             continue;
-        if (!strtok_r(data, " ", &datapos))
+        if (!_next_token(&data, data_end, &v_len))
             continue;
-        if (strcmp(pfx, "IcmpMsg:") == 0) {
-            decode_icmp_msg(linepos, datapos, &cached_icmp4_msg_mib);
+        if (_token_is(pfx, pfx_len, "IcmpMsg:")) {
+            decode_icmp_msg(line, line_end - line, data, data_end - data,
+                            &cached_icmp4_msg_mib);
         } else {
-            while ((hdr = strtok_r(linepos, " \n", &linepos)) &&
-                   (v = strtok_r(datapos, " \n", &datapos))) {
+            while ((hdr = _next_token(&line, line_end, &hdr_len)) &&
+                   (v = _next_token(&data, data_end, &v_len))) {
                 for (d = ipv4_snmp_stats; d < end; d++) {
-                    if (strcmp(d->prefix, pfx) == 0 &&
-                        strcmp(d->col_name, hdr) == 0) {
+                    if (_token_is(pfx, pfx_len, d->prefix) &&
+                        _token_is(hdr, hdr_len, d->col_name)) {
                         *(unsigned long *)(d->var + d->offset) = atol(v);
                         if (d->validity_offset != 0) {
                            *(short *)(d->var + d->validity_offset) = 1;
@@ -278,12 +340,12 @@ linux_read_mibII_stats(void)
                     }
                 }
                 if (d == end)
-                    DEBUGMSGTL(("mibII/kernel_linux", "Skipped %s %s %s\n", pfx,
-                                hdr, v));
+                    DEBUGMSGTL(("mibII/kernel_linux", "Skipped %.*s %.*s %.*s\n",
+                                (int)pfx_len, pfx, (int)hdr_len, hdr,
+                                (int)v_len, v));
             }
         }
     }
-    fclose(in);
 
     /*
      * Tweak illegal values:
@@ -318,10 +380,11 @@ linux_read_ip_stat(struct ip_mib *ipstat)
 int linux_read_ip6_stat( struct ip6_mib *ip6stat)
 {
 #ifdef NETSNMP_ENABLE_IPV6
-    FILE           *in;
-    char            line[1024];
+    netsnmp_procfs_view in;
+    const char     *cp;
+    char            line[64];       /* the name on the line */
+    size_t          len;
     unsigned long   stats;
-    char           *endp;
     int             match;
 #endif
 
@@ -330,22 +393,18 @@ int linux_read_ip6_stat( struct ip6_mib *ip6stat)
 #ifdef NETSNMP_ENABLE_IPV6
     DEBUGMSGTL(("mibII/kernel_linux/ip6stats",
                 "Reading /proc/net/snmp6 stats\n"));
-    if (NULL == (in = fopen("/proc/net/snmp6", "r"))) {
+    if (netsnmp_procfs_snapshot("/proc/net/snmp6", &in) < 0) {
         DEBUGMSGTL(("mibII/kernel_linux/ip6stats",
                     "Failed to open /proc/net/snmp6\n"));
         return -1;
     }
 
-    while (NULL != fgets(line, sizeof(line), in)) {
-        if (0 != strncmp(line, IP6_STATS_LINE, IP6_STATS_PREFIX_LEN))
+    while (NULL != (cp = netsnmp_procfs_getline(&in, &len))) {
+        if (_snmp6_line(cp, len, line, sizeof(line), &stats) < 0)
             continue;
-
-        if (1 != sscanf(line, "%*s %lu", &stats))
+        if (0 != strncmp(line, IP6_STATS_LINE, IP6_STATS_PREFIX_LEN))
             continue;
 
-        endp = strchr(line, ' ');
-        if (endp)
-            *endp = '\0';
         DEBUGMSGTL(("mibII/kernel_linux/ip6stats", "Find tag: %s\n", line));
 
         match = 1;
@@ -418,7 +477,6 @@ int linux_read_ip6_stat( struct ip6_mib *ip6stat)
                         "%s is an unknown tag\n", line));
     }
 
-    fclose(in);
 #endif
 
     memcpy((char *) ip6stat, (char *) &cached_ip6_mib, sizeof(*ip6stat));
@@ -464,11 +522,12 @@ linux_read_icmp6_parse(struct icmp6_mib *icmp6stat,
                        int *support)
 {
 #ifdef NETSNMP_ENABLE_IPV6
-    FILE           *in;
-    char            line[1024];
-    char            name[255];
+    netsnmp_procfs_view in;
+    const char     *cp;
+    char            line[64];       /* the name on the line */
+    size_t          len;
     unsigned long   stats;
-    char           *endp, *vals;
+    char           *vals;
     int             match;
 #endif
 
@@ -479,28 +538,24 @@ linux_read_icmp6_parse(struct icmp6_mib *icmp6stat,
 #ifdef NETSNMP_ENABLE_IPV6
     DEBUGMSGTL(("mibII/kernel_linux/icmp6stats",
                 "Reading /proc/net/snmp6 stats\n"));
-    if (NULL == (in = fopen("/proc/net/snmp6", "r"))) {
+    if (netsnmp_procfs_snapshot("/proc/net/snmp6", &in) < 0) {
         DEBUGMSGTL(("mibII/kernel_linux/icmp6stats",
                     "Failed to open /proc/net/snmp6\n"));
         return -1;
     }
 
-    while (NULL != fgets(line, sizeof(line), in)) {
-        if (0 != strncmp(line, ICMP6_STATS_LINE, ICMP6_STATS_PREFIX_LEN))
+    while (NULL != (cp = netsnmp_procfs_getline(&in, &len))) {
+        if (_snmp6_line(cp, len, line, sizeof(line), &stats) < 0)
             continue;
-
-        if (2 != sscanf(line, "%s %lu", name, &stats))
+        if (0 != strncmp(line, ICMP6_STATS_LINE, ICMP6_STATS_PREFIX_LEN))
             continue;
 
-        endp = strchr(line, ' ');
-        if (endp)
-            *endp = '\0';
         DEBUGMSGTL(("mibII/kernel_linux/icmp6stats", "Find tag: %s\n", line));
 
-        vals = name;
+        vals = line;
         if (NULL != icmp6msgstat) {
             int type;
-            if (0 == strncmp(name, "Icmp6OutType", 12)) {
+            if (0 == strncmp(line, "Icmp6OutType", 12)) {
                 strsep(&vals, "e");
                 type = atoi(vals);
                 if ( type < 0 || type > 255 )
@@ -508,7 +563,7 @@ linux_read_icmp6_parse(struct icmp6_mib *icmp6stat,
                 icmp6msgstat->vals[type].OutType = stats;
                 *support = 1;
                 continue;
-            } else if (0 == strncmp(name, "Icmp6InType", 11)) {
+            } else if (0 == strncmp(line, "Icmp6InType", 11)) {
                 strsep(&vals, "e");
                 type = atoi(vals);
                 if ( type < 0 || type > 255 )
@@ -594,7 +649,6 @@ linux_read_icmp6_parse(struct icmp6_mib *icmp6stat,
                         "%s is an unknown tag\n", line));
     }
 
-    fclose(in);
 #endif
 
     memcpy((char *) icmp6stat, (char *) &cached_icmp6_mib,
@@ -660,10 +714,11 @@ int
 linux_read_udp6_stat(struct udp6_mib *udp6stat)
 {
 #ifdef NETSNMP_ENABLE_IPV6
-    FILE           *in;
-    char            line[1024];
+    netsnmp_procfs_view in;
+    const char     *cp;
+    char            line[64];       /* the name on the line */
+    size_t          len;
     unsigned long   stats;
-    char           *endp;
 #endif
 
     memset(udp6stat, 0, sizeof(*udp6stat));
@@ -671,22 +726,18 @@ linux_read_udp6_stat(struct udp6_mib *udp6stat)
 #ifdef NETSNMP_ENABLE_IPV6
     DEBUGMSGTL(("mibII/kernel_linux/udp6stats",
                 "Reading /proc/net/snmp6 stats\n"));
-    if (NULL == (in = fopen("/proc/net/snmp6", "r"))) {
+    if (netsnmp_procfs_snapshot("/proc/net/snmp6", &in) < 0) {
         DEBUGMSGTL(("mibII/kernel_linux/udp6stats",
                     "Failed to open /proc/net/snmp6\n"));
        return -1;
     }
 
-    while (NULL != fgets(line, sizeof(line), in)) {
-        if (0 != strncmp(line, UDP6_STATS_LINE, UDP6_STATS_PREFIX_LEN))
+    while (NULL != (cp = netsnmp_procfs_getline(&in, &len))) {
+        if (_snmp6_line(cp, len, line, sizeof(line), &stats) < 0)
             continue;
-
-        if (1 != sscanf(line, "%*s %lu", &stats))
+        if (0 != strncmp(line, UDP6_STATS_LINE, UDP6_STATS_PREFIX_LEN))
             continue;
 
-        endp = strchr(line, ' ');
-        if (endp)
-            *endp = '\0';
         DEBUGMSGTL(("mibII/kernel_linux/udp6stats", "Find tag: %s\n", line));
 
         if (0 == strcmp(line + 4, "OutDatagrams")) {
@@ -703,7 +754,6 @@ linux_read_udp6_stat(struct udp6_mib *udp6stat)
         }
     }
 
-    fclose(in);
 #endif
 
     memcpy((char *) udp6stat, (char *) &cached_udp6_mib, sizeof(*udp6stat));
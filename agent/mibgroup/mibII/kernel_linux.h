@@ -8,6 +8,8 @@
 
 #include "kernel_mib.h"
 
+config_require(util_funcs/procfs_snapshot)
+
 int             linux_read_ip_stat(struct ip_mib *);
 int             linux_read_ip6_stat(struct ip6_mib *);
 int             linux_read_icmp_stat(struct icmp_mib *);
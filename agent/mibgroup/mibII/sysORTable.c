@@ -4,6 +4,7 @@
 #include <net-snmp/agent/net-snmp-agent-includes.h>
 #include <net-snmp/agent/table_container.h>
 #include <net-snmp/agent/agent_sysORTable.h>
+#include <net-snmp/agent/agent_workers.h>
 #include <net-snmp/agent/sysORTable.h>
 
 #include "sysORTable.h"
@@ -92,6 +93,7 @@ register_cb(int major, int minor, void* serv, void* client)
 {
     DEBUGMSGTL(("mibII/sysORTable/register_cb",
                 "register_cb(%d, %d, %p, %p)\n", major, minor, serv, client));
+    netsnmp_agent_workers_sync();
     register_foreach((struct sysORTable*)serv, NULL);
     return SNMP_ERR_NOERROR;
 }
@@ -101,12 +103,14 @@ static int
 unregister_cb(int major, int minor, void* serv, void* client)
 {
     sysORTable_entry *value;
-    netsnmp_iterator* it = CONTAINER_ITERATOR(table);
+    netsnmp_iterator* it;
 
     DEBUGMSGTL(("mibII/sysORTable/unregister_cb",
                 "unregister_cb(%d, %d, %p, %p)\n", major, minor, serv, client));
+    netsnmp_agent_workers_sync();
     sysORLastChange = ((struct sysORTable*)(serv))->OR_uptime;
 
+    it = CONTAINER_ITERATOR(table);
     while ((value = (sysORTable_entry*)ITERATOR_NEXT(it)) && value->data != serv);
     ITERATOR_RELEASE(it);
     if(value) {
@@ -238,7 +242,14 @@ init_sysORTable(void)
     sysORTable_reg =
         netsnmp_create_handler_registration(
             "mibII/sysORTable", sysORTable_handler,
-            sysORTable_oid, OID_LENGTH(sysORTable_oid), HANDLER_CAN_RONLY);
+            sysORTable_oid, OID_LENGTH(sysORTable_oid),
+            HANDLER_CAN_RONLY | HANDLER_CAN_BULK_NEXT);
+    /*
+     * the table only changes in register_cb and unregister_cb, which wait
+     * for the worker threads first
+     */
+    if (sysORTable_reg)
+        sysORTable_reg->handler->flags |= MIB_HANDLER_THREAD_SAFE;
     netsnmp_container_table_register(sysORTable_reg, sysORTable_table_info,
                                      table, TABLE_CONTAINER_KEY_NETSNMP_INDEX);
 
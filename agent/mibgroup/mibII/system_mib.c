@@ -346,11 +346,14 @@ init_system_mib(void)
     }
     {
         const oid sysUpTime_oid[] = { 1, 3, 6, 1, 2, 1, 1, 3 };
-        netsnmp_register_scalar(
+        netsnmp_handler_registration *reginfo =
             netsnmp_create_handler_registration(
                 "mibII/sysUpTime", handle_sysUpTime,
                 sysUpTime_oid, OID_LENGTH(sysUpTime_oid),
-                HANDLER_CAN_RONLY));
+                HANDLER_CAN_RONLY);
+        if (reginfo)
+            reginfo->handler->flags |= MIB_HANDLER_THREAD_SAFE;
+        netsnmp_register_scalar(reginfo);
     }
     {
         const oid sysContact_oid[] = { 1, 3, 6, 1, 2, 1, 1, 4 };
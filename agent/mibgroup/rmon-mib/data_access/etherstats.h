@@ -4,4 +4,5 @@
 
 #if defined(linux)
 config_require(rmon-mib/data_access/etherstats_linux)
+config_require(util_funcs/ethtool_stats)
 #endif
@@ -137,6 +137,8 @@ etherStatsTable_container_init(netsnmp_container ** container_ptr_ptr,
      * cache->enabled to 0.
      */
     cache->timeout = ETHERSTATSTABLE_CACHE_TIMEOUT;     /* seconds */
+
+    netsnmp_cache_group_add("interfaces", cache);
 }                               /* etherStatsTable_container_init */
 
 /**
@@ -220,76 +222,33 @@ etherStatsTable_container_load(netsnmp_container * container)
      * etherStatsIndex(1)/INTEGER32/ASN_INTEGER/long(long)//l/A/w/e/R/d/h
      */
 
-    int             fd;
-
 #if defined(linux)
-    struct ifname *list_head = NULL, *p = NULL;
+    netsnmp_ethtool_port *port;
 #endif
 
     DEBUGMSGTL(("verbose:etherStatsTable:etherStatsTable_container_load",
                 "called\n"));
 
-    
-    /*
-     * create socket for ioctls
-     */
-
-    fd = socket(AF_INET, SOCK_DGRAM, 0);
-    if(fd < 0) {
-        snmp_log(LOG_ERR, "could not create socket\n");
-        return -2;
-    }
-
-    /*
-     * get the interface names of the devices present in the system, in case of failure retval suggests the reson for failure
-     * and list_head contains null
-     */
-
 #if defined(linux)
-    {
-        int retval;
-
-        list_head = etherstats_interface_name_list_get(list_head, &retval);
-    }
-
-    if (!list_head) {
-        snmp_log (LOG_ERR, "access:etherStatsTable, error getting the interface names present in the system\n");
-        DEBUGMSGTL(("access:etherStatsTable", "error getting the interface names present in the system"));
-        close(fd);
-        return MFD_ERROR;
-    }
-
     /*
-     * Walk over the list of interface names present in the system and retreive the statistics 
+     * Walk over the interfaces with ethtool statistics and retreive the
+     * statistics.  The collector gathers those of all interfaces in one
+     * pass, which the dot3StatsTable shares when it loads along.
      */
 
-    for (p = list_head; p; p = p->ifn_next) {
-        long            etherStatsIndex;
+    for (port = netsnmp_ethtool_stats_ports(); port; port = port->next) {
         etherStatsTable_rowreq_ctx *rowreq_ctx;
 
-        DEBUGMSGTL(("access:etherStatsTable", "processing '%s'\n", p->name));
-
-        /*
-         * get index via ioctl.
-         */
-
-        etherStatsIndex = (long) etherstats_interface_ioctl_ifindex_get(-1, p->name);
+        DEBUGMSGTL(("access:etherStatsTable", "processing '%s'\n", port->name));
 
-        /* 
-         *  get the etherstats contents populated, if the device is not an ethernet device
-         *  the operation will not be supported and an error message will be logged
-         */
-        
         rowreq_ctx = etherStatsTable_allocate_rowreq_ctx(NULL);
         if (NULL == rowreq_ctx) {
             snmp_log(LOG_ERR, "memory allocation failed\n");
-            close(fd);
-            etherstats_interface_name_list_free(list_head);
             return MFD_RESOURCE_UNAVAILABLE;
         }
 
         if (MFD_SUCCESS !=
-            etherStatsTable_indexes_set(rowreq_ctx, etherStatsIndex)) {
+            etherStatsTable_indexes_set(rowreq_ctx, port->ifindex)) {
             snmp_log(LOG_ERR,
                      "error setting index while loading "
                      "etherStatsTable data.\n");
@@ -306,45 +265,21 @@ etherStatsTable_container_load(netsnmp_container * container)
          */
 
         memset (&rowreq_ctx->data, 0, sizeof (rowreq_ctx->data));
-        {
-            int rc;
-
-            rc = interface_ioctl_etherstats_get (rowreq_ctx, fd, p->name);
-
-            if (rc < 0) {
-                DEBUGMSGTL(("access:etherStatsTable", "error getting the statistics for interface |%s| "
-                            "etherStatsTable data, operation might not be supported\n", p->name));
-                etherStatsTable_release_rowreq_ctx(rowreq_ctx);
-                continue;
-            }
-
-            /*
-             * insert into table container
-             */
-            rc = CONTAINER_INSERT(container, rowreq_ctx);
-            if (rc < 0) {
-                DEBUGMSGTL(("access:etherStatsTable", "error inserting |%s| ", p->name));
-                etherStatsTable_release_rowreq_ctx(rowreq_ctx);
-                continue;
-            }
+        interface_ethtool_etherstats_get(rowreq_ctx, port);
+
+        /*
+         * insert into table container
+         */
+        if (CONTAINER_INSERT(container, rowreq_ctx) < 0) {
+            DEBUGMSGTL(("access:etherStatsTable", "error inserting |%s| ", port->name));
+            etherStatsTable_release_rowreq_ctx(rowreq_ctx);
+            continue;
         }
 
         ++count;
     }
-
-    close(fd);
-
-    /*
-     * free the interface names list 
-     */
-
-    if ( (etherstats_interface_name_list_free(list_head)) < 0) {
-        snmp_log(LOG_ERR, "access:etherStatsTable, error freeing the interface name list \n");
-        DEBUGMSGTL(("access:etherStatsTable", "error freeing the interface name list\n"));
-        return MFD_ERROR;
-    }
 #endif
-    
+
     DEBUGMSGT(("verbose:etherStatsTable:etherStatsTable_container_load",
                "inserted %" NETSNMP_PRIz "d records\n", count));
 
@@ -16,18 +16,9 @@ typedef __u8 u8;
 #endif
 #include <linux/ethtool.h>
 
-/* structure for storing the interface names in the system */
+#include "util_funcs/ethtool_stats.h"
 
-struct ifname {
-    struct ifname *ifn_next;
-    char name [IF_NAMESIZE];
-};
-
-struct ifname *etherstats_interface_name_list_get (struct ifname *, int *);
-int etherstats_interface_name_list_free (struct ifname *list_head);
-int etherstats_interface_ioctl_ifindex_get (int fd, const char *name);
-int _etherStats_ioctl_get(int fd, int which, struct ifreq *ifrq, const char* name);
-int interface_ioctl_etherstats_get(etherStatsTable_rowreq_ctx *rowreq_ctx, int fd, const char* name);
+void interface_ethtool_etherstats_get(etherStatsTable_rowreq_ctx *rowreq_ctx, const netsnmp_ethtool_port *port);
 
 /* for maintainability */
 
@@ -67,41 +58,3 @@ int interface_ioctl_etherstats_get(etherStatsTable_rowreq_ctx *rowreq_ctx, int f
 #define DSA_1024_MAXBYTES                       "hist_1024_max_bytes"
 #define FEC_1024_2047BYTES                      "rx_1024to2047byte"
 #define FEC_GTE2048BYTES                        "rx_GTE2048byte"
-
-#define ETHERSTATSOCTETS(x)                     (!strcmp(x, DSA_INCOMING_GOOD_OCTETS) || \
-                                                 !strcmp(x, DSA_INCOMING_BAD_OCTETS) || \
-                                                 !strcmp(x, GENERIC_INCOMING_OCTETS))
-#define ETHERSTATSPKTS(x)                       (!strcmp(x, DSA_INCOMING_UNICAST) || \
-                                                 !strcmp(x, DSA_INCOMING_BROADCAST) || \
-                                                 !strcmp(x, DSA_INCOMING_MULTICAST) || \
-                                                 !strcmp(x, GENERIC_INCOMING_PACKETS))
-#define ETHERSTATSBROADCASTPKTS(x)              (!strcmp(x, DSA_INCOMING_BROADCAST) || \
-                                                 !strcmp(x, GENERIC_INCOMING_BROADCAST))
-#define ETHERSTATSMULTICASTPKTS(x)              (!strcmp(x, DSA_INCOMING_MULTICAST) || \
-                                                 !strcmp(x, GENERIC_INCOMING_MULTICAST))
-#define ETHERSTATSCRCALIGNERRORS(x)             (!strcmp(x, DSA_INCOMING_FCS_ERROR) || \
-                                                 !strcmp(x, FEC_INCOMING_CRC_ERROR))
-#define ETHERSTATSUNDERSIZEPKTS(x)              (!strcmp(x, DSA_INCOMING_UNDERSIZE) || \
-                                                 !strcmp(x, FEC_INCOMING_UNDERSIZE))
-#define ETHERSTATSOVERSIZEPKTS(x)               (!strcmp(x, DSA_INCOMING_OVERSIZE) || \
-                                                 !strcmp(x, FEC_INCOMING_OVERSIZE))
-#define ETHERSTATSFRAGMENTS(x)                  (!strcmp(x, DSA_INCOMING_FRAGMENTS) || \
-                                                 !strcmp(x, FEC_INCOMING_FRAGMENT))
-#define ETHERSTATSJABBERS(x)                    (!strcmp(x, BROADCOM_RECEIVE_JABBERS) || \
-                                                 !strcmp(x, FEC_INCOMING_JABBER) || \
-                                                 !strcmp(x, DSA_INCOMING_JABBER))
-#define ETHERSTATSCOLLISIONS(x)                 (!strcmp(x, DSA_COLLISIONS) || \
-                                                 !strcmp(x, FEC_OUTGOING_COLLISION))
-#define ETHERSTATSPKTS64OCTETS(x)               (!strcmp(x, DSA_64BYTES) || \
-                                                 !strcmp(x, FEC_64BYTES))
-#define ETHERSTATSPKTS65TO127OCTETS(x)          (!strcmp(x, DSA_65_127BYTES) || \
-                                                 !strcmp(x, FEC_65_127BYTES))
-#define ETHERSTATSPKTS128TO255OCTETS(x)         (!strcmp(x, DSA_128_255BYTES) || \
-                                                 !strcmp(x, FEC_128_255BYTES))
-#define ETHERSTATSPKTS256TO511OCTETS(x)         (!strcmp(x, DSA_256_511BYTES) || \
-                                                 !strcmp(x, FEC_256_511BYTES))
-#define ETHERSTATSPKTS512TO1023OCTETS(x)        (!strcmp(x, DSA_512_1023BYTES) || \
-                                                 !strcmp(x, FEC_512_1023BYTES))
-#define ETHERSTATSPKTS1024TO1518OCTETS(x)       (!strcmp(x, DSA_1024_MAXBYTES) || \
-                                                 !strcmp(x, FEC_1024_2047BYTES) || \
-                                                 !strcmp(x, FEC_GTE2048BYTES))
@@ -64,6 +64,7 @@
 #include <net-snmp/net-snmp-includes.h>
 #include <net-snmp/agent/net-snmp-agent-includes.h>
 #include <net-snmp/library/tools.h>
+#include <net-snmp/library/large_fd_set.h>
 
 #include "smux.h"
 #include "snmpd.h"
@@ -102,6 +103,8 @@ static int      smux_pdu_process(int, u_char *, size_t);
 static int      smux_send_rrsp(int, int);
 static smux_reg *smux_find_match(smux_reg *, int, oid *, size_t, long);
 static smux_reg *smux_find_replacement(oid *, size_t);
+static void     smux_peer_ready(int, void *);
+static void     smux_listen_ready(int, void *);
 u_char         *var_smux_get(oid *, size_t, oid *, size_t *, int, size_t *,
                                u_char *);
 int             var_smux_write(int, u_char *, u_char, size_t, oid *, size_t);
@@ -276,6 +279,10 @@ real_init_smux(void)
         return;
     }
 
+    /* for snmpd loops that wait with an fd poller rather than select() */
+    netsnmp_fd_watch(smux_listen_sd, NETSNMP_FD_WATCH_READ,
+                     smux_listen_ready, NULL);
+
     DEBUGMSGTL(("smux_init",
                 "[smux_init] done; smux listen sd is %d, smux port is %d\n",
                 smux_listen_sd, ntohs(lo_socket.sin_port)));
@@ -2181,6 +2188,7 @@ int smux_snmp_select_list_add(int sd)
    if (sdlen < NUM_SOCKETS)
    {
       sdlist[sdlen++] = sd;
+      netsnmp_fd_watch(sd, NETSNMP_FD_WATCH_READ, smux_peer_ready, NULL);
       return(1);
    }
    return(0);
@@ -2202,11 +2210,30 @@ int smux_snmp_select_list_del(int sd)
    if (found)
    {
       sdlen--;
+      netsnmp_fd_unwatch(sd, NETSNMP_FD_WATCH_READ, NULL);
       return(1);
    }
    return(0);
 }
 
+/*
+ * Called back by the fd poller; the select() loop in snmpd does the same
+ * for the fd sets it builds.
+ */
+static void
+smux_peer_ready(int sd, void *data)
+{
+    if (smux_process(sd) < 0)
+        smux_snmp_select_list_del(sd);
+}
+
+static void
+smux_listen_ready(int sd, void *data)
+{
+    if ((sd = smux_accept(sd)) >= 0)
+        smux_snmp_select_list_add(sd);
+}
+
 int smux_snmp_select_list_get_length(void)
 {
    return(sdlen);
@@ -12,6 +12,17 @@
 #include "tcp-mib/tcpConnectionTable/tcpConnectionTable_constants.h"
 #include "tcp-mib/data_access/tcpConn_private.h"
 #include "mibgroup/util_funcs/get_pid_from_inode.h"
+
+#if defined(HAVE_LINUX_SOCK_DIAG_H) && defined(HAVE_LINUX_INET_DIAG_H)
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/netlink.h>
+#include <linux/sock_diag.h>
+#include <linux/inet_diag.h>
+#define NETSNMP_TCPCONN_SOCK_DIAG 1
+#endif
+
 static int
 linux_states[12] = { 1, 5, 3, 4, 6, 7, 11, 1, 8, 9, 2, 10 };
 
@@ -19,6 +30,10 @@ static int _load4(netsnmp_container *container, u_int flags);
 #if defined (NETSNMP_ENABLE_IPV6)
 static int _load6(netsnmp_container *container, u_int flags);
 #endif
+#ifdef NETSNMP_TCPCONN_SOCK_DIAG
+static int _load_diag(netsnmp_container *container, u_int flags,
+                      int family);
+#endif
 
 /*
  * initialize arch specific storage
@@ -92,7 +107,15 @@ netsnmp_arch_tcpconn_container_load(netsnmp_container *container,
         return -1;
     }
 
-    rc = _load4(container, load_flags);
+    /*
+     * prefer sock_diag, and fall back to /proc if the kernel doesn't
+     * support it or the dump failed (_load_diag adds nothing then)
+     */
+#ifdef NETSNMP_TCPCONN_SOCK_DIAG
+    rc = _load_diag(container, load_flags, AF_INET);
+    if (rc < 0)
+#endif
+        rc = _load4(container, load_flags);
 
 #if defined (NETSNMP_ENABLE_IPV6)
     if((0 != rc) || (load_flags & NETSNMP_ACCESS_TCPCONN_LOAD_IPV4_ONLY))
@@ -102,7 +125,11 @@ netsnmp_arch_tcpconn_container_load(netsnmp_container *container,
      * load ipv6. ipv6 module might not be loaded,
      * so ignore -2 err (file not found)
      */
-    rc = _load6(container, load_flags);
+#ifdef NETSNMP_TCPCONN_SOCK_DIAG
+    rc = _load_diag(container, load_flags, AF_INET6);
+    if (rc < 0)
+#endif
+        rc = _load6(container, load_flags);
     if (-2 == rc)
         rc = 0;
 #endif
@@ -404,3 +431,202 @@ _load6(netsnmp_container *container, u_int load_flags)
     return 0;
 }
 #endif /* NETSNMP_ENABLE_IPV6 */
+
+#ifdef NETSNMP_TCPCONN_SOCK_DIAG
+/*
+ * a dump the kernel flags as inconsistent (NLM_F_DUMP_INTR, because the
+ * socket tables changed while it was being sent) is requested again up
+ * to this many times; after that the last one is used as it is
+ */
+#define TCPCONN_DIAG_DUMP_RETRIES 3
+
+#ifndef NLM_F_DUMP_INTR
+#define NLM_F_DUMP_INTR 0x10
+#endif
+
+/*
+ * Loads the TCP sockets of one address family with a SOCK_DIAG_BY_FAMILY
+ * dump request.  The kernel sends binary records and skips the sockets
+ * in states we don't want, which is much cheaper than formatting and
+ * parsing /proc/net/tcp{,6} when there are many sockets.  The entries
+ * are only added to the container once a dump has completed; if it
+ * fails, the container is left as it was.
+ *
+ * @retval  0 no errors
+ * @retval -2 sock_diag is not available, nothing was loaded
+ * @retval <0 other errors, nothing was loaded
+ */
+static int
+_load_diag(netsnmp_container *container, u_int load_flags, int family)
+{
+    struct {
+        struct nlmsghdr nlh;
+        struct inet_diag_req_v2 req;
+    } msg;
+    struct sockaddr_nl nladdr;
+    enum            { rbufsize = 65536 };
+    char           *rbuf;
+    netsnmp_tcpconn_entry **entries = NULL, **tmp;
+    size_t          loaded = 0, entries_size = 0, i;
+    u_int           states, addr_len = (AF_INET == family) ? 4 : 16;
+    int             sd, len, done, intr, attempt, rc = 0;
+
+    netsnmp_assert(NULL != container);
+
+    /*
+     * TCP_ESTABLISHED (1) to TCP_CLOSING (11); request sockets are
+     * included with TCP_SYN_RECV
+     */
+    if (load_flags & NETSNMP_ACCESS_TCPCONN_LOAD_ONLYLISTEN)
+        states = 1 << 10;
+    else {
+        states = ((1 << 12) - 1) & ~1;
+        if (load_flags & NETSNMP_ACCESS_TCPCONN_LOAD_NOLISTEN)
+            states &= ~(1 << 10);
+    }
+
+    sd = socket(AF_NETLINK, SOCK_DGRAM, NETLINK_SOCK_DIAG);
+    if (sd < 0) {
+        DEBUGMSGTL(("access:tcpconn:container",
+                    "no sock_diag socket: %s\n", strerror(errno)));
+        return -2;
+    }
+
+    memset(&msg, 0, sizeof(msg));
+    msg.nlh.nlmsg_len = sizeof(msg);
+    msg.nlh.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    msg.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    msg.req.sdiag_family = family;
+    msg.req.sdiag_protocol = IPPROTO_TCP;
+    msg.req.idiag_states = states;
+
+    memset(&nladdr, 0, sizeof(nladdr));
+    nladdr.nl_family = AF_NETLINK;
+
+    rbuf = malloc(rbufsize);
+    if (NULL == rbuf) {
+        close(sd);
+        return -2;
+    }
+
+    for (attempt = 0; ; attempt++) {
+        msg.nlh.nlmsg_seq = attempt + 1;
+        if (sendto(sd, &msg, sizeof(msg), 0, (struct sockaddr *) &nladdr,
+                   sizeof(nladdr)) < 0) {
+            rc = loaded ? -1 : -2;
+            break;
+        }
+
+        done = intr = 0;
+        while (!done) {
+            struct nlmsghdr *h;
+
+            len = recv(sd, rbuf, rbufsize, 0);
+            if (len < 0) {
+                if (EINTR == errno)
+                    continue;
+                DEBUGMSGTL(("access:tcpconn:container",
+                            "sock_diag recv: %s\n", strerror(errno)));
+                rc = loaded ? -1 : -2;
+                break;
+            }
+            if (0 == len)
+                break;
+
+            for (h = (struct nlmsghdr *) rbuf; NLMSG_OK(h, len);
+                 h = NLMSG_NEXT(h, len)) {
+                netsnmp_tcpconn_entry *entry;
+                struct inet_diag_msg *r;
+
+                if (h->nlmsg_flags & NLM_F_DUMP_INTR)
+                    intr = 1;
+                if (NLMSG_DONE == h->nlmsg_type) {
+                    done = 1;
+                    break;
+                }
+                if (NLMSG_ERROR == h->nlmsg_type) {
+                    /* e.g. no sock_diag support for this family */
+                    DEBUGMSGTL(("access:tcpconn:container",
+                                "sock_diag error for family %d\n", family));
+                    rc = loaded ? -1 : -2;
+                    done = 1;
+                    break;
+                }
+                if (SOCK_DIAG_BY_FAMILY != h->nlmsg_type ||
+                    h->nlmsg_len < NLMSG_LENGTH(sizeof(*r)))
+                    continue;
+
+                r = (struct inet_diag_msg *) NLMSG_DATA(h);
+                if (r->idiag_family != family)
+                    continue;
+
+                if (loaded == entries_size) {
+                    entries_size = entries_size ? entries_size * 2 : 64;
+                    tmp = (netsnmp_tcpconn_entry **)
+                        realloc(entries, entries_size * sizeof(*entries));
+                    if (NULL == tmp) {
+                        rc = -3;
+                        done = 1;
+                        break;
+                    }
+                    entries = tmp;
+                }
+                entry = netsnmp_access_tcpconn_entry_create();
+                if (NULL == entry) {
+                    rc = -3;
+                    done = 1;
+                    break;
+                }
+
+                entry->loc_port = ntohs(r->id.idiag_sport);
+                entry->rmt_port = ntohs(r->id.idiag_dport);
+                entry->tcpConnState = (r->idiag_state & 0xf) < 12 ?
+                    linux_states[r->idiag_state & 0xf] : 2;
+                entry->pid = netsnmp_get_pid_from_inode(r->idiag_inode);
+
+                /** already in network order */
+                memcpy(entry->loc_addr, r->id.idiag_src, addr_len);
+                entry->loc_addr_len = addr_len;
+                memcpy(entry->rmt_addr, r->id.idiag_dst, addr_len);
+                entry->rmt_addr_len = addr_len;
+
+                entries[loaded++] = entry;
+            }
+            if (rc < 0)
+                break;
+        }
+
+        if (!intr || rc < 0 || attempt >= TCPCONN_DIAG_DUMP_RETRIES)
+            break;
+        DEBUGMSGTL(("access:tcpconn:container",
+                    "sock_diag dump for family %d interrupted, retrying\n",
+                    family));
+        for (i = 0; i < loaded; i++)
+            netsnmp_access_tcpconn_entry_free(entries[i]);
+        loaded = 0;
+    }
+
+    /*
+     * add the entries to the container, or drop them all if the dump
+     * didn't complete
+     */
+    for (i = 0; i < loaded; i++) {
+        if (rc < 0) {
+            netsnmp_access_tcpconn_entry_free(entries[i]);
+            continue;
+        }
+        entries[i]->arbitrary_index = CONTAINER_SIZE(container) + 1;
+        if (CONTAINER_INSERT(container, entries[i]) < 0)
+            netsnmp_access_tcpconn_entry_free(entries[i]);
+    }
+
+    free(entries);
+    free(rbuf);
+    close(sd);
+
+    DEBUGMSGTL(("access:tcpconn:container",
+                "loaded %d family %d sockets using sock_diag (rc %d)\n",
+                (int) loaded, family, rc));
+    return rc;
+}
+#endif /* NETSNMP_TCPCONN_SOCK_DIAG */
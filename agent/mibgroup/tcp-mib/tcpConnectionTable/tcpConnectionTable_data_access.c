@@ -18,6 +18,14 @@
 
 
 #include "tcpConnectionTable_data_access.h"
+#include "tcp-mib/data_access/tcpConn.h"
+
+#ifdef NETSNMP_TCPCONN_ARCH_THREAD_SAFE
+static void    *_cache_snapshot(netsnmp_cache * cache, void *magic);
+static void     _cache_swap(netsnmp_cache * cache, void *magic,
+                            void *snapshot);
+static void     _cache_snapshot_free(netsnmp_cache * cache, void *snapshot);
+#endif
 
 /** @ingroup interface 
  * @addtogroup data_access data_access: Routines to access data
@@ -131,6 +139,16 @@ tcpConnectionTable_container_init(netsnmp_container **container_ptr_ptr,
      */
     cache->timeout = TCPCONNECTIONTABLE_CACHE_TIMEOUT;  /* seconds */
     cache->flags |= NETSNMP_CACHE_DONT_INVALIDATE_ON_SET;
+#ifdef NETSNMP_TCPCONN_ARCH_THREAD_SAFE
+    /*
+     * keep the rows of an expired cache to answer from while the
+     * connections are loaded again in the background.  The loads stay
+     * in the request until cacheMaxStale gives the cache a limit.
+     */
+    cache->flags |= NETSNMP_CACHE_DONT_FREE_EXPIRED;
+    netsnmp_cache_set_background(cache, 0, _cache_snapshot, _cache_swap,
+                                 _cache_snapshot_free);
+#endif
 }                               /* tcpConnectionTable_container_init */
 
 /**
@@ -270,6 +288,58 @@ tcpConnectionTable_container_load(netsnmp_container *container)
     return MFD_SUCCESS;
 }                               /* tcpConnectionTable_container_load */
 
+#ifdef NETSNMP_TCPCONN_ARCH_THREAD_SAFE
+/**
+ * @internal
+ * loads the connections into a new container, in the cache loader
+ * thread
+ */
+static void    *
+_cache_snapshot(netsnmp_cache * cache, void *magic)
+{
+    return netsnmp_access_tcpconn_container_load(NULL,
+                                                 NETSNMP_ACCESS_TCPCONN_LOAD_NOLISTEN);
+}                               /* _cache_snapshot */
+
+static void
+_release_row(tcpConnectionTable_rowreq_ctx *rowreq_ctx, void *context)
+{
+    tcpConnectionTable_release_rowreq_ctx(rowreq_ctx);
+}
+
+/**
+ * @internal
+ * replaces the rows of the table with those of the loaded connections
+ */
+static void
+_cache_swap(netsnmp_cache * cache, void *magic, void *snapshot)
+{
+    netsnmp_container *container = (netsnmp_container *) magic;
+    netsnmp_container *raw_data = (netsnmp_container *) snapshot;
+
+    tcpConnectionTable_container_free(container);
+    CONTAINER_CLEAR(container, (netsnmp_container_obj_func *) _release_row,
+                    NULL);
+    CONTAINER_FOR_EACH(raw_data, (netsnmp_container_obj_func *)
+                       _add_connection, container);
+    netsnmp_access_tcpconn_container_free(raw_data,
+                                          NETSNMP_ACCESS_TCPCONN_FREE_DONT_CLEAR);
+    DEBUGMSGT(("verbose:tcpConnectionTable:tcpConnectionTable_cache_load",
+               "%d records swapped in\n", (int)CONTAINER_SIZE(container)));
+}                               /* _cache_swap */
+
+/**
+ * @internal
+ * frees connections that were not swapped in
+ */
+static void
+_cache_snapshot_free(netsnmp_cache * cache, void *snapshot)
+{
+    netsnmp_access_tcpconn_container_free((netsnmp_container *) snapshot,
+                                          NETSNMP_ACCESS_TCPCONN_FREE_NOFLAGS);
+}                               /* _cache_snapshot_free */
+#endif                          /* NETSNMP_TCPCONN_ARCH_THREAD_SAFE */
+
 /**
  * container clean up
  *
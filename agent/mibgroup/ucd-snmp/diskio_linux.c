@@ -7,21 +7,34 @@
 #ifdef HAVE_SYS_SYSMACROS_H
 #include <sys/sysmacros.h> /* major() */
 #endif
+#include <ctype.h>
+#include <fcntl.h>
 #include <math.h>
 #include <unistd.h>
+#ifdef HAVE_REGEX_H
+#include <regex.h>
+#endif
 #include "diskio_linux.h"
 #include "diskio.h"
 #include "util_funcs/header_simple_table.h"
+#include "util_funcs/procfs_snapshot.h"
 
 #define STRMAX 1024
 
 static void     diskio_parse_config_disks(const char *token, char *cptr);
+#ifdef HAVE_REGEX_H
+static void     diskio_parse_config_pattern(const char *token, char *cptr);
+#endif
 static int      diskio_pre_update_config(int, int, void *, void *);
 static void     diskio_free_config(void);
 
-#define DISK_INCR 2
-
+/*
+ * One record per block device, found by its device number through a
+ * hash table that grows with the number of devices.  The devices that
+ * are reported are also listed in head, in the order of the diskIOTable.
+ */
 typedef struct linux_diskio {
+    struct linux_diskio *hnext;         /* in its hash bucket */
     int             major;
     int             minor;
     unsigned long   blocks;
@@ -37,39 +50,256 @@ typedef struct linux_diskio {
     unsigned long   running;
     unsigned long   use;
     unsigned long   aveq;
-} linux_diskio;
 
-/* disk load averages */
-typedef struct linux_diskio_la {
+    /* disk load averages */
     unsigned long   use_prev;
     double          la1, la5, la15;
-} linux_diskio_la;
+    int             la_valid;
+
+    u_int           seen;               /* the last load that found it */
+    int             excluded;
+
+    /* devices configured with the diskio directive */
+    char           *syspath;            /* full stat path */
+    int             fd;
+} linux_diskio;
 
 typedef struct linux_diskio_header {
-    linux_diskio   *indices;
+    linux_diskio  **indices;
     int             length;
     int             alloc;
 } linux_diskio_header;
 
-typedef struct linux_diskio_la_header {
-    linux_diskio_la *indices;
-    int             length;
-} linux_diskio_la_header;
+#define DISKIO_HASH_INIT    64
+#define DISKIO_ROWS_INIT    16
+#define DISKIO_MAX_OPEN     32    /* unless set with diskio_max_open */
+
+static linux_diskio_header head;        /* the rows of the table */
+static linux_diskio_header disks;       /* configured, in config order */
+
+static linux_diskio **diskio_hash;
+static u_int    diskio_hash_size;
+static u_int    diskio_count;
+static u_int    diskio_loads;
+
+/*
+ * The sysfs stat files of configured devices stay open between polls,
+ * up to diskio_max_open of them.
+ */
+static int      diskio_open;
+
+#ifdef HAVE_REGEX_H
+/*
+ * diskio_include and diskio_exclude patterns, matched against the
+ * names of the devices
+ */
+typedef struct diskio_pattern_s {
+    struct diskio_pattern_s *next;
+    int             include;
+    regex_t         regex;
+} diskio_pattern;
+
+static diskio_pattern *diskio_patterns;
+static int      diskio_includes;
+#endif
 
-static linux_diskio_header head;
-static linux_diskio_la_header la_head;
+static u_int
+_diskio_bucket(int major, int minor, u_int size)
+{
+    return ((u_int) major * 31 + (u_int) minor) & (size - 1);
+}
 
-struct diskiopart {
-    char            syspath[STRMAX];    /* full stat path */
-    char            name[STRMAX];       /* name as provided */
-    char            shortname[STRMAX];  /* short name for output */
-    int             major;
-    int             minor;
-};
+static linux_diskio *
+_diskio_find(int major, int minor)
+{
+    linux_diskio   *d;
+
+    if (!diskio_hash)
+        return NULL;
+    for (d = diskio_hash[_diskio_bucket(major, minor, diskio_hash_size)];
+         d; d = d->hnext)
+        if (d->major == major && d->minor == minor)
+            return d;
+    return NULL;
+}
+
+static int
+_diskio_hash_grow(void)
+{
+    u_int           size, i, b;
+    linux_diskio  **hash, *d, *next;
+
+    size = diskio_hash_size ? diskio_hash_size * 2 : DISKIO_HASH_INIT;
+    hash = calloc(size, sizeof(*hash));
+    if (!hash)
+        return -1;
+    for (i = 0; i < diskio_hash_size; i++)
+        for (d = diskio_hash[i]; d; d = next) {
+            next = d->hnext;
+            b = _diskio_bucket(d->major, d->minor, size);
+            d->hnext = hash[b];
+            hash[b] = d;
+        }
+    free(diskio_hash);
+    diskio_hash = hash;
+    diskio_hash_size = size;
+    return 0;
+}
+
+static void
+_diskio_close(linux_diskio *d)
+{
+    if (d->fd < 0)
+        return;
+    close(d->fd);
+    d->fd = -1;
+    diskio_open--;
+}
+
+static void
+_diskio_free(linux_diskio *d)
+{
+    _diskio_close(d);
+    free(d->syspath);
+    free(d);
+}
+
+static int      is_excluded(const char *name);
+
+static void
+_diskio_set_name(linux_diskio *d, const char *name, size_t len)
+{
+    memcpy(d->name, name, len);
+    d->name[len] = '\0';
+    d->excluded = is_excluded(d->name);
+    d->la_valid = 0;
+}
+
+/*
+ * Returns the record of a device, which is created if needed.  A device
+ * number that now has another name is taken to be another device.
+ */
+static linux_diskio *
+_diskio_get(int major, int minor, const char *name, size_t len)
+{
+    linux_diskio   *d;
+    u_int           b;
+
+    if (len >= sizeof(d->name))
+        len = sizeof(d->name) - 1;
+    d = _diskio_find(major, minor);
+    if (d) {
+        if (strncmp(d->name, name, len) != 0 || d->name[len] != '\0')
+            _diskio_set_name(d, name, len);
+        return d;
+    }
+
+    if (diskio_count >= diskio_hash_size && _diskio_hash_grow() < 0)
+        return NULL;
+    d = SNMP_MALLOC_TYPEDEF(linux_diskio);
+    if (!d)
+        return NULL;
+    d->major = major;
+    d->minor = minor;
+    d->fd = -1;
+    _diskio_set_name(d, name, len);
+    b = _diskio_bucket(major, minor, diskio_hash_size);
+    d->hnext = diskio_hash[b];
+    diskio_hash[b] = d;
+    diskio_count++;
+    return d;
+}
 
-static int      numdisks;
-static int      maxdisks;
-static struct diskiopart *disks;
+/*
+ * drops the devices the last load did not find, except configured ones
+ */
+static void
+_diskio_prune(void)
+{
+    linux_diskio  **dp, *d;
+    u_int           i;
+
+    for (i = 0; i < diskio_hash_size; i++)
+        for (dp = &diskio_hash[i]; (d = *dp) != NULL;) {
+            if (d->seen != diskio_loads && !d->syspath) {
+                DEBUGMSGTL(("ucd-snmp/diskio", "%s is gone\n", d->name));
+                *dp = d->hnext;
+                _diskio_free(d);
+                diskio_count--;
+            } else
+                dp = &d->hnext;
+        }
+}
+
+static int
+_diskio_add(linux_diskio_header *h, linux_diskio *d)
+{
+    linux_diskio  **indices;
+    int             alloc;
+
+    if (h->length == h->alloc) {
+        alloc = h->alloc ? h->alloc * 2 : DISKIO_ROWS_INIT;
+        indices = realloc(h->indices, alloc * sizeof(*indices));
+        if (!indices)
+            return -1;
+        h->indices = indices;
+        h->alloc = alloc;
+    }
+    h->indices[h->length++] = d;
+    return 0;
+}
+
+/*
+ * Parses up to max numbers separated by blanks, without going past the
+ * end of the line.  Returns how many were found.
+ */
+static int
+_diskio_parse_stats(const char **cpp, unsigned long *v, int max)
+{
+    const char     *cp = *cpp;
+    char           *end;
+    int             n = 0;
+
+    while (n < max) {
+        while (*cp == ' ' || *cp == '\t')
+            cp++;
+        if (!isdigit((unsigned char) *cp))
+            break;
+        v[n++] = strtoul(cp, &end, 10);
+        cp = end;
+    }
+    *cpp = cp;
+    return n;
+}
+
+/*
+ * Sets the statistics of a device from the 11 (or more) numbers of a
+ * disk, or the 4 of a partition of a 2.6 kernel.
+ */
+static void
+_diskio_set_stats(linux_diskio *d, const unsigned long *v, int n)
+{
+    if (n >= 11) {
+        d->rio = v[0];
+        d->rmerge = v[1];
+        d->rsect = v[2];
+        d->ruse = v[3];
+        d->wio = v[4];
+        d->wmerge = v[5];
+        d->wsect = v[6];
+        d->wuse = v[7];
+        d->running = v[8];
+        d->use = v[9];
+        d->aveq = v[10];
+    } else {
+        d->rio = v[0];
+        d->rsect = v[1];
+        d->wio = v[2];
+        d->wsect = v[3];
+        d->rmerge = d->ruse = d->wmerge = d->wuse = 0;
+        d->running = d->use = d->aveq = 0;
+    }
+}
 
 /* to do: make sure diskio_free_config() gets invoked upon SIGHUP. */
 static int
@@ -83,7 +313,8 @@ diskio_pre_update_config(int major, int minor, void *serverarg,
 static void
 diskio_free_config(void)
 {
-    int             i;
+    linux_diskio   *d, *next;
+    u_int           i;
 
     DEBUGMSGTL(("diskio", "free config %d\n",
                 netsnmp_ds_get_boolean(NETSNMP_DS_APPLICATION_ID,
@@ -95,82 +326,48 @@ diskio_free_config(void)
     netsnmp_ds_set_boolean(NETSNMP_DS_APPLICATION_ID,
                            NETSNMP_DS_AGENT_DISKIO_NO_RAM, 0);
 
-    if (la_head.length) {
-        /*
-         * reset any usage stats, we may get different list of devices from
-         * config
-         */
-        free(la_head.indices);
-        la_head.length = 0;
-        la_head.indices = NULL;
-    }
-    if (numdisks > 0) {
-        head.length = 0;
-        numdisks = 0;
-        for (i = 0; i < maxdisks; i++) {        /* init/erase disk db */
-            disks[i].syspath[0] = 0;
-            disks[i].name[0] = 0;
-            disks[i].shortname[0] = 0;
-            disks[i].major = -1;
-            disks[i].minor = -1;
-        }
+#ifdef HAVE_REGEX_H
+    while (diskio_patterns) {
+        diskio_pattern *p = diskio_patterns;
+
+        diskio_patterns = p->next;
+        regfree(&p->regex);
+        free(p);
     }
-}
+    diskio_includes = 0;
+#endif
 
-static int
-disk_exists(char *path)
-{
-    int             index;
-    for (index = 0; index < numdisks; index++) {
-        DEBUGMSGTL(("ucd-snmp/disk", "Checking for %s. Found %s at %d\n",
-                    path, disks[index].syspath, index));
-        if (strcmp(path, disks[index].syspath) == 0) {
-            return index;
+    /*
+     * forget all devices, along with their usage stats: we may get a
+     * different list of devices from config
+     */
+    for (i = 0; i < diskio_hash_size; i++)
+        for (d = diskio_hash[i]; d; d = next) {
+            next = d->hnext;
+            _diskio_free(d);
         }
-    }
-    return -1;
+    SNMP_FREE(diskio_hash);
+    diskio_hash_size = 0;
+    diskio_count = 0;
+    head.length = 0;
+    disks.length = 0;
+    diskio_set_cache_time(0);
 }
 
 static void
 add_device(char *path, int addNewDisks)
 {
-    int             index;
     char            device[STRMAX];
     char            syspath[STRMAX];
     char           *basename;
     struct stat     stbuf;
+    linux_diskio   *d;
 
     if (!path || !strcmp(path, "none")) {
         DEBUGMSGTL(("ucd-snmp/diskio", "Skipping null path device (%s)\n",
                     path));
         return;
     }
-    if (numdisks == maxdisks) {
-        if (maxdisks == 0) {
-            maxdisks = 50;
-            disks = malloc(maxdisks * sizeof(struct diskiopart));
-            if (!disks) {
-                config_perror("malloc failed for new disko allocation.");
-                netsnmp_config_error("\tignoring:  %s", path);
-                return;
-            }
-            memset(disks, 0, maxdisks * sizeof(struct diskiopart));
-        } else {
-            struct diskiopart *newdisks;
-            maxdisks *= 2;
-            newdisks = realloc(disks, maxdisks * sizeof(struct diskiopart));
-            if (!newdisks) {
-                free(disks);
-                disks = NULL;
-                config_perror("malloc failed for new disko allocation.");
-                netsnmp_config_error("\tignoring:  %s", path);
-                return;
-            }
-            disks = newdisks;
-            memset(disks + maxdisks / 2, 0,
-                   maxdisks / 2 * sizeof(struct diskiopart));
-        }
-    }
 
     /* first find the path for this device */
     device[0] = '\0';
@@ -204,20 +401,20 @@ add_device(char *path, int addNewDisks)
     DEBUGMSGTL(("ucd-snmp/diskio", " monitoring sys path (%s)\n",
                 syspath));
 
-    index = disk_exists(syspath);
-
-    if (index == -1 && addNewDisks) {
-        /* The following buffers are cleared above, no need to add '\0' */
-        strlcpy(disks[numdisks].syspath, syspath,
-                sizeof(disks[numdisks].syspath) - 1);
-        strlcpy(disks[numdisks].name, path,
-                sizeof(disks[numdisks].name) - 1);
-        strlcpy(disks[numdisks].shortname, basename,
-                sizeof(disks[numdisks].shortname) - 1);
-        disks[numdisks].major = major(stbuf.st_rdev);
-        disks[numdisks].minor = minor(stbuf.st_rdev);
-        numdisks++;
+    d = _diskio_find(major(stbuf.st_rdev), minor(stbuf.st_rdev));
+    if ((d && d->syspath) || !addNewDisks)
+        return;
+
+    d = _diskio_get(major(stbuf.st_rdev), minor(stbuf.st_rdev),
+                    basename, strlen(basename));
+    if (!d || !(d->syspath = strdup(syspath)) || _diskio_add(&disks, d)) {
+        config_perror("malloc failed for new disko allocation.");
+        netsnmp_config_error("\tignoring:  %s", path);
+        if (d)
+            SNMP_FREE(d->syspath);
+        return;
     }
+    d->excluded = 0;
 }
 
 static void
@@ -240,10 +437,44 @@ diskio_parse_config_disks(const char *token, char *cptr)
 #endif                      /* HAVE_FSTAB_H || HAVE_GETMNTENT || HAVE_STATFS */
 }
 
+#ifdef HAVE_REGEX_H
+static void
+diskio_parse_config_pattern(const char *token, char *cptr)
+{
+    char            pattern[STRMAX], buf[BUFSIZ];
+    diskio_pattern *p;
+    int             r;
+
+    copy_nword(cptr, pattern, sizeof(pattern));
+    if (!pattern[0]) {
+        config_perror("missing device name pattern");
+        return;
+    }
+    p = SNMP_MALLOC_TYPEDEF(diskio_pattern);
+    if (!p) {
+        config_perror("Out of memory");
+        return;
+    }
+    r = regcomp(&p->regex, pattern, REG_EXTENDED | REG_NOSUB);
+    if (r) {
+        regerror(r, &p->regex, buf, sizeof(buf));
+        config_perror(buf);
+        free(p);
+        return;
+    }
+    p->include = (strcmp(token, "diskio_include") == 0);
+    if (p->include)
+        diskio_includes++;
+    p->next = diskio_patterns;
+    diskio_patterns = p;
+}
+#endif                          /* HAVE_REGEX_H */
+
 void init_diskio_linux(void)
 {
     char *app = netsnmp_ds_get_string(NETSNMP_DS_LIBRARY_ID,
                                       NETSNMP_DS_LIB_APPTYPE);
+
     netsnmp_ds_register_config(ASN_BOOLEAN, app, "diskio_exclude_fd",
                                NETSNMP_DS_APPLICATION_ID,
                                NETSNMP_DS_AGENT_DISKIO_NO_FD);
@@ -253,68 +484,108 @@ void init_diskio_linux(void)
     netsnmp_ds_register_config(ASN_BOOLEAN, app, "diskio_exclude_ram",
                                NETSNMP_DS_APPLICATION_ID,
                                NETSNMP_DS_AGENT_DISKIO_NO_RAM);
+    netsnmp_ds_register_config(ASN_INTEGER, app, "diskio_max_open",
+                               NETSNMP_DS_APPLICATION_ID,
+                               NETSNMP_DS_AGENT_DISKIO_MAX_OPEN);
 
     snmpd_register_config_handler("diskio", diskio_parse_config_disks,
         diskio_free_config, "path | device");
-    
+#ifdef HAVE_REGEX_H
+    snmpd_register_config_handler("diskio_include",
+                                  diskio_parse_config_pattern, NULL,
+                                  "REGEX");
+    snmpd_register_config_handler("diskio_exclude",
+                                  diskio_parse_config_pattern, NULL,
+                                  "REGEX");
+#endif
 
     snmp_register_callback(SNMP_CALLBACK_APPLICATION,
 	                   SNMPD_CALLBACK_PRE_UPDATE_CONFIG,
 	                   diskio_pre_update_config, NULL);
+}
 
+/*
+ * Reads the sysfs stat file of a configured device.
+ */
+static ssize_t
+_diskio_sysfs_read(linux_diskio *d, char *buf, size_t len)
+{
+    ssize_t         n;
+    int             retried = 0, max_open;
+
+  again:
+    if (d->fd < 0) {
+        d->fd = open(d->syspath, O_RDONLY);
+        if (d->fd < 0)
+            return -1;
+        diskio_open++;
+    }
+    n = pread(d->fd, buf, len - 1, 0);
+    if (n < 0) {
+        /*
+         * the device may have been removed and created again: try a
+         * fresh descriptor once
+         */
+        _diskio_close(d);
+        if (retried++)
+            return -1;
+        goto again;
+    }
+    buf[n] = '\0';
+
+    max_open = netsnmp_ds_get_int(NETSNMP_DS_APPLICATION_ID,
+                                  NETSNMP_DS_AGENT_DISKIO_MAX_OPEN);
+    if (max_open <= 0)
+        max_open = DISKIO_MAX_OPEN;
+    if (diskio_open > max_open)
+        _diskio_close(d);
+    return n;
 }
 
 static int
 get_sysfs_stats(void)
 {
-    int             i;
+    int             i, n;
     char            buffer[1024];
+    const char     *cp;
+    unsigned long   v[11];
+    linux_diskio   *d;
 
     head.length = 0;
 
-    for (i = 0; i < numdisks; i++) {
-        FILE *f = fopen(disks[i].syspath, "r");
-
-        if (f == NULL) {
-            DEBUGMSGTL(("ucd-snmp/diskio", "Can't open %s, skipping",
-                        disks[i].syspath));
-            continue;
-        }
-
-        if (fgets(buffer, sizeof(buffer), f) == NULL) {
+    for (i = 0; i < disks.length; i++) {
+        d = disks.indices[i];
+        if (_diskio_sysfs_read(d, buffer, sizeof(buffer)) < 0) {
             DEBUGMSGTL(("ucd-snmp/diskio", "Can't read %s, skipping",
-                        disks[i].syspath));
-            fclose(f);
+                        d->syspath));
             continue;
         }
 
-        linux_diskio   *pTemp;
-        if (head.length == head.alloc) {
-            head.alloc += DISK_INCR;
-            head.indices = realloc(head.indices,
-                                   head.alloc * sizeof(linux_diskio));
+        cp = buffer;
+        n = _diskio_parse_stats(&cp, v, 11);
+        if (n < 4) {
+            DEBUGMSGTL(("ucd-snmp/diskio", "Can't parse %s, skipping",
+                        d->syspath));
+            continue;
         }
-        pTemp = &head.indices[head.length];
-        pTemp->major = disks[i].major;
-        pTemp->minor = disks[i].minor;
-        strlcpy(pTemp->name, disks[i].shortname, sizeof(pTemp->name) - 1);
-        if (sscanf (buffer,
-                    "%*[ \n\t]%lu%*[ \n\t]%lu%*[ \n\t]%lu%*[ \n\t]%lu%*[ \n\t]%lu%*[ \n\t]%lu%*[ \n\t]%lu%*[ \n\t]%lu%*[ \n\t]%lu%*[ \n\t]%lu%*[ \n\t]%lu\n",
-                    &pTemp->rio, &pTemp->rmerge, &pTemp->rsect, &pTemp->ruse,
-                    &pTemp->wio, &pTemp->wmerge, &pTemp->wsect, &pTemp->wuse,
-                    &pTemp->running, &pTemp->use, &pTemp->aveq) != 11)
-            sscanf(buffer,
-                   "%*[ \n\t]%lu%*[ \n\t]%lu%*[ \n\t]%lu%*[ \n\t]%lu\n",
-                   &pTemp->rio, &pTemp->rsect, &pTemp->wio, &pTemp->wsect);
-        head.length++;
-        fclose(f);
+        _diskio_set_stats(d, v, n);
+        _diskio_add(&head, d);
     }
     return 0;
 }
 
+/*
+ * Returns whether a device is left out of the table.  This is decided
+ * when a device is first seen, not on each load.
+ */
 static int
 is_excluded(const char *name)
 {
+#ifdef HAVE_REGEX_H
+    diskio_pattern *p;
+    int             included = !diskio_includes;
+#endif
+
     if (netsnmp_ds_get_boolean(NETSNMP_DS_APPLICATION_ID,
                                NETSNMP_DS_AGENT_DISKIO_NO_FD)
         && !(strncmp(name, "fd", 2)))
@@ -327,6 +598,17 @@ is_excluded(const char *name)
                                NETSNMP_DS_AGENT_DISKIO_NO_RAM)
         && !(strncmp(name, "ram", 3)))
         return 1;
+#ifdef HAVE_REGEX_H
+    for (p = diskio_patterns; p; p = p->next) {
+        if (regexec(&p->regex, name, 0, NULL, 0) != 0)
+            continue;
+        if (!p->include)
+            return 1;
+        included = 1;
+    }
+    if (!included)
+        return 1;
+#endif
     return 0;
 }
 
@@ -334,7 +616,10 @@ static int read_proc_partitions(void)
 {
     FILE           *parts;
     char            buffer[1024];
-    int             rc;
+    char            name[256];
+    int             rc, major, minor;
+    unsigned long   blocks, v[11];
+    linux_diskio   *d;
 
     /*
      * /proc/partitions was introduced before 2002. See also
@@ -352,30 +637,24 @@ static int read_proc_partitions(void)
     NETSNMP_IGNORE_RESULT(fgets(buffer, sizeof(buffer), parts));
 
     while (!feof(parts)) {
-        linux_diskio   *pTemp;
-
-        if (head.length == head.alloc) {
-            head.alloc += DISK_INCR;
-            head.indices = realloc(head.indices,
-                                   head.alloc * sizeof(linux_diskio));
-        }
-        pTemp = &head.indices[head.length];
-
         rc = fscanf(parts,
                     "%d %d %lu %255s %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu\n",
-                    &pTemp->major, &pTemp->minor, &pTemp->blocks,
-                    pTemp->name, &pTemp->rio, &pTemp->rmerge,
-                    &pTemp->rsect, &pTemp->ruse, &pTemp->wio,
-                    &pTemp->wmerge, &pTemp->wsect, &pTemp->wuse,
-                    &pTemp->running, &pTemp->use, &pTemp->aveq);
+                    &major, &minor, &blocks, name, &v[0], &v[1], &v[2],
+                    &v[3], &v[4], &v[5], &v[6], &v[7], &v[8], &v[9], &v[10]);
         if (rc != 15) {
             snmp_log(LOG_ERR,
                      "diskio.c: cannot find statistics in /proc/partitions\n");
             fclose(parts);
             return FALSE;
         }
-        if (!is_excluded(pTemp->name))
-            head.length++;
+        d = _diskio_get(major, minor, name, strlen(name));
+        if (!d)
+            continue;
+        d->blocks = blocks;
+        _diskio_set_stats(d, v, 11);
+        d->seen = diskio_loads;
+        if (!d->excluded)
+            _diskio_add(&head, d);
     }
 
     fclose(parts);
@@ -383,50 +662,58 @@ static int read_proc_partitions(void)
     return TRUE;
 }
 
+/*
+ * Parses /proc/diskstats in place, in one pass.
+ */
 static int read_proc_diskstats(void)
 {
-    FILE           *parts;
-    char            buffer[1024];
+    netsnmp_procfs_view parts;
+    const char     *cp, *name;
+    unsigned long   dev[2], v[11];
+    size_t          len;
+    int             n;
+    linux_diskio   *d;
 
     /*
      * /proc/diskstats was introduced by Linux kernel commit 3422161186a4
      * ("[PATCH] Aggregated disk statistics") # v2.6.12.
      */
-    parts = fopen("/proc/diskstats", "r");
-    if (!parts)
+    if (netsnmp_procfs_snapshot("/proc/diskstats", &parts) < 0)
         return FALSE;
 
-    while (fgets(buffer, sizeof(buffer), parts)) {
-        linux_diskio *pTemp;
-
-        if (head.length == head.alloc) {
-            head.alloc += DISK_INCR;
-            head.indices = realloc(head.indices,
-                                   head.alloc * sizeof(linux_diskio));
+    for (cp = parts.data; *cp; cp++) {
+        /* major minor name, then 4 (partitions of 2.6 kernels) or 11+ */
+        if (_diskio_parse_stats(&cp, dev, 2) != 2)
+            goto bad;
+        while (*cp == ' ' || *cp == '\t')
+            cp++;
+        name = cp;
+        while (*cp && !isspace((unsigned char) *cp))
+            cp++;
+        len = cp - name;
+        n = _diskio_parse_stats(&cp, v, 11);
+        if (len == 0 || (n != 4 && n < 11))
+            goto bad;
+
+        d = _diskio_get(dev[0], dev[1], name, len);
+        if (d) {
+            _diskio_set_stats(d, v, n);
+            d->seen = diskio_loads;
+            if (!d->excluded)
+                _diskio_add(&head, d);
         }
-        pTemp = &head.indices[head.length];
-        sscanf(buffer, "%d %d", &pTemp->major, &pTemp->minor);
-        if (sscanf(buffer,
-                   "%d %d %s %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu\n",
-                   &pTemp->major, &pTemp->minor, pTemp->name, &pTemp->rio,
-                   &pTemp->rmerge, &pTemp->rsect, &pTemp->ruse, &pTemp->wio,
-                   &pTemp->wmerge, &pTemp->wsect, &pTemp->wuse,
-                   &pTemp->running, &pTemp->use, &pTemp->aveq) != 14 &&
-            sscanf(buffer, "%d %d %s %lu %lu %lu %lu\n", &pTemp->major,
-                   &pTemp->minor, pTemp->name, &pTemp->rio,
-                   &pTemp->rsect, &pTemp->wio, &pTemp->wsect) != 7) {
-            fclose(parts);
-            snmp_log(LOG_ERR,
-                     "diskio.c: failed to parse /proc/diskstats\n");
-            return FALSE;
-        }
-        if (!is_excluded(pTemp->name))
-            head.length++;
-    }
 
-    fclose(parts);
+        cp = strchr(cp, '\n');
+        if (!cp)
+            break;
+    }
 
     return TRUE;
+
+  bad:
+    snmp_log(LOG_ERR, "diskio.c: failed to parse /proc/diskstats\n");
+    head.length = 0;
+    return FALSE;
 }
 
 static int
@@ -440,15 +727,9 @@ diskio_getstats(void)
         return 0;
     }
 
-    if (!head.indices) {
-        head.alloc = DISK_INCR;
-        head.indices = malloc(head.alloc * sizeof(linux_diskio));
-    }
     head.length = 0;
 
-    memset(head.indices, 0, head.alloc * sizeof(linux_diskio));
-
-    if (numdisks > 0) {
+    if (disks.length > 0) {
         /*
          * 'diskio' configuration is used - go through the whitelist only and
          * read /sys/dev/block/xxx
@@ -457,12 +738,16 @@ diskio_getstats(void)
         return get_sysfs_stats();
     }
     /* 'diskio' configuration is not used - report all devices */
+    diskio_loads++;
     if (read_proc_diskstats()) {
     } else if (stat("/proc/vz", &stbuf) == 0) {
         // OpenVZ / Virtuozzo containers do not have /proc/diskstats
     } else if (!read_proc_partitions()) {
         return 1;
     }
+    _diskio_prune();
+    DEBUGMSGTL(("ucd-snmp/diskio", "%d of %u devices reported\n",
+                head.length, diskio_count));
 
     diskio_set_cache_time(now);
     return 0;
@@ -474,6 +759,7 @@ devla_getstats(unsigned int regno, void *dummy)
 
     static double   expon1, expon5, expon15;
     double          busy_time, busy_percent;
+    linux_diskio   *d;
     int             idx;
 
     if (diskio_getstats() == 1) {
@@ -481,49 +767,34 @@ devla_getstats(unsigned int regno, void *dummy)
         return;
     }
 
-    if (!la_head.length) {
-        la_head.indices = malloc(head.length * sizeof(linux_diskio_la));
-        for (idx = 0; idx < head.length; idx++) {
-            la_head.indices[idx].la1 = la_head.indices[idx].la5 =
-                la_head.indices[idx].la15 = 0.;
-            la_head.indices[idx].use_prev = head.indices[idx].use;
-        }
-        la_head.length = head.length;
+    if (expon1 == 0.) {
         expon1 = exp(-(((double) DISKIO_SAMPLE_INTERVAL) / ((double) 60)));
         expon5 =
             exp(-(((double) DISKIO_SAMPLE_INTERVAL) / ((double) 300)));
         expon15 =
             exp(-(((double) DISKIO_SAMPLE_INTERVAL) / ((double) 900)));
-    } else if (head.length - la_head.length) {
-        la_head.indices = realloc(la_head.indices,
-                                  head.length * sizeof(linux_diskio_la));
-        for (idx = la_head.length; idx < head.length; idx++) {
-            la_head.indices[idx].la1 = la_head.indices[idx].la5 =
-                la_head.indices[idx].la15 = 0.;
-            la_head.indices[idx].use_prev = head.indices[idx].use;
-        }
-        la_head.length = head.length;
     }
 
     for (idx = 0; idx < head.length; idx++) {
-        busy_time = head.indices[idx].use - la_head.indices[idx].use_prev;
+        d = head.indices[idx];
+        if (!d->la_valid) {
+            /* a new device: start from zero */
+            d->la1 = d->la5 = d->la15 = 0.;
+            d->use_prev = d->use;
+            d->la_valid = 1;
+            continue;
+        }
+        busy_time = d->use - d->use_prev;
         busy_percent =
             busy_time * 100. / ((double) DISKIO_SAMPLE_INTERVAL) / 1000.;
-        la_head.indices[idx].la1 =
-            la_head.indices[idx].la1 * expon1 + busy_percent * (1. -
-                                                                expon1);
-        la_head.indices[idx].la5 =
-            la_head.indices[idx].la5 * expon5 + busy_percent * (1. -
-                                                                expon5);
-        la_head.indices[idx].la15 =
-            la_head.indices[idx].la15 * expon15 + busy_percent * (1. -
-                                                                  expon15);
+        d->la1 = d->la1 * expon1 + busy_percent * (1. - expon1);
+        d->la5 = d->la5 * expon5 + busy_percent * (1. - expon5);
+        d->la15 = d->la15 * expon15 + busy_percent * (1. - expon15);
         /*
          * fprintf(stderr, "(%d) update la1=%f la5=%f la15=%f\n",
-         * idx, la_head.indices[idx].la1, la_head.indices[idx].la5,
-         * la_head.indices[idx].la15);
+         * idx, d->la1, d->la5, d->la15);
          */
-        la_head.indices[idx].use_prev = head.indices[idx].use;
+        d->use_prev = d->use;
     }
 }
 
@@ -536,6 +807,7 @@ var_diskio(struct variable *vp,
     unsigned int    indx;
     static unsigned long long_ret;
     static struct counter64 c64_ret;
+    linux_diskio   *d;
 
     if (diskio_getstats() == 1) {
         return NULL;
@@ -550,58 +822,59 @@ var_diskio(struct variable *vp,
 
     if (indx >= head.length)
         return NULL;
+    d = head.indices[indx];
 
     switch (vp->magic) {
     case DISKIO_INDEX:
         long_ret = indx + 1;
         return (u_char *) & long_ret;
     case DISKIO_DEVICE:
-        *var_len = strlen(head.indices[indx].name);
-        return (u_char *) head.indices[indx].name;
+        *var_len = strlen(d->name);
+        return (u_char *) d->name;
     case DISKIO_NREAD:
-        long_ret = (head.indices[indx].rsect * 512) & 0xffffffff;
+        long_ret = (d->rsect * 512) & 0xffffffff;
         return (u_char *) & long_ret;
     case DISKIO_NWRITTEN:
-        long_ret = (head.indices[indx].wsect * 512) & 0xffffffff;
+        long_ret = (d->wsect * 512) & 0xffffffff;
         return (u_char *) & long_ret;
     case DISKIO_READS:
-        long_ret = head.indices[indx].rio & 0xffffffff;
+        long_ret = d->rio & 0xffffffff;
         return (u_char *) & long_ret;
     case DISKIO_WRITES:
-        long_ret = head.indices[indx].wio & 0xffffffff;
+        long_ret = d->wio & 0xffffffff;
         return (u_char *) & long_ret;
     case DISKIO_LA1:
-        if (la_head.length > indx)
-            long_ret = la_head.indices[indx].la1;
+        if (d->la_valid)
+            long_ret = d->la1;
         else
             long_ret = 0;       /* we don't have the load yet */
         return (u_char *) & long_ret;
     case DISKIO_LA5:
-        if (la_head.length > indx)
-            long_ret = la_head.indices[indx].la5;
+        if (d->la_valid)
+            long_ret = d->la5;
         else
             long_ret = 0;       /* we don't have the load yet */
         return (u_char *) & long_ret;
     case DISKIO_LA15:
-        if (la_head.length > indx)
-            long_ret = la_head.indices[indx].la15;
+        if (d->la_valid)
+            long_ret = d->la15;
         else
             long_ret = 0;
         return (u_char *) & long_ret;
     case DISKIO_BUSYTIME:
         *var_len = sizeof(struct counter64);
-        c64_ret.low = head.indices[indx].use * 1000 & 0xffffffff;
-        c64_ret.high = head.indices[indx].use * 1000 >> 32;
+        c64_ret.low = d->use * 1000 & 0xffffffff;
+        c64_ret.high = d->use * 1000 >> 32;
         return (u_char *) & c64_ret;
     case DISKIO_NREADX:
         *var_len = sizeof(struct counter64);
-        c64_ret.low = head.indices[indx].rsect * 512 & 0xffffffff;
-        c64_ret.high = head.indices[indx].rsect >> (32 - 9);
+        c64_ret.low = d->rsect * 512 & 0xffffffff;
+        c64_ret.high = d->rsect >> (32 - 9);
         return (u_char *) & c64_ret;
     case DISKIO_NWRITTENX:
         *var_len = sizeof(struct counter64);
-        c64_ret.low = head.indices[indx].wsect * 512 & 0xffffffff;
-        c64_ret.high = head.indices[indx].wsect >> (32 - 9);
+        c64_ret.low = d->wsect * 512 & 0xffffffff;
+        c64_ret.high = d->wsect >> (32 - 9);
         return (u_char *) & c64_ret;
     default:
         snmp_log(LOG_ERR, "don't know how to handle %d request\n",
@@ -1 +1,2 @@
+config_require(util_funcs/procfs_snapshot)
 void init_diskio_linux(void);
@@ -0,0 +1,397 @@
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+
+#include "ethtool_stats.h"
+
+#include <errno.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#else
+#include <strings.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+#ifdef HAVE_LINUX_ETHTOOL_H
+#include <linux/sockios.h>
+#ifdef HAVE_LINUX_ETHTOOL_NEEDS_U64
+#include <linux/types.h>
+typedef __u64 u64;
+typedef __u32 u32;
+typedef __u16 u16;
+typedef __u8 u8;
+#endif
+#include <linux/ethtool.h>
+#else
+#define ETH_GSTRING_LEN 32
+#endif
+
+struct netsnmp_ethtool_driver_s {
+    struct netsnmp_ethtool_driver_s *next;
+    char           *name;
+    u_int           n_stats;
+    char           *strings;    /* n_stats names of ETH_GSTRING_LEN bytes */
+    int             ports;      /* using it after the last collection */
+    u_int           mapped;     /* bit per consumer */
+    netsnmp_ethtool_stat *map[NETSNMP_ETHTOOL_STATS_CONSUMERS];
+    size_t          map_len[NETSNMP_ETHTOOL_STATS_CONSUMERS];
+};
+
+static const netsnmp_ethtool_name *consumers[NETSNMP_ETHTOOL_STATS_CONSUMERS];
+static netsnmp_ethtool_driver *drivers = NULL;
+
+/**
+ * Registers the name list of a module and returns the number to pass
+ * to netsnmp_ethtool_stats_map().  Registering the same list again
+ * returns the same number.
+ *
+ * @retval >= 0 ok, -1 too many modules
+ */
+int
+netsnmp_ethtool_stats_consumer(const netsnmp_ethtool_name *names)
+{
+    int             i;
+
+    for (i = 0; i < NETSNMP_ETHTOOL_STATS_CONSUMERS; i++) {
+        if (consumers[i] == names)
+            return i;
+        if (consumers[i] == NULL) {
+            consumers[i] = names;
+            return i;
+        }
+    }
+    snmp_log(LOG_ERR, "ethtool_stats: too many consumers\n");
+    return -1;
+}
+
+static void
+_driver_free(netsnmp_ethtool_driver *d)
+{
+    int             i;
+
+    for (i = 0; i < NETSNMP_ETHTOOL_STATS_CONSUMERS; i++)
+        free(d->map[i]);
+    free(d->strings);
+    free(d->name);
+    free(d);
+}
+
+/**
+ * Returns the record of a driver with n_stats statistics.  If there is
+ * none yet, it is created from strings, the names of the statistics as
+ * returned by ETHTOOL_GSTRINGS; with strings NULL, only existing
+ * records are looked up.
+ *
+ * Drivers are told apart by name and number of statistics, so ports
+ * of the same driver with e.g. a different number of queues each get
+ * their own record.
+ */
+netsnmp_ethtool_driver *
+netsnmp_ethtool_stats_driver(const char *name, u_int n_stats,
+                             const char *strings)
+{
+    netsnmp_ethtool_driver *d;
+
+    for (d = drivers; d; d = d->next)
+        if (d->n_stats == n_stats && strcmp(d->name, name) == 0)
+            return d;
+    if (NULL == strings)
+        return NULL;
+
+    d = SNMP_MALLOC_TYPEDEF(netsnmp_ethtool_driver);
+    if (NULL == d)
+        return NULL;
+    d->name = strdup(name);
+    d->strings = (char *) malloc(n_stats * ETH_GSTRING_LEN + 1);
+    if (NULL == d->name || NULL == d->strings) {
+        _driver_free(d);
+        return NULL;
+    }
+    memcpy(d->strings, strings, n_stats * ETH_GSTRING_LEN);
+    d->n_stats = n_stats;
+    d->next = drivers;
+    drivers = d;
+    DEBUGMSGTL(("ethtool_stats", "driver %s: %u statistics\n", name,
+                n_stats));
+    return d;
+}
+
+/**
+ * Returns the statistics of a driver that map to columns of a module,
+ * in the order of the driver's statistics.  The names are matched once
+ * per driver and module; the result stays valid as long as the driver.
+ */
+const netsnmp_ethtool_stat *
+netsnmp_ethtool_stats_map(netsnmp_ethtool_driver *d, int consumer,
+                          size_t *len)
+{
+    const netsnmp_ethtool_name *n;
+    netsnmp_ethtool_stat *map;
+    char            s[ETH_GSTRING_LEN + 1];
+    u_int           i, columns;
+    size_t          count;
+
+    *len = 0;
+    if (NULL == d || consumer < 0 ||
+        consumer >= NETSNMP_ETHTOOL_STATS_CONSUMERS ||
+        NULL == consumers[consumer])
+        return NULL;
+
+    if (!(d->mapped & (1 << consumer))) {
+        map = NULL;
+        count = 0;
+        for (i = 0; i < d->n_stats; i++) {
+            memcpy(s, d->strings + i * ETH_GSTRING_LEN, ETH_GSTRING_LEN);
+            s[ETH_GSTRING_LEN] = '\0';
+            columns = 0;
+            for (n = consumers[consumer]; n->name; n++)
+                if (n->substring ? strstr(s, n->name) != NULL
+                                 : strcmp(s, n->name) == 0)
+                    columns |= n->columns;
+            if (!columns)
+                continue;
+            if (NULL == map) {
+                /* at most the remaining statistics can match */
+                map = (netsnmp_ethtool_stat *)
+                    malloc((d->n_stats - i) * sizeof(*map));
+                if (NULL == map)
+                    return NULL;
+            }
+            map[count].index = i;
+            map[count].columns = columns;
+            count++;
+        }
+        d->map[consumer] = map;
+        d->map_len[consumer] = count;
+        d->mapped |= 1 << consumer;
+        DEBUGMSGTL(("ethtool_stats", "driver %s: %d of %u statistics"
+                    " mapped for consumer %d\n", d->name, (int) count,
+                    d->n_stats, consumer));
+    }
+
+    *len = d->map_len[consumer];
+    return d->map[consumer];
+}
+
+#ifdef HAVE_LINUX_ETHTOOL_H
+/*
+ * A port keeps its buffer for ETHTOOL_GSTATS between collections; the
+ * values handed out point into it.
+ */
+typedef struct ethtool_port_s {
+    netsnmp_ethtool_port port;
+    void           *buf;
+    u_int           size;       /* number of values buf can hold */
+    int             seen;
+} ethtool_port;
+
+static netsnmp_ethtool_port *ports = NULL;
+static struct timeval collected_at;     /* monotonic */
+static int      collected = 0;
+static int      ethtool_fd = -1;
+static u_int    ethtool_ioctls;
+
+static int
+_ethtool(const char *name, void *data)
+{
+    struct ifreq    ifr;
+
+    memset(&ifr, 0, sizeof(ifr));
+    strlcpy(ifr.ifr_name, name, sizeof(ifr.ifr_name));
+    ifr.ifr_data = (char *) data;
+    ethtool_ioctls++;
+    return ioctl(ethtool_fd, SIOCETHTOOL, &ifr);
+}
+
+static ethtool_port *
+_port_find(int ifindex)
+{
+    netsnmp_ethtool_port *p;
+
+    for (p = ports; p; p = p->next)
+        if (p->ifindex == ifindex)
+            return (ethtool_port *) p;
+    return NULL;
+}
+
+/*
+ * Fetches the names of the statistics of an interface, unless its
+ * driver is known already.
+ */
+static netsnmp_ethtool_driver *
+_port_driver(const char *name, const struct ethtool_drvinfo *info)
+{
+    netsnmp_ethtool_driver *d;
+    struct ethtool_gstrings *strings;
+
+    d = netsnmp_ethtool_stats_driver(info->driver, info->n_stats, NULL);
+    if (d)
+        return d;
+
+    strings = (struct ethtool_gstrings *)
+        calloc(1, sizeof(*strings) + info->n_stats * ETH_GSTRING_LEN);
+    if (NULL == strings)
+        return NULL;
+    strings->cmd = ETHTOOL_GSTRINGS;
+    strings->string_set = ETH_SS_STATS;
+    strings->len = info->n_stats;
+    if (_ethtool(name, strings) < 0 || strings->len != info->n_stats) {
+        DEBUGMSGTL(("ethtool_stats", "%s: no statistics names\n", name));
+        free(strings);
+        return NULL;
+    }
+    d = netsnmp_ethtool_stats_driver(info->driver, info->n_stats,
+                                     (const char *) strings->data);
+    free(strings);
+    return d;
+}
+
+/*
+ * Collects the statistics of one interface into its port record,
+ * which is created if needed.
+ */
+static void
+_port_collect(int ifindex, const char *name)
+{
+    struct ethtool_drvinfo info;
+    struct ethtool_stats *stats;
+    netsnmp_ethtool_driver *d;
+    ethtool_port   *p;
+
+    memset(&info, 0, sizeof(info));
+    info.cmd = ETHTOOL_GDRVINFO;
+    if (_ethtool(name, &info) < 0 || info.n_stats < 1)
+        return;
+
+    d = _port_driver(name, &info);
+    if (NULL == d)
+        return;
+
+    p = _port_find(ifindex);
+    if (NULL == p) {
+        p = SNMP_MALLOC_TYPEDEF(ethtool_port);
+        if (NULL == p)
+            return;
+        p->port.ifindex = ifindex;
+        p->port.next = ports;
+        ports = &p->port;
+    }
+    if (p->size < info.n_stats) {
+        free(p->buf);
+        p->buf = malloc(sizeof(*stats) + info.n_stats * sizeof(uint64_t));
+        p->size = p->buf ? info.n_stats : 0;
+        if (NULL == p->buf)
+            return;
+    }
+    strlcpy(p->port.name, name, sizeof(p->port.name));
+
+    stats = (struct ethtool_stats *) p->buf;
+    stats->cmd = ETHTOOL_GSTATS;
+    stats->n_stats = info.n_stats;
+    if (_ethtool(name, stats) < 0 || stats->n_stats != info.n_stats) {
+        DEBUGMSGTL(("ethtool_stats", "%s: no statistics\n", name));
+        return;
+    }
+
+    p->port.driver = d;
+    p->port.n_values = info.n_stats;
+    p->port.values = (const uint64_t *) stats->data;
+    p->seen = 1;
+    d->ports++;
+}
+
+/**
+ * Returns the interfaces that have ethtool statistics, with their
+ * current values.
+ *
+ * The statistics of all interfaces are collected in one pass, which
+ * costs an ETHTOOL_GDRVINFO and an ETHTOOL_GSTATS ioctl per interface;
+ * the names are only fetched for drivers that were not seen before.
+ * A pass less than NETSNMP_ETHTOOL_STATS_AGE milliseconds old is
+ * returned as it is.
+ */
+netsnmp_ethtool_port *
+netsnmp_ethtool_stats_ports(void)
+{
+    struct if_nameindex *ifs, *ifp;
+    netsnmp_ethtool_port **prev, *p;
+    netsnmp_ethtool_driver **dprev, *d;
+    struct timeval  now;
+    long            age;
+    int             count = 0;
+
+    netsnmp_get_monotonic_clock(&now);
+    age = (now.tv_sec - collected_at.tv_sec) * 1000 +
+          (now.tv_usec - collected_at.tv_usec) / 1000;
+    if (collected && age >= 0 && age < NETSNMP_ETHTOOL_STATS_AGE) {
+        DEBUGMSGTL(("ethtool_stats", "reusing statistics (%ld ms old)\n",
+                    age));
+        return ports;
+    }
+
+    if (ethtool_fd < 0) {
+        ethtool_fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (ethtool_fd < 0) {
+            snmp_log(LOG_ERR, "ethtool_stats: could not create socket\n");
+            return NULL;
+        }
+    }
+    ifs = if_nameindex();
+    if (NULL == ifs) {
+        snmp_log(LOG_ERR, "ethtool_stats: if_nameindex failed (%d)\n",
+                 errno);
+        return NULL;
+    }
+
+    for (p = ports; p; p = p->next)
+        ((ethtool_port *) p)->seen = 0;
+    for (d = drivers; d; d = d->next)
+        d->ports = 0;
+    ethtool_ioctls = 0;
+
+    for (ifp = ifs; ifp->if_index != 0; ifp++)
+        _port_collect(ifp->if_index, ifp->if_name);
+    if_freenameindex(ifs);
+
+    /*
+     * drop the interfaces that went away or lost their statistics, and
+     * the drivers no interface uses any more
+     */
+    for (prev = &ports; (p = *prev) != NULL;) {
+        if (((ethtool_port *) p)->seen) {
+            prev = &p->next;
+            count++;
+            continue;
+        }
+        *prev = p->next;
+        free(((ethtool_port *) p)->buf);
+        free(p);
+    }
+    for (dprev = &drivers; (d = *dprev) != NULL;) {
+        if (d->ports) {
+            dprev = &d->next;
+            continue;
+        }
+        *dprev = d->next;
+        _driver_free(d);
+    }
+
+    collected = 1;
+    collected_at = now;
+    DEBUGMSGTL(("ethtool_stats", "collected %d interfaces with %u ioctls\n",
+                count, ethtool_ioctls));
+    return ports;
+}
+#else /* HAVE_LINUX_ETHTOOL_H */
+netsnmp_ethtool_port *
+netsnmp_ethtool_stats_ports(void)
+{
+    return NULL;
+}
+#endif /* HAVE_LINUX_ETHTOOL_H */
@@ -0,0 +1,70 @@
+/*
+ * util_funcs/ethtool_stats.h:  the ethtool statistics of all network
+ * interfaces, collected at most once per request for the etherlike-mib
+ * and rmon-mib data access modules.
+ */
+#ifndef NETSNMP_MIBGROUP_UTIL_FUNCS_ETHTOOL_STATS_H
+#define NETSNMP_MIBGROUP_UTIL_FUNCS_ETHTOOL_STATS_H
+
+#ifndef linux
+config_error(ethtool_stats is only suppored on linux)
+#endif
+
+#include <net/if.h>
+
+/*
+ * Statistics asked for again within this many milliseconds, e.g. by
+ * another table answering the same request, are not collected again.
+ */
+#define NETSNMP_ETHTOOL_STATS_AGE       100
+
+/* the number of modules that can map statistics to their columns */
+#define NETSNMP_ETHTOOL_STATS_CONSUMERS 4
+
+/*
+ * How a module maps the statistic names of the drivers to its columns:
+ * a statistic whose name matches adds to all of columns, which are the
+ * module's own flags.  A list ends with a NULL name.
+ */
+typedef struct netsnmp_ethtool_name_s {
+    const char     *name;
+    int             substring;  /* match anywhere in the statistic name */
+    u_int           columns;
+} netsnmp_ethtool_name;
+
+/* one statistic of a driver that is mapped to columns */
+typedef struct netsnmp_ethtool_stat_s {
+    u_int           index;      /* into the values of a port */
+    u_int           columns;
+} netsnmp_ethtool_stat;
+
+/*
+ * The statistic names of a driver, fetched once per driver and number
+ * of statistics and shared by all its ports.
+ */
+typedef struct netsnmp_ethtool_driver_s netsnmp_ethtool_driver;
+
+/*
+ * An interface with ethtool statistics.  The list and the values belong
+ * to the collector and stay valid until the next collection.
+ */
+typedef struct netsnmp_ethtool_port_s {
+    struct netsnmp_ethtool_port_s *next;
+    char            name[IF_NAMESIZE];
+    int             ifindex;
+    netsnmp_ethtool_driver *driver;
+    u_int           n_values;
+    const uint64_t *values;
+} netsnmp_ethtool_port;
+
+int             netsnmp_ethtool_stats_consumer(const netsnmp_ethtool_name
+                                               *names);
+netsnmp_ethtool_port *netsnmp_ethtool_stats_ports(void);
+netsnmp_ethtool_driver *netsnmp_ethtool_stats_driver(const char *name,
+                                                     u_int n_stats,
+                                                     const char *strings);
+const netsnmp_ethtool_stat *netsnmp_ethtool_stats_map(netsnmp_ethtool_driver
+                                                      *driver, int consumer,
+                                                      size_t *len);
+
+#endif /* NETSNMP_MIBGROUP_UTIL_FUNCS_ETHTOOL_STATS_H */
@@ -21,6 +21,9 @@
 #ifdef HAVE_LIMITS_H
 #include <limits.h>
 #endif
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_PTHREAD_CREATE)
+#include <pthread.h>
+#endif
 
 # define PROC_PATH          "/proc"
 # define SOCKET_TYPE_1      "socket:["
@@ -36,7 +39,46 @@ typedef struct {
 #define INODE_PID_TABLE_MAX_COLLISIONS 1000
 #define INODE_PID_TABLE_LENGTH 20000
 #define INODE_PID_TABLE_SIZE (INODE_PID_TABLE_LENGTH * sizeof (inode_pid_ent_t))
-static inode_pid_ent_t  inode_pid_table[INODE_PID_TABLE_LENGTH];
+
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_PTHREAD_CREATE)
+/*
+ * Each thread has a table of its own, as the tables are also loaded by
+ * the cache loader thread (see netsnmp_cache_set_background()).
+ */
+static pthread_key_t    inode_pid_key;
+static pthread_once_t   inode_pid_once = PTHREAD_ONCE_INIT;
+
+static void
+_key_create(void)
+{
+    pthread_key_create(&inode_pid_key, free);
+}
+
+static inode_pid_ent_t *
+_table(void)
+{
+    inode_pid_ent_t *table;
+
+    pthread_once(&inode_pid_once, _key_create);
+    table = (inode_pid_ent_t *) pthread_getspecific(inode_pid_key);
+    if (NULL == table) {
+        table = (inode_pid_ent_t *) calloc(1, INODE_PID_TABLE_SIZE);
+        if (NULL != table && pthread_setspecific(inode_pid_key, table)) {
+            free(table);
+            table = NULL;
+        }
+    }
+    return table;
+}
+#else
+static inode_pid_ent_t  inode_pid_table_static[INODE_PID_TABLE_LENGTH];
+
+static inode_pid_ent_t *
+_table(void)
+{
+    return inode_pid_table_static;
+}
+#endif
 
 static uint32_t
 _hash(uint64_t key)
@@ -51,14 +93,14 @@ _hash(uint64_t key)
 }
 
 static void
-_clear(void)
+_clear(inode_pid_ent_t *inode_pid_table)
 {
     /* Clear the inode/pid hash table.*/
     memset(inode_pid_table, 0, INODE_PID_TABLE_SIZE);
 }
 
 static void
-_set(ino64_t inode, pid_t pid)
+_set(inode_pid_ent_t *inode_pid_table, ino64_t inode, pid_t pid)
 {
     uint32_t        hash = _hash(inode);
     uint32_t        i;
@@ -81,7 +123,7 @@ _set(ino64_t inode, pid_t pid)
     /* the _get function will return a zero pid.*/
 }
 
-static pid_t _get(ino64_t inode)
+static pid_t _get(inode_pid_ent_t *inode_pid_table, ino64_t inode)
 {
     uint32_t        hash = _hash(inode);
     uint32_t        i;
@@ -113,8 +155,11 @@ netsnmp_get_pid_from_inode_init(void)
     struct dirent  *procinfo, *pidinfo;
     pid_t           pid = 0;
     ino64_t         temp_inode;
+    inode_pid_ent_t *table = _table();
 
-    _clear();
+    if (NULL == table)
+        return;
+    _clear(table);
 
     /* walk over all directories in /proc*/
     if (!(procdirs = opendir(PROC_PATH))) {
@@ -174,7 +219,7 @@ netsnmp_get_pid_from_inode_init(void)
             /* Add the inode/pid combination to our hash table.*/
             if (temp_inode != 0) {
                 pid = strtoul(procinfo->d_name, NULL, 0);
-                _set(temp_inode, pid);
+                _set(table, temp_inode, pid);
             }
         }
         closedir(piddirs);
@@ -186,6 +231,8 @@ netsnmp_get_pid_from_inode_init(void)
 pid_t
 netsnmp_get_pid_from_inode(ino64_t inode)
 {
-    return _get(inode);
+    inode_pid_ent_t *table = _table();
+
+    return table ? _get(table, inode) : 0;
 }
 
@@ -0,0 +1,246 @@
+#include <net-snmp/net-snmp-config.h>
+
+#include "procfs_snapshot.h"
+
+#include <net-snmp/net-snmp-includes.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#else
+#include <strings.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+/*
+ * One record per file asked for.  The file is kept open and re-read
+ * with pread() into the same buffer; only the first PROCFS_MAX_OPEN
+ * files stay open, any others are opened for each read.
+ */
+typedef struct procfs_file_s {
+    struct procfs_file_s *next;
+    char           *path;
+    int             fd;
+    char           *buf;
+    size_t          size;
+    size_t          len;
+    struct timeval  read_at;    /* monotonic */
+    int             valid;
+} procfs_file;
+
+#define PROCFS_MAX_OPEN     32
+#define PROCFS_INIT_SIZE    4096
+
+static procfs_file *procfs_files = NULL;
+static int          procfs_open = 0;
+
+static procfs_file *
+_find(const char *path)
+{
+    procfs_file    *f;
+
+    for (f = procfs_files; f; f = f->next)
+        if (strcmp(f->path, path) == 0)
+            return f;
+
+    f = SNMP_MALLOC_TYPEDEF(procfs_file);
+    if (NULL == f)
+        return NULL;
+    f->path = strdup(path);
+    if (NULL == f->path) {
+        free(f);
+        return NULL;
+    }
+    f->fd = -1;
+    f->next = procfs_files;
+    procfs_files = f;
+    return f;
+}
+
+static void
+_close(procfs_file *f)
+{
+    if (f->fd < 0)
+        return;
+    close(f->fd);
+    f->fd = -1;
+    procfs_open--;
+}
+
+/*
+ * Reads the whole file into f->buf.
+ *
+ * @retval 0 ok, -1 error (errno set)
+ */
+static int
+_read(procfs_file *f)
+{
+    ssize_t         n;
+    char           *b;
+    int             retried = 0;
+
+  again:
+    if (f->fd < 0) {
+        f->fd = open(f->path, O_RDONLY);
+        if (f->fd < 0)
+            return -1;
+        procfs_open++;
+    }
+
+    f->len = 0;
+    for (;;) {
+        if (f->len + 1 >= f->size) {
+            size_t size = f->size ? f->size * 2 : PROCFS_INIT_SIZE;
+            b = (char *) realloc(f->buf, size);
+            if (NULL == b) {
+                errno = ENOMEM;
+                return -1;
+            }
+            f->buf = b;
+            f->size = size;
+            DEBUGMSGTL(("procfs", "%s: buffer increased to %d\n", f->path,
+                        (int) size));
+        }
+        n = pread(f->fd, f->buf + f->len, f->size - f->len - 1, f->len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            /*
+             * the entry may have been removed and recreated (e.g. the
+             * file of an interface): try a fresh descriptor once
+             */
+            _close(f);
+            if (retried++)
+                return -1;
+            goto again;
+        }
+        if (n == 0)
+            break;
+        f->len += n;
+    }
+    f->buf[f->len] = '\0';
+
+    if (procfs_open > PROCFS_MAX_OPEN)
+        _close(f);
+    return 0;
+}
+
+/**
+ * Returns a view of the contents of a /proc file.
+ *
+ * The file is only read if the last snapshot of it is older than
+ * NETSNMP_PROCFS_SNAPSHOT_AGE milliseconds.
+ *
+ * @retval 0 ok, -1 the file could not be read (errno set)
+ */
+int
+netsnmp_procfs_snapshot(const char *path, netsnmp_procfs_view *view)
+{
+    procfs_file    *f;
+    struct timeval  now;
+    long            age;
+
+    f = _find(path);
+    if (NULL == f) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    netsnmp_get_monotonic_clock(&now);
+    age = (now.tv_sec - f->read_at.tv_sec) * 1000 +
+          (now.tv_usec - f->read_at.tv_usec) / 1000;
+    if (f->valid && age >= 0 && age < NETSNMP_PROCFS_SNAPSHOT_AGE) {
+        DEBUGMSGTL(("procfs", "%s: reusing snapshot (%ld ms old)\n",
+                    path, age));
+    } else {
+        f->valid = 0;
+        if (_read(f) < 0) {
+            int saved_errno = errno;
+
+            DEBUGMSGTL(("procfs", "%s: read failed (%d)\n", path, errno));
+            netsnmp_procfs_forget(path);
+            errno = saved_errno;
+            return -1;
+        }
+        f->valid = 1;
+        f->read_at = now;
+        DEBUGMSGTL(("procfs", "%s: read %d bytes\n", path, (int) f->len));
+    }
+
+    view->data = f->buf;
+    view->len = f->len;
+    view->pos = f->buf;
+    return 0;
+}
+
+/**
+ * Returns the start of the first line beginning with prefix, or NULL.
+ */
+const char *
+netsnmp_procfs_find_line(const netsnmp_procfs_view *view, const char *prefix)
+{
+    const char     *cp = view->data;
+    size_t          len = strlen(prefix);
+
+    while (cp) {
+        if (strncmp(cp, prefix, len) == 0)
+            return cp;
+        cp = strchr(cp, '\n');
+        if (cp)
+            cp++;
+    }
+    return NULL;
+}
+
+/**
+ * Returns the next line of a view and its length, without the newline,
+ * in *len.  The line is not copied: it points into the snapshot and is
+ * not NUL terminated, so parsers must stay within len.
+ *
+ * @retval the start of the line, or NULL at the end of the data
+ */
+const char *
+netsnmp_procfs_getline(netsnmp_procfs_view *view, size_t *len)
+{
+    const char     *line = view->pos, *end;
+
+    if (!line || !*line)
+        return NULL;
+
+    end = memchr(line, '\n', view->data + view->len - line);
+    if (end) {
+        *len = end - line;
+        view->pos = end + 1;
+    } else {
+        *len = view->data + view->len - line;
+        view->pos = line + *len;
+    }
+    return line;
+}
+
+/**
+ * Drops the snapshot of a file and closes it, for files which are only
+ * read once in a while or may go away (e.g. per interface files).
+ */
+void
+netsnmp_procfs_forget(const char *path)
+{
+    procfs_file    *f, **prev;
+
+    for (prev = &procfs_files; (f = *prev) != NULL; prev = &f->next) {
+        if (strcmp(f->path, path) == 0) {
+            *prev = f->next;
+            _close(f);
+            free(f->buf);
+            free(f->path);
+            free(f);
+            return;
+        }
+    }
+}
@@ -0,0 +1,39 @@
+/*
+ * util_funcs/procfs_snapshot.h:  shared snapshots of linux /proc files,
+ * read at most once per request by the data access modules.
+ */
+#ifndef NETSNMP_MIBGROUP_UTIL_FUNCS_PROCFS_SNAPSHOT_H
+#define NETSNMP_MIBGROUP_UTIL_FUNCS_PROCFS_SNAPSHOT_H
+
+#ifndef linux
+config_error(procfs_snapshot is only suppored on linux)
+#endif
+
+#include <sys/types.h>
+
+/*
+ * A file asked for again within this many milliseconds, e.g. by another
+ * module answering the same request, is not read again.
+ */
+#define NETSNMP_PROCFS_SNAPSHOT_AGE     100
+
+/*
+ * A read-only view of the contents of a file.  The data belongs to the
+ * snapshot and stays valid until the next netsnmp_procfs_snapshot() call
+ * for the same file.
+ */
+typedef struct netsnmp_procfs_view_s {
+    const char     *data;       /* NUL terminated */
+    size_t          len;
+    const char     *pos;        /* next line for netsnmp_procfs_getline() */
+} netsnmp_procfs_view;
+
+int             netsnmp_procfs_snapshot(const char *path,
+                                        netsnmp_procfs_view *view);
+const char     *netsnmp_procfs_find_line(const netsnmp_procfs_view *view,
+                                         const char *prefix);
+const char     *netsnmp_procfs_getline(netsnmp_procfs_view *view,
+                                       size_t *len);
+void            netsnmp_procfs_forget(const char *path);
+
+#endif /* NETSNMP_MIBGROUP_UTIL_FUNCS_PROCFS_SNAPSHOT_H */
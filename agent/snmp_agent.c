@@ -82,6 +82,7 @@ SOFTWARE.
 #include <net-snmp/net-snmp-includes.h>
 #include <net-snmp/agent/net-snmp-agent-includes.h>
 #include <net-snmp/agent/agent_callbacks.h>
+#include <net-snmp/agent/agent_workers.h>
 #include <net-snmp/library/large_fd_set.h>
 #include <net-snmp/library/snmp_assert.h>
 #include "agent_global_vars.h"
@@ -1397,32 +1398,102 @@ netsnmp_deregister_agent_nsap(int handle)
     }
 }
 
+/*
+ * Returns the transport of the agent NSAP with the lowest handle above
+ * *handle, and stores that handle in *handle.  Start with *handle set to 0
+ * to walk all of them.
+ */
+netsnmp_transport *
+netsnmp_agent_nsap_next(int *handle)
+{
+    agent_nsap     *a;
+
+    for (a = agent_nsap_list; a != NULL; a = a->next) {
+        if (a->handle > *handle) {
+            *handle = a->handle;
+            return a->t;
+        }
+    }
+    return NULL;
+}
+
+static int
+_agent_transport_is_udp(const netsnmp_transport *t)
+{
+    if (t->domain == netsnmpUDPDomain)
+        return 1;
+#ifdef NETSNMP_TRANSPORT_UDPIPV6_DOMAIN
+    if (t->domain == netsnmp_UDPIPv6Domain)
+        return 1;
+#endif
+    return 0;
+}
+
 int
 netsnmp_agent_listen_on(const char *port)
 {
     netsnmp_transport *transport;
-    int                handle;
+    int                handle, sockets = 1, reuseport = 0, i;
 
     if (NULL == port)
         return -1;
 
+    /*
+     * With "agentaddressSockets N", every UDP address gets N sockets bound
+     * with SO_REUSEPORT, so that the kernel spreads incoming requests over
+     * N receive queues instead of dropping them when one queue is full.
+     */
+    sockets = netsnmp_ds_get_int(NETSNMP_DS_APPLICATION_ID,
+                                 NETSNMP_DS_AGENT_UDP_SOCKETS);
+    if (sockets > 1) {
+        reuseport = netsnmp_ds_get_int(NETSNMP_DS_LIBRARY_ID,
+                                       NETSNMP_DS_LIB_UDP_REUSEPORT);
+        netsnmp_ds_set_int(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_UDP_REUSEPORT, 1);
+    }
+
     transport = netsnmp_transport_open_server("snmp", port);
     if (transport == NULL) {
         snmp_log(LOG_ERR, "Error opening specified endpoint \"%s\"\n", port);
-        return -1;
+        handle = -1;
+        goto out;
     }
 
     handle = netsnmp_register_agent_nsap(transport);
     if (handle < 0) {
         snmp_log(LOG_ERR, "Error registering specified transport \"%s\" as an "
                  "agent NSAP\n", port);
-        return -1;
+        handle = -1;
+        goto out;
     } else {
         DEBUGMSGTL(("snmp_agent",
                     "init_master_agent; \"%s\" registered as an agent NSAP\n",
                     port));
     }
 
+    if (sockets <= 1 || !_agent_transport_is_udp(transport))
+        goto out;
+
+    for (i = 1; i < sockets; i++) {
+        transport = netsnmp_transport_open_server("snmp", port);
+        if (transport == NULL) {
+            snmp_log(LOG_WARNING, "Could only open %d sockets on \"%s\"\n",
+                     i, port);
+            break;
+        }
+        if (netsnmp_register_agent_nsap(transport) < 0) {
+            snmp_log(LOG_WARNING, "Could only register %d sockets on "
+                     "\"%s\"\n", i, port);
+            break;
+        }
+    }
+    DEBUGMSGTL(("snmp_agent", "init_master_agent; %d sockets on \"%s\"\n",
+                i, port));
+
+  out:
+    if (sockets > 1)
+        netsnmp_ds_set_int(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_UDP_REUSEPORT, reuseport);
     return handle;
 }
 
@@ -1556,6 +1627,7 @@ clear_nsap_list(void)
 void
 shutdown_master_agent(void)
 {
+    netsnmp_agent_workers_shutdown();
     clear_nsap_list();
 
 #ifndef NETSNMP_NO_PDU_STATS
@@ -1614,6 +1686,7 @@ free_agent_snmp_session(netsnmp_agent_session *asp)
     DEBUGMSGTL(("snmp_agent","agent_session %8p released\n", asp));
 
     netsnmp_remove_from_delegated(asp);
+    netsnmp_agent_workers_forget(asp);
     
     DEBUGMSGTL(("verbose:asp", "asp %p reqinfo %p freed\n",
                 asp, asp->reqinfo));
@@ -2527,59 +2600,58 @@ check_acm(netsnmp_agent_session *asp, u_char type)
     int             i, j, k;
     netsnmp_request_info *request;
     int             ret = 0;
-    netsnmp_variable_list *vb, *vb2, *vbc;
-    int             earliest = 0;
+    netsnmp_variable_list *vb, *vb2;
 
     for (i = 0; i <= asp->treecache_num; i++) {
         for (request = asp->treecache[i].requests_begin;
              request; request = request->next) {
             /*
-             * for each request, run it through in_a_view() 
+             * for each request, run it through in_a_view().  For GETBULK
+             * the results so far run from requestvb_start up to
+             * requestvb, which handlers that can do bulk may have moved
+             * along several repetitions.
              */
-            earliest = 0;
-            for(j = request->repeat, vb = request->requestvb_start;
-                vb && j > -1;
-                j--, vb = vb->next_variable) {
-                if (vb->type != ASN_NULL &&
-                    vb->type != ASN_PRIV_RETRY) { /* not yet processed */
-                    view =
-                        in_a_view(vb->name, &vb->name_length,
-                                  asp->pdu, vb->type);
+            for (j = request->repeat, k = 0, vb = request->requestvb_start;
+                 vb && vb != request->requestvb && k < request->orig_repeat;
+                 k++, vb = vb->next_variable)
+                j++;
+            for (vb = request->requestvb_start;
+                 vb && j > -1;
+                 j--, vb = vb->next_variable) {
+                if (vb->type == ASN_NULL ||
+                    vb->type == ASN_PRIV_RETRY) /* not yet processed */
+                    continue;
+                view = in_a_view(vb->name, &vb->name_length,
+                                 asp->pdu, vb->type);
+                if (view == VACM_SUCCESS)
+                    continue;
 
+                /*
+                 * if a ACM error occurs, mark it as type passed in 
+                 */
+                ret++;
+                if (request->repeat < request->orig_repeat) {
                     /*
-                     * if a ACM error occurs, mark it as type passed in 
+                     * basically this means a GETBULK.  Results after
+                     * the denied one are thrown away and the search
+                     * resumes from the denied one, so the responses
+                     * stay lexicographically sorted.
                      */
-                    if (view != VACM_SUCCESS) {
-                        ret++;
-                        if (request->repeat < request->orig_repeat) {
-                            /* basically this means a GETBULK */
-                            request->repeat++;
-                            if (!earliest) {
-                                request->requestvb = vb;
-                                earliest = 1;
-                            }
-
-                            /* ugh.  if a whole now exists, we need to
-                               move the contents up the chain and fill
-                               in at the end else we won't end up
-                               lexographically sorted properly */
-                            if (j > -1 && vb->next_variable &&
-                                vb->next_variable->type != ASN_NULL &&
-                                vb->next_variable->type != ASN_PRIV_RETRY) {
-                                for(k = j, vbc = vb, vb2 = vb->next_variable;
-                                    k > -2 && vbc && vb2;
-                                    k--, vbc = vb2, vb2 = vb2->next_variable) {
-                                    /* clone next into the current */
-                                    snmp_clone_var(vb2, vbc);
-                                    vbc->next_variable = vb2;
-                                }
-                            }
-                        }
-                        snmp_set_var_typed_value(vb, type, NULL, 0);
-                        if (ASN_PRIV_RETRY == type)
-                            request->inclusive = 0;
+                    request->repeat = j;
+                    request->requestvb = vb;
+                    for (k = j, vb2 = vb->next_variable; vb2 && k > 0;
+                         k--, vb2 = vb2->next_variable) {
+                        if (vb2->type == ASN_NULL && vb2->name_length == 0)
+                            break;      /* never used */
+                        snmp_set_var_typed_value(vb2, ASN_NULL, NULL, 0);
+                        vb2->name_length = 0;
                     }
                 }
+                snmp_set_var_typed_value(vb, type, NULL, 0);
+                if (ASN_PRIV_RETRY == type)
+                    request->inclusive = 0;
+                if (request->requestvb == vb)
+                    break;
             }
         }
     }
@@ -3016,7 +3088,11 @@ handle_var_requests(netsnmp_agent_session *asp)
          */
         if(NULL != asp->treecache[i].subtree->reginfo) {
             reginfo = asp->treecache[i].subtree->reginfo;
-            status = netsnmp_call_handlers(reginfo, asp->reqinfo,
+            if (netsnmp_agent_workers_eligible(reginfo, asp->reqinfo))
+                status = netsnmp_agent_workers_dispatch(reginfo, asp->reqinfo,
+                                            asp->treecache[i].requests_begin);
+            else
+                status = netsnmp_call_handlers(reginfo, asp->reqinfo,
                                            asp->treecache[i].requests_begin);
         }
         else
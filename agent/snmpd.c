@@ -330,6 +330,7 @@ RETSIGTYPE
 SnmpdDump(int a)
 {
     dump_registry();
+    netsnmp_dump_handler_stats();
     signal(SIGUSR1, SnmpdDump);
 }
 #endif
@@ -1194,6 +1195,7 @@ receive(void)
 {
     int             numfds;
     netsnmp_large_fd_set readfds, writefds, exceptfds;
+    netsnmp_fd_poller *poller;
     struct timeval  timeout, *tvp = &timeout;
     int             count, block, i;
 #ifdef	USING_SMUX_MODULE
@@ -1203,6 +1205,7 @@ receive(void)
     netsnmp_large_fd_set_init(&readfds, FD_SETSIZE);
     netsnmp_large_fd_set_init(&writefds, FD_SETSIZE);
     netsnmp_large_fd_set_init(&exceptfds, FD_SETSIZE);
+    poller = netsnmp_fd_poller_create();
 
     /*
      * ignore early sighup during startup
@@ -1230,35 +1233,45 @@ receive(void)
         tvp->tv_usec = 0;
 
         numfds = 0;
-        NETSNMP_LARGE_FD_ZERO(&readfds);
-        NETSNMP_LARGE_FD_ZERO(&writefds);
-        NETSNMP_LARGE_FD_ZERO(&exceptfds);
         block = 0;
-        snmp_select_info2(&numfds, &readfds, tvp, &block);
-        if (block == 1) {
-            tvp = NULL;         /* block without timeout */
-	}
+        if (poller) {
+            /*
+             * The poller watches the sockets (SMUX's included) and the
+             * external fds; only the timeout is needed.
+             */
+            snmp_sess_select_info2_flags(NULL, NULL, NULL, tvp, &block,
+                                         NETSNMP_SELECT_NOFDS);
+        } else {
+            NETSNMP_LARGE_FD_ZERO(&readfds);
+            NETSNMP_LARGE_FD_ZERO(&writefds);
+            NETSNMP_LARGE_FD_ZERO(&exceptfds);
+            snmp_select_info2(&numfds, &readfds, tvp, &block);
 
 #ifdef	USING_SMUX_MODULE
-        if (smux_listen_sd >= 0) {
-            NETSNMP_LARGE_FD_SET(smux_listen_sd, &readfds);
-            numfds =
-                smux_listen_sd >= numfds ? smux_listen_sd + 1 : numfds;
-
-            for (i = 0; i < smux_snmp_select_list_get_length(); i++) {
-                sd = smux_snmp_select_list_get_SD_from_List(i);
-                if (sd != 0)
-                {
-                   NETSNMP_LARGE_FD_SET(sd, &readfds);
-                   numfds = sd >= numfds ? sd + 1 : numfds;
+            if (smux_listen_sd >= 0) {
+                NETSNMP_LARGE_FD_SET(smux_listen_sd, &readfds);
+                numfds =
+                    smux_listen_sd >= numfds ? smux_listen_sd + 1 : numfds;
+
+                for (i = 0; i < smux_snmp_select_list_get_length(); i++) {
+                    sd = smux_snmp_select_list_get_SD_from_List(i);
+                    if (sd != 0)
+                    {
+                       NETSNMP_LARGE_FD_SET(sd, &readfds);
+                       numfds = sd >= numfds ? sd + 1 : numfds;
+                    }
                 }
             }
-        }
 #endif                          /* USING_SMUX_MODULE */
 
 #ifndef NETSNMP_FEATURE_REMOVE_FD_EVENT_MANAGER
-        netsnmp_external_event_info2(&numfds, &readfds, &writefds, &exceptfds);
+            netsnmp_external_event_info2(&numfds, &readfds, &writefds,
+                                         &exceptfds);
 #endif /* NETSNMP_FEATURE_REMOVE_FD_EVENT_MANAGER */
+        }
+        if (block == 1) {
+            tvp = NULL;         /* block without timeout */
+	}
 
     reselect:
 #ifndef NETSNMP_FEATURE_REMOVE_REGISTER_SIGNAL
@@ -1275,11 +1288,16 @@ receive(void)
         if (tvp)
             DEBUGMSGTL(("timer", "tvp %ld.%ld\n", (long) tvp->tv_sec,
                         (long) tvp->tv_usec));
-        count = netsnmp_large_fd_set_select(numfds, &readfds, &writefds, &exceptfds,
-				     tvp);
+        if (poller)
+            count = netsnmp_fd_poller_dispatch(poller, tvp);
+        else
+            count = netsnmp_large_fd_set_select(numfds, &readfds, &writefds,
+                                                &exceptfds, tvp);
         DEBUGMSGTL(("snmpd/select", "returned, count = %d\n", count));
 
-        if (count > 0) {
+        if (count > 0 && poller) {
+            /* netsnmp_fd_poller_dispatch() has called the fds' functions */
+        } else if (count > 0) {
 
 #ifdef USING_SMUX_MODULE
             /*
@@ -1357,6 +1375,7 @@ receive(void)
     netsnmp_large_fd_set_cleanup(&readfds);
     netsnmp_large_fd_set_cleanup(&writefds);
     netsnmp_large_fd_set_cleanup(&exceptfds);
+    netsnmp_fd_poller_free(poller);
 
 #if defined(WIN32)
     join_stdin_waiter_thread();
@@ -97,6 +97,7 @@ SOFTWARE.
 #include <net-snmp/net-snmp-includes.h>
 #include <net-snmp/agent/net-snmp-agent-includes.h>
 #include <net-snmp/library/fd_event_manager.h>
+#include <net-snmp/library/large_fd_set.h>
 #include <net-snmp/agent/netsnmp_close_fds.h>
 #include "../snmplib/snmp_syslog.h"
 #include "../agent_global_vars.h"
@@ -506,9 +507,14 @@ static void
 snmptrapd_main_loop(void)
 {
     int             count, numfds, block;
-    fd_set          readfds,writefds,exceptfds;
+    netsnmp_large_fd_set readfds, writefds, exceptfds;
+    netsnmp_fd_poller *poller;
     struct timeval  timeout;
-    NETSNMP_SELECT_TIMEVAL timeout2;
+
+    netsnmp_large_fd_set_init(&readfds, FD_SETSIZE);
+    netsnmp_large_fd_set_init(&writefds, FD_SETSIZE);
+    netsnmp_large_fd_set_init(&exceptfds, FD_SETSIZE);
+    poller = netsnmp_fd_poller_create();
 
     while (netsnmp_running) {
         if (reconfig) {
@@ -527,30 +533,40 @@ snmptrapd_main_loop(void)
             }
             reconfig = 0;
         }
-        numfds = 0;
-        FD_ZERO(&readfds);
-        FD_ZERO(&writefds);
-        FD_ZERO(&exceptfds);
         block = 0;
         timerclear(&timeout);
         timeout.tv_sec = 5;
-        snmp_select_info(&numfds, &readfds, &timeout, &block);
+        if (poller) {
+            /* the poller calls the sessions and external fds back itself */
+            snmp_sess_select_info2_flags(NULL, NULL, NULL, &timeout, &block,
+                                         NETSNMP_SELECT_NOFDS);
+            count = netsnmp_fd_poller_dispatch(poller,
+                                               !block ? &timeout : NULL);
+        } else {
+            numfds = 0;
+            NETSNMP_LARGE_FD_ZERO(&readfds);
+            NETSNMP_LARGE_FD_ZERO(&writefds);
+            NETSNMP_LARGE_FD_ZERO(&exceptfds);
+            snmp_select_info2(&numfds, &readfds, &timeout, &block);
 #ifndef NETSNMP_FEATURE_REMOVE_FD_EVENT_MANAGER
-        netsnmp_external_event_info(&numfds, &readfds, &writefds, &exceptfds);
+            netsnmp_external_event_info2(&numfds, &readfds, &writefds,
+                                         &exceptfds);
 #endif /* NETSNMP_FEATURE_REMOVE_FD_EVENT_MANAGER */
-        timeout2.tv_sec = timeout.tv_sec;
-        timeout2.tv_usec = timeout.tv_usec;
-        count = select(numfds, &readfds, &writefds, &exceptfds,
-                       !block ? &timeout2 : NULL);
-        if (count > 0) {
+            count = netsnmp_large_fd_set_select(numfds, &readfds, &writefds,
+                                                &exceptfds,
+                                                !block ? &timeout : NULL);
+        }
+        if (count > 0 && poller) {
+            /* netsnmp_fd_poller_dispatch() has called the fds' functions */
+        } else if (count > 0) {
 #ifndef NETSNMP_FEATURE_REMOVE_FD_EVENT_MANAGER
-            netsnmp_dispatch_external_events(&count, &readfds, &writefds,
-                                             &exceptfds);
+            netsnmp_dispatch_external_events2(&count, &readfds, &writefds,
+                                              &exceptfds);
 #endif /* NETSNMP_FEATURE_REMOVE_FD_EVENT_MANAGER */
             /* If there are any more events after external events, then
              * try SNMP events. */
             if (count > 0) {
-                snmp_read(&readfds);
+                snmp_read2(&readfds);
             }
         } else {
             switch (count) {
@@ -570,6 +586,11 @@ snmptrapd_main_loop(void)
 	}
 	run_alarms();
     }
+
+    netsnmp_large_fd_set_cleanup(&readfds);
+    netsnmp_large_fd_set_cleanup(&writefds);
+    netsnmp_large_fd_set_cleanup(&exceptfds);
+    netsnmp_fd_poller_free(poller);
 }
 
 /*******************************************************************-o-******
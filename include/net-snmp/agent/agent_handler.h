@@ -32,6 +32,14 @@ struct netsnmp_handler_registration_s;
 #define MIB_HANDLER_AUTO_NEXT                   0x00000001
 #define MIB_HANDLER_AUTO_NEXT_OVERRIDE_ONCE     0x00000002
 #define MIB_HANDLER_INSTANCE                    0x00000004
+/*
+ * handler may be called from an agent worker thread for GET, GETNEXT
+ * and GETBULK requests (see agentWorkerThreads).  Handlers of the same
+ * registration are never called concurrently, but they may run at the
+ * same time as the main thread and as handlers of other registrations.
+ * When called from a worker thread, reqinfo->asp is NULL.
+ */
+#define MIB_HANDLER_THREAD_SAFE                 0x00000008
 
 #define MIB_HANDLER_CUSTOM4                     0x10000000
 #define MIB_HANDLER_CUSTOM3                     0x20000000
@@ -87,6 +95,15 @@ typedef struct netsnmp_mib_handler_s {
 #define HANDLER_CAN_NOT_CREATE        0x08         /* auto set if ! CAN_SET */
 #define HANDLER_CAN_BABY_STEP         0x10
 #define HANDLER_CAN_STASH             0x20
+/*
+ * GETNEXT may be repeated for all repetitions of a GETBULK request in
+ * one pass (see bulk_to_next); the agent checks access afterwards.
+ * table_container registrations get all the repetitions that follow an
+ * answer in a single GET call of their handler.  Only set this for
+ * registrations whose handlers answer each GETNEXT from their own data,
+ * without side effects that depend on the pass, and never delegate.
+ */
+#define HANDLER_CAN_BULK_NEXT         0x40
 
 
 #define HANDLER_CAN_RONLY   (HANDLER_CAN_GETANDGETNEXT)
@@ -94,6 +111,25 @@ typedef struct netsnmp_mib_handler_s {
 #define HANDLER_CAN_SET_ONLY (HANDLER_CAN_SET | HANDLER_CAN_NOT_CREATE)
 #define HANDLER_CAN_DEFAULT (HANDLER_CAN_RONLY | HANDLER_CAN_NOT_CREATE)
 
+/*
+ * Number of buckets of the handler latency histogram.  Bucket 0 counts
+ * calls that took less than a microsecond, bucket n > 0 those that took
+ * from 2^(n-1) up to 2^n - 1 microseconds, and the last bucket all
+ * longer ones.
+ */
+#define NETSNMP_HANDLER_STATS_BUCKETS 24
+
+/** @struct netsnmp_handler_stats_s
+ *  Call count and time spent in the handlers of a registration, as
+ *  measured by netsnmp_call_handlers().
+ */
+typedef struct netsnmp_handler_stats_s {
+        u_long          calls;
+        struct counter64 usecs;         /* total time, in microseconds */
+        u_long          max_usecs;
+        u_long          histogram[NETSNMP_HANDLER_STATS_BUCKETS];
+} netsnmp_handler_stats;
+
 /** @typedef struct netsnmp_handler_registration_s netsnmp_handler_registration
  * Typedefs the netsnmp_handler_registration_s struct into netsnmp_handler_registration  */
 
@@ -136,6 +172,12 @@ typedef struct netsnmp_handler_registration_s {
          */
         void *          my_reg_void;
 
+        /**
+         * call statistics, allocated by netsnmp_register_mib(); read them
+         * with netsnmp_handler_stats_get()
+         */
+        netsnmp_handler_stats *stats;
+
 } netsnmp_handler_registration;
 
 /*
@@ -266,6 +308,8 @@ typedef int (Netsnmp_Node_Handler) (netsnmp_mib_handler *handler,
         *netsnmp_handler_registration_dup(netsnmp_handler_registration *);
     void           
         netsnmp_handler_registration_free(netsnmp_handler_registration *);
+    int             netsnmp_handler_stats_get(const netsnmp_handler_registration *,
+                                              netsnmp_handler_stats *);
 
 #define REQUEST_IS_DELEGATED     1
 #define REQUEST_IS_NOT_DELEGATED 0
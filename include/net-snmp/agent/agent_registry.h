@@ -47,10 +47,14 @@ struct register_parameters {
     netsnmp_handler_registration *reginfo;
 };
 
+struct subtree_index_node_s;
+
 typedef struct subtree_context_cache_s {
     const char				*context_name;
     struct netsnmp_subtree_s		*first_subtree;
     struct subtree_context_cache_s	*next;
+    /** OID trie over the start OIDs of the subtrees in this context */
+    struct subtree_index_node_s		*index;
 } subtree_context_cache;
 
 
@@ -58,6 +62,7 @@ typedef struct subtree_context_cache_s {
 void             setup_tree		  (void);
 void             shutdown_tree    (void);
 void             dump_registry(void);
+void             netsnmp_dump_handler_stats(void);
 
 
 netsnmp_subtree *netsnmp_subtree_find	  (const oid *, size_t,
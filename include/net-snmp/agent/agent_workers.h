@@ -0,0 +1,26 @@
+#ifndef AGENT_WORKERS_H
+#define AGENT_WORKERS_H
+
+#ifdef __cplusplus
+extern          "C" {
+#endif
+
+    /*
+     * Optional pool of worker threads that run the handlers of read
+     * requests for registrations whose whole handler chain is marked
+     * MIB_HANDLER_THREAD_SAFE.  Requests handed to the pool are treated
+     * like any other delegated request by the agent.
+     */
+    int             netsnmp_agent_workers_eligible(netsnmp_handler_registration *reginfo,
+                                                   netsnmp_agent_request_info *reqinfo);
+    int             netsnmp_agent_workers_dispatch(netsnmp_handler_registration *reginfo,
+                                                   netsnmp_agent_request_info *reqinfo,
+                                                   netsnmp_request_info *requests);
+    void            netsnmp_agent_workers_sync(void);
+    void            netsnmp_agent_workers_forget(netsnmp_agent_session *asp);
+    void            netsnmp_agent_workers_shutdown(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif                          /* AGENT_WORKERS_H */
@@ -27,9 +27,12 @@ extern          "C" {
 #define CACHE_NAME "cache_info"
 
     typedef struct netsnmp_cache_s netsnmp_cache;
+    typedef struct netsnmp_cache_group_s netsnmp_cache_group;
 
     typedef int  (NetsnmpCacheLoad)(netsnmp_cache *, void*);
     typedef void (NetsnmpCacheFree)(netsnmp_cache *, void*);
+    typedef void *(NetsnmpCacheSnapshot)(netsnmp_cache *, void*);
+    typedef void (NetsnmpCacheSwap)(netsnmp_cache *, void*, void*);
 
     struct netsnmp_cache_s {
 	/** Number of handlers whose myvoid member points at this structure. */
@@ -67,6 +70,25 @@ extern          "C" {
         oid *rootoid;
         int  rootoid_len;
 
+        /*
+         * Number of calls of load_cache, and the group of caches
+         * this one is reloaded together with (if any)
+         */
+        u_int                loads;
+        netsnmp_cache_group *group;
+        netsnmp_cache       *group_next;
+
+        /*
+         * Background loading (see netsnmp_cache_set_background()), and
+         * the duration of the last and of the longest load (in ms)
+         */
+        NetsnmpCacheSnapshot *load_snapshot;
+        NetsnmpCacheSwap     *swap_snapshot;
+        NetsnmpCacheFree     *free_snapshot;
+        int                   max_stale;    /* in s, 0 to load in the request */
+        int                   loading;      /* a snapshot is being built */
+        u_int                 load_time;
+        u_int                 load_time_max;
     };
 
 
@@ -110,6 +132,15 @@ extern          "C" {
     unsigned int netsnmp_cache_timer_start(netsnmp_cache *cache);
     void netsnmp_cache_timer_stop(netsnmp_cache *cache);
 
+    int  netsnmp_cache_group_add(const char *name, netsnmp_cache *cache);
+    void netsnmp_cache_group_remove(netsnmp_cache *cache);
+    const char *netsnmp_cache_group_name(const netsnmp_cache *cache);
+    void netsnmp_cache_set_background(netsnmp_cache *cache, int max_stale,
+                                      NetsnmpCacheSnapshot *snapshot_hook,
+                                      NetsnmpCacheSwap *swap_hook,
+                                      NetsnmpCacheFree *free_hook);
+    void netsnmp_init_cache_conf(void);
+
 /*
  * Flags affecting cache handler operation
  */
@@ -306,6 +306,7 @@ extern          "C" {
     int             netsnmp_register_agent_nsap(struct netsnmp_transport_s
                                                 *t);
     void            netsnmp_deregister_agent_nsap(int handle);
+    struct netsnmp_transport_s *netsnmp_agent_nsap_next(int *handle);
 
     int             netsnmp_agent_listen_on(const char *port);
 
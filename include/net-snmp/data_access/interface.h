@@ -244,6 +244,8 @@ netsnmp_access_interface_container_load(netsnmp_container* container,
 #define NETSNMP_ACCESS_INTERFACE_LOAD_NO_STATS              0x0001
 #define NETSNMP_ACCESS_INTERFACE_LOAD_IP4_ONLY              0x0002
 #define NETSNMP_ACCESS_INTERFACE_LOAD_IP6_ONLY              0x0004
+/* the container holds the entries of an earlier load: update them */
+#define NETSNMP_ACCESS_INTERFACE_LOAD_REUSE                 0x0008
 
 void netsnmp_access_interface_container_free(netsnmp_container *container,
                                              u_int free_flags);
@@ -106,6 +106,28 @@ void netsnmp_access_route_container_free(netsnmp_container *container,
 #define NETSNMP_ACCESS_ROUTE_FREE_DONT_CLEAR            0x0001
 #define NETSNMP_ACCESS_ROUTE_FREE_KEEP_CONTAINER        0x0002
 
+/*
+ * route table changes
+ *
+ * Returns 0 if the OS doesn't tell us about route changes. Otherwise
+ * the value changes every time the routes change, so a previously
+ * loaded container is still current as long as it returns the same
+ * value as when the container was loaded.
+ */
+u_int netsnmp_access_route_generation(void);
+
+/*
+ * single route changes
+ *
+ * Where the OS reports them, the hook is called with an entry for each
+ * route (next hop) that was added or changed, or removed if removed is
+ * set, and the generation stays the same. The hook owns the entry.
+ * Changes that can't be told this way still change the generation.
+ */
+typedef void (NetsnmpAccessRouteUpdate)(netsnmp_route_entry *entry,
+                                        int removed);
+void netsnmp_access_route_set_update_hook(NetsnmpAccessRouteUpdate *hook);
+
 
 /*
  * create/copy/free a route entry
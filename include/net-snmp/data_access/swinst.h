@@ -65,6 +65,14 @@ extern "C" {
     netsnmp_swinst_entry * netsnmp_swinst_entry_create(int32_t index);
     void netsnmp_swinst_entry_free(netsnmp_swinst_entry *entry);
 
+    /*
+     * Returns 0 if the installed software is not watched for changes.
+     * Otherwise the value changes every time software is installed or
+     * removed, so a previously loaded container is still current as
+     * long as it returns the same value as when it was loaded.
+     */
+    u_int netsnmp_swinst_generation(void);
+
     int32_t netsnmp_swinst_add_name(const char *name);
     int32_t netsnmp_swinst_get_id(const char *name);
     const char * netsnmp_swinst_get_name(int32_t id);
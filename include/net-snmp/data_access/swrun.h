@@ -51,6 +51,12 @@ extern "C" {
          */
         int32_t         hrSWRunPerfCPU;
         int32_t         hrSWRunPerfMem;
+
+        /*
+         * when the process started (arch specific units), so that arch
+         * code updating entries in place can tell a reused pid apart
+         */
+        unsigned long long start_time;
         
     } netsnmp_swrun_entry;
 
@@ -97,7 +103,8 @@ extern "C" {
 #define NETSNMP_SWRUN_NOFLAGS            0x00000000
 #define NETSNMP_SWRUN_ALL_OR_NONE        0x00000001
 #define NETSNMP_SWRUN_DONT_FREE_ITEMS    0x00000002
-/*#define NETSNMP_SWRUN_xx                0x00000004 */
+#define NETSNMP_SWRUN_UPDATE             0x00000004
+/*#define NETSNMP_SWRUN_xx                0x00000008 */
 
 #ifdef  __cplusplus
 }
@@ -130,6 +130,11 @@ extern          "C" {
 #define NETSNMP_DS_LIB_RETRIES             15
 #define NETSNMP_DS_LIB_MSG_SEND_MAX        16 /* global max response size */
 #define NETSNMP_DS_LIB_FILTER_TYPE         17 /* 0=NONE, 1=whitelist, -1=blacklist */
+#define NETSNMP_DS_LIB_UDP_BATCH_SIZE      19 /* datagrams per recvmmsg() */
+#define NETSNMP_DS_LIB_UDP_REUSEPORT       20 /* SO_REUSEPORT on UDP servers */
+#define NETSNMP_DS_LIB_TLS_SESSION_CACHE_SIZE 21 /* resumable (D)TLS sessions */
+#define NETSNMP_DS_LIB_TLS_SESSION_LIFETIME 22 /* seconds a session is resumable */
+#define NETSNMP_DS_LIB_USM_KEY_THREADS     23 /* threads localizing keys */
 #define NETSNMP_DS_LIB_MAX_INT_ID          48 /* match NETSNMP_DS_MAX_SUBIDS */
     
     /*
@@ -185,6 +190,7 @@ extern          "C" {
 #define NETSNMP_DS_LIB_OUTPUT_PRECISION  35
 #define NETSNMP_DS_LIB_TLS_MIN_VERSION   36
 #define NETSNMP_DS_LIB_TLS_MAX_VERSION   37
+#define NETSNMP_DS_LIB_FD_POLLER         38 /* auto, epoll or select */
 #define NETSNMP_DS_LIB_MAX_STR_ID        48 /* match NETSNMP_DS_MAX_SUBIDS */
 
     /*
@@ -151,6 +151,55 @@ int    netsnmp_large_fd_set_select(int numfds, netsnmp_large_fd_set *readfds,
 NETSNMP_IMPORT
 void   netsnmp_large_fd_set_cleanup(netsnmp_large_fd_set *fdset);
 
+/*
+ * File descriptors watched by an event loop.  Where epoll is available,
+ * a poller keeps the watched descriptors registered with the kernel, so
+ * that opening or closing a session costs one system call and a wakeup
+ * only visits the descriptors that are ready.  The session sockets and
+ * the descriptors registered with the fd event manager are watched
+ * automatically.  netsnmp_fd_poller_create() returns NULL where epoll is
+ * not available or when "fdPoller select" is configured; the caller then
+ * builds its fd sets and calls select() as before.
+ */
+#define NETSNMP_FD_WATCH_READ   0
+#define NETSNMP_FD_WATCH_WRITE  1
+#define NETSNMP_FD_WATCH_EXCEPT 2
+
+typedef void    (netsnmp_fd_watch_func) (int fd, void *data);
+
+typedef struct netsnmp_fd_poller_s netsnmp_fd_poller;
+
+/*
+ * Calls func(fd, data) from netsnmp_fd_poller_dispatch() whenever fd is
+ * ready for kind (one of NETSNMP_FD_WATCH_*), replacing what was watched
+ * for that kind before.  Returns 0, or -1 if out of memory.
+ */
+NETSNMP_IMPORT
+int    netsnmp_fd_watch(int fd, int kind, netsnmp_fd_watch_func *func,
+                        void *data);
+
+/*
+ * Stops watching fd for kind; if data is not NULL, only if the watch was
+ * registered with that data.
+ */
+NETSNMP_IMPORT
+void   netsnmp_fd_unwatch(int fd, int kind, void *data);
+
+NETSNMP_IMPORT
+netsnmp_fd_poller *netsnmp_fd_poller_create(void);
+
+NETSNMP_IMPORT
+void   netsnmp_fd_poller_free(netsnmp_fd_poller *poller);
+
+/*
+ * Waits at most timeout (NULL: forever) for watched descriptors to become
+ * ready and calls their functions.  Returns the number of calls made, or
+ * -1 with errno set if the wait failed.
+ */
+NETSNMP_IMPORT
+int    netsnmp_fd_poller_dispatch(netsnmp_fd_poller *poller,
+                                  struct timeval *timeout);
+
 /**
  * Copy an fd_set to a netsnmp_large_fd_set structure.
  *
@@ -148,6 +148,39 @@ typedef struct netsnmp_priv_alg_info_s {
                                         u_int msglen, const u_char * MAC,
                                         u_int maclen);
 
+    /*
+     * A localized authentication key, prepared once for the keyed hash
+     * of many messages.
+     */
+    typedef struct netsnmp_keyed_hash_ctx_s netsnmp_keyed_hash_ctx;
+
+    NETSNMP_IMPORT
+    netsnmp_keyed_hash_ctx *sc_keyed_hash_ctx_new(const oid * authtype,
+                                                  size_t authtypelen,
+                                                  const u_char * key,
+                                                  u_int keylen);
+    NETSNMP_IMPORT
+    netsnmp_keyed_hash_ctx *sc_keyed_hash_ctx_ref(netsnmp_keyed_hash_ctx *ctx);
+    NETSNMP_IMPORT
+    void            sc_keyed_hash_ctx_free(netsnmp_keyed_hash_ctx *ctx);
+    NETSNMP_IMPORT
+    int             sc_keyed_hash_ctx_matches(const netsnmp_keyed_hash_ctx
+                                              *ctx, const oid * authtype,
+                                              size_t authtypelen,
+                                              const u_char * key,
+                                              u_int keylen);
+    NETSNMP_IMPORT
+    int             sc_generate_keyed_hash_ctx(netsnmp_keyed_hash_ctx *ctx,
+                                               const u_char * message,
+                                               u_int msglen, u_char * MAC,
+                                               size_t * maclen);
+    NETSNMP_IMPORT
+    int             sc_check_keyed_hash_ctx(netsnmp_keyed_hash_ctx *ctx,
+                                            const u_char * message,
+                                            u_int msglen,
+                                            const u_char * MAC,
+                                            u_int maclen);
+
     NETSNMP_IMPORT
     int             sc_encrypt(const oid * privtype, size_t privtypelen,
                                u_char * key, u_int keylen,
@@ -162,6 +195,36 @@ typedef struct netsnmp_priv_alg_info_s {
                                u_char * ciphertext, u_int ctlen,
                                u_char * plaintext, size_t * ptlen);
 
+    /*
+     * A localized privacy key, prepared once for the encryption and
+     * decryption of many messages.
+     */
+    typedef struct netsnmp_cipher_ctx_s netsnmp_cipher_ctx;
+
+    NETSNMP_IMPORT
+    netsnmp_cipher_ctx *sc_cipher_ctx_new(const oid * privtype,
+                                          size_t privtypelen,
+                                          const u_char * key, u_int keylen);
+    NETSNMP_IMPORT
+    netsnmp_cipher_ctx *sc_cipher_ctx_ref(netsnmp_cipher_ctx *ctx);
+    NETSNMP_IMPORT
+    void            sc_cipher_ctx_free(netsnmp_cipher_ctx *ctx);
+    NETSNMP_IMPORT
+    int             sc_cipher_ctx_matches(const netsnmp_cipher_ctx *ctx,
+                                          const oid * privtype,
+                                          size_t privtypelen,
+                                          const u_char * key, u_int keylen);
+    NETSNMP_IMPORT
+    int             sc_encrypt_ctx(netsnmp_cipher_ctx *ctx,
+                                   u_char * iv, u_int ivlen,
+                                   const u_char * plaintext, u_int ptlen,
+                                   u_char * ciphertext, size_t * ctlen);
+    NETSNMP_IMPORT
+    int             sc_decrypt_ctx(netsnmp_cipher_ctx *ctx,
+                                   u_char * iv, u_int ivlen,
+                                   u_char * ciphertext, u_int ctlen,
+                                   u_char * plaintext, size_t * ptlen);
+
     NETSNMP_IMPORT
     int             sc_hash_type(int auth_type, const u_char * buf,
                                  size_t buf_len, u_char * MAC,
@@ -20,6 +20,8 @@ extern          "C" {
 
     NETSNMP_IMPORT
     u_char         *date_n_time(const time_t *, size_t *);
+    NETSNMP_IMPORT
+    u_char         *date_n_time_r(const time_t *, u_char *, size_t *);
     time_t          ctime_to_timet(const char *);
 
     /*
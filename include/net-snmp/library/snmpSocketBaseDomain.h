@@ -16,6 +16,7 @@ extern          "C" {
  */
     int netsnmp_socketbase_close(netsnmp_transport *t);
     int netsnmp_sock_buffer_set(int s, int optname, int local, int size);
+    int netsnmp_sock_get_rcv_drops(int s, u_long *drops);
     int netsnmp_set_non_blocking_mode(int sock, int non_blocking_mode);
 
 #ifdef __cplusplus
@@ -48,6 +48,8 @@ extern          "C" {
        char                      *their_fingerprint;
        char                      *their_hostname;
        char                      *trust_cert;
+       u_char                    *session_key;
+       size_t                     session_key_len;
     } _netsnmpTLSBaseData;
 
 #define VRFY_PARENT_WAS_OK 1
@@ -76,6 +78,11 @@ extern          "C" {
                                      struct snmp_session *sess);
     int tls_get_verify_info_index(void);
 
+    void netsnmp_tlsbase_session_attach(SSL *ssl, _netsnmpTLSBaseData *tlsdata,
+                                        const void *peer, size_t peer_len);
+    void netsnmp_tlsbase_session_established(SSL *ssl,
+                                             _netsnmpTLSBaseData *tlsdata);
+
     void netsnmp_tlsbase_free_tlsdata(_netsnmpTLSBaseData *tlsbase);
 #ifdef __cplusplus
 }
@@ -743,9 +743,18 @@ struct netsnmp_transport_s;
 #define  STAT_TLSTM_STATS_START                 STAT_TLSTM_SNMPTLSTMSESSIONOPENS
 #define  STAT_TLSTM_STATS_END          STAT_TLSTM_SNMPTLSTMSESSIONINVALIDCACHES
 
+    /*
+     * (D)TLS session resumption counters (not part of any MIB)
+     */
+#define  STAT_TLS_SESSIONCACHEHITS                57
+#define  STAT_TLS_SESSIONCACHEMISSES              58
+
+#define  STAT_TLS_STATS_START                 STAT_TLS_SESSIONCACHEHITS
+#define  STAT_TLS_STATS_END                   STAT_TLS_SESSIONCACHEMISSES
+
     /* this previously was end+1; don't know why the +1 is needed;
        XXX: check the code */
-#define  NETSNMP_STAT_MAX_STATS              (STAT_TLSTM_STATS_END+1)
+#define  NETSNMP_STAT_MAX_STATS              (STAT_TLS_STATS_END+1)
 /** backwards compatability */
 #define MAX_STATS NETSNMP_STAT_MAX_STATS
 
@@ -57,6 +57,8 @@ extern          "C" {
 #define		NETSNMP_TRANSPORT_FLAG_OPENED	 0x20  /* f_open called */
 #define		NETSNMP_TRANSPORT_FLAG_SHARED	 0x40
 #define		NETSNMP_TRANSPORT_FLAG_HOSTNAME	 0x80  /* for fmtaddr hook */
+#define		NETSNMP_TRANSPORT_FLAG_PENDING	 0x100 /* f_recv has more
+                                                        packets queued */
 
 /*  The standard SNMP domains.  */
 
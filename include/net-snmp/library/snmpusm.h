@@ -82,6 +82,13 @@ extern          "C" {
         void           *usmDHUserPrivKeyChange;
         struct usmUser *next;
         struct usmUser *prev;
+        struct usmUser *hnext;  /* chain in the engineID/name index */
+        /* authKey prepared for the keyed hash, see usm_user_auth_ctx() */
+        struct netsnmp_keyed_hash_ctx_s *authKeyCtx;
+        /* privKey prepared for the cipher, see usm_user_priv_ctx() */
+        struct netsnmp_cipher_ctx_s *privKeyCtx;
+        /* keys still to be localized from pass phrases, see createUser */
+        struct usm_key_job_s *keyJobs;
     };
 
 #define USMUSER_FLAG_KEEP_MASTER_KEY             0x01
@@ -37,6 +37,7 @@ register_readfd(int fd, void (*func) (int, void *), void *data)
         external_readfdfunc[external_readfdlen] = func;
         external_readfd_data[external_readfdlen] = data;
         external_readfdlen++;
+        netsnmp_fd_watch(fd, NETSNMP_FD_WATCH_READ, func, data);
         DEBUGMSGTL(("fd_event_manager:register_readfd", "registered fd %d\n", fd));
         return FD_REGISTERED_OK;
     } else {
@@ -57,6 +58,7 @@ register_writefd(int fd, void (*func) (int, void *), void *data)
         external_writefdfunc[external_writefdlen] = func;
         external_writefd_data[external_writefdlen] = data;
         external_writefdlen++;
+        netsnmp_fd_watch(fd, NETSNMP_FD_WATCH_WRITE, func, data);
         DEBUGMSGTL(("fd_event_manager:register_writefd", "registered fd %d\n", fd));
         return FD_REGISTERED_OK;
     } else {
@@ -78,6 +80,7 @@ register_exceptfd(int fd, void (*func) (int, void *), void *data)
         external_exceptfdfunc[external_exceptfdlen] = func;
         external_exceptfd_data[external_exceptfdlen] = data;
         external_exceptfdlen++;
+        netsnmp_fd_watch(fd, NETSNMP_FD_WATCH_EXCEPT, func, data);
         DEBUGMSGTL(("fd_event_manager:register_exceptfd", "registered fd %d\n", fd));
         return FD_REGISTERED_OK;
     } else {
@@ -104,6 +107,7 @@ unregister_readfd(int fd)
                 external_readfd_data[j] = external_readfd_data[j + 1];
             }
             DEBUGMSGTL(("fd_event_manager:unregister_readfd", "unregistered fd %d\n", fd));
+            netsnmp_fd_unwatch(fd, NETSNMP_FD_WATCH_READ, NULL);
             external_fd_unregistered = 1;
             return FD_UNREGISTERED_OK;
         }
@@ -128,6 +132,7 @@ unregister_writefd(int fd)
                 external_writefd_data[j] = external_writefd_data[j + 1];
             }
             DEBUGMSGTL(("fd_event_manager:unregister_writefd", "unregistered fd %d\n", fd));
+            netsnmp_fd_unwatch(fd, NETSNMP_FD_WATCH_WRITE, NULL);
             external_fd_unregistered = 1;
             return FD_UNREGISTERED_OK;
         }
@@ -153,6 +158,7 @@ unregister_exceptfd(int fd)
             }
             DEBUGMSGTL(("fd_event_manager:unregister_exceptfd", "unregistered fd %d\n",
                         fd));
+            netsnmp_fd_unwatch(fd, NETSNMP_FD_WATCH_EXCEPT, NULL);
             external_fd_unregistered = 1;
             return FD_UNREGISTERED_OK;
         }
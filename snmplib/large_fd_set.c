@@ -21,6 +21,14 @@
 #include <string.h> /* memset(), which is invoked by FD_ZERO() */
 
 #include <stddef.h>
+#include <errno.h>
+#include <limits.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
 
 #include <net-snmp/net-snmp-includes.h>
 #include <net-snmp/library/snmp_assert.h>
@@ -300,3 +308,338 @@ netsnmp_copy_large_fd_set_to_fd_set(fd_set * dst,
 
     return 0;
 }
+
+#ifdef HAVE_SYS_EPOLL_H
+
+/*
+ * The watched file descriptors, indexed by fd.  The generation of an fd
+ * changes whenever it is watched afresh; it travels with the epoll events
+ * so that an event for a descriptor that has been closed and reused
+ * within the same wakeup is not delivered to the new owner.
+ */
+typedef struct fd_watch_s {
+    netsnmp_fd_watch_func *func[3];
+    void           *data[3];
+    uint32_t        generation;
+} fd_watch;
+
+static fd_watch *fd_watches;
+static int      fd_watches_len;
+static int      fd_watches_used;
+
+struct netsnmp_fd_poller_s {
+    int             epfd;
+    uint32_t       *events;     /* per fd: the epoll events registered */
+    int             events_len;
+    int            *unpollable; /* fds epoll refuses, e.g. regular files */
+    int             unpollable_len;
+    struct epoll_event *ready;
+    int             ready_len;
+    struct netsnmp_fd_poller_s *next;
+};
+
+static netsnmp_fd_poller *fd_pollers;
+
+static uint32_t
+_fd_watch_events(const fd_watch *w)
+{
+    return (w->func[NETSNMP_FD_WATCH_READ] ? EPOLLIN : 0) |
+        (w->func[NETSNMP_FD_WATCH_WRITE] ? EPOLLOUT : 0) |
+        (w->func[NETSNMP_FD_WATCH_EXCEPT] ? EPOLLPRI : 0);
+}
+
+static void
+_fd_poller_unpollable(netsnmp_fd_poller *poller, int fd, int add)
+{
+    int             i;
+
+    for (i = 0; i < poller->unpollable_len; i++)
+        if (poller->unpollable[i] == fd)
+            break;
+    if (!add) {
+        if (i < poller->unpollable_len)
+            poller->unpollable[i] =
+                poller->unpollable[--poller->unpollable_len];
+    } else if (i == poller->unpollable_len) {
+        int            *unpollable = (int *) realloc(poller->unpollable,
+                                                     (i + 1) * sizeof(int));
+        if (unpollable == NULL)
+            return;
+        unpollable[i] = fd;
+        poller->unpollable = unpollable;
+        poller->unpollable_len++;
+    }
+}
+
+/* passes the watch of fd on to the kernel */
+static void
+_fd_poller_update(netsnmp_fd_poller *poller, int fd)
+{
+    struct epoll_event ev;
+    uint32_t        have, want;
+    int             rc;
+
+    if (fd >= poller->events_len) {
+        int             len = fd_watches_len;
+        uint32_t       *events = (uint32_t *) realloc(poller->events,
+                                                      len * sizeof(uint32_t));
+        if (events == NULL)
+            return;
+        memset(events + poller->events_len, 0,
+               (len - poller->events_len) * sizeof(uint32_t));
+        poller->events = events;
+        poller->events_len = len;
+    }
+    have = poller->events[fd];
+    want = fd < fd_watches_len ? _fd_watch_events(&fd_watches[fd]) : 0;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = want;
+    if (want)
+        ev.data.u64 = (uint64_t) fd_watches[fd].generation << 32 |
+            (uint32_t) fd;
+
+    if (!want) {
+        /* fails harmlessly if the fd has been closed in the meantime */
+        if (have)
+            (void) epoll_ctl(poller->epfd, EPOLL_CTL_DEL, fd, &ev);
+        _fd_poller_unpollable(poller, fd, 0);
+        poller->events[fd] = 0;
+        return;
+    }
+
+    rc = epoll_ctl(poller->epfd, have ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd,
+                   &ev);
+    if (rc < 0 && errno == ENOENT)
+        /* closed and reopened: the kernel has forgotten about it */
+        rc = epoll_ctl(poller->epfd, EPOLL_CTL_ADD, fd, &ev);
+    else if (rc < 0 && errno == EEXIST)
+        rc = epoll_ctl(poller->epfd, EPOLL_CTL_MOD, fd, &ev);
+    if (rc < 0 && errno == EPERM) {
+        /* select() reports these as always ready, and so do we */
+        DEBUGMSGTL(("fd_poller", "fd %d can't be polled\n", fd));
+        _fd_poller_unpollable(poller, fd, 1);
+    } else if (rc < 0)
+        snmp_log(LOG_ERR, "fd_poller: can't watch fd %d: %s\n", fd,
+                 strerror(errno));
+    poller->events[fd] = rc < 0 ? 0 : want;
+}
+
+int
+netsnmp_fd_watch(int fd, int kind, netsnmp_fd_watch_func *func, void *data)
+{
+    netsnmp_fd_poller *poller;
+    fd_watch       *w;
+
+    netsnmp_assert(fd >= 0 && kind >= 0 && kind <= 2 && func);
+    if (fd >= fd_watches_len) {
+        int             len = fd_watches_len ? fd_watches_len : 64;
+        fd_watch       *watches;
+
+        while (len <= fd)
+            len *= 2;
+        watches = (fd_watch *) realloc(fd_watches, len * sizeof(fd_watch));
+        if (watches == NULL)
+            return -1;
+        memset(watches + fd_watches_len, 0,
+               (len - fd_watches_len) * sizeof(fd_watch));
+        fd_watches = watches;
+        fd_watches_len = len;
+    }
+    w = &fd_watches[fd];
+    if (!_fd_watch_events(w)) {
+        w->generation++;
+        fd_watches_used++;
+    }
+    w->func[kind] = func;
+    w->data[kind] = data;
+    DEBUGMSGTL(("fd_poller", "watching fd %d (%d)\n", fd, kind));
+
+    for (poller = fd_pollers; poller; poller = poller->next)
+        _fd_poller_update(poller, fd);
+    return 0;
+}
+
+void
+netsnmp_fd_unwatch(int fd, int kind, void *data)
+{
+    netsnmp_fd_poller *poller;
+    fd_watch       *w;
+
+    if (fd < 0 || fd >= fd_watches_len)
+        return;
+    w = &fd_watches[fd];
+    if (w->func[kind] == NULL || (data && w->data[kind] != data))
+        return;
+    w->func[kind] = NULL;
+    w->data[kind] = NULL;
+    DEBUGMSGTL(("fd_poller", "no longer watching fd %d (%d)\n", fd, kind));
+
+    for (poller = fd_pollers; poller; poller = poller->next)
+        _fd_poller_update(poller, fd);
+
+    if (!_fd_watch_events(w) && --fd_watches_used == 0 && !fd_pollers) {
+        SNMP_FREE(fd_watches);
+        fd_watches_len = 0;
+    }
+}
+
+/* calls the function watching fd for kind, if the watch is still current */
+static int
+_fd_poller_call(int fd, uint32_t generation, int kind)
+{
+    fd_watch       *w;
+
+    if (fd >= fd_watches_len)
+        return 0;
+    w = &fd_watches[fd];
+    if (w->generation != generation || w->func[kind] == NULL)
+        return 0;
+    (*w->func[kind]) (fd, w->data[kind]);
+    return 1;
+}
+
+int
+netsnmp_fd_poller_dispatch(netsnmp_fd_poller *poller,
+                           struct timeval *timeout)
+{
+    int             i, n, ms, fd, count = 0;
+    uint32_t        ev, generation;
+
+    if (poller->ready_len < fd_watches_used) {
+        struct epoll_event *ready = (struct epoll_event *)
+            realloc(poller->ready, fd_watches_used * sizeof(*ready));
+        if (ready != NULL) {
+            poller->ready = ready;
+            poller->ready_len = fd_watches_used;
+        }
+    }
+
+    if (poller->unpollable_len)
+        ms = 0;
+    else if (timeout == NULL)
+        ms = -1;
+    else if (timeout->tv_sec >= INT_MAX / 1000 - 1)
+        ms = INT_MAX;
+    else
+        ms = timeout->tv_sec * 1000 + (timeout->tv_usec + 999) / 1000;
+
+    n = epoll_wait(poller->epfd, poller->ready,
+                   poller->ready_len ? poller->ready_len : 1, ms);
+    if (n < 0)
+        return -1;
+
+    /*
+     * The functions called may watch and unwatch descriptors, so look
+     * each one up again before calling it.
+     */
+    for (i = 0; i < n; i++) {
+        ev = poller->ready[i].events;
+        fd = (int) (poller->ready[i].data.u64 & 0xffffffff);
+        generation = (uint32_t) (poller->ready[i].data.u64 >> 32);
+        if (ev & (EPOLLIN | EPOLLHUP | EPOLLERR))
+            count += _fd_poller_call(fd, generation, NETSNMP_FD_WATCH_READ);
+        if (ev & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+            count += _fd_poller_call(fd, generation, NETSNMP_FD_WATCH_WRITE);
+        if (ev & (EPOLLPRI | EPOLLHUP | EPOLLERR))
+            count += _fd_poller_call(fd, generation,
+                                     NETSNMP_FD_WATCH_EXCEPT);
+    }
+    for (i = 0; i < poller->unpollable_len; i++) {
+        fd = poller->unpollable[i];
+        generation = fd_watches[fd].generation;
+        count += _fd_poller_call(fd, generation, NETSNMP_FD_WATCH_READ);
+        count += _fd_poller_call(fd, generation, NETSNMP_FD_WATCH_WRITE);
+    }
+    return count;
+}
+
+#else /* !HAVE_SYS_EPOLL_H */
+
+int
+netsnmp_fd_watch(int fd, int kind, netsnmp_fd_watch_func *func, void *data)
+{
+    return 0;
+}
+
+void
+netsnmp_fd_unwatch(int fd, int kind, void *data)
+{
+}
+
+int
+netsnmp_fd_poller_dispatch(netsnmp_fd_poller *poller,
+                           struct timeval *timeout)
+{
+    errno = EINVAL;
+    return -1;
+}
+
+#endif /* HAVE_SYS_EPOLL_H */
+
+/**
+ * Creates a poller, using the backend configured with the fdPoller
+ * token (auto, epoll or select).
+ *
+ * @return the poller, or NULL if select() is to be used.  NULL may be
+ *   passed to netsnmp_fd_poller_free().
+ */
+netsnmp_fd_poller *
+netsnmp_fd_poller_create(void)
+{
+    const char     *type = netsnmp_ds_get_string(NETSNMP_DS_LIBRARY_ID,
+                                                 NETSNMP_DS_LIB_FD_POLLER);
+#ifdef HAVE_SYS_EPOLL_H
+    netsnmp_fd_poller *poller;
+    int             fd;
+
+    if (type && strcmp(type, "select") == 0)
+        return NULL;
+    if (type && strcmp(type, "auto") != 0 && strcmp(type, "epoll") != 0)
+        snmp_log(LOG_WARNING, "unknown fdPoller %s; using auto\n", type);
+
+    poller = SNMP_MALLOC_TYPEDEF(netsnmp_fd_poller);
+    if (poller == NULL)
+        return NULL;
+    poller->epfd = epoll_create(64);
+    if (poller->epfd < 0) {
+        snmp_log(LOG_WARNING, "epoll_create: %s; falling back to select()\n",
+                 strerror(errno));
+        free(poller);
+        return NULL;
+    }
+    for (fd = 0; fd < fd_watches_len; fd++)
+        if (_fd_watch_events(&fd_watches[fd]))
+            _fd_poller_update(poller, fd);
+    poller->next = fd_pollers;
+    fd_pollers = poller;
+    DEBUGMSGTL(("fd_poller", "using epoll\n"));
+    return poller;
+#else
+    if (type && strcmp(type, "epoll") == 0)
+        snmp_log(LOG_WARNING,
+                 "epoll is not available; falling back to select()\n");
+    return NULL;
+#endif
+}
+
+void
+netsnmp_fd_poller_free(netsnmp_fd_poller *poller)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    netsnmp_fd_poller **prevp;
+
+    if (poller == NULL)
+        return;
+    for (prevp = &fd_pollers; *prevp; prevp = &(*prevp)->next)
+        if (*prevp == poller) {
+            *prevp = poller->next;
+            break;
+        }
+    close(poller->epfd);
+    free(poller->events);
+    free(poller->unpollable);
+    free(poller->ready);
+    free(poller);
+#endif
+}
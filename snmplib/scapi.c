@@ -85,10 +85,17 @@ netsnmp_feature_child_of(usm_scapi, usm_support);
 #include <openssl/hmac.h>
 #include <openssl/evp.h>
 #include <openssl/rand.h>
+#include <openssl/err.h>
 #include <openssl/des.h>
 #ifdef HAVE_AES
 #include <openssl/aes.h>
 #endif
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+/* keyed hash contexts keep a keyed EVP_MAC_CTX to duplicate per message */
+#define NETSNMP_SCAPI_EVP_MAC 1
+static EVP_MAC *sc_hmac = NULL;
+#endif
 
 #ifndef NETSNMP_DISABLE_DES
 #ifdef HAVE_STRUCT_DES_KS_STRUCT_WEAK_KEY
@@ -566,9 +573,36 @@ sc_init(void)
      */
 #endif                          /* ifndef NETSNMP_USE_OPENSSL */
 
+#ifdef NETSNMP_SCAPI_EVP_MAC
+    if (NULL == sc_hmac)
+        sc_hmac = EVP_MAC_fetch(NULL, OSSL_MAC_NAME_HMAC, NULL);
+#endif
+
     return rval;
 }                               /* end sc_init() */
 
+/*******************************************************************-o-******
+ * sc_shutdown
+ *
+ * Releases what sc_init() set up.
+ *
+ * Returns:
+ *	SNMPERR_SUCCESS			Success.
+ */
+int
+sc_shutdown(int majorID, int minorID, void *serverarg, void *clientarg)
+{
+#ifdef NETSNMP_SCAPI_EVP_MAC
+    /*
+     * the keyed hash contexts still around hold references of their own
+     */
+    EVP_MAC_free(sc_hmac);
+    sc_hmac = NULL;
+#endif
+
+    return SNMPERR_SUCCESS;
+}                               /* end sc_shutdown() */
+
 /*******************************************************************-o-******
  * sc_random
  *
@@ -1139,6 +1173,227 @@ sc_check_keyed_hash(const oid * authtypeOID, size_t authtypeOIDlen,
 #else
 _SCAPI_NOT_CONFIGURED
 #endif                          /* NETSNMP_USE_INTERNAL_MD5 */
+
+/*
+ * A keyed hash context holds a localized authentication key.  With
+ * OpenSSL 3 the HMAC inner and outer states are computed once, when the
+ * context is created, and only copied for each message; otherwise the
+ * context just remembers the key for sc_generate_keyed_hash().
+ */
+struct netsnmp_keyed_hash_ctx_s {
+    int             refcnt;
+    int             auth_type;
+    u_char         *key;
+    u_int           keylen;
+#ifdef NETSNMP_SCAPI_EVP_MAC
+    EVP_MAC_CTX    *mac;
+#endif
+};
+
+#ifdef NETSNMP_SCAPI_EVP_MAC
+/*
+ * fetched by sc_init(), before any thread may create a context, and
+ * released by sc_shutdown(). Without it, contexts are not precomputed.
+ */
+static EVP_MAC *
+_sc_get_hmac(void)
+{
+    return sc_hmac;
+}
+#endif
+
+/*******************************************************************-o-******
+ * sc_keyed_hash_ctx_new
+ *
+ * Parameters:
+ *	 authtype	Type of authentication transform.
+ *	 authtypelen
+ *	*key		Pointer to key (Kul) to use in keyed hash.
+ *	 keylen		Length of key in bytes.
+ *
+ * Returns:
+ *	a context with one reference, or NULL if the transform or the key
+ *	length is not supported.
+ */
+netsnmp_keyed_hash_ctx *
+sc_keyed_hash_ctx_new(const oid * authtypeOID, size_t authtypeOIDlen,
+                      const u_char * key, u_int keylen)
+{
+    netsnmp_keyed_hash_ctx *ctx;
+    int             auth_type, properlength;
+#ifdef NETSNMP_SCAPI_EVP_MAC
+    const EVP_MD   *hashfn;
+    OSSL_PARAM      params[2];
+#endif
+
+    if (!authtypeOID || !key || keylen <= 0)
+        return NULL;
+
+    auth_type = sc_get_authtype(authtypeOID, authtypeOIDlen);
+    properlength = sc_get_auth_maclen(auth_type);
+    if (auth_type < 0 || properlength <= 0 || keylen < (u_int)properlength)
+        return NULL;
+
+    ctx = SNMP_MALLOC_TYPEDEF(netsnmp_keyed_hash_ctx);
+    if (NULL == ctx)
+        return NULL;
+    ctx->key = netsnmp_memdup(key, keylen);
+    if (NULL == ctx->key) {
+        free(ctx);
+        return NULL;
+    }
+    ctx->refcnt = 1;
+    ctx->auth_type = auth_type;
+    ctx->keylen = keylen;
+
+#ifdef NETSNMP_SCAPI_EVP_MAC
+    hashfn = sc_get_openssl_hashfn(auth_type);
+    if (hashfn && _sc_get_hmac()) {
+        params[0] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST,
+                        NETSNMP_REMOVE_CONST(char *, EVP_MD_get0_name(hashfn)), 0);
+        params[1] = OSSL_PARAM_construct_end();
+        ctx->mac = EVP_MAC_CTX_new(_sc_get_hmac());
+        if (ctx->mac && !EVP_MAC_init(ctx->mac, key, keylen, params)) {
+            /* sc_generate_keyed_hash() will report the error */
+            EVP_MAC_CTX_free(ctx->mac);
+            ctx->mac = NULL;
+        }
+    }
+    DEBUGMSGTL(("scapi", "keyed hash context for %s%s\n",
+                sc_get_auth_name(auth_type),
+                ctx->mac ? "" : " (not precomputed)"));
+#endif
+
+    return ctx;
+}
+
+/*
+ * Adds a reference to a keyed hash context, e.g. for a cached
+ * usmStateReference which may outlive the user.
+ */
+netsnmp_keyed_hash_ctx *
+sc_keyed_hash_ctx_ref(netsnmp_keyed_hash_ctx *ctx)
+{
+    if (ctx)
+        ctx->refcnt++;
+    return ctx;
+}
+
+/*
+ * Drops a reference to a keyed hash context, and frees it with the last.
+ */
+void
+sc_keyed_hash_ctx_free(netsnmp_keyed_hash_ctx *ctx)
+{
+    if (NULL == ctx || --ctx->refcnt > 0)
+        return;
+
+#ifdef NETSNMP_SCAPI_EVP_MAC
+    EVP_MAC_CTX_free(ctx->mac);
+#endif
+    SNMP_ZERO(ctx->key, ctx->keylen);
+    SNMP_FREE(ctx->key);
+    SNMP_FREE(ctx);
+}
+
+/*
+ * Returns 1 if ctx was created for the given transform and key.
+ */
+int
+sc_keyed_hash_ctx_matches(const netsnmp_keyed_hash_ctx *ctx,
+                          const oid * authtypeOID, size_t authtypeOIDlen,
+                          const u_char * key, u_int keylen)
+{
+    return ctx && authtypeOID && key && ctx->keylen == keylen &&
+        ctx->auth_type == sc_get_authtype(authtypeOID, authtypeOIDlen) &&
+        memcmp(ctx->key, key, keylen) == 0;
+}
+
+/*******************************************************************-o-******
+ * sc_generate_keyed_hash_ctx
+ *
+ * Like sc_generate_keyed_hash(), with the transform and key of ctx.
+ */
+int
+sc_generate_keyed_hash_ctx(netsnmp_keyed_hash_ctx *ctx,
+                           const u_char * message, u_int msglen,
+                           u_char * MAC, size_t * maclen)
+{
+#ifdef NETSNMP_SCAPI_EVP_MAC
+    int             rval = SNMPERR_SUCCESS;
+    u_char          buf[EVP_MAX_MD_SIZE];
+    size_t          buf_len = 0;
+    EVP_MAC_CTX    *mac;
+#endif
+    const oid      *authtypeOID;
+    size_t          authtypeOIDlen;
+
+    DEBUGTRACE;
+
+    if (!ctx || !message || !MAC || !maclen || msglen <= 0 || *maclen <= 0)
+        return SNMPERR_GENERR;
+
+#ifdef NETSNMP_SCAPI_EVP_MAC
+    if (ctx->mac) {
+        mac = EVP_MAC_CTX_dup(ctx->mac);
+        if (NULL == mac)
+            return SNMPERR_GENERR;
+        if (!EVP_MAC_update(mac, message, msglen) ||
+            !EVP_MAC_final(mac, buf, &buf_len, sizeof(buf)) ||
+            buf_len !=
+            (size_t)sc_get_proper_auth_length_bytype(ctx->auth_type)) {
+            QUITFUN(SNMPERR_GENERR, sc_generate_keyed_hash_ctx_quit);
+        }
+        if (*maclen > buf_len)
+            *maclen = buf_len;
+        memcpy(MAC, buf, *maclen);
+
+      sc_generate_keyed_hash_ctx_quit:
+        EVP_MAC_CTX_free(mac);
+        memset(buf, 0, sizeof(buf));
+        return rval;
+    }
+#endif
+
+    authtypeOID = sc_get_auth_oid(ctx->auth_type, &authtypeOIDlen);
+    return sc_generate_keyed_hash(authtypeOID, authtypeOIDlen, ctx->key,
+                                  ctx->keylen, message, msglen, MAC, maclen);
+}
+
+/*******************************************************************-o-******
+ * sc_check_keyed_hash_ctx
+ *
+ * Like sc_check_keyed_hash(), with the transform and key of ctx.
+ */
+int
+sc_check_keyed_hash_ctx(netsnmp_keyed_hash_ctx *ctx,
+                        const u_char * message, u_int msglen,
+                        const u_char * MAC, u_int maclen)
+{
+    int             rval = SNMPERR_SUCCESS, auth_size;
+    u_char          buf[SNMP_MAXBUF_SMALL];
+    size_t          buf_len = sizeof(buf);
+
+    DEBUGTRACE;
+
+    if (!ctx || !message || !MAC || msglen <= 0 || maclen <= 0)
+        return SNMPERR_GENERR;
+
+    auth_size = sc_get_auth_maclen(ctx->auth_type);
+    if (0 == auth_size || maclen != auth_size || maclen > msglen)
+        return SNMPERR_GENERR;
+
+    rval = sc_generate_keyed_hash_ctx(ctx, message, msglen, buf, &buf_len);
+    QUITFUN(rval, sc_check_keyed_hash_ctx_quit);
+
+    if (memcmp(buf, MAC, maclen) != 0) {
+        QUITFUN(SNMPERR_GENERR, sc_check_keyed_hash_ctx_quit);
+    }
+
+  sc_check_keyed_hash_ctx_quit:
+    memset(buf, 0, buf_len);
+    return rval;
+}
 /*******************************************************************-o-******
  * sc_encrypt
  *
@@ -1631,6 +1886,272 @@ sc_decrypt(const oid * privtype, size_t privtypelen,
 }
 #endif                          /* NETSNMP_USE_OPENSSL */
 
+/*
+ * A cipher context holds a localized privacy key.  With OpenSSL the key
+ * schedule is computed once, when the context is created, and each
+ * message works on a copy with its own IV, so that a context may be
+ * used by several threads at once; otherwise, or if OpenSSL does not
+ * provide the cipher (e.g. DES without the legacy provider of OpenSSL
+ * 3), the context just remembers the key for sc_encrypt() and
+ * sc_decrypt().  Callers serialize sc_cipher_ctx_ref() and
+ * sc_cipher_ctx_free().
+ */
+#if defined(NETSNMP_USE_OPENSSL) && defined(NETSNMP_ENABLE_SCAPI_AUTHPRIV)
+#define NETSNMP_SCAPI_CIPHER_CTX 1
+#endif
+
+struct netsnmp_cipher_ctx_s {
+    int             refcnt;
+    const netsnmp_priv_alg_info *pai;
+    u_char         *key;
+    u_int           keylen;
+#ifdef NETSNMP_SCAPI_CIPHER_CTX
+    EVP_CIPHER_CTX *enc;
+    EVP_CIPHER_CTX *dec;
+#endif
+};
+
+/*******************************************************************-o-******
+ * sc_cipher_ctx_new
+ *
+ * Parameters:
+ *	 privtype	Type of privacy cryptographic transform.
+ *	*key		Key bits for crypting.
+ *	 keylen		Length of key (buffer) in bytes.
+ *
+ * Returns:
+ *	a context with one reference, or NULL if the transform or the key
+ *	length is not supported.
+ */
+netsnmp_cipher_ctx *
+sc_cipher_ctx_new(const oid * privtype, size_t privtypelen,
+                  const u_char * key, u_int keylen)
+{
+    netsnmp_cipher_ctx *ctx;
+    const netsnmp_priv_alg_info *pai;
+#ifdef NETSNMP_SCAPI_CIPHER_CTX
+    const EVP_CIPHER *cipher = NULL;
+#endif
+
+    if (!privtype || !key || keylen <= 0)
+        return NULL;
+
+    pai = sc_get_priv_alg_byoid(privtype, privtypelen);
+    if (NULL == pai || pai->proper_length <= 0 ||
+        keylen < (u_int)pai->proper_length)
+        return NULL;
+
+    ctx = SNMP_MALLOC_TYPEDEF(netsnmp_cipher_ctx);
+    if (NULL == ctx)
+        return NULL;
+    ctx->key = netsnmp_memdup(key, keylen);
+    if (NULL == ctx->key) {
+        free(ctx);
+        return NULL;
+    }
+    ctx->refcnt = 1;
+    ctx->pai = pai;
+    ctx->keylen = keylen;
+
+#ifdef NETSNMP_SCAPI_CIPHER_CTX
+#if !defined(NETSNMP_DISABLE_DES) && !defined(OLD_DES)
+    if (USM_CREATE_USER_PRIV_DES == (pai->type & USM_PRIV_MASK_ALG))
+        cipher = EVP_des_cbc();
+#endif
+#ifdef HAVE_AES
+    if (USM_CREATE_USER_PRIV_AES == (pai->type & USM_PRIV_MASK_ALG))
+        cipher = sc_get_openssl_privfn(pai->type);
+#endif
+    if (cipher) {
+        ctx->enc = EVP_CIPHER_CTX_new();
+        ctx->dec = EVP_CIPHER_CTX_new();
+        if (!ctx->enc || !ctx->dec ||
+            EVP_EncryptInit_ex(ctx->enc, cipher, NULL, key, NULL) != 1 ||
+            EVP_DecryptInit_ex(ctx->dec, cipher, NULL, key, NULL) != 1) {
+            /* sc_encrypt() and sc_decrypt() are used instead */
+            ERR_clear_error();
+            EVP_CIPHER_CTX_free(ctx->enc);
+            EVP_CIPHER_CTX_free(ctx->dec);
+            ctx->enc = ctx->dec = NULL;
+        } else if (pai->pad_size > 0) {
+            /* sc_encrypt_ctx() pads the way the USM does */
+            EVP_CIPHER_CTX_set_padding(ctx->enc, 0);
+            EVP_CIPHER_CTX_set_padding(ctx->dec, 0);
+        }
+    }
+    DEBUGMSGTL(("scapi", "cipher context for %s%s\n", pai->name,
+                ctx->enc ? "" : " (not precomputed)"));
+#else
+    DEBUGMSGTL(("scapi", "cipher context for %s\n", pai->name));
+#endif /* NETSNMP_SCAPI_CIPHER_CTX */
+
+    return ctx;
+}
+
+/*
+ * Adds a reference to a cipher context.
+ */
+netsnmp_cipher_ctx *
+sc_cipher_ctx_ref(netsnmp_cipher_ctx *ctx)
+{
+    if (ctx)
+        ctx->refcnt++;
+    return ctx;
+}
+
+/*
+ * Drops a reference to a cipher context, and frees it with the last.
+ */
+void
+sc_cipher_ctx_free(netsnmp_cipher_ctx *ctx)
+{
+    if (NULL == ctx || --ctx->refcnt > 0)
+        return;
+
+#ifdef NETSNMP_SCAPI_CIPHER_CTX
+    EVP_CIPHER_CTX_free(ctx->enc);
+    EVP_CIPHER_CTX_free(ctx->dec);
+#endif
+    SNMP_ZERO(ctx->key, ctx->keylen);
+    SNMP_FREE(ctx->key);
+    SNMP_FREE(ctx);
+}
+
+/*
+ * Returns 1 if ctx was created for the given transform and key.
+ */
+int
+sc_cipher_ctx_matches(const netsnmp_cipher_ctx *ctx,
+                      const oid * privtype, size_t privtypelen,
+                      const u_char * key, u_int keylen)
+{
+    return ctx && privtype && key && ctx->keylen == keylen &&
+        ctx->pai == sc_get_priv_alg_byoid(privtype, privtypelen) &&
+        memcmp(ctx->key, key, keylen) == 0;
+}
+
+/*******************************************************************-o-******
+ * sc_encrypt_ctx
+ *
+ * Like sc_encrypt(), with the transform and key of ctx.  plaintext and
+ * ciphertext may be the same buffer, which must then have room for the
+ * padding.
+ */
+int
+sc_encrypt_ctx(netsnmp_cipher_ctx *ctx, u_char * iv, u_int ivlen,
+               const u_char * plaintext, u_int ptlen,
+               u_char * ciphertext, size_t * ctlen)
+{
+    int             rval = SNMPERR_SUCCESS;
+#ifdef NETSNMP_SCAPI_CIPHER_CTX
+    u_char          pad_block[128];
+    int             pad = 0, plast = ptlen, pad_size;
+    int             len, len2 = 0, len3;
+    EVP_CIPHER_CTX *enc;
+#endif /* NETSNMP_SCAPI_CIPHER_CTX */
+    DEBUGTRACE;
+
+    if (!ctx || !iv || !plaintext || !ciphertext || !ctlen || ivlen <= 0 ||
+        ivlen < (u_int)ctx->pai->iv_length || ptlen <= 0 || ptlen > *ctlen) {
+        DEBUGMSGTL(("scapi:encrypt", "bad arguments\n"));
+        return SNMPERR_SC_GENERAL_FAILURE;
+    }
+
+#ifdef NETSNMP_SCAPI_CIPHER_CTX
+    if (ctx->enc) {
+        pad_size = ctx->pai->pad_size;
+        if (pad_size > 0) {
+            pad = pad_size - (ptlen % pad_size);
+            plast = (int) ptlen - (pad_size - pad);
+            if (pad == pad_size)
+                pad = 0;
+            if (ptlen + pad > *ctlen) {
+                DEBUGMSGTL(("scapi:encrypt", "not enough space\n"));
+                return SNMPERR_SC_GENERAL_FAILURE;
+            }
+            if (pad > 0) {      /* copy data into pad block if needed */
+                memcpy(pad_block, plaintext + plast, pad_size - pad);
+                memset(&pad_block[pad_size - pad], pad, pad);
+            }
+        }
+        /* a copy of the key schedule, with only the IV set */
+        enc = EVP_CIPHER_CTX_new();
+        if (NULL == enc || EVP_CIPHER_CTX_copy(enc, ctx->enc) != 1 ||
+            EVP_EncryptInit_ex(enc, NULL, NULL, NULL, iv) != 1 ||
+            EVP_EncryptUpdate(enc, ciphertext, &len, plaintext,
+                              plast) != 1 ||
+            (pad > 0 &&
+             EVP_EncryptUpdate(enc, ciphertext + len, &len2, pad_block,
+                               pad_size) != 1) ||
+            EVP_EncryptFinal_ex(enc, ciphertext + len + len2,
+                                &len3) != 1) {
+            DEBUGMSGTL(("scapi:encrypt", "openssl error\n"));
+            rval = SNMPERR_SC_GENERAL_FAILURE;
+        } else
+            *ctlen = len + len2 + len3;
+        EVP_CIPHER_CTX_free(enc);
+        if (pad > 0)
+            memset(pad_block, 0, sizeof(pad_block));
+        return rval;
+    }
+#endif /* NETSNMP_SCAPI_CIPHER_CTX */
+
+    return sc_encrypt(ctx->pai->alg_oid, ctx->pai->oid_len,
+                      ctx->key, ctx->keylen, iv, ivlen,
+                      plaintext, ptlen, ciphertext, ctlen);
+}
+
+/*******************************************************************-o-******
+ * sc_decrypt_ctx
+ *
+ * Like sc_decrypt(), with the transform and key of ctx.  ciphertext and
+ * plaintext may be the same buffer, to decrypt in place.
+ */
+int
+sc_decrypt_ctx(netsnmp_cipher_ctx *ctx, u_char * iv, u_int ivlen,
+               u_char * ciphertext, u_int ctlen,
+               u_char * plaintext, size_t * ptlen)
+{
+    int             rval = SNMPERR_SUCCESS;
+#ifdef NETSNMP_SCAPI_CIPHER_CTX
+    int             len, len2;
+    EVP_CIPHER_CTX *dec;
+#endif /* NETSNMP_SCAPI_CIPHER_CTX */
+    DEBUGTRACE;
+
+    if (!ctx || !iv || !plaintext || !ciphertext || !ptlen || ctlen <= 0 ||
+        ivlen < (u_int)ctx->pai->iv_length || *ptlen < ctlen) {
+        DEBUGMSGTL(("scapi", "decrypt: arg sanity checks failed\n"));
+        return SNMPERR_SC_GENERAL_FAILURE;
+    }
+
+#ifdef NETSNMP_SCAPI_CIPHER_CTX
+    /*
+     * without padding, a block cipher only decrypts whole blocks; other
+     * lengths are left to sc_decrypt()
+     */
+    if (ctx->dec &&
+        (ctx->pai->pad_size <= 0 || ctlen % ctx->pai->pad_size == 0)) {
+        dec = EVP_CIPHER_CTX_new();
+        if (NULL == dec || EVP_CIPHER_CTX_copy(dec, ctx->dec) != 1 ||
+            EVP_DecryptInit_ex(dec, NULL, NULL, NULL, iv) != 1 ||
+            EVP_DecryptUpdate(dec, plaintext, &len, ciphertext,
+                              ctlen) != 1 ||
+            EVP_DecryptFinal_ex(dec, plaintext + len, &len2) != 1) {
+            DEBUGMSGTL(("scapi", "decrypt: openssl error\n"));
+            rval = SNMPERR_SC_GENERAL_FAILURE;
+        } else
+            *ptlen = ctlen;
+        EVP_CIPHER_CTX_free(dec);
+        return rval;
+    }
+#endif /* NETSNMP_SCAPI_CIPHER_CTX */
+
+    return sc_decrypt(ctx->pai->alg_oid, ctx->pai->oid_len,
+                      ctx->key, ctx->keylen, iv, ivlen,
+                      ciphertext, ctlen, plaintext, ptlen);
+}
+
 #ifdef NETSNMP_USE_INTERNAL_CRYPTO
 
 /* These functions are basically copies of the MDSign() routine in
@@ -125,11 +125,18 @@ netsnmp_dateandtime_set_buf_from_vars(u_char *buf, size_t *bufsize,
 #endif /* NETSNMP_FEATURE_REMOVE_NETSNMP_DATEANDTIME_SET_BUF_FROM_VARS */
 
 #ifndef NETSNMP_FEATURE_REMOVE_DATE_N_TIME
+/*
+ * Same as date_n_time(), but formats the DateAndTime into string, which
+ * must have room for 11 bytes, so that it can be used from more than
+ * one thread.
+ */
 u_char         *
-date_n_time(const time_t * when, size_t * length)
+date_n_time_r(const time_t * when, u_char * string, size_t * length)
 {
     struct tm      *tm_p;
-    static u_char   string[11];
+#ifdef HAVE_LOCALTIME_R
+    struct tm       tm;
+#endif
     unsigned short yauron;
 
     /*
@@ -152,7 +159,11 @@ date_n_time(const time_t * when, size_t * length)
     /*
      * Basic 'local' time handling
      */
+#ifdef HAVE_LOCALTIME_R
+    tm_p = localtime_r(when, &tm);
+#else
     tm_p = localtime(when);
+#endif
     yauron = tm_p->tm_year + 1900;
     string[0] = (u_char)(yauron >> 8);
     string[1] = (u_char)yauron;
@@ -204,6 +215,14 @@ date_n_time(const time_t * when, size_t * length)
 
     return string;
 }
+
+u_char         *
+date_n_time(const time_t * when, size_t * length)
+{
+    static u_char   string[11];
+
+    return date_n_time_r(when, string, length);
+}
 #endif /* NETSNMP_FEATURE_REMOVE_DATE_N_TIME */
 
 #ifndef NETSNMP_FEATURE_REMOVE_CTIME_TO_TIMET
@@ -101,6 +101,9 @@ SOFTWARE.
 #endif
 #endif
 #include <errno.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #if HAVE_LOCALE_H
 #include <locale.h>
@@ -211,10 +214,13 @@ struct snmp_internal_session {
     size_t        packet_len;  /* length of data received so far */
     size_t        packet_size; /* size of buffer for packet data */
 
-    u_char       *obuf;         /* send packet buffer */
+    u_char       *obuf;         /* send packet buffer (kept between sends) */
     size_t        obuf_size;    /* size of buffer for packet data */
     u_char       *opacket;      /* send packet data (within obuf) */
     size_t        opacket_len;  /* length of data */
+    int           obuf_idle;    /* sends in a row that used little of obuf */
+
+    int           watched_fd;   /* socket watched for the fd poller, or -1 */
 };
 
 /*
@@ -324,6 +330,14 @@ static long     Reqid = 0;      /* MT_LIB_REQUESTID */
 static long     Msgid = 0;      /* MT_LIB_MESSAGEID */
 static long     Sessid = 0;     /* MT_LIB_SESSIONID */
 static long     Transid = 0;    /* MT_LIB_TRANSID */
+/*
+ * Requests outstanding on all sessions, and whether a session transport
+ * has been closed, so that loops watching the session sockets only walk
+ * the session list when a request may time out or a session needs to be
+ * closed.  MT_LIB_SESSION
+ */
+static int      requests_outstanding = 0;
+static int      sessions_closed = 0;
 int             snmp_errno = 0;
 /*
  * END MTCRITICAL_RESOURCE
@@ -836,6 +850,8 @@ register_default_handlers(void)
 		      NETSNMP_DS_LIBRARY_ID, NETSNMP_DS_LIB_SERVERSENDBUF);
     netsnmp_ds_register_config(ASN_INTEGER, "snmp", "serverRecvBuf",
 		      NETSNMP_DS_LIBRARY_ID, NETSNMP_DS_LIB_SERVERRECVBUF);
+    netsnmp_ds_register_config(ASN_INTEGER, "snmp", "udpBatchSize",
+		      NETSNMP_DS_LIBRARY_ID, NETSNMP_DS_LIB_UDP_BATCH_SIZE);
     netsnmp_ds_register_config(ASN_INTEGER, "snmp", "clientSendBuf",
 		      NETSNMP_DS_LIBRARY_ID, NETSNMP_DS_LIB_CLIENTSENDBUF);
     netsnmp_ds_register_config(ASN_INTEGER, "snmp", "clientRecvBuf",
@@ -1005,6 +1021,8 @@ snmp_shutdown(const char *type)
     _init_snmp_init_done = 0;
 }
 
+static void     _sess_fd_ready(int fd, void *data);
+
 /*
  * inserts session into session list
  */
@@ -1016,9 +1034,24 @@ void  snmp_session_insert(struct session_list *slp)
     snmp_res_lock(MT_LIBRARY_ID, MT_LIB_SESSION);
     slp->next = Sessions;
     Sessions = slp;
+    if (slp->internal && slp->transport && slp->transport->sock >= 0 &&
+        netsnmp_fd_watch(slp->transport->sock, NETSNMP_FD_WATCH_READ,
+                         _sess_fd_ready, slp) == 0)
+        slp->internal->watched_fd = slp->transport->sock;
     snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_SESSION);
 }
 
+/* stops watching the socket of a session taken off the session list */
+static void
+_sess_unwatch(struct session_list *slp)
+{
+    if (slp->internal && slp->internal->watched_fd >= 0) {
+        netsnmp_fd_unwatch(slp->internal->watched_fd, NETSNMP_FD_WATCH_READ,
+                           slp);
+        slp->internal->watched_fd = -1;
+    }
+}
+
 /*
  * Sets up the session with the snmp_session information provided by the user.
  * Then opens and binds the necessary low-level transport.  A handle to the
@@ -1111,6 +1144,7 @@ _sess_copy(netsnmp_session * in_session)
         in_session->s_snmp_errno = SNMPERR_MALLOC;
         return (NULL);
     }
+    isp->watched_fd = -1;
 
     slp->internal = isp;
     slp->session = netsnmp_memdup(in_session, sizeof(netsnmp_session));
@@ -1969,6 +2003,7 @@ snmp_sess_close(struct session_list *slp)
         netsnmp_request_list *rp, *orp;
 
         SNMP_FREE(isp->packet);
+        SNMP_FREE(isp->obuf);
 
         /*
          * Free each element in the input request list.  
@@ -1984,6 +2019,7 @@ snmp_sess_close(struct session_list *slp)
             }
             snmp_free_pdu(orp->pdu);
             free((char *) orp);
+            requests_outstanding--;
         }
 
         free((char *) isp);
@@ -2049,6 +2085,7 @@ snmp_close(netsnmp_session * session)
     if (slp == NULL) {
         return 0;
     }
+    _sess_unwatch(slp);
     return snmp_sess_close(slp);
 }
 
@@ -2061,6 +2098,7 @@ snmp_close_sessions(void)
     while (Sessions) {
         slp = Sessions;
         Sessions = Sessions->next;
+        _sess_unwatch(slp);
         snmp_sess_close(slp);
     }
     snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_SESSION);
@@ -3443,84 +3481,51 @@ snmp_pdu_realloc_rbuild(u_char ** pkt, size_t * pkt_len, size_t * offset,
 #ifndef VPCACHE_SIZE
 #define VPCACHE_SIZE 50
 #endif
-    netsnmp_variable_list *vpcache[VPCACHE_SIZE];
-    netsnmp_variable_list *vp, *tmpvp;
+    netsnmp_variable_list *vpcache[VPCACHE_SIZE], **vps = vpcache;
+    netsnmp_variable_list *vp;
     size_t          start_offset = *offset;
-    int             i, wrapped = 0, notdone, final, rc = 0;
+    int             i, count = 0, rc = 0;
 
     DEBUGMSGTL(("snmp_pdu_realloc_rbuild", "starting\n"));
-    for (vp = pdu->variables, i = VPCACHE_SIZE - 1; vp;
-         vp = vp->next_variable, i--) {
-        /*
-         * if estimated getbulk response size exceeded packet max size,
-         * processing was stopped before bulk cache was filled and type
-         * was set to ASN_PRIV_STOP, indicating that the rest of the varbinds
-         * in the cache are empty and we can stop encoding them.
-         */
-        if (ASN_PRIV_STOP == vp->type)
-            break;
-        if (i < 0) {
-            wrapped = notdone = 1;
-            i = VPCACHE_SIZE - 1;
-            DEBUGMSGTL(("snmp_pdu_realloc_rbuild", "wrapped\n"));
-        }
-        vpcache[i] = vp;
-    }
-    final = i + 1;
+    /*
+     * if estimated getbulk response size exceeded packet max size,
+     * processing was stopped before bulk cache was filled and type
+     * was set to ASN_PRIV_STOP, indicating that the rest of the varbinds
+     * in the cache are empty and we can stop encoding them.
+     */
+    for (vp = pdu->variables; vp && ASN_PRIV_STOP != vp->type;
+         vp = vp->next_variable)
+        count++;
 
-    do {
-        for (i = final; i < VPCACHE_SIZE; i++) {
-            vp = vpcache[i];
-            DEBUGDUMPSECTION("send", "VarBind");
-            rc = snmp_realloc_rbuild_var_op(pkt, pkt_len, offset, 1,
-                                            vp->name, &vp->name_length,
-                                            vp->type,
-                                            (u_char *) vp->val.string,
-                                            vp->val_len);
-            DEBUGINDENTLESS();
-            if (rc == 0) {
-                return 0;
-            }
-        }
+    /*
+     * The varbinds are encoded last to first, so collect them in an array
+     * that is walked backwards.
+     */
+    if (count > VPCACHE_SIZE) {
+        vps = (netsnmp_variable_list **) malloc(count * sizeof(*vps));
+        if (vps == NULL)
+            return 0;
+    }
+    for (vp = pdu->variables, i = 0; i < count; vp = vp->next_variable)
+        vps[i++] = vp;
 
+    for (i = count - 1; i >= 0; i--) {
+        vp = vps[i];
+        DEBUGDUMPSECTION("send", "VarBind");
+        rc = snmp_realloc_rbuild_var_op(pkt, pkt_len, offset, 1,
+                                        vp->name, &vp->name_length,
+                                        vp->type,
+                                        (u_char *) vp->val.string,
+                                        vp->val_len);
         DEBUGINDENTLESS();
-        if (wrapped) {
-            notdone = 1;
-            for (i = 0; i < final; i++) {
-                vp = vpcache[i];
-                DEBUGDUMPSECTION("send", "VarBind");
-                rc = snmp_realloc_rbuild_var_op(pkt, pkt_len, offset, 1,
-                                                vp->name, &vp->name_length,
-                                                vp->type,
-                                                (u_char *) vp->val.string,
-                                                vp->val_len);
-                DEBUGINDENTLESS();
-                if (rc == 0) {
-                    return 0;
-                }
-            }
-
-            if (final == 0) {
-                tmpvp = vpcache[VPCACHE_SIZE - 1];
-            } else {
-                tmpvp = vpcache[final - 1];
-            }
-            wrapped = 0;
-
-            for (vp = pdu->variables, i = VPCACHE_SIZE - 1;
-                 vp && vp != tmpvp; vp = vp->next_variable, i--) {
-                if (i < 0) {
-                    wrapped = 1;
-                    i = VPCACHE_SIZE - 1;
-                    DEBUGMSGTL(("snmp_pdu_realloc_rbuild", "wrapped\n"));
-                }
-                vpcache[i] = vp;
-            }
-            final = i + 1;
-        } else {
-            notdone = 0;
-        }
-    } while (notdone);
+        if (rc == 0)
+            break;
+    }
+    DEBUGINDENTLESS();
+    if (vps != vpcache)
+        free(vps);
+    if (rc == 0 && count > 0)
+        return 0;
 
     /*
      * Save current location and build SEQUENCE tag and length placeholder for
@@ -4942,6 +4947,53 @@ snmpv3_scopedPDU_parse(netsnmp_pdu *pdu, u_char * cp, size_t * length)
  *
  * build pdu packet
  */
+
+/*
+ * Send buffers up to SNMP_OBUF_KEEP_MAX bytes are kept by the session
+ * for the next PDU.  A kept buffer larger than SNMP_OBUF_SHRINK_MIN is
+ * released once SNMP_OBUF_IDLE_SENDS sends in a row have used less than
+ * a quarter of it, so one large response doesn't pin it for good.
+ */
+#define SNMP_OBUF_KEEP_MAX      (16 * 1024)
+#define SNMP_OBUF_SHRINK_MIN    (4 * 1024)
+#define SNMP_OBUF_IDLE_SENDS    16
+
+/*
+ * Returns an upper bound for the encoded size of a PDU, so that the
+ * packet buffer can be allocated once instead of being grown (and its
+ * contents moved) while the packet is built in reverse.  Header and
+ * security parameter overhead is covered by a fixed allowance; should
+ * the estimate ever be short, the builders still grow the buffer.
+ */
+static size_t
+_snmp_predict_packet_size(netsnmp_session *sp, netsnmp_pdu *pdu)
+{
+    /* worst case number of bytes per encoded sub-identifier */
+    const size_t    subid_max = (sizeof(oid) * 8 + 6) / 7;
+    netsnmp_variable_list *vp;
+    size_t          size;
+
+    size = 256 + sp->community_len + pdu->community_len +
+        sp->securityNameLen + pdu->securityNameLen +
+        sp->contextNameLen + pdu->contextNameLen +
+        sp->contextEngineIDLen + pdu->contextEngineIDLen +
+        sp->securityEngineIDLen + pdu->securityEngineIDLen +
+        pdu->enterprise_length * subid_max;
+
+    for (vp = pdu->variables; vp; vp = vp->next_variable) {
+        if (ASN_PRIV_STOP == vp->type)
+            break;
+        /* varbind, name and value headers, opaque wrapping */
+        size += 24 + vp->name_length * subid_max;
+        if (ASN_OBJECT_ID == vp->type)
+            size += vp->val_len / sizeof(oid) * subid_max;
+        else
+            size += vp->val_len;
+    }
+
+    return size;
+}
+
 int
 netsnmp_build_packet(struct snmp_internal_session *isp, netsnmp_session *sp,
                      netsnmp_pdu *pdu, u_char **pktbuf_p,
@@ -5006,7 +5058,11 @@ _build_initial_pdu_packet(struct session_list *slp, netsnmp_pdu *pdu, int bulk)
         return SNMPERR_GENERR;
     }
 
-    SNMP_FREE(isp->obuf); /* should already be NULL */
+    if (isp->opacket) {
+        /* a built packet that was never sent */
+        isp->opacket = NULL;
+        isp->opacket_len = 0;
+    }
 
     session->s_snmp_errno = 0;
     session->s_errno = 0;
@@ -5085,15 +5141,26 @@ _build_initial_pdu_packet(struct session_list *slp, netsnmp_pdu *pdu, int bulk)
     netsnmp_assert(pdu->msgMaxSize > 0);
 
     /*
-     * allocate initial packet buffer. Buffer will be grown as needed
-     * while building the packet.
+     * Size the packet buffer for the whole PDU up front, reusing the
+     * buffer of the previous send when it is large enough.  The buffer
+     * will still be grown as needed while building the packet.
      */
-    pktbuf_len = SNMP_MIN_MAX_LEN;
-    if ((pktbuf = (u_char *)malloc(pktbuf_len)) == NULL) {
-        DEBUGMSGTL(("sess_async_send",
-                    "couldn't malloc initial packet buffer\n"));
-        session->s_snmp_errno = SNMPERR_MALLOC;
-        return SNMPERR_MALLOC;
+    length = _snmp_predict_packet_size(session, pdu);
+    if (length < SNMP_MIN_MAX_LEN)
+        length = SNMP_MIN_MAX_LEN;
+    pktbuf = isp->obuf;
+    pktbuf_len = isp->obuf_size;
+    isp->obuf = NULL;
+    isp->obuf_size = 0;
+    if (pktbuf_len < length) {
+        SNMP_FREE(pktbuf);
+        pktbuf_len = length;
+        if ((pktbuf = (u_char *)malloc(pktbuf_len)) == NULL) {
+            DEBUGMSGTL(("sess_async_send",
+                        "couldn't malloc initial packet buffer\n"));
+            session->s_snmp_errno = SNMPERR_MALLOC;
+            return SNMPERR_MALLOC;
+        }
     }
 
 #ifdef TEMPORARILY_DISABLED
@@ -5328,7 +5395,23 @@ _sess_async_send(struct session_list *slp,
                                     &(pdu->transport_data),
                                     &(pdu->transport_data_length));
 
-    SNMP_FREE(isp->obuf);
+    /*
+     * Keep the buffer for the next PDU, unless it has grown large or has
+     * been much larger than the recent packets.
+     */
+    if (isp->obuf_size > SNMP_OBUF_SHRINK_MIN &&
+        isp->opacket_len < isp->obuf_size / 4)
+        isp->obuf_idle++;
+    else
+        isp->obuf_idle = 0;
+    if (isp->obuf_size > SNMP_OBUF_KEEP_MAX ||
+        isp->obuf_idle >= SNMP_OBUF_IDLE_SENDS) {
+        DEBUGMSGTL(("sess_async_send", "releasing send buffer of %"
+                    NETSNMP_PRIz "u bytes\n", isp->obuf_size));
+        SNMP_FREE(isp->obuf);
+        isp->obuf_size = 0;
+        isp->obuf_idle = 0;
+    }
     isp->opacket = NULL; /* opacket was in obuf, so no free needed */
     isp->opacket_len = 0;
 
@@ -5400,6 +5483,7 @@ _sess_async_send(struct session_list *slp,
             isp->requests = rp;
             isp->requestsEnd = rp;
         }
+        requests_outstanding++;
         snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_SESSION);
     } else {
         /*
@@ -5677,6 +5761,7 @@ remove_request(struct snmp_internal_session *isp,
     if (isp->requestsEnd == rp)
         isp->requestsEnd = orp;
     snmp_free_pdu(rp->pdu);
+    requests_outstanding--;
 }
 
 /*
@@ -6059,7 +6144,8 @@ _sess_read_dgram_packet(struct session_list *slp, netsnmp_large_fd_set * fdset,
     }
 
     /** clear so any other sess sharing this socket won't try reading again */
-    NETSNMP_LARGE_FD_CLR(transport->sock, fdset);
+    if (fdset)
+        NETSNMP_LARGE_FD_CLR(transport->sock, fdset);
 
     if (0 == rcvp->packet_len &&
         transport->flags & NETSNMP_TRANSPORT_FLAG_EMPTY_PKT) {
@@ -6086,18 +6172,16 @@ _sess_read_dgram_packet(struct session_list *slp, netsnmp_large_fd_set * fdset,
  * MTR: can't lock here and at snmp_read 
  * Beware recursive send maybe inside snmp_read callback function. 
  */
+static int      _sess_read_ready(struct session_list *slp,
+                                 netsnmp_large_fd_set * fdset);
+
 int
 _sess_read(struct session_list *slp, netsnmp_large_fd_set * fdset)
 {
-    netsnmp_session *sp = slp ? slp->session : NULL;
-    struct snmp_internal_session *isp = slp ? slp->internal : NULL;
     netsnmp_transport *transport = slp ? slp->transport : NULL;
-    size_t          pdulen = 0, rxbuf_len = SNMP_MAX_RCV_MSG_SIZE;
-    u_char         *rxbuf = NULL;
-    int             length = 0, olength = 0, rc = 0;
-    void           *opaque = NULL;
 
-    if (NULL == slp || NULL == sp || NULL == isp || NULL == transport) {
+    if (NULL == slp || NULL == slp->session || NULL == slp->internal ||
+        NULL == transport) {
         snmp_log(LOG_ERR, "bad parameters to _sess_read\n");
         return SNMPERR_GENERR;
     }
@@ -6117,6 +6201,24 @@ _sess_read(struct session_list *slp, netsnmp_large_fd_set * fdset)
         return 0;
     }
 
+    return _sess_read_ready(slp, fdset);
+}
+
+/*
+ * Reads from the socket of a session that is ready to be read.  fdset,
+ * if not NULL, is what select() returned.
+ */
+static int
+_sess_read_ready(struct session_list *slp, netsnmp_large_fd_set * fdset)
+{
+    netsnmp_session *sp = slp->session;
+    struct snmp_internal_session *isp = slp->internal;
+    netsnmp_transport *transport = slp->transport;
+    size_t          pdulen = 0, rxbuf_len = SNMP_MAX_RCV_MSG_SIZE;
+    u_char         *rxbuf = NULL;
+    int             length = 0, olength = 0, rc = 0;
+    void           *opaque = NULL;
+
     sp->s_snmp_errno = 0;
     sp->s_errno = 0;
 
@@ -6125,20 +6227,28 @@ _sess_read(struct session_list *slp, netsnmp_large_fd_set * fdset)
 
     if (!(transport->flags & NETSNMP_TRANSPORT_FLAG_STREAM)) {
         snmp_rcv_packet rcvp;
-        memset(&rcvp, 0x0, sizeof(rcvp));
 
-        /** read the packet */
-        rc = _sess_read_dgram_packet(slp, fdset, &rcvp);
-        if (-1 == rc) /* protocol error */
-            return -1;
-        else if (-2 == rc) /* no packet to process */
-            return 0;
+        /*
+         * A transport that read several datagrams at once keeps
+         * NETSNMP_TRANSPORT_FLAG_PENDING set until it has handed out the
+         * last of them; the socket won't select as readable for those.
+         */
+        do {
+            memset(&rcvp, 0x0, sizeof(rcvp));
+
+            /** read the packet */
+            rc = _sess_read_dgram_packet(slp, fdset, &rcvp);
+            if (-1 == rc) /* protocol error */
+                return -1;
+            else if (-2 == rc) /* no packet to process */
+                return 0;
 
-        rc = _sess_process_packet(slp, sp, isp, transport,
-                                  rcvp.opaque, rcvp.olength,
-                                  rcvp.packet, rcvp.packet_len);
-        SNMP_FREE(rcvp.packet);
-        /** opaque is freed in _sess_process_packet */
+            rc = _sess_process_packet(slp, sp, isp, transport,
+                                      rcvp.opaque, rcvp.olength,
+                                      rcvp.packet, rcvp.packet_len);
+            SNMP_FREE(rcvp.packet);
+            /** opaque is freed in _sess_process_packet */
+        } while (transport->flags & NETSNMP_TRANSPORT_FLAG_PENDING);
         return rc;
     }
 
@@ -6414,6 +6524,36 @@ snmp_sess_read2(struct session_list *slp, netsnmp_large_fd_set * fdset)
     return rc;
 }
 
+/*
+ * Called by netsnmp_fd_poller_dispatch() when the socket of a session on
+ * the session list is readable.
+ */
+static void
+_sess_fd_ready(int fd, void *data)
+{
+    struct session_list *slp = (struct session_list *) data;
+    int             rc;
+
+    if (NULL == slp->session || NULL == slp->internal ||
+        NULL == slp->transport || slp->transport->sock != fd)
+        return;
+
+    snmp_res_lock(MT_LIBRARY_ID, MT_LIB_SESSION);
+    rc = _sess_read_ready(slp, NULL);
+    snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_SESSION);
+    if (rc && slp->session->s_snmp_errno)
+        SET_SNMP_ERROR(slp->session->s_snmp_errno);
+
+    /*
+     * A stream whose peer has gone away; snmp_select_info() closes such
+     * sessions, but it isn't called for every wakeup any more.
+     */
+    if (slp->transport && slp->transport->sock < 0) {
+        DEBUGMSGTL(("sess_read", "closing session %p\n", slp->session));
+        snmp_close(slp->session);
+    }
+}
+
 
 /**
  * Returns info about what snmp requires from a select statement.
@@ -6521,7 +6661,11 @@ snmp_sess_select_info2(struct session_list *slp, int *numfds, netsnmp_large_fd_s
  * @param[in,out] block   On input, whether the caller prefers to block forever
  *   when no alarms are active. On output, 0 means that no alarms are active
  *   nor that there is a timeout pending for any of the processed sessions.
- * @param[in]     flags   Either 0 or NETSNMP_SELECT_NOALARMS.
+ * @param[in]     flags   0 or a combination of NETSNMP_SELECT_NOALARMS and
+ *   NETSNMP_SELECT_NOFDS.  With NETSNMP_SELECT_NOFDS, numfds and fdset are
+ *   not used (the session sockets are watched by an fd poller) and the
+ *   sessions are only visited if a request is outstanding or a session
+ *   transport has been closed.
  *
  * @return Number of sessions processed by this function.
  *
@@ -6547,6 +6691,12 @@ snmp_sess_select_info2_flags(struct session_list *sessp, int *numfds,
      * If a single session is specified, do just for that session.
      */
 
+    if ((flags & NETSNMP_SELECT_NOFDS) && !sessp && !requests_outstanding &&
+        !sessions_closed)
+        goto alarms;
+    if (!sessp)
+        sessions_closed = 0;
+
     DEBUGMSGTL(("sess_select", "for %s session%s: ",
                 sessp ? "single" : "all", sessp ? "" : "s"));
 
@@ -6577,11 +6727,12 @@ snmp_sess_select_info2_flags(struct session_list *sessp, int *numfds,
         }
 
         DEBUGMSG(("sess_select", "%d ", slp->transport->sock));
-        if ((slp->transport->sock + 1) > *numfds) {
-            *numfds = (slp->transport->sock + 1);
+        if (!(flags & NETSNMP_SELECT_NOFDS)) {
+            if ((slp->transport->sock + 1) > *numfds) {
+                *numfds = (slp->transport->sock + 1);
+            }
+            NETSNMP_LARGE_FD_SET(slp->transport->sock, fdset);
         }
-
-        NETSNMP_LARGE_FD_SET(slp->transport->sock, fdset);
         if (slp->internal != NULL && slp->internal->requests) {
             /*
              * Found another session with outstanding requests.  
@@ -6608,6 +6759,7 @@ snmp_sess_select_info2_flags(struct session_list *sessp, int *numfds,
     }
     DEBUGMSG(("sess_select", "\n"));
 
+  alarms:
     netsnmp_get_monotonic_clock(&now);
 
     if (netsnmp_ds_get_boolean(NETSNMP_DS_LIBRARY_ID,
@@ -6669,6 +6821,9 @@ void
 snmp_timeout(void)
 {
     struct session_list *slp;
+
+    if (!requests_outstanding)
+        return;
     snmp_res_lock(MT_LIBRARY_ID, MT_LIB_SESSION);
     for (slp = Sessions; slp; slp = slp->next) {
         snmp_sess_timeout(slp);
@@ -6696,12 +6851,13 @@ snmp_resend_request(struct session_list *slp, netsnmp_request_list *orp,
         return 0;
     }
 
-    if ((pktbuf = (u_char *)malloc(2048)) == NULL) {
+    pktbuf_len = _snmp_predict_packet_size(sp, rp->pdu);
+    if (pktbuf_len < 2048)
+        pktbuf_len = 2048;
+    if ((pktbuf = (u_char *)malloc(pktbuf_len)) == NULL) {
         DEBUGMSGTL(("sess_resend",
                     "couldn't malloc initial packet buffer\n"));
         return 0;
-    } else {
-        pktbuf_len = 2048;
     }
 
     if (incr_retries) {
@@ -6844,6 +7000,54 @@ snmp_sess_timeout(struct session_list *slp)
         free((char *) freeme);
         freeme = NULL;
     }
+
+    /* a callback may have closed the transport; see snmp_select_info() */
+    if (slp->transport && slp->transport->sock < 0)
+        sessions_closed = 1;
+}
+
+/*
+ * Returns the index of the first sub-identifier in which name1 and name2
+ * differ, or len if their first len sub-identifiers are equal.
+ *
+ * OID comparisons are among the most frequent operations in the agent,
+ * so blocks of sub-identifiers are compared at once: 32 bytes per step
+ * with SSE2 where the compiler targets it (all x86-64), four
+ * sub-identifiers per step otherwise.  The caller orders the OIDs on the
+ * returned sub-identifier; doing that as separate comparisons avoids
+ * the problems subtraction has with subids > 2^31.
+ */
+NETSNMP_STATIC_INLINE size_t
+_oid_mismatch(const oid *name1, const oid *name2, size_t len)
+{
+    size_t          i = 0;
+
+#ifdef __SSE2__
+#define OID_BLOCK (32 / sizeof(oid))
+    for (; i + OID_BLOCK <= len; i += OID_BLOCK) {
+        __m128i         lo, hi;
+
+        lo = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(name1 + i)),
+                            _mm_loadu_si128((const __m128i *)(name2 + i)));
+        hi = _mm_cmpeq_epi8(
+            _mm_loadu_si128((const __m128i *)(name1 + i + OID_BLOCK / 2)),
+            _mm_loadu_si128((const __m128i *)(name2 + i + OID_BLOCK / 2)));
+        if (_mm_movemask_epi8(_mm_and_si128(lo, hi)) != 0xffff)
+            break;
+    }
+#undef OID_BLOCK
+#else
+    for (; i + 4 <= len; i += 4) {
+        if (((name1[i] ^ name2[i]) | (name1[i + 1] ^ name2[i + 1]) |
+             (name1[i + 2] ^ name2[i + 2]) | (name1[i + 3] ^ name2[i + 3])))
+            break;
+    }
+#endif
+    for (; i < len; i++)
+        if (name1[i] != name2[i])
+            break;
+
+    return i;
 }
 
 /*
@@ -6860,10 +7064,7 @@ snmp_oid_ncompare(const oid * in_name1,
                   size_t len1,
                   const oid * in_name2, size_t len2, size_t max_len)
 {
-    register int    len;
-    register const oid *name1 = in_name1;
-    register const oid *name2 = in_name2;
-    size_t          min_len;
+    size_t          min_len, i;
 
     /*
      * len = minimum of len1 and len2 
@@ -6876,25 +7077,12 @@ snmp_oid_ncompare(const oid * in_name1,
     if (min_len > max_len)
         min_len = max_len;
 
-    len = min_len;
-
     /*
      * find first non-matching OID 
      */
-    while (len-- > 0) {
-        /*
-         * these must be done in seperate comparisons, since
-         * subtracting them and using that result has problems with
-         * subids > 2^31. 
-         */
-        if (*(name1) != *(name2)) {
-            if (*(name1) < *(name2))
-                return -1;
-            return 1;
-        }
-        name1++;
-        name2++;
-    }
+    i = _oid_mismatch(in_name1, in_name2, min_len);
+    if (i < min_len)
+        return in_name1[i] < in_name2[i] ? -1 : 1;
 
     if (min_len != max_len) {
         /*
@@ -6920,9 +7108,7 @@ int
 snmp_oid_compare(const oid * in_name1,
                  size_t len1, const oid * in_name2, size_t len2)
 {
-    register int    len;
-    register const oid *name1 = in_name1;
-    register const oid *name2 = in_name2;
+    size_t          len, i;
 
     /*
      * len = minimum of len1 and len2 
@@ -6934,20 +7120,9 @@ snmp_oid_compare(const oid * in_name1,
     /*
      * find first non-matching OID 
      */
-    while (len-- > 0) {
-        /*
-         * these must be done in seperate comparisons, since
-         * subtracting them and using that result has problems with
-         * subids > 2^31. 
-         */
-        if (*(name1) != *(name2)) {
-            if (*(name1) < *(name2))
-                return -1;
-            return 1;
-        }
-        name1++;
-        name2++;
-    }
+    i = _oid_mismatch(in_name1, in_name2, len);
+    if (i < len)
+        return in_name1[i] < in_name2[i] ? -1 : 1;
     /*
      * both OIDs equal up to length of shorter OID 
      */
@@ -6970,40 +7145,27 @@ netsnmp_oid_compare_ll(const oid * in_name1,
                        size_t len1, const oid * in_name2, size_t len2,
                        size_t *offpt)
 {
-    register int    len;
-    register const oid *name1 = in_name1;
-    register const oid *name2 = in_name2;
-    int initlen;
+    size_t          len, i;
 
     /*
      * len = minimum of len1 and len2 
      */
     if (len1 < len2)
-        initlen = len = len1;
+        len = len1;
     else
-        initlen = len = len2;
+        len = len2;
     /*
      * find first non-matching OID 
      */
-    while (len-- > 0) {
-        /*
-         * these must be done in seperate comparisons, since
-         * subtracting them and using that result has problems with
-         * subids > 2^31. 
-         */
-        if (*(name1) != *(name2)) {
-            *offpt = initlen - len;
-            if (*(name1) < *(name2))
-                return -1;
-            return 1;
-        }
-        name1++;
-        name2++;
+    i = _oid_mismatch(in_name1, in_name2, len);
+    if (i < len) {
+        *offpt = i + 1;
+        return in_name1[i] < in_name2[i] ? -1 : 1;
     }
     /*
      * both OIDs equal up to length of shorter OID 
      */
-    *offpt = initlen - len;
+    *offpt = len + 1;
     if (len1 < len2)
         return -1;
     if (len2 < len1)
@@ -7050,10 +7212,6 @@ int
 netsnmp_oid_equals(const oid * in_name1,
                    size_t len1, const oid * in_name2, size_t len2)
 {
-    register const oid *name1 = in_name1;
-    register const oid *name2 = in_name2;
-    register int    len = len1;
-
     /*
      * len = minimum of len1 and len2 
      */
@@ -7064,21 +7222,12 @@ netsnmp_oid_equals(const oid * in_name1,
      */
     if (len1 == 0)
         return 0;   /* Two null OIDs are (trivially) the same */
-    if (!name1 || !name2)
+    if (!in_name1 || !in_name2)
         return 1;   /* Otherwise something's wrong, so report a non-match */
     /*
      * find first non-matching OID 
      */
-    while (len-- > 0) {
-        /*
-         * these must be done in seperate comparisons, since
-         * subtracting them and using that result has problems with
-         * subids > 2^31. 
-         */
-        if (*(name1++) != *(name2++))
-            return 1;
-    }
-    return 0;
+    return _oid_mismatch(in_name1, in_name2, len1) != len1;
 }
 
 #ifndef NETSNMP_FEATURE_REMOVE_OID_IS_SUBTREE
@@ -7116,7 +7265,6 @@ int
 netsnmp_oid_find_prefix(const oid * in_name1, size_t len1,
                         const oid * in_name2, size_t len2)
 {
-    int i;
     size_t min_size;
 
     if (!in_name1 || !in_name2 || !len1 || !len2)
@@ -7125,14 +7273,12 @@ netsnmp_oid_find_prefix(const oid * in_name1, size_t len1,
     if (in_name1[0] != in_name2[0])
         return 0;   /* No match */
     min_size = SNMP_MIN(len1, len2);
-    for(i = 0; i < (int)min_size; i++) {
-        if (in_name1[i] != in_name2[i])
-            return i;    /* '' is the first differing subidentifier
-                            So the common prefix is 0..(i-1), of length i */
-    }
-    return min_size;	/* The shorter OID is a prefix of the longer, and
-                           hence is precisely the common prefix of the two.
-                           Return its length. */
+    /*
+     * The first differing subidentifier ends the common prefix; if there
+     * is none, the shorter OID is a prefix of the longer, and hence is
+     * precisely the common prefix of the two.
+     */
+    return _oid_mismatch(in_name1, in_name2, min_size);
 }
 
 #ifndef NETSNMP_DISABLE_MIB_LOADING
@@ -135,6 +135,9 @@ init_snmp_transport(void)
                                 netsnmp_transport_filter_cleanup,
                                 "host");
 #endif /* NETSNMP_FEATURE_REMOVE_FILTER_SOURCE */
+    netsnmp_ds_register_config(ASN_OCTET_STR, "snmp", "fdPoller",
+                               NETSNMP_DS_LIBRARY_ID,
+                               NETSNMP_DS_LIB_FD_POLLER);
 }
 
 void
@@ -56,6 +56,10 @@
 #if HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_PTHREAD_CREATE) && !defined(WIN32)
+#include <pthread.h>
+#define NETSNMP_USM_KEY_THREADS 1
+#endif
 
 #include <net-snmp/types.h>
 #include <net-snmp/output_api.h>
@@ -100,6 +104,8 @@ struct usmStateReference {
     u_char         *usr_priv_key;
     size_t          usr_priv_key_length;
     u_int           usr_sec_level;
+    netsnmp_keyed_hash_ctx *usr_auth_ctx;  /* of usr_auth_key */
+    netsnmp_cipher_ctx *usr_priv_ctx;      /* of usr_priv_key */
 };
 
 const oid usmNoAuthProtocol[10] = { NETSNMP_USMAUTH_BASE_OID,
@@ -233,6 +239,8 @@ static struct usmUser *noNameUser = NULL;
  */
 static struct usmUser *userList = NULL;
 
+static void     usm_cancel_key_jobs(struct usmUser *user, int priv);
+
 /*
  * Set a given field of the secStateRef.
  *
@@ -313,6 +321,29 @@ usm_clone(netsnmp_pdu *pdu, netsnmp_pdu *new_pdu)
     return ret;
 }
 
+/*
+ * The cipher context of a user is shared with the usmStateReferences
+ * of the messages in flight, possibly in other threads: references are
+ * taken and dropped, and the context of a user replaced, under the
+ * MT_LIB_USM_PRIVCTX lock.
+ */
+static netsnmp_cipher_ctx *
+usm_priv_ctx_ref(netsnmp_cipher_ctx *ctx)
+{
+    snmp_res_lock(MT_LIBRARY_ID, MT_LIB_USM_PRIVCTX);
+    sc_cipher_ctx_ref(ctx);
+    snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_USM_PRIVCTX);
+    return ctx;
+}
+
+static void
+usm_priv_ctx_free(netsnmp_cipher_ctx *ctx)
+{
+    snmp_res_lock(MT_LIBRARY_ID, MT_LIB_USM_PRIVCTX);
+    sc_cipher_ctx_free(ctx);
+    snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_USM_PRIVCTX);
+}
+
 static void
 usm_free_usmStateReference(void *old)
 {
@@ -333,6 +364,8 @@ usm_free_usmStateReference(void *old)
         SNMP_ZERO(ref->usr_auth_key, ref->usr_auth_key_length);
         SNMP_FREE(ref->usr_auth_key);
     }
+    sc_keyed_hash_ctx_free(ref->usr_auth_ctx);
+    usm_priv_ctx_free(ref->usr_priv_ctx);
     if (ref->usr_priv_key_length && ref->usr_priv_key) {
         SNMP_ZERO(ref->usr_priv_key, ref->usr_priv_key_length);
         SNMP_FREE(ref->usr_priv_key);
@@ -341,12 +374,6 @@ usm_free_usmStateReference(void *old)
     SNMP_FREE(ref);
 }                               /* end usm_free_usmStateReference() */
 
-struct usmUser *
-usm_get_userList(void)
-{
-    return userList;
-}
-
 static int
 usm_set_usmStateReference_name(struct usmStateReference *ref,
                                char *name, size_t name_len)
@@ -431,6 +458,8 @@ usm_clone_usmStateReference(struct usmStateReference *from,
         *to = NULL;
         return -1;
     }
+    cloned_usmStateRef->usr_auth_ctx = sc_keyed_hash_ctx_ref(from->usr_auth_ctx);
+    cloned_usmStateRef->usr_priv_ctx = usm_priv_ctx_ref(from->usr_priv_ctx);
 
     return 0;
 
@@ -472,31 +501,226 @@ emergency_print(u_char * field, u_int length)
 }                               /* end emergency_print() */
 #endif                          /* NETSNMP_ENABLE_TESTING_CODE */
 
+/*
+ * The users of userList are also chained into a hash table on their
+ * engineID and name, so that a lookup does not have to scan the list.
+ * New users are appended to the list; the list is only sorted again, for
+ * a walk of the usmUserTable, when usm_get_userList() is called after a
+ * user was appended out of order.
+ */
+#define USM_USER_HASH_INIT  64
+
+static struct usmUser **userHash = NULL;
+static size_t   userHashSize = 0;
+static size_t   userCount = 0;
+static struct usmUser *userListTail = NULL;
+static int      userListSorted = 1;
+
+static u_int
+usm_user_hash(const u_char *engineID, size_t engineIDLen,
+              const char *name, size_t nameLen)
+{
+    u_int           h = 2166136261U;  /* FNV-1a */
+    size_t          i;
+
+    for (i = 0; engineID && i < engineIDLen; i++)
+        h = (h ^ engineID[i]) * 16777619U;
+    h = (h ^ 0xff) * 16777619U;
+    for (i = 0; i < nameLen; i++)
+        h = (h ^ (u_char) name[i]) * 16777619U;
+    return h;
+}
+
+static struct usmUser **
+usm_user_bucket(const struct usmUser *user)
+{
+    const char     *name = user->name ? user->name : "";
+
+    return &userHash[usm_user_hash(user->engineID, user->engineIDLen, name,
+                                   strlen(name)) & (userHashSize - 1)];
+}
+
+/*
+ * Compares a key to a user in the order of the usmUserTable: by the
+ * engineID length, then the engineID, then the name length, then the
+ * name.  A NULL engineID sorts before any other of the same length.
+ */
+static int
+usm_user_cmp(const u_char *engineID, size_t engineIDLen,
+             const char *name, size_t nameLen, const struct usmUser *user)
+{
+    size_t          len = user->name ? strlen(user->name) : 0;
+    int             rc;
+
+    if (engineIDLen != user->engineIDLen)
+        return engineIDLen < user->engineIDLen ? -1 : 1;
+    if ((engineID == NULL) != (user->engineID == NULL))
+        return engineID == NULL ? -1 : 1;
+    if (engineID && (rc = memcmp(engineID, user->engineID, engineIDLen)))
+        return rc;
+    if (nameLen != len)
+        return nameLen < len ? -1 : 1;
+    return len ? memcmp(name, user->name, len) : 0;
+}
+
+static int
+usm_user_cmp_users(const struct usmUser *a, const struct usmUser *b)
+{
+    return usm_user_cmp(a->engineID, a->engineIDLen, a->name,
+                        a->name ? strlen(a->name) : 0, b);
+}
+
+static void
+usm_user_hash_grow(void)
+{
+    struct usmUser **old = userHash, *ptr, *next, **bucket;
+    size_t          oldSize = userHashSize, i;
+    size_t          size = userHashSize ? userHashSize * 2 :
+                           USM_USER_HASH_INIT;
+
+    userHash = calloc(size, sizeof(*userHash));
+    if (NULL == userHash) {
+        /* keep the table we have, only the chains get longer */
+        userHash = old;
+        return;
+    }
+    userHashSize = size;
+    for (i = 0; i < oldSize; i++) {
+        for (ptr = old[i]; ptr; ptr = next) {
+            next = ptr->hnext;
+            bucket = usm_user_bucket(ptr);
+            ptr->hnext = *bucket;
+            *bucket = ptr;
+        }
+    }
+    free(old);
+    DEBUGMSGTL(("usm:hash", "user index grown to %d buckets\n", (int) size));
+}
+
+static int
+usm_user_hash_add(struct usmUser *user)
+{
+    struct usmUser **bucket;
+
+    if (userCount >= userHashSize)
+        usm_user_hash_grow();
+    if (NULL == userHash)
+        return -1;
+    bucket = usm_user_bucket(user);
+    user->hnext = *bucket;
+    *bucket = user;
+    userCount++;
+    return 0;
+}
+
+/*
+ * Unchains user from the index.
+ *
+ * @retval 1 the user was indexed, i.e. is in userList, 0 it was not
+ */
+static int
+usm_user_hash_remove(struct usmUser *user)
+{
+    struct usmUser **pptr;
+
+    if (NULL == userHash)
+        return 0;
+    for (pptr = usm_user_bucket(user); *pptr; pptr = &(*pptr)->hnext) {
+        if (*pptr == user) {
+            *pptr = user->hnext;
+            user->hnext = NULL;
+            userCount--;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Merge sorts userList (a bottom-up merge of runs of doubling length),
+ * then repairs the prev pointers and the tail.
+ */
+static void
+usm_sort_userList(void)
+{
+    struct usmUser *list = userList, *p, *q, *e, *tail;
+    size_t          insize = 1, psize, qsize, i;
+    int             merges;
+
+    if (userListSorted)
+        return;
+
+    do {
+        p = list;
+        list = tail = NULL;
+        merges = 0;
+        while (p) {
+            merges++;
+            for (q = p, psize = 0, i = 0; i < insize && q; i++, psize++)
+                q = q->next;
+            qsize = insize;
+            while (psize > 0 || (qsize > 0 && q)) {
+                if (psize == 0) {
+                    e = q; q = q->next; qsize--;
+                } else if (qsize == 0 || !q ||
+                           usm_user_cmp_users(p, q) <= 0) {
+                    e = p; p = p->next; psize--;
+                } else {
+                    e = q; q = q->next; qsize--;
+                }
+                if (tail)
+                    tail->next = e;
+                else
+                    list = e;
+                tail = e;
+            }
+            p = q;
+        }
+        if (tail)
+            tail->next = NULL;
+        insize *= 2;
+    } while (merges > 1);
+
+    for (p = list, q = NULL; p; q = p, p = p->next)
+        p->prev = q;
+    userList = list;
+    userListTail = q;
+    userListSorted = 1;
+    DEBUGMSGTL(("usm:hash", "sorted %d users\n", (int) userCount));
+}
+
+struct usmUser *
+usm_get_userList(void)
+{
+    usm_sort_userList();
+    return userList;
+}
+
 static struct usmUser *
 usm_get_user_from_list(const u_char *engineID, size_t engineIDLen,
-                       const char *name, size_t nameLen,
-                       struct usmUser *puserList, int use_default)
+                       const char *name, size_t nameLen, int use_default)
 {
     struct usmUser *ptr;
 
-    for (ptr = puserList; ptr != NULL; ptr = ptr->next) {
-        if (ptr->name && strlen(ptr->name) == nameLen &&
-            memcmp(ptr->name, name, nameLen) == 0) {
-          DEBUGMSGTL(("usm", "match on user %s\n", ptr->name));
-          if (ptr->engineIDLen == engineIDLen &&
-            ((ptr->engineID == NULL && engineID == NULL) ||
-             (ptr->engineID != NULL && engineID != NULL &&
-              memcmp(ptr->engineID, engineID, engineIDLen) == 0)))
-            return ptr;
-          DEBUGMSGTL(("usm", "no match on engineID ("));
-          if (engineID) {
-              DEBUGMSGHEX(("usm", engineID, engineIDLen));
-          } else {
-              DEBUGMSGTL(("usm", "Empty EngineID"));
-          }
-          DEBUGMSG(("usm", ")\n"));
+    if (userHash) {
+        ptr = userHash[usm_user_hash(engineID, engineIDLen, name, nameLen) &
+                       (userHashSize - 1)];
+        for (; ptr != NULL; ptr = ptr->hnext) {
+            if (usm_user_cmp(engineID, engineIDLen, name, nameLen,
+                             ptr) == 0) {
+                DEBUGMSGTL(("usm", "match on user %s\n", ptr->name));
+                return ptr;
+            }
         }
     }
+    DEBUGMSGTL(("usm", "no match on user %.*s engineID (", (int) nameLen,
+                name));
+    if (engineID) {
+        DEBUGMSGHEX(("usm", engineID, engineIDLen));
+    } else {
+        DEBUGMSGTL(("usm", "Empty EngineID"));
+    }
+    DEBUGMSG(("usm", ")\n"));
 
     /*
      * return "" user used to facilitate engineID discovery
@@ -512,8 +736,7 @@ usm_get_user2(const u_char *engineID, size_t engineIDLen, const void *name,
 {
     DEBUGMSGTL(("usm", "getting user %.*s\n", (int)nameLen,
                 (const char *)name));
-    return usm_get_user_from_list(engineID, engineIDLen, name, nameLen,
-                                  userList, 1);
+    return usm_get_user_from_list(engineID, engineIDLen, name, nameLen, 1);
 }
 
 /*
@@ -527,110 +750,65 @@ usm_get_user(const u_char *engineID, size_t engineIDLen, const char *name)
 }
 
 static struct usmUser *
-usm_add_user_to_list(struct usmUser *user, struct usmUser *puserList)
+usm_add_user_to_list(struct usmUser *user)
 {
-    struct usmUser *nptr, *pptr, *optr;
+    struct usmUser *optr;
 
-    /*
-     * loop through puserList till we find the proper, sorted place to
-     * insert the new user
-     */
     /* XXX - how to handle a NULL user->name ?? */
-    /* XXX - similarly for a NULL nptr->name ?? */
-    for (nptr = puserList, pptr = NULL; nptr != NULL;
-         pptr = nptr, nptr = nptr->next) {
-        if (nptr->engineIDLen > user->engineIDLen)
-            break;
-
-        if (user->engineID == NULL && nptr->engineID != NULL)
-            break;
-
-        if (nptr->engineIDLen == user->engineIDLen &&
-            (nptr->engineID != NULL && user->engineID != NULL &&
-             memcmp(nptr->engineID, user->engineID,
-                    user->engineIDLen) > 0))
-            break;
-
-        if (!(nptr->engineID == NULL && user->engineID != NULL)) {
-            if (nptr->engineIDLen == user->engineIDLen &&
-                ((nptr->engineID == NULL && user->engineID == NULL) ||
-                 memcmp(nptr->engineID, user->engineID,
-                        user->engineIDLen) == 0)
-                && strlen(nptr->name) > strlen(user->name))
-                break;
-
-            if (nptr->engineIDLen == user->engineIDLen &&
-                ((nptr->engineID == NULL && user->engineID == NULL) ||
-                 memcmp(nptr->engineID, user->engineID,
-                        user->engineIDLen) == 0)
-                && strlen(nptr->name) == strlen(user->name)
-                && strcmp(nptr->name, user->name) > 0)
-                break;
+    optr = usm_get_user_from_list(user->engineID, user->engineIDLen,
+                                  user->name ? user->name : "",
+                                  user->name ? strlen(user->name) : 0, 0);
+    if (optr == user)
+        return userList;
+    if (usm_user_hash_add(user) < 0)
+        return NULL;
 
-            if (nptr->engineIDLen == user->engineIDLen &&
-                ((nptr->engineID == NULL && user->engineID == NULL) ||
-                 memcmp(nptr->engineID, user->engineID,
-                        user->engineIDLen) == 0)
-                && strlen(nptr->name) == strlen(user->name)
-                && strcmp(nptr->name, user->name) == 0) {
-                /*
-                 * the user is an exact match of a previous entry.
-                 * Credentials may be different, though, so remove
-                 * the old entry (and add the new one)!
-                 */
-                if (pptr) { /* change prev's next pointer */
-                  pptr->next = nptr->next;
-                }
-                if (nptr->next) { /* change next's prev pointer */
-                  nptr->next->prev = pptr;
-                }
-                optr = nptr;
-                nptr = optr->next; /* add new user at this position */
-                /* free the old user */
-                optr->next=NULL;
-                optr->prev=NULL;
-                usm_free_user(optr);
-                break; /* new user will be added below */
-            }
-        }
+    if (optr) {
+        /*
+         * the user is an exact match of a previous entry.
+         * Credentials may be different, though, so remove
+         * the old entry (and add the new one in its place)!
+         */
+        usm_user_hash_remove(optr);
+        user->prev = optr->prev;
+        user->next = optr->next;
+        if (user->prev)
+            user->prev->next = user;
+        else
+            userList = user;
+        if (user->next)
+            user->next->prev = user;
+        else
+            userListTail = user;
+        /* free the old user */
+        optr->next = NULL;
+        optr->prev = NULL;
+        usm_free_user(optr);
+        return userList;
     }
 
     /*
-     * nptr should now point to the user that we need to add ourselves
-     * in front of, and pptr should be our new 'prev'.
-     */
-
-    /*
-     * change our pointers
-     */
-    user->prev = pptr;
-    user->next = nptr;
-
-    /*
-     * change the next's prev pointer
-     */
-    if (user->next)
-        user->next->prev = user;
-
-    /*
-     * change the prev's next pointer
+     * append the new user; the list stays sorted as long as the users
+     * are added in order, e.g. from a persistent file written in order
      */
-    if (user->prev)
-        user->prev->next = user;
-
-    /*
-     * rewind to the head of the list and return it (since the new head
-     * could be us, we need to notify the above routine who the head now is.
-     */
-    for (pptr = user; pptr->prev != NULL; pptr = pptr->prev);
-    return pptr;
+    if (userListTail && usm_user_cmp_users(userListTail, user) > 0)
+        userListSorted = 0;
+    user->next = NULL;
+    user->prev = userListTail;
+    if (userListTail)
+        userListTail->next = user;
+    else
+        userList = user;
+    userListTail = user;
+    return userList;
 }
 
 /*
- * usm_add_user(): Add's a user to the userList, sorted by the
- * engineIDLength then the engineID then the name length then the name
- * to facilitate getNext calls on a usmUser table which is indexed by
- * these values.
+ * usm_add_user(): Add's a user to the end of the userList, or in the
+ * place of a user with the same engineID and name.  If it was added out
+ * of order, the list is sorted again by the engineIDLength then the
+ * engineID then the name length then the name, the index of the
+ * usmUserTable, when usm_get_userList() is next called.
  *
  * returns the head of the list (which could change due to this add).
  */
@@ -638,95 +816,115 @@ usm_add_user_to_list(struct usmUser *user, struct usmUser *puserList)
 struct usmUser *
 usm_add_user(struct usmUser *user)
 {
-    struct usmUser *uptr;
-    uptr = usm_add_user_to_list(user, userList);
-    if (uptr != NULL)
-        userList = uptr;
-    return uptr;
+    return usm_add_user_to_list(user);
 }
 
 /*
- * usm_remove_usmUser_from_list remove user from (optional) list
- *
- * if list is not specified, defaults to global userList.
+ * usm_remove_usmUser_from_list remove user from the userList.
  *
  * returns SNMPERR_SUCCESS or SNMPERR_USM_UNKNOWNSECURITYNAME
  */
 static int
-usm_remove_usmUser_from_list(struct usmUser *user, struct usmUser **ppuserList)
+usm_remove_usmUser_from_list(struct usmUser *user)
 {
-    struct usmUser *nptr, *pptr;
-
     /*
-     * NULL pointers aren't allowed
+     * only the users in the list are in the index
      */
-    if (ppuserList == NULL)
-        ppuserList = &userList;
-
-    if (*ppuserList == NULL)
+    if (user == NULL || !usm_user_hash_remove(user))
         return SNMPERR_USM_UNKNOWNSECURITYNAME;
 
     /*
-     * find the user in the list
+     * remove the user from the linked list
      */
-    for (nptr = *ppuserList, pptr = NULL; nptr != NULL;
-         pptr = nptr, nptr = nptr->next) {
-        if (nptr == user)
-            break;
-    }
-
-    if (nptr) {
-        /*
-         * remove the user from the linked list
-         */
-        if (pptr) {
-            pptr->next = nptr->next;
-        }
-        if (nptr->next) {
-            nptr->next->prev = pptr;
-        }
-    } else {
-        /*
-         * user didn't exist
-         */
-        return SNMPERR_USM_UNKNOWNSECURITYNAME;
-    }
-    if (nptr == *ppuserList)    /* we're the head of the list, need to change
-                                 * * the head to the next user */
-        *ppuserList = nptr->next;
+    if (user->prev)
+        user->prev->next = user->next;
+    else
+        userList = user->next;
+    if (user->next)
+        user->next->prev = user->prev;
+    else
+        userListTail = user->prev;
+    user->next = NULL;
+    user->prev = NULL;
     return SNMPERR_SUCCESS;
 }                               /* end usm_remove_usmUser_from_list() */
 
 /*
- * usm_remove_user_from_list
- *
- * removes user from list.
+ * usm_remove_user(): finds and removes a user from a list
  *
  * returns new list head on success, or NULL on error.
  *
  * NOTE: if there was only one user in the list, list head will be NULL.
- *       So NULL can also mean success. Use the newer usm_remove_usmUser() for
- *       more specific return codes. This function is kept for backwards
- *       compatability with this ambiguous behaviour.
+ *       So NULL can also mean success.
  */
-static struct usmUser *
-usm_remove_user_from_list(struct usmUser *user,
-                          struct usmUser **ppuserList)
+struct usmUser *
+usm_remove_user(struct usmUser *user)
 {
-    int rc = usm_remove_usmUser_from_list(user, ppuserList);
-    if (rc != SNMPERR_SUCCESS || NULL == ppuserList)
+    if (usm_remove_usmUser_from_list(user) != SNMPERR_SUCCESS)
         return NULL;
+    return userList;
+}
 
-    return *ppuserList;
-}                               /* end usm_remove_user_from_list() */
+/*
+ * usm_user_auth_ctx(): Returns the keyed hash context of the user's
+ * localized authentication key, prepared again if the key or the
+ * protocol changed since (e.g. by a SET of the usmUserTable), or NULL
+ * if it cannot be prepared.
+ */
+static netsnmp_keyed_hash_ctx *
+usm_user_auth_ctx(struct usmUser *user)
+{
+    if (user->authKeyCtx &&
+        sc_keyed_hash_ctx_matches(user->authKeyCtx, user->authProtocol,
+                                  user->authProtocolLen, user->authKey,
+                                  user->authKeyLen))
+        return user->authKeyCtx;
+
+    sc_keyed_hash_ctx_free(user->authKeyCtx);
+    user->authKeyCtx = NULL;
+    if (user->authKey && user->authKeyLen &&
+        sc_get_auth_maclen(sc_get_authtype(user->authProtocol,
+                                           user->authProtocolLen)) > 0)
+        user->authKeyCtx = sc_keyed_hash_ctx_new(user->authProtocol,
+                                                 user->authProtocolLen,
+                                                 user->authKey,
+                                                 user->authKeyLen);
+    return user->authKeyCtx;
+}
 
 /*
- * usm_remove_user(): finds and removes a user from a list
+ * usm_user_priv_ctx(): Returns the cipher context of the user's
+ * localized privacy key, prepared again if the key or the protocol
+ * changed since, or NULL if it cannot be prepared.  Like user->privKey,
+ * it remains valid as long as the key of the user does not change.
+ * With take_ref, the context is returned with a new reference, for a
+ * usmStateReference; drop it with usm_priv_ctx_free().
  */
-struct usmUser *
-usm_remove_user(struct usmUser *user)
+static netsnmp_cipher_ctx *
+usm_user_priv_ctx(struct usmUser *user, int take_ref)
 {
-    return usm_remove_user_from_list(user, &userList);
+    netsnmp_cipher_ctx *ctx;
+
+    snmp_res_lock(MT_LIBRARY_ID, MT_LIB_USM_PRIVCTX);
+    if (NULL == user->privKeyCtx ||
+        !sc_cipher_ctx_matches(user->privKeyCtx, user->privProtocol,
+                               user->privProtocolLen, user->privKey,
+                               user->privKeyLen)) {
+        sc_cipher_ctx_free(user->privKeyCtx);
+        user->privKeyCtx = NULL;
+        if (user->privKey && user->privKeyLen &&
+            sc_get_proper_priv_length(user->privProtocol,
+                                      user->privProtocolLen) > 0)
+            user->privKeyCtx = sc_cipher_ctx_new(user->privProtocol,
+                                                 user->privProtocolLen,
+                                                 user->privKey,
+                                                 user->privKeyLen);
+    }
+    ctx = user->privKeyCtx;
+    if (take_ref)
+        sc_cipher_ctx_ref(ctx);
+    snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_USM_PRIVCTX);
+    return ctx;
 }
 
 /*
@@ -745,6 +943,11 @@ usm_free_user(struct usmUser *user)
     if (user == NULL)
         return NULL;
 
+    usm_remove_usmUser_from_list(user);
+    usm_cancel_key_jobs(user, -1);
+
+    sc_keyed_hash_ctx_free(user->authKeyCtx);
+    usm_priv_ctx_free(user->privKeyCtx);
     SNMP_FREE(user->engineID);
     SNMP_FREE(user->name);
     SNMP_FREE(user->secName);
@@ -1484,6 +1687,8 @@ usm_generate_out_msg(int msgProcModel,  /* (UNUSED) */
     u_int           theEngineIDLength = 0;
     u_char         *theAuthKey = NULL;
     u_int           theAuthKeyLength = 0;
+    netsnmp_keyed_hash_ctx *theAuthCtx = NULL;
+    netsnmp_cipher_ctx *thePrivCtx = NULL;
     const oid      *theAuthProtocol = NULL;
     u_int           theAuthProtocolLength = 0;
     u_char         *thePrivKey = NULL;
@@ -1516,10 +1721,12 @@ usm_generate_out_msg(int msgProcModel,  /* (UNUSED) */
         theAuthProtocolLength = ref->usr_auth_protocol_length;
         theAuthKey = ref->usr_auth_key;
         theAuthKeyLength = ref->usr_auth_key_length;
+        theAuthCtx = ref->usr_auth_ctx;
         thePrivProtocol = ref->usr_priv_protocol;
         thePrivProtocolLength = ref->usr_priv_protocol_length;
         thePrivKey = ref->usr_priv_key;
         thePrivKeyLength = ref->usr_priv_key_length;
+        thePrivCtx = ref->usr_priv_ctx;
         theSecLevel = ref->usr_sec_level;
     }
 
@@ -1549,10 +1756,12 @@ usm_generate_out_msg(int msgProcModel,  /* (UNUSED) */
             theAuthProtocolLength = user->authProtocolLen;
             theAuthKey = user->authKey;
             theAuthKeyLength = user->authKeyLen;
+            theAuthCtx = usm_user_auth_ctx(user);
             thePrivProtocol = user->privProtocol;
             thePrivProtocolLength = user->privProtocolLen;
             thePrivKey = user->privKey;
             thePrivKeyLength = user->privKeyLen;
+            thePrivCtx = usm_user_priv_ctx(user, 0);
         } else {
             /*
              * unknown users can not do authentication (obviously) 
@@ -1682,11 +1891,15 @@ usm_generate_out_msg(int msgProcModel,  /* (UNUSED) */
         }
 #endif
 
-        if (sc_encrypt(thePrivProtocol, thePrivProtocolLength,
-                       thePrivKey, thePrivKeyLength,
-                       salt, salt_length,
-                       scopedPdu, scopedPduLen,
-                       &ptr[dataOffset], &encrypted_length)
+        if ((thePrivCtx ?
+             sc_encrypt_ctx(thePrivCtx, salt, salt_length,
+                            scopedPdu, scopedPduLen,
+                            &ptr[dataOffset], &encrypted_length) :
+             sc_encrypt(thePrivProtocol, thePrivProtocolLength,
+                        thePrivKey, thePrivKeyLength,
+                        salt, salt_length,
+                        scopedPdu, scopedPduLen,
+                        &ptr[dataOffset], &encrypted_length))
             != SNMP_ERR_NOERROR) {
             DEBUGMSGTL(("usm", "encryption error.\n"));
             return SNMPERR_USM_ENCRYPTIONERROR;
@@ -1854,9 +2067,12 @@ usm_generate_out_msg(int msgProcModel,  /* (UNUSED) */
             return SNMPERR_USM_GENERICERROR;
         }
 
-        if (sc_generate_keyed_hash(theAuthProtocol, theAuthProtocolLength,
-                                   theAuthKey, theAuthKeyLength,
-                                   ptr, ptr_len, temp_sig, &temp_sig_len)
+        if ((theAuthCtx ?
+             sc_generate_keyed_hash_ctx(theAuthCtx, ptr, ptr_len,
+                                        temp_sig, &temp_sig_len) :
+             sc_generate_keyed_hash(theAuthProtocol, theAuthProtocolLength,
+                                    theAuthKey, theAuthKeyLength,
+                                    ptr, ptr_len, temp_sig, &temp_sig_len))
             != SNMP_ERR_NOERROR) {
             /*
              * FIX temp_sig_len defined?!
@@ -1975,6 +2191,8 @@ usm_rgenerate_out_msg(int msgProcModel, /* (UNUSED) */
     u_int           theEngineIDLength = 0;
     u_char         *theAuthKey = NULL;
     u_int           theAuthKeyLength = 0;
+    netsnmp_keyed_hash_ctx *theAuthCtx = NULL;
+    netsnmp_cipher_ctx *thePrivCtx = NULL;
     const oid      *theAuthProtocol = NULL;
     u_int           theAuthProtocolLength = 0;
     u_char         *thePrivKey = NULL;
@@ -2012,10 +2230,12 @@ usm_rgenerate_out_msg(int msgProcModel, /* (UNUSED) */
         theAuthProtocolLength = ref->usr_auth_protocol_length;
         theAuthKey = ref->usr_auth_key;
         theAuthKeyLength = ref->usr_auth_key_length;
+        theAuthCtx = ref->usr_auth_ctx;
         thePrivProtocol = ref->usr_priv_protocol;
         thePrivProtocolLength = ref->usr_priv_protocol_length;
         thePrivKey = ref->usr_priv_key;
         thePrivKeyLength = ref->usr_priv_key_length;
+        thePrivCtx = ref->usr_priv_ctx;
         theSecLevel = ref->usr_sec_level;
     }
 
@@ -2045,10 +2265,12 @@ usm_rgenerate_out_msg(int msgProcModel, /* (UNUSED) */
             theAuthProtocolLength = user->authProtocolLen;
             theAuthKey = user->authKey;
             theAuthKeyLength = user->authKeyLen;
+            theAuthCtx = usm_user_auth_ctx(user);
             thePrivProtocol = user->privProtocol;
             thePrivProtocolLength = user->privProtocolLen;
             thePrivKey = user->privKey;
             thePrivKeyLength = user->privKeyLen;
+            thePrivCtx = usm_user_priv_ctx(user, 0);
         } else {
             /*
              * unknown users can not do authentication (obviously) 
@@ -2113,8 +2335,15 @@ usm_rgenerate_out_msg(int msgProcModel, /* (UNUSED) */
         size_t          ciphertextlen = scopedPduLen + 64;
         int             priv_type = sc_get_privtype(thePrivProtocol,
                                                     thePrivProtocolLength);
+        /*
+         * The scopedPdu is normally what has been encoded so far, and can
+         * then be encrypted where it is.
+         */
+        int             in_place = thePrivCtx && scopedPduLen == *offset &&
+            scopedPdu == *wholeMsg + *wholeMsgLen - *offset;
 
-        if ((ciphertext = (u_char *) malloc(ciphertextlen)) == NULL) {
+        if (!in_place &&
+            (ciphertext = (u_char *) malloc(ciphertextlen)) == NULL) {
             DEBUGMSGTL(("usm",
                         "couldn't malloc %d bytes for encrypted PDU\n",
                         (int)ciphertextlen));
@@ -2159,26 +2388,62 @@ usm_rgenerate_out_msg(int msgProcModel, /* (UNUSED) */
         }
 #endif
 
-        if (sc_encrypt(thePrivProtocol, thePrivProtocolLength,
-                       thePrivKey, thePrivKeyLength,
-                       salt, salt_length,
-                       scopedPdu, scopedPduLen,
-                       ciphertext, &ciphertextlen) != SNMP_ERR_NOERROR) {
-            DEBUGMSGTL(("usm", "encryption error.\n"));
-            SNMP_FREE(ciphertext);
-            return SNMPERR_USM_ENCRYPTIONERROR;
-        }
+        if (in_place) {
+            /* move the plaintext down to leave room for the DES padding */
+            size_t          pad = 0;
 
-        /*
-         * Write the encrypted scopedPdu back into the packet buffer.  
-         */
+            if (USM_CREATE_USER_PRIV_DES == (priv_type & USM_PRIV_MASK_ALG))
+                pad = (8 - scopedPduLen % 8) % 8;
+            while (*wholeMsgLen - *offset < pad) {
+                if (!asn_realloc(wholeMsg, wholeMsgLen)) {
+                    DEBUGMSGTL(("usm", "couldn't grow the packet buffer\n"));
+                    return SNMPERR_MALLOC;
+                }
+            }
+            ciphertext = *wholeMsg + *wholeMsgLen - *offset - pad;
+            memmove(ciphertext, ciphertext + pad, scopedPduLen);
+            ciphertextlen = scopedPduLen + pad;
+            if (sc_encrypt_ctx(thePrivCtx, salt, salt_length,
+                               ciphertext, scopedPduLen,
+                               ciphertext, &ciphertextlen)
+                != SNMP_ERR_NOERROR || ciphertextlen != scopedPduLen + pad) {
+                DEBUGMSGTL(("usm", "encryption error.\n"));
+                return SNMPERR_USM_ENCRYPTIONERROR;
+            }
+            ciphertext = NULL;
+            *offset = ciphertextlen;
+            rc = asn_realloc_rbuild_header(wholeMsg, wholeMsgLen, offset, 1,
+                                           (u_char) (ASN_UNIVERSAL |
+                                                     ASN_PRIMITIVE |
+                                                     ASN_OCTET_STR),
+                                           ciphertextlen);
+        } else {
+            if ((thePrivCtx ?
+                 sc_encrypt_ctx(thePrivCtx, salt, salt_length,
+                                scopedPdu, scopedPduLen,
+                                ciphertext, &ciphertextlen) :
+                 sc_encrypt(thePrivProtocol, thePrivProtocolLength,
+                            thePrivKey, thePrivKeyLength,
+                            salt, salt_length,
+                            scopedPdu, scopedPduLen,
+                            ciphertext, &ciphertextlen))
+                != SNMP_ERR_NOERROR) {
+                DEBUGMSGTL(("usm", "encryption error.\n"));
+                SNMP_FREE(ciphertext);
+                return SNMPERR_USM_ENCRYPTIONERROR;
+            }
 
-        *offset = 0;
-        rc = asn_realloc_rbuild_string(wholeMsg, wholeMsgLen, offset, 1,
-                                       (u_char) (ASN_UNIVERSAL |
-                                                 ASN_PRIMITIVE |
-                                                 ASN_OCTET_STR),
-                                       ciphertext, ciphertextlen);
+            /*
+             * Write the encrypted scopedPdu back into the packet buffer.  
+             */
+
+            *offset = 0;
+            rc = asn_realloc_rbuild_string(wholeMsg, wholeMsgLen, offset, 1,
+                                           (u_char) (ASN_UNIVERSAL |
+                                                     ASN_PRIMITIVE |
+                                                     ASN_OCTET_STR),
+                                           ciphertext, ciphertextlen);
+        }
         if (rc == 0) {
             DEBUGMSGTL(("usm", "Encryption failed.\n"));
             SNMP_FREE(ciphertext);
@@ -2374,10 +2639,13 @@ usm_rgenerate_out_msg(int msgProcModel, /* (UNUSED) */
             return SNMPERR_USM_GENERICERROR;
         }
 
-        if (sc_generate_keyed_hash(theAuthProtocol, theAuthProtocolLength,
-                                   theAuthKey, theAuthKeyLength,
-                                   proto_msg, proto_msg_len,
-                                   temp_sig, &temp_sig_len)
+        if ((theAuthCtx ?
+             sc_generate_keyed_hash_ctx(theAuthCtx, proto_msg, proto_msg_len,
+                                        temp_sig, &temp_sig_len) :
+             sc_generate_keyed_hash(theAuthProtocol, theAuthProtocolLength,
+                                    theAuthKey, theAuthKeyLength,
+                                    proto_msg, proto_msg_len,
+                                    temp_sig, &temp_sig_len))
             != SNMP_ERR_NOERROR) {
             SNMP_FREE(temp_sig);
             DEBUGMSGTL(("usm", "Signing failed.\n"));
@@ -3069,7 +3337,7 @@ usm_process_in_msg(int msgProcModel,    /* (UNUSED) */
      * If the user/engine ID is unknown, report this as an error.
      */
     if ((user = usm_get_user_from_list(secEngineID, *secEngineIDLen,
-                                       secName, *secNameLen, userList,
+                                       secName, *secNameLen,
                                        (((sess && sess->isAuthoritative ==
                                           SNMP_SESS_AUTHORITATIVE) ||
                                          (!sess)) ? 0 : 1)))
@@ -3109,10 +3377,15 @@ usm_process_in_msg(int msgProcModel,    /* (UNUSED) */
      */
     if (secLevel == SNMP_SEC_LEVEL_AUTHNOPRIV
         || secLevel == SNMP_SEC_LEVEL_AUTHPRIV) {
-        if (sc_check_keyed_hash(user->authProtocol, user->authProtocolLen,
-                                user->authKey, user->authKeyLen,
-                                wholeMsg, wholeMsgLen,
-                                signature, signature_length)
+        netsnmp_keyed_hash_ctx *auth_ctx = usm_user_auth_ctx(user);
+
+        if ((auth_ctx ?
+             sc_check_keyed_hash_ctx(auth_ctx, wholeMsg, wholeMsgLen,
+                                     signature, signature_length) :
+             sc_check_keyed_hash(user->authProtocol, user->authProtocolLen,
+                                 user->authKey, user->authKeyLen,
+                                 wholeMsg, wholeMsgLen,
+                                 signature, signature_length))
             != SNMP_ERR_NOERROR) {
             DEBUGMSGTL(("usm", "Verification failed.\n"));
             snmp_increment_statistic(STAT_USMSTATSWRONGDIGESTS);
@@ -3150,6 +3423,9 @@ usm_process_in_msg(int msgProcModel,    /* (UNUSED) */
         error = SNMPERR_USM_GENERICERROR;
         goto err;
     }
+    sc_keyed_hash_ctx_free((*secStateRef)->usr_auth_ctx);
+    (*secStateRef)->usr_auth_ctx =
+        sc_keyed_hash_ctx_ref(user->authKeyCtx);
 
     if (usm_set_usmStateReference_priv_protocol(*secStateRef,
                                                 user->privProtocol,
@@ -3168,6 +3444,10 @@ usm_process_in_msg(int msgProcModel,    /* (UNUSED) */
         error = SNMPERR_USM_GENERICERROR;
         goto err;
     }
+    usm_priv_ctx_free((*secStateRef)->usr_priv_ctx);
+    (*secStateRef)->usr_priv_ctx = NULL;
+    if (secLevel == SNMP_SEC_LEVEL_AUTHPRIV)
+        (*secStateRef)->usr_priv_ctx = usm_user_priv_ctx(user, 1);
 
 
     /*
@@ -3200,6 +3480,7 @@ usm_process_in_msg(int msgProcModel,    /* (UNUSED) */
     if (secLevel == SNMP_SEC_LEVEL_AUTHPRIV) {
         int priv_type = sc_get_privtype(user->privProtocol,
                                         user->privProtocolLen);
+        netsnmp_cipher_ctx *priv_ctx;
         remaining = wholeMsgLen - (data_ptr - wholeMsg);
 
         if ((value_ptr = asn_parse_sequence(data_ptr, &remaining,
@@ -3277,11 +3558,27 @@ usm_process_in_msg(int msgProcModel,    /* (UNUSED) */
             dump_chunk("usm/dump", "IV + Encrypted form:", iv, iv_length);
         }
 #endif
-        if (sc_decrypt(user->privProtocol, user->privProtocolLen,
-                       user->privKey, user->privKeyLen,
-                       iv, iv_length,
-                       value_ptr, remaining, *scopedPdu, scopedPduLen)
-            != SNMP_ERR_NOERROR) {
+        priv_ctx = (*secStateRef)->usr_priv_ctx;
+        if (priv_ctx) {
+            /*
+             * decrypt in place: the plaintext scopedPDU replaces the
+             * ciphertext in the received message
+             */
+            size_t          plaintext_len = remaining;
+
+            rc = sc_decrypt_ctx(priv_ctx, iv, iv_length,
+                                value_ptr, remaining,
+                                value_ptr, &plaintext_len);
+            if (rc == SNMP_ERR_NOERROR) {
+                *scopedPdu = value_ptr;
+                *scopedPduLen = plaintext_len;
+            }
+        } else
+            rc = sc_decrypt(user->privProtocol, user->privProtocolLen,
+                            user->privKey, user->privKeyLen,
+                            iv, iv_length,
+                            value_ptr, remaining, *scopedPdu, scopedPduLen);
+        if (rc != SNMP_ERR_NOERROR) {
             DEBUGMSGTL(("usm", "%s\n", "Failed decryption."));
             snmp_increment_statistic(STAT_USMSTATSDECRYPTIONERRORS);
             error = SNMPERR_USM_DECRYPTIONERROR;
@@ -3604,8 +3901,7 @@ usm_create_user_from_session(netsnmp_session * session)
     user = usm_get_user_from_list(session->securityEngineID,
                                   session->securityEngineIDLen,
                                   session->securityName,
-                                  session->securityNameLen,
-                                  usm_get_userList(), 0);
+                                  session->securityNameLen, 0);
     if (NULL != user) {
         DEBUGMSGTL(("usm", "user exists x=%p\n", user));
     } else {
@@ -3936,6 +4232,11 @@ clear_user_list(void)
 	tmp = next;
     }
     userList = NULL;
+    userListTail = NULL;
+    userListSorted = 1;
+    SNMP_FREE(userHash);
+    userHashSize = 0;
+    userCount = 0;
 
 }
 
@@ -4290,6 +4591,8 @@ usm_read_user(const char *line)
 
     line = read_config_read_octet_string(line, &user->userPublicString,
                                          &user->userPublicStringLen);
+    usm_user_auth_ctx(user);
+    usm_user_priv_ctx(user, 0);
     return user;
 }
 
@@ -4306,6 +4609,520 @@ usm_parse_config_usmUser(const char *token, char *line)
         usm_add_user(uptr);
 }
 
+/*
+ * Localized key cache.
+ *
+ * Localizing a pass phrase hashes a megabyte (RFC 3414, A.2.1), and
+ * every createUser line does it again each time the configuration is
+ * read.  The localized keys are therefore remembered in memory, indexed
+ * by an HMAC of the authentication protocol, the engineID and the pass
+ * phrase.  The HMAC key is random and never leaves the process, so the
+ * index is no help in guessing a pass phrase.  The cache is not saved:
+ * a saved cache would allow offline guessing at the speed of one HMAC
+ * per guess, far below the cost of a localization.
+ *
+ * The persistent file is only read after the configuration files, so
+ * while these are read the createUser pass phrases are not localized but
+ * queued as jobs on their users.  Once all files are read,
+ * usm_resolve_key_jobs() looks the keys up in the cache and derives the
+ * missing ones on all processors (or usmKeyThreads threads).  A user
+ * replaced by a usmUser line in the meantime never needs its keys.  The
+ * keys that the configuration did not use are then forgotten.
+ */
+#define USM_KEYCACHE_SECRET_LEN 64      /* the longest USM digest */
+#define USM_KEYCACHE_BUCKETS    1024
+#define USM_KEY_THREADS_MAX     32
+#define USM_KEYCACHE_BUCKET(d)  (((d)[0] | ((d)[1] << 8)) & \
+                                 (USM_KEYCACHE_BUCKETS - 1))
+
+typedef struct usm_key_cache_s {
+    struct usm_key_cache_s *next;
+    u_char          digest[USM_AUTH_KU_LEN];
+    size_t          digestLen;
+    u_char          key[USM_AUTH_KU_LEN];
+    size_t          keyLen;             /* 0 until the key is derived */
+    int             used;               /* by the last config read */
+    struct usm_key_job_s *job;          /* what to derive it from */
+} usm_key_cache;
+
+struct usm_key_job_s {
+    struct usm_key_job_s *next;         /* all jobs, in config file order */
+    struct usm_key_job_s *unext;        /* the jobs of the same user */
+    struct usmUser *user;               /* NULL once the user is freed */
+    int             priv;               /* privKey rather than authKey */
+    int             copyToPriv;         /* privKey is a copy of authKey */
+    int             properPrivKeyLen;
+    char           *passphrase;
+    usm_key_cache  *entry;
+};
+
+static usm_key_cache **keyCache = NULL;
+static u_char   keyCacheSecret[USM_KEYCACHE_SECRET_LEN];
+static int      keyCacheSecretSet = 0;
+static struct usm_key_job_s *keyJobs = NULL, **keyJobsTail = &keyJobs;
+static int      keyJobsDeferred = 0;
+
+static int
+usm_keycache_digest(const oid *authProtocol, size_t authProtocolLen,
+                    const u_char *engineID, size_t engineIDLen,
+                    const char *passphrase, u_char *digest,
+                    size_t *digestLen)
+{
+    int             auth_type = sc_get_authtype(authProtocol,
+                                                authProtocolLen);
+    size_t          passLen = strlen(passphrase), len, i;
+    u_char         *buf;
+    int             rc;
+
+    if (!keyCacheSecretSet) {
+        len = sizeof(keyCacheSecret);
+        if (sc_random(keyCacheSecret, &len) != SNMPERR_SUCCESS ||
+            len != sizeof(keyCacheSecret))
+            return SNMPERR_GENERR;
+        keyCacheSecretSet = 1;
+    }
+
+    len = 2 + engineIDLen + passLen;
+    buf = (u_char *) malloc(len);
+    if (NULL == buf || auth_type < 0 || engineIDLen > 255) {
+        free(buf);
+        return SNMPERR_GENERR;
+    }
+    i = 0;
+    buf[i++] = (u_char) auth_type;
+    buf[i++] = (u_char) engineIDLen;
+    memcpy(buf + i, engineID, engineIDLen);
+    i += engineIDLen;
+    memcpy(buf + i, passphrase, passLen);
+
+    *digestLen = USM_AUTH_KU_LEN;
+    rc = sc_generate_keyed_hash(authProtocol, authProtocolLen,
+                                keyCacheSecret, sizeof(keyCacheSecret),
+                                buf, len, digest, digestLen);
+    SNMP_ZERO(buf, len);
+    free(buf);
+    return rc;
+}
+
+static usm_key_cache *
+usm_keycache_find(const u_char *digest, size_t digestLen)
+{
+    usm_key_cache  *entry;
+
+    if (NULL == keyCache)
+        return NULL;
+    for (entry = keyCache[USM_KEYCACHE_BUCKET(digest)]; entry;
+         entry = entry->next)
+        if (entry->digestLen == digestLen &&
+            memcmp(entry->digest, digest, digestLen) == 0)
+            return entry;
+    return NULL;
+}
+
+static usm_key_cache *
+usm_keycache_add(const u_char *digest, size_t digestLen,
+                 const u_char *key, size_t keyLen)
+{
+    usm_key_cache  *entry;
+    u_int           bucket;
+
+    if (digestLen < 2 || digestLen > sizeof(entry->digest) ||
+        keyLen > sizeof(entry->key))
+        return NULL;
+    entry = usm_keycache_find(digest, digestLen);
+    if (entry) {
+        if (keyLen > 0)
+            memcpy(entry->key, key, keyLen);
+        entry->keyLen = keyLen;
+        return entry;
+    }
+
+    if (NULL == keyCache) {
+        keyCache = (usm_key_cache **) calloc(USM_KEYCACHE_BUCKETS,
+                                             sizeof(usm_key_cache *));
+        if (NULL == keyCache)
+            return NULL;
+    }
+    entry = SNMP_MALLOC_TYPEDEF(usm_key_cache);
+    if (NULL == entry)
+        return NULL;
+    memcpy(entry->digest, digest, digestLen);
+    entry->digestLen = digestLen;
+    if (keyLen > 0)
+        memcpy(entry->key, key, keyLen);
+    entry->keyLen = keyLen;
+    bucket = USM_KEYCACHE_BUCKET(digest);
+    entry->next = keyCache[bucket];
+    keyCache[bucket] = entry;
+    return entry;
+}
+
+/*
+ * usm_keycache_expire(): forgets the keys not used since the last call,
+ * and starts over for the next one.
+ */
+static void
+usm_keycache_expire(void)
+{
+    usm_key_cache  *entry, **ep;
+    int             i;
+
+    if (NULL == keyCache)
+        return;
+    for (i = 0; i < USM_KEYCACHE_BUCKETS; i++) {
+        ep = &keyCache[i];
+        while ((entry = *ep) != NULL) {
+            if (entry->used) {
+                entry->used = 0;
+                ep = &entry->next;
+                continue;
+            }
+            *ep = entry->next;
+            SNMP_ZERO(entry, sizeof(*entry));
+            free(entry);
+        }
+    }
+}
+
+static void
+usm_keycache_clear(void)
+{
+    usm_key_cache  *entry;
+    int             i;
+
+    if (NULL == keyCache)
+        return;
+    for (i = 0; i < USM_KEYCACHE_BUCKETS; i++) {
+        while ((entry = keyCache[i]) != NULL) {
+            keyCache[i] = entry->next;
+            SNMP_ZERO(entry, sizeof(*entry));
+            free(entry);
+        }
+    }
+    SNMP_FREE(keyCache);
+}
+
+/*
+ * usm_derive_kul(): localizes a pass phrase the long way.
+ */
+static int
+usm_derive_kul(const oid *authProtocol, size_t authProtocolLen,
+               const u_char *engineID, size_t engineIDLen,
+               const char *passphrase, u_char *key, size_t *keyLen)
+{
+    u_char          Ku[SNMP_MAXBUF_SMALL];
+    size_t          KuLen = sizeof(Ku);
+    int             rc;
+
+    rc = generate_Ku(authProtocol, authProtocolLen, (const u_char *) passphrase,
+                     strlen(passphrase), Ku, &KuLen);
+    if (rc == SNMPERR_SUCCESS)
+        rc = generate_kul(authProtocol, authProtocolLen, engineID,
+                          engineIDLen, Ku, KuLen, key, keyLen);
+    memset(Ku, 0, sizeof(Ku));
+    return rc;
+}
+
+/*
+ * usm_localize_passphrase(): sets key to the localized key of a pass
+ * phrase of user, from the cache if it is there.  While the
+ * configuration is read, the key is left for usm_resolve_key_jobs()
+ * instead if job is not NULL, and *job is set.
+ */
+static int
+usm_localize_passphrase(struct usmUser *user, int priv,
+                        const char *passphrase, u_char *key, size_t *keyLen,
+                        struct usm_key_job_s **job)
+{
+    u_char          digest[USM_AUTH_KU_LEN];
+    size_t          digestLen = sizeof(digest);
+    usm_key_cache  *entry;
+    int             rc, have_digest;
+
+    have_digest = keyCacheSecretSet &&
+        usm_keycache_digest(user->authProtocol, user->authProtocolLen,
+                            user->engineID, user->engineIDLen, passphrase,
+                            digest, &digestLen) == SNMPERR_SUCCESS;
+    if (have_digest && (entry = usm_keycache_find(digest, digestLen)) &&
+        entry->keyLen > 0 && entry->keyLen <= *keyLen) {
+        DEBUGMSGTL(("usm:keycache", "found the key of %s\n", user->secName));
+        memcpy(key, entry->key, entry->keyLen);
+        *keyLen = entry->keyLen;
+        entry->used = 1;
+        return SNMPERR_SUCCESS;
+    }
+
+    if (job && keyJobsDeferred) {
+        int proper = sc_get_proper_auth_length_bytype(
+            sc_get_authtype(user->authProtocol, user->authProtocolLen));
+
+        if (proper <= 0 || (size_t)proper > *keyLen)
+            return SNMPERR_GENERR;
+        *job = SNMP_MALLOC_STRUCT(usm_key_job_s);
+        if (NULL == *job)
+            return SNMPERR_MALLOC;
+        (*job)->passphrase = strdup(passphrase);
+        if (NULL == (*job)->passphrase) {
+            SNMP_FREE(*job);
+            return SNMPERR_MALLOC;
+        }
+        (*job)->user = user;
+        (*job)->priv = priv;
+        (*job)->unext = user->keyJobs;
+        user->keyJobs = *job;
+        *keyJobsTail = *job;
+        keyJobsTail = &(*job)->next;
+        memset(key, 0, proper);
+        *keyLen = proper;
+        return SNMPERR_SUCCESS;
+    }
+
+    rc = usm_derive_kul(user->authProtocol, user->authProtocolLen,
+                        user->engineID, user->engineIDLen, passphrase,
+                        key, keyLen);
+    if (rc == SNMPERR_SUCCESS && (have_digest ||
+        usm_keycache_digest(user->authProtocol, user->authProtocolLen,
+                            user->engineID, user->engineIDLen, passphrase,
+                            digest, &digestLen) == SNMPERR_SUCCESS) &&
+        (entry = usm_keycache_add(digest, digestLen, key, *keyLen)))
+        entry->used = 1;
+    memset(digest, 0, sizeof(digest));
+    return rc;
+}
+
+/*
+ * usm_cancel_key_jobs(): forgets the pending jobs of user, all of them
+ * or only those of its privacy (priv = 1) or authentication (priv = 0)
+ * key.
+ */
+static void
+usm_cancel_key_jobs(struct usmUser *user, int priv)
+{
+    struct usm_key_job_s **jp = &user->keyJobs, *job;
+
+    while ((job = *jp) != NULL) {
+        if (priv < 0 || job->priv == priv) {
+            job->user = NULL;
+            *jp = job->unext;
+        } else
+            jp = &job->unext;
+    }
+}
+
+static void
+usm_derive_entry(usm_key_cache *entry)
+{
+    struct usmUser *user = entry->job->user;
+
+    entry->keyLen = sizeof(entry->key);
+    if (usm_derive_kul(user->authProtocol, user->authProtocolLen,
+                       user->engineID, user->engineIDLen,
+                       entry->job->passphrase, entry->key,
+                       &entry->keyLen) != SNMPERR_SUCCESS)
+        entry->keyLen = 0;
+}
+
+#ifdef NETSNMP_USM_KEY_THREADS
+struct usm_key_work {
+    pthread_mutex_t lock;
+    usm_key_cache **entries;
+    int             count;
+    int             next;
+};
+
+static void    *
+usm_key_worker(void *arg)
+{
+    struct usm_key_work *work = (struct usm_key_work *) arg;
+    int             i;
+
+    for (;;) {
+        pthread_mutex_lock(&work->lock);
+        i = work->next++;
+        pthread_mutex_unlock(&work->lock);
+        if (i >= work->count)
+            break;
+        usm_derive_entry(work->entries[i]);
+    }
+    return NULL;
+}
+#endif /* NETSNMP_USM_KEY_THREADS */
+
+/*
+ * usm_derive_entries(): derives the keys of count cache entries, on as
+ * many threads as there are processors, or as usmKeyThreads says.
+ */
+static void
+usm_derive_entries(usm_key_cache **entries, int count)
+{
+#ifdef NETSNMP_USM_KEY_THREADS
+    struct usm_key_work work;
+    pthread_t       threads[USM_KEY_THREADS_MAX];
+    int             nthreads, started;
+
+    nthreads = netsnmp_ds_get_int(NETSNMP_DS_LIBRARY_ID,
+                                  NETSNMP_DS_LIB_USM_KEY_THREADS);
+#if defined(HAVE_SYSCONF) && defined(_SC_NPROCESSORS_ONLN)
+    if (nthreads <= 0)
+        nthreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (nthreads > count)
+        nthreads = count;
+    if (nthreads > USM_KEY_THREADS_MAX)
+        nthreads = USM_KEY_THREADS_MAX;
+    if (nthreads > 1) {
+        work.entries = entries;
+        work.count = count;
+        work.next = 0;
+        pthread_mutex_init(&work.lock, NULL);
+        /* this thread is one of the workers */
+        for (started = 0; started < nthreads - 1; started++)
+            if (pthread_create(&threads[started], NULL, usm_key_worker,
+                               &work) != 0)
+                break;
+        DEBUGMSGTL(("usm:keycache", "deriving %d keys on %d threads\n",
+                    count, started + 1));
+        usm_key_worker(&work);
+        while (started > 0)
+            pthread_join(threads[--started], NULL);
+        pthread_mutex_destroy(&work.lock);
+        return;
+    }
+#endif /* NETSNMP_USM_KEY_THREADS */
+    DEBUGMSGTL(("usm:keycache", "deriving %d keys\n", count));
+    while (count-- > 0)
+        usm_derive_entry(*entries++);
+}
+
+/*
+ * usm_finish_key_job(): sets the key of a job from its cache entry, and
+ * completes the privacy key the way usm_create_usmUser_from_string()
+ * does.  Returns NULL, or an error message.
+ */
+static const char *
+usm_finish_key_job(struct usm_key_job_s *job)
+{
+    struct usmUser *user = job->user;
+
+    if (NULL == job->entry || 0 == job->entry->keyLen)
+        return "could not localize the pass phrase";
+    job->entry->used = 1;
+
+    if (!job->priv) {
+        if (job->entry->keyLen > user->authKeyLen)
+            return "improper authentication key length";
+        memcpy(user->authKey, job->entry->key, job->entry->keyLen);
+        user->authKeyLen = job->entry->keyLen;
+        if (job->copyToPriv && user->privKey &&
+            user->privKeyLen <= user->authKeyLen)
+            memcpy(user->privKey, user->authKey, user->privKeyLen);
+        return NULL;
+    }
+
+    if (job->entry->keyLen > user->privKeyLen)
+        return "improper privacy key length";
+    memcpy(user->privKey, job->entry->key, job->entry->keyLen);
+    user->privKeyLen = job->entry->keyLen;
+    if (user->privKeyLen < (size_t)job->properPrivKeyLen &&
+        usm_extend_user_kul(user, job->properPrivKeyLen) != SNMPERR_SUCCESS)
+        return "could not extend localized privacy key to required length.";
+    if (user->privKeyLen < (size_t)job->properPrivKeyLen)
+        return "privKey length is less than required by privProtocol";
+    user->privKeyLen = job->properPrivKeyLen;
+    return NULL;
+}
+
+/*
+ * usm_resolve_key_jobs(): localizes the pass phrases of the createUser
+ * lines, once all configuration files (and so the key cache) are read.
+ */
+static int
+usm_resolve_key_jobs(int majorid, int minorid, void *serverarg,
+                     void *clientarg)
+{
+    struct usm_key_job_s *job, *jobs = keyJobs;
+    usm_key_cache **entries = NULL, *entry, **tmp;
+    u_char          digest[USM_AUTH_KU_LEN];
+    size_t          digestLen;
+    const char     *error;
+    int             count = 0, size = 0, found = 0;
+
+    keyJobsDeferred = 0;
+    keyJobs = NULL;
+    keyJobsTail = &keyJobs;
+
+    for (job = jobs; job; job = job->next) {
+        if (NULL == job->user)
+            continue;
+        digestLen = sizeof(digest);
+        if (usm_keycache_digest(job->user->authProtocol,
+                                job->user->authProtocolLen,
+                                job->user->engineID, job->user->engineIDLen,
+                                job->passphrase, digest, &digestLen)
+            != SNMPERR_SUCCESS)
+            continue;
+        entry = usm_keycache_find(digest, digestLen);
+        if (entry && entry->keyLen > 0) {
+            found++;
+        } else if (!entry || !entry->job) {
+            /* not known yet, nor queued for another job */
+            if (count == size) {
+                size = size ? size * 2 : 64;
+                tmp = (usm_key_cache **) realloc(entries,
+                                                 size * sizeof(*entries));
+                if (NULL == tmp)
+                    continue;
+                entries = tmp;
+            }
+            if (!entry)
+                entry = usm_keycache_add(digest, digestLen, NULL, 0);
+            if (NULL == entry)
+                continue;
+            entry->job = job;
+            entries[count++] = entry;
+        }
+        job->entry = entry;
+    }
+    memset(digest, 0, sizeof(digest));
+    DEBUGMSGTL(("usm:keycache", "%d keys found, %d to derive\n", found,
+                count));
+
+    if (count > 0)
+        usm_derive_entries(entries, count);
+    while (count > 0)
+        entries[--count]->job = NULL;
+    SNMP_FREE(entries);
+
+    while ((job = jobs) != NULL) {
+        jobs = job->next;
+        if (job->user) {
+            struct usmUser *user = job->user;
+
+            error = usm_finish_key_job(job);
+            usm_cancel_key_jobs(user, job->priv);
+            if (error) {
+                snmp_log(LOG_ERR, "createUser %s: %s\n", user->secName,
+                         error);
+                usm_remove_user(user);
+                usm_free_user(user);
+            }
+        }
+        SNMP_ZERO(job->passphrase, strlen(job->passphrase));
+        SNMP_FREE(job->passphrase);
+        SNMP_FREE(job);
+    }
+    usm_keycache_expire();
+    return SNMPERR_SUCCESS;
+}
+
+static int
+usm_defer_key_jobs(int majorid, int minorid, void *serverarg,
+                   void *clientarg)
+{
+    keyJobsDeferred = 1;
+    return SNMPERR_SUCCESS;
+}
+
 /*******************************************************************-o-******
  * usm_set_password
  *
@@ -4431,8 +5248,22 @@ usm_set_user_password(struct usmUser *user, const char *token, char *line)
         memset(*key, 0, *keyLen);
         SNMP_FREE(*key);
     }
+    usm_cancel_key_jobs(user, key == &user->privKey);
 
-    if (type == 0) {
+    if (type == 0 && cp != NULL &&
+        !(user->flags & USMUSER_FLAG_KEEP_MASTER_KEY)) {
+        /*
+         * localize the password, or find its key in the cache
+         */
+        *key = (u_char *) malloc(SNMP_MAXBUF_SMALL);
+        *keyLen = SNMP_MAXBUF_SMALL;
+        if (NULL == *key ||
+            usm_localize_passphrase(user, key == &user->privKey, cp, *key,
+                                    keyLen, NULL) != SNMPERR_SUCCESS) {
+            config_perror("setting key failed (in generate_kul())");
+            return;
+        }
+    } else if (type == 0) {
         /*
          * convert the password into a key 
          */
@@ -4466,7 +5297,7 @@ usm_set_user_password(struct usmUser *user, const char *token, char *line)
         }
     }
 
-    if (type < 2) {
+    if (type < 2 && NULL == *key) {
         *key = (u_char *) malloc(SNMP_MAXBUF_SMALL);
         *keyLen = SNMP_MAXBUF_SMALL;
         ret = generate_kul(user->authProtocol, user->authProtocolLen,
@@ -4482,7 +5313,7 @@ usm_set_user_password(struct usmUser *user, const char *token, char *line)
          */
         memset(userKey, 0, sizeof(userKey));
 
-    } else {
+    } else if (type == 2) {
         /*
          * the key is given, copy it in 
          */
@@ -4500,7 +5331,9 @@ usm_set_user_password(struct usmUser *user, const char *token, char *line)
             config_perror("error extending localized user key");
             return;
         }
-    }
+        usm_user_priv_ctx(user, 0);
+    } else
+        usm_user_auth_ctx(user);
 }                               /* end usm_set_password() */
 
 /*
@@ -4526,10 +5359,11 @@ usm_create_usmUser_from_string(char *line, const char **errorMsg)
     size_t          userKeyLen = SNMP_MAXBUF_SMALL;
     size_t          privKeySize;
     size_t          ret;
-    int             ret2, properLen, properPrivKeyLen;
+    int             ret2, properLen, properPrivKeyLen, passphrase;
     const oid      *def_auth_prot, *def_priv_prot;
     size_t          def_auth_prot_len, def_priv_prot_len;
     const netsnmp_priv_alg_info *pai;
+    struct usm_key_job_s *authJob = NULL, *privJob = NULL;
 
     def_auth_prot = get_default_authtype(&def_auth_prot_len);
     def_priv_prot = get_default_privtype(&def_priv_prot_len);
@@ -4666,6 +5500,7 @@ usm_create_usmUser_from_string(char *line, const char **errorMsg)
      * READ: Authentication Pass Phrase or key
      */
     cp = copy_nword(cp, buf, sizeof(buf));
+    passphrase = 0;
     if (strcmp(buf,"-m") == 0) {
         /* a master key is specified */
         cp = copy_nword(cp, buf, sizeof(buf));
@@ -4681,6 +5516,10 @@ usm_create_usmUser_from_string(char *line, const char **errorMsg)
             newuser->authKeyKu = netsnmp_memdup(userKey, userKeyLen);
             newuser->authKeyKuLen = userKeyLen;
         }
+    } else if (strcmp(buf,"-l") != 0 &&
+               !(newuser->flags & USMUSER_FLAG_KEEP_MASTER_KEY)) {
+        /* a password is specified, localized below */
+        passphrase = 1;
     } else if (strcmp(buf,"-l") != 0) {
         /* a password is specified */
         userKeyLen = sizeof(userKey);
@@ -4723,6 +5562,13 @@ usm_create_usmUser_from_string(char *line, const char **errorMsg)
             *errorMsg = "improper key length to -l";
             goto fail;
         }
+    } else if (passphrase) {
+        ret2 = usm_localize_passphrase(newuser, 0, buf, newuser->authKey,
+                                       &newuser->authKeyLen, &authJob);
+        if (ret2 != SNMPERR_SUCCESS) {
+            *errorMsg = "could not generate localized authentication key (Kul) from the supplied pass phrase.";
+            goto fail;
+        }
     } else {
         ret2 = generate_kul(newuser->authProtocol, newuser->authProtocolLen,
                            newuser->engineID, newuser->engineIDLen,
@@ -4816,6 +5662,8 @@ usm_create_usmUser_from_string(char *line, const char **errorMsg)
         newuser->privKey = netsnmp_memdup(newuser->authKey,
                                           newuser->authKeyLen);
         privKeySize = newuser->privKeyLen = newuser->authKeyLen;
+        if (authJob)
+            authJob->copyToPriv = 1;
         if (newuser->flags & USMUSER_FLAG_KEEP_MASTER_KEY) {
             newuser->privKeyKu = netsnmp_memdup(newuser->authKeyKu,
                                                 newuser->authKeyKuLen);
@@ -4823,7 +5671,8 @@ usm_create_usmUser_from_string(char *line, const char **errorMsg)
         }
     } else {
         cp = copy_nword(cp, buf, sizeof(buf));
-        
+        passphrase = 0;
+
         if (strcmp(buf,"-m") == 0) {
             /* a master key is specified */
             cp = copy_nword(cp, buf, sizeof(buf));
@@ -4839,6 +5688,10 @@ usm_create_usmUser_from_string(char *line, const char **errorMsg)
                 newuser->privKeyKu = netsnmp_memdup(userKey, userKeyLen);
                 newuser->privKeyKuLen = userKeyLen;
             }
+        } else if (strcmp(buf,"-l") != 0 &&
+                   !(newuser->flags & USMUSER_FLAG_KEEP_MASTER_KEY)) {
+            /* a password is specified, localized below */
+            passphrase = 1;
         } else if (strcmp(buf,"-l") != 0) {
             /* a password is specified */
             userKeyLen = sizeof(userKey);
@@ -4873,6 +5726,13 @@ usm_create_usmUser_from_string(char *line, const char **errorMsg)
                 *errorMsg = "invalid key value argument to -l";
                 goto fail;
             }
+        } else if (passphrase) {
+            ret2 = usm_localize_passphrase(newuser, 1, buf, newuser->privKey,
+                                           &newuser->privKeyLen, &privJob);
+            if (ret2 != SNMPERR_SUCCESS) {
+                *errorMsg = "could not generate localized privacy key (Kul) from the supplied pass phrase.";
+                goto fail;
+            }
         } else {
             ret2 = generate_kul(newuser->authProtocol, newuser->authProtocolLen,
                                newuser->engineID, newuser->engineIDLen,
@@ -4884,7 +5744,7 @@ usm_create_usmUser_from_string(char *line, const char **errorMsg)
             }
         }
 
-        if (newuser->privKeyLen < properPrivKeyLen) {
+        if (!privJob && newuser->privKeyLen < properPrivKeyLen) {
             ret = usm_extend_user_kul(newuser, properPrivKeyLen);
             if (ret != SNMPERR_SUCCESS) {
                 *errorMsg = "could not extend localized privacy key to required length.";
@@ -4893,7 +5753,11 @@ usm_create_usmUser_from_string(char *line, const char **errorMsg)
         }
     }
 
-    if ((newuser->privKeyLen >= properPrivKeyLen) || (properPrivKeyLen == 0)){
+    if (privJob) {
+        /* extended and truncated once the key is localized */
+        privJob->properPrivKeyLen = properPrivKeyLen;
+    } else if ((newuser->privKeyLen >= properPrivKeyLen) ||
+               (properPrivKeyLen == 0)) {
         DEBUGMSGTL(("9:usmUser", "truncating privKeyLen from %" NETSNMP_PRIz "d to %d\n",
                     newuser->privKeyLen, properPrivKeyLen));
         newuser->privKeyLen = properPrivKeyLen;
@@ -5103,6 +5967,14 @@ init_usm(void)
                            SNMP_CALLBACK_SHUTDOWN,
                            free_engineID, NULL);
 
+    snmp_register_callback(SNMP_CALLBACK_LIBRARY,
+                           SNMP_CALLBACK_PRE_READ_CONFIG,
+                           usm_defer_key_jobs, NULL);
+
+    snmp_register_callback(SNMP_CALLBACK_LIBRARY,
+                           SNMP_CALLBACK_POST_READ_CONFIG,
+                           usm_resolve_key_jobs, NULL);
+
     register_config_handler("snmp", "defAuthType", snmpv3_authtype_conf,
                             NULL, "MD5|SHA|SHA-512|SHA-384|SHA-256|SHA-224");
     register_config_handler("snmp", "defPrivType", snmpv3_privtype_conf,
@@ -5117,6 +5989,9 @@ init_usm(void)
                             " (AES support not available)"
 #endif
                            );
+    netsnmp_ds_register_config(ASN_INTEGER, "snmp", "usmKeyThreads",
+                               NETSNMP_DS_LIBRARY_ID,
+                               NETSNMP_DS_LIB_USM_KEY_THREADS);
 
     /*
      * Free stuff at shutdown time
@@ -5147,4 +6022,9 @@ shutdown_usm(void)
 {
     free_etimelist();
     clear_user_list();
+    usm_resolve_key_jobs(0, 0, NULL, NULL);
+    usm_keycache_clear();
+    memset(keyCacheSecret, 0, sizeof(keyCacheSecret));
+    keyCacheSecretSet = 0;
+    sc_shutdown(0, 0, NULL, NULL);
 }
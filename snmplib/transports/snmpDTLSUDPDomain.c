@@ -120,6 +120,13 @@ typedef struct bio_cache_s {
 
 static bio_cache *biocache = NULL;
 
+/*
+ * All server connections present the same (default) identity, so they
+ * share one context and with it the cache of resumable sessions.  It is
+ * rebuilt once the configuration has been (re)read.
+ */
+static SSL_CTX *dtls_server_ctx = NULL;
+
 static int openssl_addr_index = 0;
 
 static int netsnmp_dtls_verify_cookie(SSL *ssl,
@@ -211,6 +218,18 @@ static void remove_and_free_bio_cache(bio_cache *cachep)
 }
 
 
+static int
+_release_server_ctx(int majorid, int minorid, void *serverarg,
+                    void *clientarg)
+{
+    if (dtls_server_ctx) {
+        /* connections still using it hold their own reference */
+        SSL_CTX_free(dtls_server_ctx);
+        dtls_server_ctx = NULL;
+    }
+    return 0;
+}
+
 /* XXX: lots of malloc/state cleanup needed */
 #define DIEHERE(msg) do { snmp_log(LOG_ERR, "%s\n", msg); return NULL; } while(0)
 
@@ -324,26 +343,38 @@ start_new_cached_connection(netsnmp_transport *t,
         DEBUGMSGTL(("dtlsudp",
                     "starting a new connection as a client to sock: %d\n",
                     t->sock));
-        tlsdata->ssl = SSL_new(sslctx_client_setup(DTLS_method(), tlsdata));
+        SSL_CTX *ctx = sslctx_client_setup(DTLS_method(), tlsdata);
+        if (ctx) {
+            tlsdata->ssl = SSL_new(ctx);
+            SSL_CTX_free(ctx); /* the SSL holds its own reference */
+        }
 
-        /* XXX: session setting 735 */
+        /* resume an earlier session with this server if we have one */
+        if (tlsdata->ssl)
+            netsnmp_tlsbase_session_attach(tlsdata->ssl, tlsdata,
+                                           &cachep->sas,
+                                           netsnmp_sockaddr_size(&cachep->sas.sa));
     } else {
         /* we're the server */
-        SSL_CTX *ctx = sslctx_server_setup(DTLS_method());
-        if (!ctx) {
-            BIO_free(cachep->read_bio);
-            BIO_free(cachep->write_bio);
-            cachep->read_bio = NULL;
-            cachep->write_bio = NULL;
-            DIEHERE("failed to create the SSL Context");
-        }
+        if (NULL == dtls_server_ctx) {
+            SSL_CTX *ctx = sslctx_server_setup(DTLS_method());
+            if (!ctx) {
+                BIO_free(cachep->read_bio);
+                BIO_free(cachep->write_bio);
+                cachep->read_bio = NULL;
+                cachep->write_bio = NULL;
+                DIEHERE("failed to create the SSL Context");
+            }
 
-        /* turn on cookie exchange */
-        /* Set DTLS cookie generation and verification callbacks */
-        SSL_CTX_set_cookie_generate_cb(ctx, netsnmp_dtls_gen_cookie);
-        SSL_CTX_set_cookie_verify_cb(ctx, netsnmp_dtls_verify_cookie);
+            /* turn on cookie exchange */
+            /* Set DTLS cookie generation and verification callbacks */
+            SSL_CTX_set_cookie_generate_cb(ctx, netsnmp_dtls_gen_cookie);
+            SSL_CTX_set_cookie_verify_cb(ctx, netsnmp_dtls_verify_cookie);
 
-        tlsdata->ssl = SSL_new(ctx);
+            dtls_server_ctx = ctx;
+        }
+
+        tlsdata->ssl = SSL_new(dtls_server_ctx);
     }
 
     if (!tlsdata->ssl) {
@@ -966,6 +997,7 @@ netsnmp_dtlsudp_recv(netsnmp_transport *t, void *buf, int size,
                 }
             }
             tlsdata->flags |= NETSNMP_TLSBASE_CERT_FP_VERIFIED;
+            netsnmp_tlsbase_session_established(tlsdata->ssl, tlsdata);
             DEBUGMSGTL(("dtlsudp", "Verified the server's certificate\n"));
         } else {
 #ifndef NETSNMP_NO_LISTEN_SUPPORT
@@ -991,6 +1023,7 @@ netsnmp_dtlsudp_recv(netsnmp_transport *t, void *buf, int size,
                 }
             }
             tlsdata->flags |= NETSNMP_TLSBASE_CERT_FP_VERIFIED;
+            netsnmp_tlsbase_session_established(tlsdata->ssl, tlsdata);
             DEBUGMSGTL(("dtlsudp", "Verified the client's certificate\n"));
 #else /* NETSNMP_NO_LISTEN_SUPPORT */
             return NULL;
@@ -1682,6 +1715,12 @@ netsnmp_dtlsudp_ctor(void)
             SSL_get_ex_new_index(0, NETSNMP_REMOVE_CONST(void *, indexname),
                                  NULL, NULL, NULL);
 
+    snmp_register_callback(SNMP_CALLBACK_LIBRARY,
+                           SNMP_CALLBACK_POST_READ_CONFIG,
+                           _release_server_ctx, NULL);
+    snmp_register_callback(SNMP_CALLBACK_LIBRARY, SNMP_CALLBACK_SHUTDOWN,
+                           _release_server_ctx, NULL);
+
     netsnmp_tdomain_register(&dtlsudpDomain);
 }
 
@@ -30,6 +30,9 @@
 #ifdef HAVE_SYS_SOCKET_H
 #include <sys/socket.h>
 #endif
+#ifdef HAVE_LINUX_SOCK_DIAG_H
+#include <linux/sock_diag.h>
+#endif
 #include <errno.h>
 
 #include <net-snmp/types.h>
@@ -331,6 +334,31 @@ netsnmp_sock_buffer_set(int s, int optname, int local, int size)
 #endif
 }
 
+/**
+ * Returns the number of packets the kernel dropped because the receive
+ * queue of a socket was full.
+ *
+ * @param[in]  s     Socket descriptor.
+ * @param[out] drops Number of packets dropped since the socket was opened.
+ *
+ * @return zero upon success and -1 if the platform does not provide this
+ *   count.
+ */
+int
+netsnmp_sock_get_rcv_drops(int s, u_long *drops)
+{
+#if defined(SO_MEMINFO) && defined(HAVE_LINUX_SOCK_DIAG_H)
+    u_int           meminfo[SK_MEMINFO_VARS];
+    socklen_t       len = sizeof(meminfo);
+
+    if (getsockopt(s, SOL_SOCKET, SO_MEMINFO, (void *) meminfo, &len) == 0
+        && len > SK_MEMINFO_DROPS * sizeof(meminfo[0])) {
+        *drops = meminfo[SK_MEMINFO_DROPS];
+        return 0;
+    }
+#endif
+    return -1;
+}
 
 /**
  * Sets the mode of a socket for all subsequent I/O operations.
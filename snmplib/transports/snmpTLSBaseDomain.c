@@ -21,6 +21,16 @@ netsnmp_feature_require(cert_util);
 #if HAVE_NETDB_H
 #include <netdb.h>
 #endif
+#if TIME_WITH_SYS_TIME
+# include <sys/time.h>
+# include <time.h>
+#else
+# if HAVE_SYS_TIME_H
+#  include <sys/time.h>
+# else
+#  include <time.h>
+# endif
+#endif
 #include <errno.h>
 #include <ctype.h>
 #include "../memcheck.h"
@@ -458,6 +468,225 @@ _load_trusted_certs(SSL_CTX *the_ctx) {
     }
 }    
 
+/*
+ * (D)TLS session resumption.  A server keeps the sessions it negotiated
+ * in the cache of its context and also hands out session tickets; a
+ * client context lives no longer than its connection, so clients keep
+ * the last session with each peer in the list below instead.  Either
+ * way a reconnecting client skips the full handshake, including the
+ * certificate chain verification.  The list is flushed whenever the
+ * configuration is (re)read, since its sessions were verified against
+ * the certificates and trust settings of the previous one.
+ */
+#define NETSNMP_TLS_SESSION_CACHE_SIZE 1024
+#define NETSNMP_TLS_SESSION_LIFETIME   7200
+
+typedef struct _netsnmp_tls_session_s {
+    u_char                         *key;
+    size_t                          key_len;
+    SSL_SESSION                    *session;
+    struct _netsnmp_tls_session_s  *next;
+} _netsnmp_tls_session;
+
+static _netsnmp_tls_session *tls_sessions = NULL;
+static int tls_session_index = -1;
+static const unsigned char tls_session_id_context[] = "net-snmp";
+
+static void
+_tls_session_free(_netsnmp_tls_session *entry)
+{
+    SSL_SESSION_free(entry->session);
+    SNMP_FREE(entry->key);
+    free(entry);
+}
+
+static int
+_tls_session_flush(int majorid, int minorid, void *serverarg,
+                   void *clientarg)
+{
+    _netsnmp_tls_session *entry;
+
+    while ((entry = tls_sessions) != NULL) {
+        tls_sessions = entry->next;
+        _tls_session_free(entry);
+    }
+    return 0;
+}
+
+/* called by openssl when a client connection got a (new) session */
+static int
+_tls_session_new_cb(SSL *ssl, SSL_SESSION *session)
+{
+    _netsnmpTLSBaseData   *tlsdata;
+    _netsnmp_tls_session  *entry, **prevp;
+    int                    count = 0, cache_size;
+
+    cache_size = netsnmp_ds_get_int(NETSNMP_DS_LIBRARY_ID,
+                                    NETSNMP_DS_LIB_TLS_SESSION_CACHE_SIZE);
+    tlsdata = SSL_get_ex_data(ssl, tls_session_index);
+    if (NULL == tlsdata || NULL == tlsdata->session_key || cache_size <= 0)
+        return 0;
+
+    /* replace the previous session with this peer and make room for the
+       new one by dropping the least recently used ones */
+    for (prevp = &tls_sessions; (entry = *prevp) != NULL; ) {
+        if ((entry->key_len == tlsdata->session_key_len &&
+             memcmp(entry->key, tlsdata->session_key, entry->key_len) == 0) ||
+            ++count >= cache_size) {
+            *prevp = entry->next;
+            _tls_session_free(entry);
+        } else
+            prevp = &entry->next;
+    }
+
+    entry = SNMP_MALLOC_TYPEDEF(_netsnmp_tls_session);
+    if (NULL == entry)
+        return 0;
+    entry->key = netsnmp_memdup(tlsdata->session_key,
+                                tlsdata->session_key_len);
+    if (NULL == entry->key) {
+        free(entry);
+        return 0;
+    }
+    entry->key_len = tlsdata->session_key_len;
+    entry->session = session;
+    entry->next = tls_sessions;
+    tls_sessions = entry;
+
+    DEBUGMSGTL(("tls:session", "remembering the session with a server\n"));
+    return 1; /* we keep the reference */
+}
+
+/*
+ * Offer the session of an earlier connection to the same peer, if it
+ * was verified the same way and has not expired yet.  peer is anything
+ * that identifies the remote end: its address string or sockaddr.
+ */
+void
+netsnmp_tlsbase_session_attach(SSL *ssl, _netsnmpTLSBaseData *tlsdata,
+                               const void *peer, size_t peer_len)
+{
+    const SSL_METHOD      *method;
+    const char            *ids[5];
+    _netsnmp_tls_session  *entry, **prevp;
+    u_char                *key, *cp;
+    size_t                 key_len, i;
+
+    if (NULL == ssl || NULL == tlsdata || tls_session_index < 0 ||
+        netsnmp_ds_get_int(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_TLS_SESSION_CACHE_SIZE) <= 0)
+        return;
+
+    ids[0] = tlsdata->our_identity;
+    ids[1] = tlsdata->their_identity;
+    ids[2] = tlsdata->their_fingerprint;
+    ids[3] = tlsdata->their_hostname;
+    ids[4] = tlsdata->trust_cert;
+
+    /* key: method, peer and each identity including its terminator */
+    method = SSL_get_ssl_method(ssl);
+    key_len = sizeof(method) + peer_len;
+    for (i = 0; i < sizeof(ids) / sizeof(ids[0]); i++)
+        key_len += (ids[i] ? strlen(ids[i]) : 0) + 1;
+    cp = key = malloc(key_len);
+    if (NULL == key)
+        return;
+    memcpy(cp, &method, sizeof(method));
+    cp += sizeof(method);
+    memcpy(cp, peer, peer_len);
+    cp += peer_len;
+    for (i = 0; i < sizeof(ids) / sizeof(ids[0]); i++) {
+        if (ids[i]) {
+            strcpy((char *) cp, ids[i]);
+            cp += strlen(ids[i]);
+        }
+        *cp++ = '\0';
+    }
+
+    SNMP_FREE(tlsdata->session_key);
+    tlsdata->session_key = key;
+    tlsdata->session_key_len = key_len;
+    SSL_set_ex_data(ssl, tls_session_index, tlsdata);
+
+    for (prevp = &tls_sessions; (entry = *prevp) != NULL;
+         prevp = &entry->next) {
+        if (entry->key_len != key_len ||
+            memcmp(entry->key, key, key_len) != 0)
+            continue;
+        *prevp = entry->next;
+        if (SSL_SESSION_get_time(entry->session) +
+            SSL_SESSION_get_timeout(entry->session) < time(NULL)) {
+            DEBUGMSGTL(("tls:session", "the cached session has expired\n"));
+            _tls_session_free(entry);
+            break;
+        }
+        entry->next = tls_sessions;
+        tls_sessions = entry;
+        SSL_set_session(ssl, entry->session);
+        DEBUGMSGTL(("tls:session", "offering a cached session\n"));
+        break;
+    }
+}
+
+/* count whether a (D)TLS connection that has been set up was resumed */
+void
+netsnmp_tlsbase_session_established(SSL *ssl, _netsnmpTLSBaseData *tlsdata)
+{
+    const char *side;
+
+    if (NULL == ssl || NULL == tlsdata)
+        return;
+
+    side = (tlsdata->flags & NETSNMP_TLSBASE_IS_CLIENT) ? "client" : "server";
+    if (SSL_session_reused(ssl)) {
+        snmp_increment_statistic(STAT_TLS_SESSIONCACHEHITS);
+        DEBUGMSGTL(("tls:session", "%s: resumed a session\n", side));
+    } else {
+        snmp_increment_statistic(STAT_TLS_SESSIONCACHEMISSES);
+        DEBUGMSGTL(("tls:session", "%s: full handshake\n", side));
+    }
+    DEBUGMSGTL(("tls:session", "%u hits, %u misses\n",
+                snmp_get_statistic(STAT_TLS_SESSIONCACHEHITS),
+                snmp_get_statistic(STAT_TLS_SESSIONCACHEMISSES)));
+}
+
+static void
+_sslctx_session_setup(SSL_CTX *the_ctx, int isserver)
+{
+    int cache_size, lifetime;
+
+    cache_size = netsnmp_ds_get_int(NETSNMP_DS_LIBRARY_ID,
+                                    NETSNMP_DS_LIB_TLS_SESSION_CACHE_SIZE);
+    lifetime = netsnmp_ds_get_int(NETSNMP_DS_LIBRARY_ID,
+                                  NETSNMP_DS_LIB_TLS_SESSION_LIFETIME);
+
+    if (cache_size <= 0) {
+        DEBUGMSGTL(("tls:session", "session resumption is disabled\n"));
+        SSL_CTX_set_session_cache_mode(the_ctx, SSL_SESS_CACHE_OFF);
+        SSL_CTX_set_options(the_ctx, SSL_OP_NO_TICKET);
+#ifdef TLS1_3_VERSION
+        if (isserver)
+            SSL_CTX_set_num_tickets(the_ctx, 0);
+#endif
+        return;
+    }
+
+    if (lifetime > 0)
+        SSL_CTX_set_timeout(the_ctx, lifetime);
+
+    if (isserver) {
+        /* without an id context openssl won't resume verified sessions */
+        SSL_CTX_set_session_id_context(the_ctx, tls_session_id_context,
+                                       sizeof(tls_session_id_context) - 1);
+        SSL_CTX_set_session_cache_mode(the_ctx, SSL_SESS_CACHE_SERVER);
+        SSL_CTX_sess_set_cache_size(the_ctx, cache_size);
+    } else {
+        SSL_CTX_set_session_cache_mode(the_ctx, SSL_SESS_CACHE_CLIENT |
+                                       SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(the_ctx, _tls_session_new_cb);
+    }
+}
+
 SSL_CTX *
 _sslctx_common_setup(SSL_CTX *the_ctx, _netsnmpTLSBaseData *tlsbase) {
     char         *crlFile;
@@ -562,6 +791,7 @@ SSL_CTX *
 sslctx_client_setup(const SSL_METHOD *method, _netsnmpTLSBaseData *tlsbase) {
     netsnmp_cert *id_cert, *peer_cert;
     SSL_CTX      *the_ctx;
+    X509         *chain_cert;
 
     /***********************************************************************
      * Set up the client context
@@ -611,8 +841,13 @@ sslctx_client_setup(const SSL_METHOD *method, _netsnmpTLSBaseData *tlsbase) {
 
     while (id_cert->issuer_cert) {
         id_cert = id_cert->issuer_cert;
-        if (!SSL_CTX_add_extra_chain_cert(the_ctx, id_cert->ocert))
+        /* the context owns (and frees) its chain; give it a copy */
+        chain_cert = X509_dup(id_cert->ocert);
+        if (!chain_cert ||
+            !SSL_CTX_add_extra_chain_cert(the_ctx, chain_cert)) {
+            X509_free(chain_cert);
             LOGANDDIE("failed to add intermediate client certificate");
+        }
     }
 
     if (tlsbase->their_identity)
@@ -637,12 +872,15 @@ sslctx_client_setup(const SSL_METHOD *method, _netsnmpTLSBaseData *tlsbase) {
             return 0;
     }
 
+    _sslctx_session_setup(the_ctx, 0);
+
     return _sslctx_common_setup(the_ctx, tlsbase);
 }
 
 SSL_CTX *
 sslctx_server_setup(const SSL_METHOD *method) {
     netsnmp_cert *id_cert;
+    X509         *chain_cert;
 
     /***********************************************************************
      * Set up the server context
@@ -677,8 +915,13 @@ sslctx_server_setup(const SSL_METHOD *method) {
 
     while (id_cert->issuer_cert) {
         id_cert = id_cert->issuer_cert;
-        if (!SSL_CTX_add_extra_chain_cert(the_ctx, id_cert->ocert))
+        /* the context owns (and frees) its chain; give it a copy */
+        chain_cert = X509_dup(id_cert->ocert);
+        if (!chain_cert ||
+            !SSL_CTX_add_extra_chain_cert(the_ctx, chain_cert)) {
+            X509_free(chain_cert);
             LOGANDDIE("failed to add intermediate server certificate");
+        }
     }
 
     SSL_CTX_set_read_ahead(the_ctx, 1); /* XXX: DTLS only? */
@@ -689,6 +932,8 @@ sslctx_server_setup(const SSL_METHOD *method) {
                        SSL_VERIFY_CLIENT_ONCE,
                        &verify_callback);
 
+    _sslctx_session_setup(the_ctx, 1);
+
     return _sslctx_common_setup(the_ctx, NULL);
 }
 
@@ -770,6 +1015,7 @@ static int have_done_bootstrap = 0;
 static int
 tls_bootstrap(int majorid, int minorid, void *serverarg, void *clientarg) {
     char indexname[] = "_netsnmp_verify_info";
+    char sessionindexname[] = "_netsnmp_tls_session";
 
     /* don't do this more than once */
     if (have_done_bootstrap)
@@ -780,6 +1026,8 @@ tls_bootstrap(int majorid, int minorid, void *serverarg, void *clientarg) {
 
     openssl_local_index =
         SSL_get_ex_new_index(0, indexname, NULL, NULL, NULL);
+    tls_session_index =
+        SSL_get_ex_new_index(0, sessionindexname, NULL, NULL, NULL);
 
     return 0;
 }
@@ -846,6 +1094,24 @@ netsnmp_tlsbase_ctor(void) {
                                NETSNMP_DS_LIBRARY_ID,
                                NETSNMP_DS_LIB_TLS_MAX_VERSION);
 
+    /* How many sessions to keep for resumption and for how long */
+    if (0 == netsnmp_ds_get_int(NETSNMP_DS_LIBRARY_ID,
+                                NETSNMP_DS_LIB_TLS_SESSION_CACHE_SIZE))
+        netsnmp_ds_set_int(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_TLS_SESSION_CACHE_SIZE,
+                           NETSNMP_TLS_SESSION_CACHE_SIZE);
+    netsnmp_ds_register_config(ASN_INTEGER, "snmp", "tlsSessionCacheSize",
+                               NETSNMP_DS_LIBRARY_ID,
+                               NETSNMP_DS_LIB_TLS_SESSION_CACHE_SIZE);
+    if (0 == netsnmp_ds_get_int(NETSNMP_DS_LIBRARY_ID,
+                                NETSNMP_DS_LIB_TLS_SESSION_LIFETIME))
+        netsnmp_ds_set_int(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_TLS_SESSION_LIFETIME,
+                           NETSNMP_TLS_SESSION_LIFETIME);
+    netsnmp_ds_register_config(ASN_INTEGER, "snmp", "tlsSessionLifetime",
+                               NETSNMP_DS_LIBRARY_ID,
+                               NETSNMP_DS_LIB_TLS_SESSION_LIFETIME);
+
     /*
      * for the client
      */
@@ -877,6 +1143,11 @@ netsnmp_tlsbase_ctor(void) {
     snmp_register_callback(SNMP_CALLBACK_LIBRARY,
 			   SNMP_CALLBACK_POST_PREMIB_READ_CONFIG,
 			   tls_bootstrap, NULL);
+    snmp_register_callback(SNMP_CALLBACK_LIBRARY,
+                           SNMP_CALLBACK_POST_READ_CONFIG,
+                           _tls_session_flush, NULL);
+    snmp_register_callback(SNMP_CALLBACK_LIBRARY, SNMP_CALLBACK_SHUTDOWN,
+                           _tls_session_flush, NULL);
 
 }
 
@@ -931,6 +1202,7 @@ void netsnmp_tlsbase_free_tlsdata(_netsnmpTLSBaseData *tlsbase) {
     SNMP_FREE(tlsbase->their_fingerprint);
     SNMP_FREE(tlsbase->their_hostname);
     SNMP_FREE(tlsbase->trust_cert);
+    SNMP_FREE(tlsbase->session_key);
 
     /* free the base itself */
     SNMP_FREE(tlsbase);
@@ -82,6 +82,14 @@ size_t          netsnmpTLSTCPDomain_len = OID_LENGTH(netsnmpTLSTCPDomain);
 
 static netsnmp_tdomain tlstcpDomain;
 
+/*
+ * All listeners present the same (default) identity, so they share one
+ * context and with it the cache of resumable sessions and the ticket
+ * keys.  It is rebuilt once the configuration has been (re)read, so
+ * that no session verified under the old trust settings is resumed.
+ */
+static SSL_CTX *tls_server_ctx = NULL;
+
 /*
  * Return a string representing the address in data, or else the "far end"
  * address if data is NULL.  
@@ -163,6 +171,9 @@ netsnmp_tlstcp_copy(const netsnmp_transport *oldt, netsnmp_transport *newt)
     if (oldtlsdata->addr)
         newtlsdata->addr = netsnmp_memdup(oldtlsdata->addr,
                                           sizeof(*oldtlsdata->addr));
+    if (oldtlsdata->session_key)
+        newtlsdata->session_key = netsnmp_memdup(oldtlsdata->session_key,
+                                                 oldtlsdata->session_key_len);
 
     return 0;
 }
@@ -545,7 +556,9 @@ netsnmp_tlstcp_accept(netsnmp_transport *t)
     }
 
     /* create the OpenSSL TLS context */
-    ctx = tlsdata->ssl_context;
+    if (NULL == tls_server_ctx)
+        tls_server_ctx = sslctx_server_setup(TLS_method());
+    ctx = tls_server_ctx;
 
     /* create the server's main SSL bio */
     ssl = tlsdata->ssl = SSL_new(ctx);
@@ -640,6 +653,7 @@ netsnmp_tlstcp_accept(netsnmp_transport *t)
 
     /* XXX: check acceptance criteria here */
 
+    netsnmp_tlsbase_session_established(ssl, tlsdata);
     DEBUGMSGTL(("tlstcp", "accept succeeded on sock %d\n", t->sock));
 
     /* RFC5953 Section 5.1.2 step 1, part2::
@@ -774,6 +788,10 @@ netsnmp_tlstcp_open_client(netsnmp_transport *t)
     SSL_set_bio(ssl, bio, bio);
     SSL_set_mode(ssl, SSL_MODE_AUTO_RETRY);
 
+    /* resume an earlier session with this server if we have one */
+    netsnmp_tlsbase_session_attach(ssl, tlsdata, tlsdata->addr_string,
+                                   strlen(tlsdata->addr_string));
+
     verify_info = SNMP_MALLOC_TYPEDEF(_netsnmp_verify_info);
     if (NULL == verify_info) {
         snmp_increment_statistic(STAT_TLSTM_SNMPTLSTMSESSIONOPENERRORS);
@@ -864,6 +882,7 @@ netsnmp_tlstcp_open_client(netsnmp_transport *t)
     */
     /* XXX: add snmpTlstmSessionInvalidServerCertificates on
        crypto failure */
+    netsnmp_tlsbase_session_established(ssl, tlsdata);
 
     /* RFC5953 Section 5.3.1: Establishing a Session as a Client
        6)  The TLSTM-specific session identifier (tlstmSessionID) is set in
@@ -913,8 +932,9 @@ netsnmp_tlstcp_open_server(netsnmp_transport *t)
         return NULL;
     }
 
-    /* create the OpenSSL TLS context */
-    tlsdata->ssl_context = sslctx_server_setup(TLS_method());
+    /* create the OpenSSL TLS context, shared by all listeners */
+    if (NULL == tls_server_ctx)
+        tls_server_ctx = sslctx_server_setup(TLS_method());
 
     t->sock = BIO_get_fd(tlsdata->accept_bio, NULL);
     t->flags |= NETSNMP_TRANSPORT_FLAG_LISTEN;
@@ -1069,6 +1089,18 @@ netsnmp_tlstcp_create_ostring(const void *o, size_t o_len, int local)
     return netsnmp_tlstcp_transport(buf, local);
 }
 
+static int
+_release_server_ctx(int majorid, int minorid, void *serverarg,
+                    void *clientarg)
+{
+    if (tls_server_ctx) {
+        /* connections still using it hold their own reference */
+        SSL_CTX_free(tls_server_ctx);
+        tls_server_ctx = NULL;
+    }
+    return 0;
+}
+
 void
 netsnmp_tlstcp_ctor(void)
 {
@@ -1085,5 +1117,11 @@ netsnmp_tlstcp_ctor(void)
     tlstcpDomain.f_create_from_tstring_new = netsnmp_tlstcp_create_tstring;
     tlstcpDomain.f_create_from_ostring     = netsnmp_tlstcp_create_ostring;
 
+    snmp_register_callback(SNMP_CALLBACK_LIBRARY,
+                           SNMP_CALLBACK_POST_READ_CONFIG,
+                           _release_server_ctx, NULL);
+    snmp_register_callback(SNMP_CALLBACK_LIBRARY, SNMP_CALLBACK_SHUTDOWN,
+                           _release_server_ctx, NULL);
+
     netsnmp_tdomain_register(&tlstcpDomain);
 }
@@ -10,6 +10,10 @@
  * distributed with the Net-SNMP package.
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* recvmmsg(), sendmmsg() */
+#endif
+
 #include <net-snmp/net-snmp-config.h>
 
 #include <net-snmp/types.h>
@@ -98,6 +102,21 @@ _netsnmp_udp_sockopt_set(int fd, int local)
 #endif                          /*SO_REUSEADDR */
 #endif
 
+#ifdef SO_REUSEPORT
+    /*
+     * SO_REUSEPORT is only set when asked for, by an agent that opens
+     * several sockets on one address so that the kernel spreads the
+     * incoming datagrams over their receive queues.
+     */
+    if (local && netsnmp_ds_get_int(NETSNMP_DS_LIBRARY_ID,
+                                    NETSNMP_DS_LIB_UDP_REUSEPORT) > 0) {
+        int             one = 1;
+        DEBUGMSGTL(("socket:option", "setting socket option SO_REUSEPORT\n"));
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (void *) &one,
+                   sizeof(one));
+    }
+#endif                          /*SO_REUSEPORT */
+
     /*
      * Try to set the send and receive buffers to a reasonably large value, so
      * that we can send and receive big PDUs (defaults to 8192 bytes (!) on
@@ -133,6 +152,39 @@ static LPFN_WSARECVMSG pfWSARecvMsg;
 static LPFN_WSASENDMSG pfWSASendMsg;
 #endif
 
+#if !defined(WIN32)
+/*
+ * Copies the destination address of a received datagram from the control
+ * messages in msg to dstip and if_index.
+ */
+static void
+_udpbase_get_dstip(struct msghdr *msg, struct sockaddr *dstip, int *if_index)
+{
+    struct cmsghdr *cm;
+
+    for (cm = CMSG_FIRSTHDR(msg); cm != NULL; cm = CMSG_NXTHDR(msg, cm)) {
+#if defined(HAVE_IP_PKTINFO)
+        if (cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_PKTINFO) {
+            struct in_pktinfo* src = (struct in_pktinfo *)CMSG_DATA(cm);
+            netsnmp_assert(dstip->sa_family == AF_INET);
+            ((struct sockaddr_in*)dstip)->sin_addr = src->ipi_addr;
+            *if_index = src->ipi_ifindex;
+            DEBUGMSGTL(("udpbase:recv",
+                        "got destination (local) addr %s, iface %d\n",
+                        inet_ntoa(src->ipi_addr), *if_index));
+        }
+#elif defined(HAVE_IP_RECVDSTADDR)
+        if (cm->cmsg_level == IPPROTO_IP && cm->cmsg_type == IP_RECVDSTADDR) {
+            struct in_addr* src = (struct in_addr *)CMSG_DATA(cm);
+            ((struct sockaddr_in*)dstip)->sin_addr = *src;
+            DEBUGMSGTL(("netsnmp_udp", "got destination (local) addr %s\n",
+                        inet_ntoa(*src)));
+        }
+#endif
+    }
+}
+#endif /* !defined(WIN32) */
+
 int
 netsnmp_udpbase_recvfrom(int s, void *buf, int len, struct sockaddr *from,
                          socklen_t *fromlen, struct sockaddr *dstip,
@@ -142,7 +194,6 @@ netsnmp_udpbase_recvfrom(int s, void *buf, int len, struct sockaddr *from,
 #if !defined(WIN32)
     struct iovec iov;
     char cmsg[CMSG_SPACE(cmsg_data_size)];
-    struct cmsghdr *cm;
     struct msghdr msg;
 
     iov.iov_base = buf;
@@ -198,26 +249,7 @@ netsnmp_udpbase_recvfrom(int s, void *buf, int len, struct sockaddr *from,
     }
 
 #if !defined(WIN32)
-    for (cm = CMSG_FIRSTHDR(&msg); cm != NULL; cm = CMSG_NXTHDR(&msg, cm)) {
-#if defined(HAVE_IP_PKTINFO)
-        if (cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_PKTINFO) {
-            struct in_pktinfo* src = (struct in_pktinfo *)CMSG_DATA(cm);
-            netsnmp_assert(dstip->sa_family == AF_INET);
-            ((struct sockaddr_in*)dstip)->sin_addr = src->ipi_addr;
-            *if_index = src->ipi_ifindex;
-            DEBUGMSGTL(("udpbase:recv",
-                        "got destination (local) addr %s, iface %d\n",
-                        inet_ntoa(src->ipi_addr), *if_index));
-        }
-#elif defined(HAVE_IP_RECVDSTADDR)
-        if (cm->cmsg_level == IPPROTO_IP && cm->cmsg_type == IP_RECVDSTADDR) {
-            struct in_addr* src = (struct in_addr *)CMSG_DATA(cm);
-            ((struct sockaddr_in*)dstip)->sin_addr = *src;
-            DEBUGMSGTL(("netsnmp_udp", "got destination (local) addr %s\n",
-                        inet_ntoa(*src)));
-        }
-#endif
-    }
+    _udpbase_get_dstip(&msg, dstip, if_index);
 #else /* !defined(WIN32) */
     for (cm = WSA_CMSG_FIRSTHDR(&msg); cm; cm = WSA_CMSG_NXTHDR(&msg, cm)) {
         if (cm->cmsg_level == IPPROTO_IP && cm->cmsg_type == IP_PKTINFO) {
@@ -418,6 +450,251 @@ int netsnmp_udpbase_sendto(int fd, const struct in_addr *srcip, int if_index,
 }
 #endif /* HAVE_IP_PKTINFO || HAVE_IP_RECVDSTADDR */
 
+#if defined(HAVE_RECVMMSG) && defined(HAVE_SENDMMSG) && \
+    defined(HAVE_IP_PKTINFO) && !defined(WIN32)
+#define NETSNMP_UDPBASE_BATCH
+
+/*
+ * Batched I/O for server sockets, enabled by setting udpBatchSize above 1.
+ * One recvmmsg() call fills up to 'size' slots, which netsnmp_udpbase_recv()
+ * then hands out one at a time, keeping NETSNMP_TRANSPORT_FLAG_PENDING set
+ * so that the session layer reads them all before it selects again.
+ * Replies sent in the meantime are copied into the buffers of datagrams
+ * that have already been handed out and leave with a single sendmmsg()
+ * just before the last datagram of the batch is handed out.
+ *
+ * The state lives in t->data, which UDP server transports don't use
+ * otherwise.
+ */
+struct udpbase_slot {
+    struct sockaddr_in from;
+    struct iovec    iov;
+    char            cmsg[CMSG_SPACE(cmsg_data_size)];
+    /* queued reply */
+    struct sockaddr_in to;
+    struct in_addr  srcip;
+    int             if_index;
+    struct iovec    reply_iov;
+    char            reply_cmsg[CMSG_SPACE(cmsg_data_size)];
+};
+
+struct udpbase_batch {
+    int             size;        /* number of slots */
+    int             bufsize;     /* bytes per slot buffer */
+    int             received;    /* datagrams read by the last recvmmsg() */
+    int             next;        /* next datagram to hand out */
+    int             queued;      /* replies waiting for sendmmsg() */
+    int             bound;       /* SO_BINDTODEVICE is set */
+    struct sockaddr_in local;
+    /* the following point into the same allocation */
+    struct udpbase_slot *slot;
+    struct mmsghdr *rmsg;
+    struct mmsghdr *smsg;
+    u_char         *buf;
+};
+
+static void
+_udpbase_batch_layout(struct udpbase_batch *b)
+{
+    b->slot = (struct udpbase_slot *)(b + 1);
+    b->rmsg = (struct mmsghdr *)(b->slot + b->size);
+    b->smsg = b->rmsg + b->size;
+    b->buf = (u_char *)(b->smsg + b->size);
+}
+
+/*
+ * Returns the batch state of t, (re)allocating it for bufsize byte
+ * datagrams if necessary, or NULL if t reads one datagram at a time.
+ */
+static struct udpbase_batch *
+_udpbase_batch_get(netsnmp_transport *t, int bufsize)
+{
+    int             size = netsnmp_ds_get_int(NETSNMP_DS_LIBRARY_ID,
+                                              NETSNMP_DS_LIB_UDP_BATCH_SIZE);
+    struct udpbase_batch *b;
+    socklen_t       local_len;
+    size_t          len;
+
+    if (t->local == NULL || t->remote != NULL)
+        return NULL;
+
+    b = (struct udpbase_batch *)t->data;
+    if (b != NULL) {
+        _udpbase_batch_layout(b);
+        if (b->next < b->received || b->queued ||
+            (b->size == size && b->bufsize == bufsize))
+            return b;
+        /* the configuration changed; start over */
+        SNMP_FREE(t->data);
+        t->data_length = 0;
+    }
+    if (size <= 1 || bufsize <= 0)
+        return NULL;
+
+    len = sizeof(*b) + size * (sizeof(struct udpbase_slot) +
+                               2 * sizeof(struct mmsghdr) + bufsize);
+    b = (struct udpbase_batch *)calloc(1, len);
+    if (b == NULL)
+        return NULL;
+    b->size = size;
+    b->bufsize = bufsize;
+    _udpbase_batch_layout(b);
+
+    local_len = sizeof(b->local);
+    if (getsockname(t->sock, (struct sockaddr *)&b->local, &local_len) < 0 ||
+        b->local.sin_family != AF_INET) {
+        free(b);
+        return NULL;
+    }
+#ifdef HAVE_SO_BINDTODEVICE
+    {
+        char            iface[IFNAMSIZ];
+        socklen_t       ifacelen = IFNAMSIZ;
+
+        /* see netsnmp_udpbase_sendto_unix() */
+        b->bound = getsockopt(t->sock, SOL_SOCKET, SO_BINDTODEVICE, iface,
+                              &ifacelen) == 0 && ifacelen > 0;
+    }
+#endif
+
+    DEBUGMSGTL(("udpbase:batch", "fd %d: batches of %d\n", t->sock, size));
+    t->data = b;
+    t->data_length = len;
+    return b;
+}
+
+static void
+_udpbase_batch_flush(netsnmp_transport *t, struct udpbase_batch *b)
+{
+    struct udpbase_slot *s;
+    int             sent = 0, rc;
+
+    while (sent < b->queued) {
+        rc = sendmmsg(t->sock, b->smsg + sent, b->queued - sent,
+                      MSG_DONTWAIT);
+        if (rc > 0) {
+            sent += rc;
+            continue;
+        }
+        if (rc < 0 && errno == EINTR)
+            continue;
+        /* leave the error handling for this one to the regular path */
+        s = &b->slot[sent++];
+        netsnmp_udpbase_sendto(t->sock, &s->srcip, s->if_index,
+                               (struct sockaddr *)&s->to,
+                               s->reply_iov.iov_base, s->reply_iov.iov_len);
+    }
+    DEBUGMSGTL(("udpbase:batch", "fd %d: sent %d replies\n", t->sock,
+                b->queued));
+    b->queued = 0;
+}
+
+static int
+_udpbase_batch_recv(netsnmp_transport *t, struct udpbase_batch *b,
+                    void *buf, int size, netsnmp_indexed_addr_pair *addr_pair)
+{
+    struct udpbase_slot *s;
+    struct msghdr  *m;
+    int             i, rc;
+
+    if (b->next == b->received) {
+        for (i = 0; i < b->size; i++) {
+            s = &b->slot[i];
+            m = &b->rmsg[i].msg_hdr;
+            memset(m, 0, sizeof(*m));
+            s->iov.iov_base = b->buf + i * b->bufsize;
+            s->iov.iov_len = b->bufsize;
+            m->msg_name = &s->from;
+            m->msg_namelen = sizeof(s->from);
+            m->msg_iov = &s->iov;
+            m->msg_iovlen = 1;
+            m->msg_control = s->cmsg;
+            m->msg_controllen = sizeof(s->cmsg);
+        }
+        b->next = b->received = 0;
+        rc = recvmmsg(t->sock, b->rmsg, b->size, MSG_DONTWAIT, NULL);
+        if (rc <= 0)
+            return -1;
+        b->received = rc;
+        DEBUGMSGTL(("udpbase:batch", "fd %d: received %d datagrams\n",
+                    t->sock, rc));
+    }
+
+    i = b->next++;
+    s = &b->slot[i];
+    rc = b->rmsg[i].msg_len;
+    if (rc > size)
+        rc = size;
+    memcpy(buf, s->iov.iov_base, rc);
+    memcpy(&addr_pair->remote_addr, &s->from, sizeof(s->from));
+    memcpy(&addr_pair->local_addr, &b->local, sizeof(b->local));
+    _udpbase_get_dstip(&b->rmsg[i].msg_hdr, &addr_pair->local_addr.sa,
+                       &addr_pair->if_index);
+
+    if (b->next < b->received) {
+        t->flags |= NETSNMP_TRANSPORT_FLAG_PENDING;
+    } else {
+        t->flags &= ~NETSNMP_TRANSPORT_FLAG_PENDING;
+        _udpbase_batch_flush(t, b);
+    }
+    return rc;
+}
+
+/*
+ * Queues a reply while a batch is being processed.  Returns -1 if it has
+ * to be sent right away instead.
+ */
+static int
+_udpbase_batch_send(netsnmp_transport *t, struct udpbase_batch *b,
+                    const netsnmp_indexed_addr_pair *addr_pair,
+                    const void *buf, int size)
+{
+    struct udpbase_slot *s;
+    struct msghdr  *m;
+
+    if (b->bound || size > b->bufsize ||
+        addr_pair->remote_addr.sa.sa_family != AF_INET)
+        return -1;
+    /* only the buffers of datagrams already handed out are free */
+    if (b->queued == b->next)
+        _udpbase_batch_flush(t, b);
+
+    s = &b->slot[b->queued];
+    memcpy(b->buf + b->queued * b->bufsize, buf, size);
+    s->reply_iov.iov_base = b->buf + b->queued * b->bufsize;
+    s->reply_iov.iov_len = size;
+    s->to = addr_pair->remote_addr.sin;
+    s->srcip = addr_pair->local_addr.sin.sin_addr;
+    s->if_index = addr_pair->if_index;
+
+    m = &b->smsg[b->queued].msg_hdr;
+    memset(m, 0, sizeof(*m));
+    m->msg_name = &s->to;
+    m->msg_namelen = sizeof(s->to);
+    m->msg_iov = &s->reply_iov;
+    m->msg_iovlen = 1;
+    if (s->srcip.s_addr != INADDR_ANY) {
+        struct cmsghdr *cm;
+        struct in_pktinfo ipi;
+
+        memset(s->reply_cmsg, 0, sizeof(s->reply_cmsg));
+        m->msg_control = s->reply_cmsg;
+        m->msg_controllen = sizeof(s->reply_cmsg);
+        cm = CMSG_FIRSTHDR(m);
+        cm->cmsg_len = CMSG_LEN(cmsg_data_size);
+        cm->cmsg_level = SOL_IP;
+        cm->cmsg_type = IP_PKTINFO;
+        memset(&ipi, 0, sizeof(ipi));
+#ifdef HAVE_STRUCT_IN_PKTINFO_IPI_SPEC_DST
+        ipi.ipi_spec_dst.s_addr = s->srcip.s_addr;
+#endif
+        memcpy(CMSG_DATA(cm), &ipi, sizeof(ipi));
+    }
+    b->queued++;
+    return size;
+}
+#endif /* HAVE_RECVMMSG && HAVE_SENDMMSG && HAVE_IP_PKTINFO && !WIN32 */
+
 /*
  * You can write something into opaque that will subsequently get passed back 
  * to your send function if you like.  For instance, you might want to
@@ -432,6 +709,9 @@ netsnmp_udpbase_recv(netsnmp_transport *t, void *buf, int size,
     socklen_t       fromlen = sizeof(netsnmp_sockaddr_storage);
     netsnmp_indexed_addr_pair *addr_pair = NULL;
     struct sockaddr *from;
+#ifdef NETSNMP_UDPBASE_BATCH
+    struct udpbase_batch *batch;
+#endif
 
     if (t != NULL && t->sock >= 0) {
         addr_pair = SNMP_MALLOC_TYPEDEF(netsnmp_indexed_addr_pair);
@@ -442,9 +722,17 @@ netsnmp_udpbase_recv(netsnmp_transport *t, void *buf, int size,
         } else
             from = &addr_pair->remote_addr.sa;
 
+#ifdef NETSNMP_UDPBASE_BATCH
+        batch = _udpbase_batch_get(t, size);
+#endif
 	while (rc < 0) {
 #ifdef netsnmp_udpbase_recvfrom_sendto_defined
             socklen_t local_addr_len = sizeof(addr_pair->local_addr);
+#ifdef NETSNMP_UDPBASE_BATCH
+            if (batch != NULL)
+                rc = _udpbase_batch_recv(t, batch, buf, size, addr_pair);
+            else
+#endif
             rc = netsnmp_udp_recvfrom(t->sock, buf, size, from, &fromlen,
                                       &addr_pair->local_addr.sa,
                                       &local_addr_len, &(addr_pair->if_index));
@@ -512,6 +800,15 @@ netsnmp_udpbase_send(netsnmp_transport *t, const void *buf, int size,
                         size, buf, str, t->sock));
             free(str);
         }
+#ifdef NETSNMP_UDPBASE_BATCH
+        if ((t->flags & NETSNMP_TRANSPORT_FLAG_PENDING) && olength != NULL &&
+            *olength == sizeof(netsnmp_indexed_addr_pair)) {
+            rc = _udpbase_batch_send(t, (struct udpbase_batch *)t->data,
+                                     addr_pair, buf, size);
+            if (rc >= 0)
+                return rc;
+        }
+#endif
 	while (rc < 0) {
 #ifdef netsnmp_udpbase_recvfrom_sendto_defined
             rc = netsnmp_udp_sendto(t->sock,
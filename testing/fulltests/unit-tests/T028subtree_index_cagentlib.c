@@ -0,0 +1,80 @@
+/* HEADER Testing the subtree index of the agent registry */
+
+/*
+ * Register a few hundred instances in a shuffled order, unregister some of
+ * them again and verify after each step that looking up the subtree for a
+ * set of OIDs yields the same subtree as walking the subtree list does.
+ */
+
+static oid      base[] = { 1, 3, 6, 1, 3, 327, 0, 0 };
+static oid      probe[MAX_OID_LEN];
+netsnmp_handler_registration *reg[20][20];
+netsnmp_subtree *s, *expected, *found;
+int             i, j, k, n, mismatches;
+
+init_snmp("snmp");
+
+memset(reg, 0, sizeof(reg));
+n = 0;
+for (k = 0; k < 400; k++) {
+    /* visit all (i, j) pairs in a scrambled order */
+    i = (k * 7) % 20;
+    j = (k * 13 / 20 + k) % 20;
+    if (reg[i][j])
+        continue;
+    base[6] = i + 1;
+    base[7] = 2 * j + 1;
+    reg[i][j] = netsnmp_create_handler_registration("subtree-index", NULL,
+                     base, OID_LENGTH(base), HANDLER_CAN_RONLY);
+    if (netsnmp_register_instance(reg[i][j]) == MIB_REGISTERED_OK)
+        n++;
+}
+OKF(n > 0, ("registered %d instances", n));
+
+#define CHECK_LOOKUPS(what)                                             \
+    mismatches = 0;                                                     \
+    for (i = 0; i <= 21; i++) {                                         \
+        for (j = 0; j <= 42; j++) {                                     \
+            memcpy(probe, base, sizeof(base));                          \
+            probe[6] = i;                                               \
+            probe[7] = j;                                               \
+            for (k = 0; k < 3; k++) {                                   \
+                expected = NULL;                                        \
+                for (s = netsnmp_subtree_find_first(""); s; s = s->next) { \
+                    if (snmp_oid_compare(probe, OID_LENGTH(base) + k,   \
+                                         s->start_a, s->start_len) < 0) \
+                        break;                                          \
+                    expected = s;                                       \
+                }                                                       \
+                found = netsnmp_subtree_find_prev(probe,                \
+                                                  OID_LENGTH(base) + k, \
+                                                  NULL, "");            \
+                if (found != expected)                                  \
+                    mismatches++;                                       \
+                probe[OID_LENGTH(base) + k] = k;                        \
+            }                                                           \
+        }                                                               \
+    }                                                                   \
+    OKF(mismatches == 0, ("%s: %d lookup mismatches", what, mismatches))
+
+CHECK_LOOKUPS("after registration");
+
+for (i = 0; i < 20; i++) {
+    for (j = i % 3; j < 20; j += 3) {
+        if (reg[i][j]) {
+            netsnmp_unregister_handler(reg[i][j]);
+            reg[i][j] = NULL;
+        }
+    }
+}
+
+CHECK_LOOKUPS("after unregistration");
+
+for (i = 0; i < 20; i++)
+    for (j = 0; j < 20; j++)
+        if (reg[i][j])
+            netsnmp_unregister_handler(reg[i][j]);
+
+CHECK_LOOKUPS("after unregistering everything");
+
+snmp_shutdown("snmp");
@@ -0,0 +1,39 @@
+/* HEADER Reverse encoding of PDUs with many varbinds */
+#ifdef NETSNMP_USE_REVERSE_ASNENCODING
+netsnmp_pdu *pdu, *parsed;
+netsnmp_variable_list *vp;
+u_char *packet;
+oid name[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 10, 0 };
+size_t packet_len = 64, offset = 0, len;
+long i;
+int rc;
+
+pdu = snmp_pdu_create(SNMP_MSG_RESPONSE);
+pdu->version = SNMP_VERSION_2c;
+for (i = 0; i < 300; i++) {
+    name[OID_LENGTH(name) - 1] = i;
+    snmp_pdu_add_variable(pdu, name, OID_LENGTH(name), ASN_INTEGER,
+                          &i, sizeof(i));
+}
+
+packet = malloc(packet_len);
+rc = snmp_pdu_realloc_rbuild(&packet, &packet_len, &offset, pdu);
+OKF((rc != 0), ("Building a PDU with 300 varbinds failed"));
+
+parsed = snmp_pdu_create(0);
+parsed->version = SNMP_VERSION_2c;
+len = offset;
+rc = snmp_pdu_parse(parsed, packet + packet_len - offset, &len);
+OKF((rc == 0), ("Parsing the PDU failed: %d", rc));
+
+for (vp = parsed->variables, i = 0; vp; vp = vp->next_variable, i++)
+    if (*vp->val.integer != i || vp->name[vp->name_length - 1] != (oid)i)
+        break;
+OKF((i == 300 && vp == NULL), ("Varbind %ld is out of order", i));
+
+snmp_free_pdu(parsed);
+snmp_free_pdu(pdu);
+free(packet);
+#else
+OK(1, "reverse encoding is not enabled");
+#endif
@@ -0,0 +1,49 @@
+/* HEADER OID comparison */
+oid a[40], b[40];
+size_t la, lb, i, diff, off;
+int n, expect, bad = 0, bad_ll = 0, bad_eq = 0, bad_prefix = 0;
+
+srand(42);
+for (n = 0; n < 20000; n++) {
+    la = rand() % 40;
+    lb = rand() % 40;
+    for (i = 0; i < 40; i++)
+        a[i] = b[i] = (oid) (rand() % 3 ? rand() % 100 : ~(oid) 0 - rand() % 3);
+    /* make them differ at a random position, if at all */
+    diff = rand() % 41;
+    if (diff < 40)
+        b[diff] = (rand() & 1) ? a[diff] + 1 : a[diff] - 1;
+
+    /* reference result */
+    expect = 0;
+    for (i = 0; i < la && i < lb; i++) {
+        if (a[i] != b[i]) {
+            expect = a[i] < b[i] ? -1 : 1;
+            break;
+        }
+    }
+    if (!expect && la != lb)
+        expect = la < lb ? -1 : 1;
+
+    if (snmp_oid_compare(a, la, b, lb) != expect)
+        bad++;
+    if (netsnmp_oid_compare_ll(a, la, b, lb, &off) != expect ||
+        off != i + 1)
+        bad_ll++;
+    if ((netsnmp_oid_equals(a, la, b, lb) == 0) != (expect == 0))
+        bad_eq++;
+    if (la && lb && a[0] == b[0] &&
+        netsnmp_oid_find_prefix(a, la, b, lb) != (int) i)
+        bad_prefix++;
+}
+
+OKF(bad == 0, ("snmp_oid_compare: %d mismatches", bad));
+OKF(bad_ll == 0, ("netsnmp_oid_compare_ll: %d mismatches", bad_ll));
+OKF(bad_eq == 0, ("netsnmp_oid_equals: %d mismatches", bad_eq));
+OKF(bad_prefix == 0, ("netsnmp_oid_find_prefix: %d mismatches", bad_prefix));
+
+a[0] = 1; a[1] = 3; a[2] = 6;
+b[0] = 1; b[1] = 3; b[2] = 7;
+OK(snmp_oid_ncompare(a, 3, b, 3, 2) == 0, "ncompare within max_len");
+OK(snmp_oid_ncompare(a, 3, b, 3, 3) < 0, "ncompare past max_len");
+OK(snmp_oid_ncompare(a, 2, b, 3, 3) < 0, "ncompare shorter OID");
@@ -0,0 +1,69 @@
+/* HEADER Mapping of ethtool statistic names to columns */
+#include <net-snmp/agent/mib_module_config.h>
+#ifdef USING_UTIL_FUNCS_ETHTOOL_STATS_MODULE
+#include "util_funcs/ethtool_stats.h"
+
+/*
+ * A stand-in for a driver with many statistics, of which only a few are
+ * known to the consumer. The names have room for one more statistic, for
+ * a second driver of the same name.
+ */
+#define STANDIN_STATS   300
+#define STANDIN_LEN     32
+static const netsnmp_ethtool_name names[] = {
+    { "rx_crc_errors", 1, 0x1 },
+    { "in_broadcast",  0, 0x2 | 0x4 },
+    { "tx_deferred",   0, 0x8 },
+    { NULL, 0, 0 }
+};
+netsnmp_ethtool_driver *d, *d2;
+const netsnmp_ethtool_stat *map, *map2;
+char *strings;
+size_t len, len2;
+int consumer, i;
+
+strings = calloc(STANDIN_STATS + 1, STANDIN_LEN);
+for (i = 0; i < STANDIN_STATS + 1; i++)
+    snprintf(strings + i * STANDIN_LEN, STANDIN_LEN, "queue_%d_packets", i);
+strcpy(strings + 7 * STANDIN_LEN, "port0_rx_crc_errors");
+strcpy(strings + 120 * STANDIN_LEN, "in_broadcast");
+strcpy(strings + 121 * STANDIN_LEN, "in_broadcasts");
+strcpy(strings + 299 * STANDIN_LEN, "tx_deferred");
+
+consumer = netsnmp_ethtool_stats_consumer(names);
+OKF(consumer >= 0, ("consumer registered"));
+OKF(netsnmp_ethtool_stats_consumer(names) == consumer,
+    ("registering a consumer again returns the same index"));
+
+OKF(netsnmp_ethtool_stats_driver("standin", STANDIN_STATS, NULL) == NULL,
+    ("an unknown driver is not found"));
+d = netsnmp_ethtool_stats_driver("standin", STANDIN_STATS, strings);
+OKF(d != NULL, ("driver created"));
+d2 = netsnmp_ethtool_stats_driver("standin", STANDIN_STATS, NULL);
+OKF(d2 == d, ("driver found by name and number of statistics"));
+d2 = netsnmp_ethtool_stats_driver("standin", STANDIN_STATS + 1, strings);
+OKF(d2 != NULL && d2 != d,
+    ("another number of statistics is another driver"));
+
+map = netsnmp_ethtool_stats_map(d, consumer, &len);
+OKF(map != NULL && len == 3, ("three statistics mapped (%d)", (int) len));
+if (map && len == 3) {
+    OKF(map[0].index == 7 && map[0].columns == 0x1,
+        ("substring match: %u 0x%x", map[0].index, map[0].columns));
+    OKF(map[1].index == 120 && map[1].columns == (0x2 | 0x4),
+        ("exact match to two columns: %u 0x%x", map[1].index,
+         map[1].columns));
+    OKF(map[2].index == 299 && map[2].columns == 0x8,
+        ("last statistic: %u 0x%x", map[2].index, map[2].columns));
+}
+
+map2 = netsnmp_ethtool_stats_map(d, consumer, &len2);
+OKF(map2 == map && len2 == len, ("map is built once per driver"));
+
+map = netsnmp_ethtool_stats_map(d, consumer + 1, &len);
+OKF(map == NULL && len == 0, ("no map for an unregistered consumer"));
+
+free(strings);
+#else
+OKF(1, ("ethtool_stats is not compiled in"));
+#endif
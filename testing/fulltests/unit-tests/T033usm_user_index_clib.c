@@ -0,0 +1,107 @@
+/* HEADER Lookup and sorted walk of 100000 USM users */
+#define USERS   100000
+static const u_char engines[2][5] = {
+    { 0x80, 0x00, 0x1f, 0x88, 0x01 },
+    { 0x80, 0x00, 0x1f, 0x88, 0x02 }
+};
+struct usmUser *u, *prev, *found, *twin;
+char name[32];
+int i, n, count, sorted, linked, missing, wrong;
+
+/*
+ * add the users out of order (a stride coprime to the count), so that
+ * the walk has to sort them
+ */
+for (i = 0, n = 0; i < USERS; i++, n = (n + 7919) % USERS) {
+    u = usm_create_user();
+    if (NULL == u)
+        break;
+    snprintf(name, sizeof(name), "user%d", n / 2);
+    u->name = strdup(name);
+    u->secName = strdup(name);
+    u->engineID = netsnmp_memdup(engines[n % 2], sizeof(engines[0]));
+    u->engineIDLen = sizeof(engines[0]);
+    usm_add_user(u);
+}
+OKF(i == USERS, ("added %d users", i));
+
+missing = wrong = 0;
+for (n = 0; n < USERS; n++) {
+    snprintf(name, sizeof(name), "user%d", n / 2);
+    found = usm_get_user(engines[n % 2], sizeof(engines[0]), name);
+    if (NULL == found)
+        missing++;
+    else if (strcmp(found->name, name) != 0 ||
+             memcmp(found->engineID, engines[n % 2], sizeof(engines[0])))
+        wrong++;
+}
+OKF(missing == 0 && wrong == 0,
+    ("all users found (%d missing, %d wrong)", missing, wrong));
+OKF(usm_get_user(engines[0], sizeof(engines[0]), "user50000") == NULL,
+    ("an unknown name is not found"));
+OKF(usm_get_user(engines[0], 4, "user1") == NULL,
+    ("a shorter engineID is not found"));
+
+count = 0;
+sorted = linked = 1;
+for (u = usm_get_userList(), prev = NULL; u; prev = u, u = u->next) {
+    count++;
+    if (u->prev != prev)
+        linked = 0;
+    if (prev && (memcmp(prev->engineID, u->engineID, u->engineIDLen) > 0 ||
+                 (memcmp(prev->engineID, u->engineID, u->engineIDLen) == 0 &&
+                  (strlen(prev->name) > strlen(u->name) ||
+                   (strlen(prev->name) == strlen(u->name) &&
+                    strcmp(prev->name, u->name) >= 0)))))
+        sorted = 0;
+}
+OKF(count == USERS, ("walk returned %d users", count));
+OKF(sorted, ("walk is in usmUserTable order"));
+OKF(linked, ("prev pointers follow the walk"));
+
+/* a user added again replaces the old one in place */
+found = usm_get_user(engines[1], sizeof(engines[1]), "user10");
+twin = usm_create_user();
+twin->name = strdup("user10");
+twin->secName = strdup("user10");
+twin->engineID = netsnmp_memdup(engines[1], sizeof(engines[1]));
+twin->engineIDLen = sizeof(engines[1]);
+prev = found ? found->prev : NULL;
+usm_add_user(twin);
+OKF(usm_get_user(engines[1], sizeof(engines[1]), "user10") == twin,
+    ("a duplicate replaces the user"));
+OKF(prev && prev->next == twin && twin->prev == prev,
+    ("the duplicate takes the place of the user"));
+
+/* remove every other user */
+for (n = 0; n < USERS; n += 2) {
+    snprintf(name, sizeof(name), "user%d", n / 2);
+    u = usm_get_user(engines[0], sizeof(engines[0]), name);
+    usm_remove_user(u);
+    usm_free_user(u);
+}
+missing = wrong = 0;
+for (n = 0; n < USERS; n++) {
+    snprintf(name, sizeof(name), "user%d", n / 2);
+    found = usm_get_user(engines[n % 2], sizeof(engines[0]), name);
+    if (n % 2 == 0 && found)
+        wrong++;
+    if (n % 2 == 1 && !found)
+        missing++;
+}
+OKF(missing == 0 && wrong == 0,
+    ("removed users are gone (%d missing, %d still found)", missing, wrong));
+count = 0;
+for (u = usm_get_userList(); u; u = u->next)
+    count++;
+OKF(count == USERS / 2, ("walk returned %d users after removal", count));
+OKF(usm_remove_user(twin) != NULL && usm_remove_user(twin) == NULL,
+    ("a user can only be removed once"));
+usm_free_user(twin);
+
+while ((u = usm_get_userList()) != NULL) {
+    usm_remove_user(u);
+    usm_free_user(u);
+}
+OKF(usm_get_user(engines[1], sizeof(engines[1]), "user11") == NULL,
+    ("no users left"));
@@ -0,0 +1,72 @@
+/* HEADER Keyed hash contexts of localized authentication keys */
+const netsnmp_auth_alg_info *aai;
+netsnmp_keyed_hash_ctx *ctx;
+u_char key[64], message[484], mac[64], mac2[64];
+size_t len, len2;
+u_int i, tested = 0;
+int rc, rc2;
+
+for (i = 0; i < sizeof(key); i++)
+    key[i] = (u_char) (i * 7 + 1);
+for (i = 0; i < sizeof(message); i++)
+    message[i] = (u_char) (i * 13);
+
+for (i = 0; (aai = sc_get_auth_alg_byindex(i)) != NULL; i++) {
+    if (aai->mac_length <= 0)
+        continue;
+    ctx = sc_keyed_hash_ctx_new(aai->alg_oid, aai->oid_len, key,
+                                aai->proper_length);
+    if (NULL == ctx)
+        continue;           /* not supported by this crypto library */
+    tested++;
+
+    len = len2 = sizeof(mac);
+    rc = sc_generate_keyed_hash(aai->alg_oid, aai->oid_len, key,
+                                aai->proper_length, message,
+                                sizeof(message), mac, &len);
+    rc2 = sc_generate_keyed_hash_ctx(ctx, message, sizeof(message), mac2,
+                                     &len2);
+    OKF(rc == SNMPERR_SUCCESS && rc2 == SNMPERR_SUCCESS && len == len2 &&
+        memcmp(mac, mac2, len) == 0,
+        ("%s: same hash as sc_generate_keyed_hash (%d bytes)", aai->name,
+         (int) len2));
+
+    /* a second message through the same context */
+    len = len2 = sizeof(mac);
+    sc_generate_keyed_hash(aai->alg_oid, aai->oid_len, key,
+                           aai->proper_length, message, 100, mac, &len);
+    sc_generate_keyed_hash_ctx(ctx, message, 100, mac2, &len2);
+    OKF(len == len2 && memcmp(mac, mac2, len) == 0,
+        ("%s: context is reusable", aai->name));
+
+    OKF(sc_check_keyed_hash_ctx(ctx, message, 100, mac2,
+                                aai->mac_length) == SNMPERR_SUCCESS,
+        ("%s: truncated hash checks", aai->name));
+    mac2[0] ^= 1;
+    OKF(sc_check_keyed_hash_ctx(ctx, message, 100, mac2,
+                                aai->mac_length) != SNMPERR_SUCCESS,
+        ("%s: wrong hash does not check", aai->name));
+
+    OKF(sc_keyed_hash_ctx_matches(ctx, aai->alg_oid, aai->oid_len, key,
+                                  aai->proper_length),
+        ("%s: context matches its key", aai->name));
+    key[0] ^= 1;
+    OKF(!sc_keyed_hash_ctx_matches(ctx, aai->alg_oid, aai->oid_len, key,
+                                   aai->proper_length),
+        ("%s: context does not match another key", aai->name));
+    key[0] ^= 1;
+
+    /* the context lives until its last reference is dropped */
+    OKF(sc_keyed_hash_ctx_ref(ctx) == ctx, ("%s: referenced", aai->name));
+    sc_keyed_hash_ctx_free(ctx);
+    len2 = sizeof(mac2);
+    OKF(sc_generate_keyed_hash_ctx(ctx, message, 100, mac2, &len2) ==
+        SNMPERR_SUCCESS, ("%s: usable after dropping a reference",
+                          aai->name));
+    sc_keyed_hash_ctx_free(ctx);
+}
+OKF(tested > 0, ("%u authentication protocols tested", tested));
+
+OKF(sc_keyed_hash_ctx_new(usmHMACSHA1AuthProtocol,
+                          OID_LENGTH(usmHMACSHA1AuthProtocol), key, 4) == NULL,
+    ("a short key is refused"));
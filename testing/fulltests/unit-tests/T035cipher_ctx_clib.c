@@ -0,0 +1,76 @@
+/* HEADER Cipher contexts of localized privacy keys */
+const netsnmp_priv_alg_info *pai;
+netsnmp_cipher_ctx *ctx;
+u_char key[64], iv[32], message[485], ct[512], ct2[512], buf[512];
+size_t len, len2;
+u_int i, tested = 0;
+int rc, rc2;
+
+for (i = 0; i < sizeof(key); i++)
+    key[i] = (u_char) (i * 7 + 1);
+for (i = 0; i < sizeof(iv); i++)
+    iv[i] = (u_char) (i * 3 + 5);
+for (i = 0; i < sizeof(message); i++)
+    message[i] = (u_char) (i * 13);
+
+for (i = 0; (pai = sc_get_priv_alg_byindex(i)) != NULL; i++) {
+    if (pai->proper_length <= 0)
+        continue;
+    ctx = sc_cipher_ctx_new(pai->alg_oid, pai->oid_len, key,
+                            pai->proper_length);
+    if (NULL == ctx)
+        continue;
+    tested++;
+
+    len = len2 = sizeof(ct);
+    rc = sc_encrypt(pai->alg_oid, pai->oid_len, key, pai->proper_length,
+                    iv, pai->iv_length, message, sizeof(message), ct, &len);
+    rc2 = sc_encrypt_ctx(ctx, iv, pai->iv_length, message, sizeof(message),
+                         ct2, &len2);
+    OKF(rc == SNMPERR_SUCCESS && rc2 == SNMPERR_SUCCESS && len == len2 &&
+        memcmp(ct, ct2, len) == 0,
+        ("%s: same ciphertext as sc_encrypt (%d bytes)", pai->name,
+         (int) len2));
+
+    /* encrypt again in place, with the padding room after the plaintext */
+    memcpy(buf, message, sizeof(message));
+    len2 = sizeof(buf);
+    rc2 = sc_encrypt_ctx(ctx, iv, pai->iv_length, buf, sizeof(message),
+                         buf, &len2);
+    OKF(rc2 == SNMPERR_SUCCESS && len == len2 && memcmp(ct, buf, len) == 0,
+        ("%s: context is reusable and encrypts in place", pai->name));
+
+    len2 = sizeof(buf);
+    rc2 = sc_decrypt_ctx(ctx, iv, pai->iv_length, buf, len, buf, &len2);
+    OKF(rc2 == SNMPERR_SUCCESS && len2 == len &&
+        memcmp(buf, message, sizeof(message)) == 0,
+        ("%s: decrypts in place", pai->name));
+
+    len2 = sizeof(buf);
+    rc = sc_decrypt(pai->alg_oid, pai->oid_len, key, pai->proper_length,
+                    iv, pai->iv_length, ct, len, ct2, &len2);
+    OKF(rc == SNMPERR_SUCCESS && memcmp(ct2, message, sizeof(message)) == 0,
+        ("%s: sc_decrypt reads the ciphertext", pai->name));
+
+    OKF(sc_cipher_ctx_matches(ctx, pai->alg_oid, pai->oid_len, key,
+                              pai->proper_length),
+        ("%s: context matches its key", pai->name));
+    key[0] ^= 1;
+    OKF(!sc_cipher_ctx_matches(ctx, pai->alg_oid, pai->oid_len, key,
+                               pai->proper_length),
+        ("%s: context does not match another key", pai->name));
+    key[0] ^= 1;
+
+    /* the context lives until its last reference is dropped */
+    OKF(sc_cipher_ctx_ref(ctx) == ctx, ("%s: referenced", pai->name));
+    sc_cipher_ctx_free(ctx);
+    len2 = sizeof(ct2);
+    OKF(sc_encrypt_ctx(ctx, iv, pai->iv_length, message, 16, ct2, &len2) ==
+        SNMPERR_SUCCESS, ("%s: usable after dropping a reference",
+                          pai->name));
+    sc_cipher_ctx_free(ctx);
+}
+OKF(tested > 0, ("%u privacy protocols tested", tested));
+
+OKF(sc_cipher_ctx_new(usmAESPrivProtocol, OID_LENGTH(usmAESPrivProtocol),
+                      key, 4) == NULL, ("a short key is refused"));
@@ -0,0 +1,81 @@
+/* HEADER Reuse of the session send buffer */
+
+SOCK_STARTUP;
+
+netsnmp_session session, *ss;
+netsnmp_pdu *pdu, *parsed;
+netsnmp_variable_list *vp;
+struct sockaddr_in addr;
+socklen_t addr_len = sizeof(addr);
+oid name[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 10, 0 };
+u_char buf[65536], community[64], *data;
+u_char public[] = "public";
+size_t len, community_len;
+long version, n, i;
+char peer[64];
+int sd, rc, round, bad = 0;
+
+init_snmp("testing");
+
+sd = socket(AF_INET, SOCK_DGRAM, 0);
+memset(&addr, 0, sizeof(addr));
+addr.sin_family = AF_INET;
+addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+rc = bind(sd, (struct sockaddr *) &addr, sizeof(addr));
+OKF((rc == 0), ("Binding the receiving socket failed"));
+getsockname(sd, (struct sockaddr *) &addr, &addr_len);
+
+snmp_sess_init(&session);
+session.version = SNMP_VERSION_2c;
+snprintf(peer, sizeof(peer), "udp:127.0.0.1:%d", ntohs(addr.sin_port));
+session.peername = peer;
+session.community = public;
+session.community_len = sizeof(public) - 1;
+ss = snmp_open(&session);
+OKF((ss != NULL), ("Creating a session failed"));
+
+/*
+ * A large PDU, enough small ones for the session to give up its large
+ * buffer, and a large one again: every packet must carry exactly its
+ * own varbinds, whichever buffer it was built in.
+ */
+for (round = 0; ss && round < 22; round++) {
+    n = (round == 0 || round == 21) ? 100 : 1 + round % 3;
+    pdu = snmp_pdu_create(SNMP_MSG_TRAP2);
+    for (i = 0; i < n; i++) {
+        name[OID_LENGTH(name) - 1] = i;
+        snmp_pdu_add_variable(pdu, name, OID_LENGTH(name), ASN_INTEGER,
+                              &i, sizeof(i));
+    }
+    if (snmp_send(ss, pdu) == 0) {
+        snmp_free_pdu(pdu);
+        bad++;
+        continue;
+    }
+
+    len = recv(sd, buf, sizeof(buf), 0);
+    community_len = sizeof(community);
+    data = snmp_comstr_parse(buf, &len, community, &community_len,
+                             &version);
+    parsed = snmp_pdu_create(0);
+    parsed->version = SNMP_VERSION_2c;
+    if (data == NULL || snmp_pdu_parse(parsed, data, &len) != 0) {
+        snmp_free_pdu(parsed);
+        bad++;
+        continue;
+    }
+    for (vp = parsed->variables, i = 0; vp; vp = vp->next_variable, i++)
+        if (*vp->val.integer != i || vp->name[vp->name_length - 1] != (oid)i)
+            break;
+    if (vp != NULL || i != n)
+        bad++;
+    snmp_free_pdu(parsed);
+}
+OKF((bad == 0), ("%d of 22 packets were not sent or not as built", bad));
+
+if (ss)
+    snmp_close(ss);
+close(sd);
+snmp_shutdown("testing");
+
+SOCK_CLEANUP;
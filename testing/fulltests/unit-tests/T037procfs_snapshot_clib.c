@@ -0,0 +1,60 @@
+/* HEADER Lines of a /proc file snapshot */
+#include <net-snmp/agent/mib_module_config.h>
+#ifdef USING_UTIL_FUNCS_PROCFS_SNAPSHOT_MODULE
+#include "util_funcs/procfs_snapshot.h"
+
+static const char contents[] =
+    "Ip: Forwarding InReceives\n"
+    "Ip: 2 1149370\n"
+    "\n"
+    "IpExt: InOctets";           /* the last line has no newline */
+char path[] = "/tmp/snmp-procfs-XXXXXX";
+netsnmp_procfs_view view;
+const char *line;
+size_t len;
+int fd, rc;
+
+fd = mkstemp(path);
+OKF(fd >= 0, ("temporary file created"));
+if (fd >= 0) {
+    rc = write(fd, contents, sizeof(contents) - 1);
+    close(fd);
+    OKF(rc == sizeof(contents) - 1, ("temporary file written"));
+
+    rc = netsnmp_procfs_snapshot(path, &view);
+    OKF(rc == 0 && view.len == sizeof(contents) - 1,
+        ("snapshot of %d bytes", (int) view.len));
+
+    line = netsnmp_procfs_getline(&view, &len);
+    OKF(line == view.data && len == 25,
+        ("first line in place, without the newline (%d)", (int) len));
+    line = netsnmp_procfs_getline(&view, &len);
+    OKF(line == view.data + 26 && len == 13 &&
+        memcmp(line, "Ip: 2 1149370", 13) == 0,
+        ("second line: '%.*s'", (int) len, line));
+    line = netsnmp_procfs_getline(&view, &len);
+    OKF(line == view.data + 40 && len == 0, ("empty line (%d)", (int) len));
+    line = netsnmp_procfs_getline(&view, &len);
+    OKF(line != NULL && len == 15 && memcmp(line, "IpExt: InOctets", 15) == 0,
+        ("last line without a newline (%d)", (int) len));
+    line = netsnmp_procfs_getline(&view, &len);
+    OKF(line == NULL, ("no line after the end of the data"));
+
+    line = netsnmp_procfs_find_line(&view, "IpExt:");
+    OKF(line == view.data + 41, ("line found by prefix"));
+    line = netsnmp_procfs_find_line(&view, "Tcp:");
+    OKF(line == NULL, ("no line for a missing prefix"));
+
+    /* a second snapshot within the age limit is the same data */
+    unlink(path);
+    rc = netsnmp_procfs_snapshot(path, &view);
+    OKF(rc == 0 && view.len == sizeof(contents) - 1,
+        ("recent snapshot is reused"));
+
+    netsnmp_procfs_forget(path);
+    rc = netsnmp_procfs_snapshot(path, &view);
+    OKF(rc < 0, ("a forgotten file is read again"));
+}
+#else
+OKF(1, ("procfs_snapshot is not compiled in"));
+#endif
@@ -109,6 +109,10 @@ SOURCE=..\..\agent\agent_trap.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\agent\agent_workers.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\agent\helpers\all_helpers.c
 # End Source File
 # Begin Source File
@@ -249,6 +253,10 @@ SOURCE="..\..\include\net-snmp\agent\agent_trap.h"
 # End Source File
 # Begin Source File
 
+SOURCE="..\..\include\net-snmp\agent\agent_workers.h"
+# End Source File
+# Begin Source File
+
 SOURCE="..\..\include\net-snmp\agent\all_helpers.h"
 # End Source File
 # Begin Source File
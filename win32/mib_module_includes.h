@@ -97,6 +97,7 @@
 #include "mibgroup/target/target_counters.h"
 #include "mibgroup/agent/nsTransactionTable.h"
 #include "mibgroup/agent/nsModuleTable.h"
+#include "mibgroup/agent/nsListenerTable.h"
 #include "mibgroup/agent/nsDebug.h"
 #include "mibgroup/agent/nsCache.h"
 #include "mibgroup/agent/nsLogging.h"
@@ -57,6 +57,7 @@
   if (should_init("target_counters")) init_target_counters();
   if (should_init("nsTransactionTable")) init_nsTransactionTable();
   if (should_init("nsModuleTable")) init_nsModuleTable();
+  if (should_init("nsListenerTable")) init_nsListenerTable();
   if (should_init("nsDebug")) init_nsDebug();
   if (should_init("nsCache")) init_nsCache();
   if (should_init("nsLogging")) init_nsLogging();
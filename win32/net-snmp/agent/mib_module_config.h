@@ -204,6 +204,9 @@
 /* Define if compiling with the agent/nsModuleTable module files.  */
 #define USING_AGENT_NSMODULETABLE_MODULE 1
  
+/* Define if compiling with the agent/nsListenerTable module files.  */
+#define USING_AGENT_NSLISTENERTABLE_MODULE 1
+ 
 /* Define if compiling with the agent/nsDebug module files.  */
 #define USING_AGENT_NSDEBUG_MODULE 1
  
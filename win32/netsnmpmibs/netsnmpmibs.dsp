@@ -415,6 +415,10 @@ SOURCE=..\..\agent\mibgroup\agent\nsModuleTable.c
 
 SOURCE=..\..\agent\mibgroup\agent\nsTransactionTable.c
 # End Source File
+# Begin Source File
+
+SOURCE=..\..\agent\mibgroup\agent\nsListenerTable.c
+# End Source File
 # End Group
 # Begin Group "utilities"
 